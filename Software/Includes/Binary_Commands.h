@@ -0,0 +1,53 @@
+/** @file Binary_Commands.h
+ * Execute compact binary I2C and SPI transaction frames, intended to be used by automation tools rather than by humans.
+ * A request frame is a sequence of operations, each operation is made of an opcode optionally followed by a bytes count and the data bytes to write.
+ * The response frame starts with a status byte, followed by all the bytes read by the operations in their execution order.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_BINARY_COMMANDS_H
+#define H_BINARY_COMMANDS_H
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** The maximum size in bytes of a response frame, including the status byte. */
+#define BINARY_COMMANDS_MAXIMUM_RESPONSE_SIZE 63 // This is one byte less than a full-speed bulk packet, so a response always ends the USB transfer with a short packet
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** All supported operations. */
+typedef enum : unsigned char
+{
+	BINARY_COMMANDS_OPCODE_I2C_GENERATE_START = 0x01, //!< Generate a START, or a REPEATED START if a START has already been generated by the frame.
+	BINARY_COMMANDS_OPCODE_I2C_GENERATE_STOP = 0x02, //!< Generate a STOP.
+	BINARY_COMMANDS_OPCODE_I2C_WRITE = 0x03, //!< Followed by the bytes count and the bytes to write.
+	BINARY_COMMANDS_OPCODE_I2C_READ = 0x04, //!< Followed by the bytes count. The last read byte is not acknowledged.
+	BINARY_COMMANDS_OPCODE_SPI_SELECT_SLAVE = 0x10, //!< Assert the slave select signal.
+	BINARY_COMMANDS_OPCODE_SPI_DESELECT_SLAVE = 0x11, //!< Release the slave select signal.
+	BINARY_COMMANDS_OPCODE_SPI_TRANSFER = 0x12 //!< Followed by the bytes count and the bytes to write, the received bytes are appended to the response.
+} TBinaryCommandsOpcode;
+
+/** The response status byte values. */
+typedef enum : unsigned char
+{
+	BINARY_COMMANDS_STATUS_SUCCESS = 0, //!< All operations have been executed.
+	BINARY_COMMANDS_STATUS_UNKNOWN_OPCODE = 1, //!< The frame contains an unsupported opcode, nothing has been executed.
+	BINARY_COMMANDS_STATUS_TRUNCATED_FRAME = 2, //!< An operation bytes count or its data bytes are missing, nothing has been executed.
+	BINARY_COMMANDS_STATUS_RESPONSE_TOO_LONG = 3, //!< The operations would read more data than a response frame can hold, nothing has been executed.
+	BINARY_COMMANDS_STATUS_I2C_NOT_ACKNOWLEDGED = 4, //!< An I2C slave did not acknowledge a written byte, the execution has been stopped here (the response contains the data read so far).
+	BINARY_COMMANDS_STATUS_CORRUPTED_FRAME = 5 //!< The frame transport detected a wrong checksum or an oversized frame, nothing has been executed. Only the serial port binary protocol reports it (see Binary_Protocol.h).
+} TBinaryCommandsStatus;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Validate then execute all operations of a request frame.
+ * @param Pointer_Request The request frame.
+ * @param Request_Size The request frame size in bytes.
+ * @param Pointer_Response On output, contain the response frame. The buffer must be at least BINARY_COMMANDS_MAXIMUM_RESPONSE_SIZE bytes large.
+ * @return The response frame size in bytes (it is always at least 1, because of the status byte).
+ */
+unsigned char BinaryCommandsExecuteFrame(unsigned char *Pointer_Request, unsigned char Request_Size, unsigned char *Pointer_Response);
+
+#endif
@@ -0,0 +1,29 @@
+/** @file Binary_Protocol.h
+ * Exchange binary command frames (see Binary_Commands.h) on the shell serial port, so automation tools do not need to type text commands and to parse the text dumps back.
+ * The host enters the binary mode by sending BINARY_PROTOCOL_MAGIC_SEQUENCE while the shell is in machine mode (see the "shell-mode" command) and waits for a command line. The device answers with the same sequence, all data received by the host before it belong to the text mode and must be discarded.
+ * Each request and response is then framed this way : the payload size (1 byte), the payload, the CRC-16/CCITT-FALSE of the size and the payload (2 bytes, little-endian).
+ * A request payload is a binary commands request frame. A response payload is a binary commands response frame : the status byte followed by the read bytes.
+ * A request with an empty payload leaves the binary mode, it is answered by an empty response before the shell waits for the next command line in machine mode. The binary mode is also left when the host closes the port, which also brings the shell back to the interactive mode.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_BINARY_PROTOCOL_H
+#define H_BINARY_PROTOCOL_H
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** The control characters that switch the shell to the binary mode. A keyboard can produce them (they are Ctrl+P and Ctrl+B, which are used by the terminals line edition), so they are only looked for in machine mode, where the shell input comes from a program. */
+#define BINARY_PROTOCOL_MAGIC_SEQUENCE "\x10\x02\x10\x02"
+
+/** The largest request payload in bytes. A larger payload is discarded and answered with the BINARY_COMMANDS_STATUS_CORRUPTED_FRAME status. */
+#define BINARY_PROTOCOL_MAXIMUM_REQUEST_PAYLOAD_SIZE 64
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Execute the request frames received on the shell port until the host leaves the binary mode.
+ * @note Call this function right after the magic sequence has been received.
+ */
+void BinaryProtocolRun(void);
+
+#endif
@@ -0,0 +1,58 @@
+/** @file Link.h
+ * Follow the USB link from the power-up to the first shell command, and measure how long each step took.
+ * A free-running boot clock is started as early as possible, then each time the link reaches a new state for the first time, its time is recorded. The boot clock is stopped once the first command has been received, as there is nothing left to measure.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_LINK_H
+#define H_LINK_H
+
+#include <xc.h>
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** Tell whether the boot clock interrupt needs to be serviced. */
+#define LINK_IS_BOOT_CLOCK_INTERRUPT_FIRED() (PIE2bits.TMR3IE && PIR2bits.TMR3IF) // Check the interrupt enabled bit, because it is cleared to atomically read the boot clock while another low-priority interrupt can still fire
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** All link states, in the order they are reached after a power-up. */
+typedef enum : unsigned char
+{
+	LINK_STATE_POWERED, //!< The firmware is running and the USB module is attached to the bus.
+	LINK_STATE_DEFAULT, //!< The host has reset the bus.
+	LINK_STATE_ADDRESSED, //!< The host has assigned an address to the device.
+	LINK_STATE_CONFIGURED, //!< The host has configured the device, its drivers can now use it.
+	LINK_STATE_SHELL_OPENED, //!< A terminal has opened the shell port (it has set the DTR signal).
+	LINK_STATE_FIRST_COMMAND_RECEIVED, //!< The shell has received the first command line.
+	LINK_STATES_COUNT //!< Not a state, this is the amount of states.
+} TLinkState;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Start the boot clock. Call this function as soon as the system clock is stable. */
+void LinkInitialize(void);
+
+/** Must be called by the low-priority interrupt handler when the boot clock overflows. */
+void LinkBootClockInterruptHandler(void);
+
+/** Retrieve the current link state from the USB stack, and record the time of each newly reached state.
+ * @return The current link state. It can go back to a previous state, like when the host resets the bus.
+ * @note This function never blocks, so it can be polled while waiting for the link to reach a given state.
+ */
+TLinkState LinkUpdateState(void);
+
+/** Tell that the shell has received a command line, the first call records the time to first command and stops the boot clock. */
+void LinkSignalCommandReceived(void);
+
+/** Tell when a link state has been reached for the first time.
+ * @param State The state to retrieve the time of.
+ * @param Pointer_Milliseconds_Count On output, the amount of milliseconds elapsed between the boot clock start and the first time the state was reached.
+ * @return 0 if the state has been reached,
+ * @return 1 if the state has never been reached yet.
+ */
+unsigned char LinkGetStateTime(TLinkState State, unsigned long *Pointer_Milliseconds_Count);
+
+#endif
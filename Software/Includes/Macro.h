@@ -0,0 +1,93 @@
+/** @file Macro.h
+ * Store sequences of shell command lines in the data EEPROM, so they can be replayed on the device without paying an USB round trip for each command.
+ * The macros are stored one after the other from the EEPROM beginning, each one is made of its name length, its name, its body size and its body. The body holds the command lines tokens separated by a single space, and each command line is terminated by a '\r' character (except the last one). The macros list is terminated by an erased byte.
+ * To make the 256-byte EEPROM hold realistic device initialization sequences, the I2C and SPI transaction commands are not stored as text but as binary operations (see Binary_Commands.h), which are turned back into text when the macro is read. Such an operation is not separated from the surrounding tokens, its opcode can't be mistaken for a text character because it is a control character. Consecutive write operations are merged into a single one.
+ * For instance "i2c [ h50 h01 h80 ]" takes 11 bytes (including the command line terminating character) instead of 20, so 20 of these command lines fit in a single macro.
+ * A new macro is written after the last one and the list end is moved at the very end, so an interrupted recording does not corrupt the stored macros.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_MACRO_H
+#define H_MACRO_H
+
+#include <Binary_Commands.h>
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** How many characters a macro name can contain. */
+#define MACRO_MAXIMUM_NAME_LENGTH 8
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Start recording a new macro.
+ * @param Pointer_String_Name The macro name, it does not need to be zero-terminated.
+ * @param Name_Length The name length, it must be in range [1, MACRO_MAXIMUM_NAME_LENGTH].
+ * @return 0 on success,
+ * @return 1 if the EEPROM is full.
+ */
+unsigned char MacroRecordBegin(char *Pointer_String_Name, unsigned char Name_Length);
+
+/** Start a new command line in the macro being recorded.
+ * @param Pointer_String_Command The command name, it does not need to be zero-terminated.
+ * @param Length The command name length.
+ * @return 0 on success,
+ * @return 1 if the EEPROM is full.
+ */
+unsigned char MacroRecordCommand(char *Pointer_String_Command, unsigned char Length);
+
+/** Append an argument to the command line being recorded.
+ * @param Pointer_String_Argument The argument, it does not need to be zero-terminated.
+ * @param Length The argument length.
+ * @return 0 on success,
+ * @return 1 if the EEPROM is full.
+ */
+unsigned char MacroRecordArgument(char *Pointer_String_Argument, unsigned char Length);
+
+/** Append a transaction command to the command line being recorded, in its binary form.
+ * @param Opcode The operation, only the I2C and SPI transaction operations are supported.
+ * @param Data The byte to write for a BINARY_COMMANDS_OPCODE_I2C_WRITE or a BINARY_COMMANDS_OPCODE_SPI_TRANSFER operation, the bytes count for a BINARY_COMMANDS_OPCODE_I2C_READ operation, it is ignored by the other operations.
+ * @return 0 on success,
+ * @return 1 if the EEPROM is full.
+ * @note A written byte following another written byte is appended to the same operation.
+ */
+unsigned char MacroRecordOperation(TBinaryCommandsOpcode Opcode, unsigned char Data);
+
+/** Make the recorded macro available. A stored macro with the same name is replaced, or deleted if no command line has been recorded.
+ * @return 0 if the macro has been stored,
+ * @return 1 if the macro with the same name has been deleted,
+ * @return 2 if no command line has been recorded and no macro has the same name.
+ */
+unsigned char MacroRecordEnd(void);
+
+/** Find a macro from its name.
+ * @param Pointer_String_Name The macro name, it does not need to be zero-terminated.
+ * @param Name_Length The name length.
+ * @param Pointer_Index On output, contain the macro index.
+ * @return 0 if the macro has been found,
+ * @return 1 if no macro has this name.
+ */
+unsigned char MacroFind(char *Pointer_String_Name, unsigned char Name_Length, unsigned char *Pointer_Index);
+
+/** Select the macro to read the command lines of with MacroReadCharacter().
+ * @param Index The macro index, the macros are indexed in the order they have been recorded.
+ * @param Pointer_String_Name On output, contain the zero-terminated macro name. The buffer must be MACRO_MAXIMUM_NAME_LENGTH + 1 bytes large. Set to NULL if the name is not needed.
+ * @return 0 if the macro has been selected,
+ * @return 1 if no macro has this index.
+ */
+unsigned char MacroSelect(unsigned char Index, char *Pointer_String_Name);
+
+/** Read the next character of the selected macro command lines. Each command line is terminated by a '\r' character.
+ * @param Pointer_Character On output, contain the next character.
+ * @return 0 if more characters follow,
+ * @return 1 if this was the last character.
+ * @note This function can be directly used as a shell input source (see ShellSetInputSource()).
+ */
+unsigned char MacroReadCharacter(char *Pointer_Character);
+
+/** Tell how much EEPROM is left to record macros.
+ * @return The amount of free bytes, the name and the body size of a macro take their share of it.
+ */
+unsigned char MacroGetFreeBytesCount(void);
+
+#endif
@@ -7,14 +7,84 @@
 
 #include <Shell_Commands.h>
 
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** How many bus transaction commands are validated before being executed. A longer transaction is executed one window at a time, so its length is not limited. A repeat loop body is replayed from a single window, so it can't contain more commands. */
+#define SHELL_TRANSACTION_WINDOW_SIZE 16
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** How the shell talks to the host. */
+typedef enum : unsigned char
+{
+	SHELL_MODE_INTERACTIVE, //!< Display a prompt, echo the typed characters and allow to edit the command line. This is the mode for a human using a terminal.
+	SHELL_MODE_MACHINE //!< Do not display a prompt nor echo the received characters, and terminate the output of each command with a status line (see ShellWriteStatusLine()). This is the mode for a program sending many commands back to back.
+} TShellMode;
+
+/** Provide the characters of command lines that are replayed instead of being received from the shell port.
+ * @param Pointer_Character On output, contain the next character. Each command line must be terminated by a '\r' character.
+ * @return 0 if more characters follow,
+ * @return 1 if this was the last character, the next characters are received from the shell port again.
+ */
+typedef unsigned char (*TShellInputSourceCallback)(char *Pointer_Character);
+
+/** Parse a single bus transaction command and store it to the window slot provided by ShellReadTransactionWindow().
+ * @param Pointer_String_Command The command (it is not zero-terminated).
+ * @param Length The command length.
+ * @param Pointer_Command The window slot to fill, its type is only known by the bus command.
+ * @return 0 if the command is valid,
+ * @return 1 if the command is invalid, an error message has been displayed.
+ */
+typedef unsigned char (*TShellTransactionCommandParserCallback)(char *Pointer_String_Command, unsigned char Length, void *Pointer_Command);
+
+/** The state of a bus transaction being parsed one window at a time. */
+typedef struct
+{
+	unsigned char Commands_Count; //!< How many commands the last parsed window contains.
+	unsigned char Is_Repeat_Loop_Body; //!< Tell whether the last parsed window is a repeat loop body.
+	unsigned char Is_Repeat_Loop_Pending; //!< Tell whether a repeat loop header ended the last parsed window, so the next window is the loop body.
+	unsigned char Is_Command_Line_End_Reached; //!< Tell whether the last parsed window ends the transaction.
+	unsigned long Repeat_Loop_Iterations_Count; //!< How many times the repeat loop body must be executed.
+	unsigned short Repeat_Loop_Delay; //!< The delay in milliseconds to wait between two repeat loop iterations.
+} TShellTransactionWindow;
+
 //-------------------------------------------------------------------------------------------------
 // Functions
 //-------------------------------------------------------------------------------------------------
+/** Check the shell commands table when the logs are enabled : the commands that are not sorted by strictly ascending name order (see SHELL_COMMANDS_COUNT) are reported, because the shell can't find them. This function does nothing when the logs are disabled. */
+void ShellInitialize(void);
+
+/** Select how the shell talks to the host. The shell goes back to the interactive mode when the host closes the shell port, so a terminal opened after a program always gets the interactive shell.
+ * @param Mode The new mode.
+ */
+void ShellSetMode(TShellMode Mode);
+
+/** Replay the command lines provided by an input source, they are executed by the usual ShellReadCommandLine() and ShellProcessCommand() loop without echo nor prompt.
+ * @param Input_Source_Callback Provide the command lines characters.
+ * @note Call this function from a command callback. The status line of this command and the ones of the replayed command lines are merged into a single status line (see ShellWriteStatusLine()).
+ */
+void ShellSetInputSource(TShellInputSourceCallback Input_Source_Callback);
+
 /** Block until a command line is entered by the user (note that the returned command line can be empty).
  * @param Pointer_String_Command_Line On output, will contain the command line typed by the user.
  * @param Maximum_Length The command line string buffer size, including the terminating zero character.
+ * @return 0 if a command line has been entered,
+ * @return 1 if the host sent the binary mode magic sequence in machine mode (see Binary_Protocol.h), the command line is empty in this case.
+ * @note When the user types more characters than the buffer can hold, this function returns as soon as the buffer is full. The end of the command line is then received by ShellReadNextArgument(), or discarded by ShellProcessCommand().
+ */
+unsigned char ShellReadCommandLine(char *Pointer_String_Command_Line, unsigned char Maximum_Length);
+
+/** Retrieve the next argument of the command being executed. When the command line did not fit in the buffer, its end is received while the arguments are consumed, so a command can process an arbitrarily long arguments list with a constant memory usage.
+ * @param Pointer_Pointer_String_Argument On output, point to the argument. It is not zero-terminated, but the character following it can be temporarily overwritten (see ShellConvertNumericalArgumentToBinary()).
+ * @param Pointer_Length On output, contain the argument length.
+ * @return 0 if an argument has been retrieved,
+ * @return 1 if the end of the command line has been reached,
+ * @return 2 if an argument is too long to fit in the command line buffer or if the user cancelled the end of the command line.
+ * @note This function can only be called by the commands that stream their arguments (see TShellCommand). The retrieved argument is valid until the next call.
  */
-void ShellReadCommandLine(char *Pointer_String_Command_Line, unsigned char Maximum_Length);
+unsigned char ShellReadNextArgument(char **Pointer_Pointer_String_Argument, unsigned char *Pointer_Length);
 
 /** Process a string by discarding the separating characters (mostly space) and find the first meaningful token word.
  * @param Pointer_String_Command_Line On the first call, provide the command line as retrieved with a call to ShellReadCommandLine(). On the following calls, provide the previous result returned by this function call (in order to update the beginning of the next token).
@@ -25,14 +95,31 @@ void ShellReadCommandLine(char *Pointer_String_Command_Line, unsigned char Maxim
  */
 char *ShellExtractNextToken(char *Pointer_String_Command_Line, unsigned char *Pointer_Token_Length);
 
+/** Find a command in the commands table.
+ * @param Pointer_String_Command The command name, it does not need to be zero-terminated.
+ * @param Length The command name length.
+ * @return NULL if the command does not exist,
+ * @return A pointer on the command description.
+ */
+const TShellCommand *ShellFindCommand(char *Pointer_String_Command, unsigned char Length);
+
 /** Determine which command the user has typed in the shell and execute it.
  * @param Pointer_String_Command_Line The command line as retrieved by ShellReadCommandLine().
  * @return 0 if the command was successfully executed,
  * @return 1 if no matching command was found,
- * @return 2 if the command was found but its execution callback was missing.
+ * @return 2 if the command was found but its execution callback was missing,
+ * @return 3 if the command failed.
  */
 unsigned char ShellProcessCommand(char *Pointer_String_Command_Line);
 
+/** Terminate the output of a command with a status line when the shell is in machine mode, so a program can send the next command without waiting for a prompt. Nothing is written in interactive mode.
+ * The status line is made of the '#' character followed by the ShellProcessCommand() return value as a decimal digit, surrounded by CRLF sequences (like "\r\n#0\r\n" for a successful command).
+ * When command lines are replayed from an input source, a single status line is written after the last replayed command line. The replay is stopped by the first failing command line, which status is reported.
+ * @param Status The value returned by ShellProcessCommand().
+ * @note This function must be called after each ShellProcessCommand() call, even in interactive mode.
+ */
+void ShellWriteStatusLine(unsigned char Status);
+
 /** Allow to easily compare a token (which is a non zero-terminated string) with a classic ASCIIZ string.
  * @param Pointer_String_Token The token string, which may or may not be zero-terminated.
  * @param Pointer_String_To_Compare The string to compare with.
@@ -52,10 +139,39 @@ unsigned char ShellCompareTokenWithString(char *Pointer_String_Token, char *Poin
  */
 unsigned char ShellConvertNumericalArgumentToBinary(char *Pointer_String, unsigned char Length, unsigned long *Pointer_Binary);
 
+/** Parse the header of a "repeat" loop, which follows the "repeat" keyword in the I2C and SPI transactions : the iterations count, an optional "dXXXX" delay in milliseconds between two iterations, then the "{" character opening the loop body.
+ * @param Pointer_Iterations_Count On output, contain how many times the loop body must be executed.
+ * @param Pointer_Delay On output, contain the delay in milliseconds to wait between two iterations, 0 if no delay was given.
+ * @return 0 if the header is valid,
+ * @return 1 if the header is invalid, an error message has been displayed.
+ * @note This function reads the arguments with ShellReadNextArgument(), so it can only be called by the commands that stream their arguments.
+ */
+unsigned char ShellReadRepeatLoopHeader(unsigned long *Pointer_Iterations_Count, unsigned short *Pointer_Delay);
+
+/** Parse the next window of an I2C or SPI transaction, which ends at the end of the command line, after SHELL_TRANSACTION_WINDOW_SIZE commands, before a repeat loop body or at the end of a repeat loop body. The "repeat" and "}" keywords are handled here, the bus commands are parsed by the provided callback.
+ * @param Pointer_Window The transaction state, it must be zeroed before parsing the first window.
+ * @param Pointer_Commands The window commands array, which must be able to hold SHELL_TRANSACTION_WINDOW_SIZE commands.
+ * @param Command_Size The size in bytes of a single command.
+ * @param Command_Parser_Callback Parse a bus command to the next window slot.
+ * @return 0 if the window is valid (it can be empty),
+ * @return 1 if the window is invalid, an error message has been displayed.
+ * @note This function reads the arguments with ShellReadNextArgument(), so it can only be called by the commands that stream their arguments.
+ */
+unsigned char ShellReadTransactionWindow(TShellTransactionWindow *Pointer_Window, void *Pointer_Commands, unsigned char Command_Size, TShellTransactionCommandParserCallback Command_Parser_Callback);
+
+/** Wait for the delay between two repeat loop iterations, while checking whether the user pressed Ctrl+C to stop the loop.
+ * @param Delay The delay in milliseconds, it can be 0.
+ * @return 0 if the next iteration can be executed,
+ * @return 1 if the user asked to stop the loop. The characters received up to the Ctrl+C one have been discarded, like the end of the command line.
+ * @note The characters typed ahead of the next command lines are left untouched as long as Ctrl+C is not received.
+ */
+unsigned char ShellWaitForNextRepeatLoopIteration(unsigned short Delay);
+
 /** Display a hexadecimal dump of the data followed by an ASCII dump.
  * @param Starting_Address The address value to display at the beginning of the dump.
  * @param Pointer_Data The data bytes to display.
  * @param Data_Bytes_Count How many data bytes to process.
+ * @note The dump is sent to the data port when a program on the host has opened it, otherwise it is displayed in the shell.
  */
 void ShellDisplayDataDump(unsigned long Starting_Address, unsigned char *Pointer_Data, unsigned char Data_Bytes_Count);
 
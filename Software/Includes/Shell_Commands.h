@@ -8,67 +8,123 @@
 //-------------------------------------------------------------------------------------------------
 // Constants
 //-------------------------------------------------------------------------------------------------
-/** How many commands are listed in the Shell_Commands array. */
-#define SHELL_COMMANDS_COUNT 7 // The sizeof() operator can't be used on the array as the array is declared in a separate C file
+/** How many commands are listed in the Shell_Commands array.
+ * @note The commands must be listed by strictly ascending name order, like strcmp() would sort them (a name comes before the longer names it is the beginning of, like "i2c" before "i2c-configure"), because ShellFindCommand() uses a binary search. A misplaced command is not found by the shell, ShellInitialize() reports it when the logs are enabled.
+ */
+#ifndef SHELL_COMMANDS_COUNT // The host tests provide their own table to measure the lookup cost as the table grows
+	#define SHELL_COMMANDS_COUNT 13 // The sizeof() operator can't be used on the array as the array is declared in a separate C file
+#endif
+
+/** Fill the command name fields of a TShellCommand, the name length is computed by the compiler.
+ * @param String_Command The command name, it must be a string literal.
+ */
+#define SHELL_COMMANDS_NAME(String_Command) .Pointer_String_Command = String_Command, .Command_Length = sizeof(String_Command) - 1
 
 //-------------------------------------------------------------------------------------------------
 // Types
 //-------------------------------------------------------------------------------------------------
 /** The command code.
  * @param Pointer_String_Arguments The remaining arguments provided on the command line.
+ * @return 0 if the command succeeded,
+ * @return 1 if the command failed, the reason has been displayed to the user.
  */
-typedef void (*TShellCommandCallback)(char *Pointer_String_Arguments);
+typedef unsigned char (*TShellCommandCallback)(char *Pointer_String_Arguments);
 
 /** A shell command description. */
 typedef struct
 {
 	const char *Pointer_String_Command;
+	unsigned char Command_Length; //!< The command name length, so it does not need to be computed at each lookup. Use SHELL_COMMANDS_NAME() to fill it.
 	const char *Pointer_String_Description;
 	TShellCommandCallback Command_Callback;
+	unsigned char Are_Arguments_Streamed; //!< Set to 1 when the command retrieves its arguments with ShellReadNextArgument(), so it can run before the whole command line has been received. Set to 0 (or omit it) when the command parses its arguments string.
 } TShellCommand;
 
 //-------------------------------------------------------------------------------------------------
 // Variables
 //-------------------------------------------------------------------------------------------------
-/** Hold all existing shell commands. */
+/** Hold all existing shell commands, sorted by ascending name order (like strcmp() would sort them) so a command can be found with a binary search. */
 extern const TShellCommand Shell_Commands[SHELL_COMMANDS_COUNT];
 
 //-------------------------------------------------------------------------------------------------
 // Functions
 //-------------------------------------------------------------------------------------------------
+/** Implement the "boot-time" shell command.
+ * @param Pointer_String_Arguments The command line arguments.
+ * @return 0 if the command succeeded, 1 if it failed.
+ */
+unsigned char ShellCommandUSBBootTimeCallback(char *Pointer_String_Arguments);
+
 /** Implement the "help" shell command.
  * @param Pointer_String_Arguments The command line arguments.
+ * @return 0 if the command succeeded, 1 if it failed.
  */
-void ShellCommandHelpCallback(char *Pointer_String_Arguments);
+unsigned char ShellCommandHelpCallback(char *Pointer_String_Arguments);
 
 /** Implement the "i2c" shell command.
  * @param Pointer_String_Arguments The command line arguments.
+ * @return 0 if the command succeeded, 1 if it failed.
  */
-void ShellCommandI2CCallback(char *Pointer_String_Arguments);
+unsigned char ShellCommandI2CCallback(char *Pointer_String_Arguments);
 
 /** Implement the "i2c-configure" shell command.
  * @param Pointer_String_Arguments The command line arguments.
+ * @return 0 if the command succeeded, 1 if it failed.
  */
-void ShellCommandI2CConfigureCallback(char *Pointer_String_Arguments);
+unsigned char ShellCommandI2CConfigureCallback(char *Pointer_String_Arguments);
 
 /** Implement the "i2c-scan" shell command.
  * @param Pointer_String_Arguments The command line arguments.
+ * @return 0 if the command succeeded, 1 if it failed.
+ */
+unsigned char ShellCommandI2CScanCallback(char *Pointer_String_Arguments);
+
+/** Implement the "macro-list" shell command.
+ * @param Pointer_String_Arguments The command line arguments.
+ * @return 0 if the command succeeded, 1 if it failed.
+ */
+unsigned char ShellCommandMacroListCallback(char *Pointer_String_Arguments);
+
+/** Implement the "macro-record" shell command.
+ * @param Pointer_String_Arguments The command line arguments.
+ * @return 0 if the command succeeded, 1 if it failed.
+ */
+unsigned char ShellCommandMacroRecordCallback(char *Pointer_String_Arguments);
+
+/** Implement the "macro-run" shell command.
+ * @param Pointer_String_Arguments The command line arguments.
+ * @return 0 if the command succeeded, 1 if it failed.
  */
-void ShellCommandI2CScanCallback(char *Pointer_String_Arguments);
+unsigned char ShellCommandMacroRunCallback(char *Pointer_String_Arguments);
 
 /** Implement the "pinout" shell command.
  * @param Pointer_String_Arguments The command line arguments.
+ * @return 0 if the command succeeded, 1 if it failed.
  */
-void ShellCommandPinoutCallback(char *Pointer_String_Arguments);
+unsigned char ShellCommandPinoutCallback(char *Pointer_String_Arguments);
+
+/** Implement the "shell-mode" shell command.
+ * @param Pointer_String_Arguments The command line arguments.
+ * @return 0 if the command succeeded, 1 if it failed.
+ */
+unsigned char ShellCommandShellModeCallback(char *Pointer_String_Arguments);
 
 /** Implement the "spi" shell command.
  * @param Pointer_String_Arguments The command line arguments.
+ * @return 0 if the command succeeded, 1 if it failed.
  */
-void ShellCommandSPICallback(char *Pointer_String_Arguments);
+unsigned char ShellCommandSPICallback(char *Pointer_String_Arguments);
 
 /** Implement the "spi-configure" shell command.
  * @param Pointer_String_Arguments The command line arguments.
+ * @return 0 if the command succeeded, 1 if it failed.
+ */
+unsigned char ShellCommandSPIConfigureCallback(char *Pointer_String_Arguments);
+
+/** Implement the "usb-stats" shell command.
+ * @param Pointer_String_Arguments The command line arguments.
+ * @return 0 if the command succeeded, 1 if it failed.
  */
-void ShellCommandSPIConfigureCallback(char *Pointer_String_Arguments);
+unsigned char ShellCommandUSBStatisticsCallback(char *Pointer_String_Arguments);
 
 #endif
@@ -13,9 +13,30 @@
 /** The Class Definitions for Communications Devices document revision 1.2 release number in little-endian BCD format. */
 #define USB_COMMUNICATIONS_SPECIFICATION_RELEASE_NUMBER { 0x02, 0x01 }
 
+/** How many CDC ACM functions the device exposes. */
+#define USB_COMMUNICATIONS_PORTS_COUNT 2
+
 //-------------------------------------------------------------------------------------------------
 // Types
 //-------------------------------------------------------------------------------------------------
+/** Identify each CDC ACM function of the device, which is seen as a serial port by the host. */
+typedef enum : unsigned char
+{
+	USB_COMMUNICATIONS_PORT_ID_SHELL, //!< The interactive text interface.
+	USB_COMMUNICATIONS_PORT_ID_DATA //!< Carry the large data dumps and the streamed data, so they do not clutter the shell.
+} TUSBCommunicationsPortID;
+
+/** The asynchronous events that can be reported to the host through the notification endpoint of a port, several events can be combined.
+ * Each event is a bit of the PSTN Serial State notification UART state bitmap (see CDC PSTN revision 1.2 table 31), so a stock CDC ACM driver reports them with its standard serial line counters.
+ */
+typedef enum : unsigned char
+{
+	USB_COMMUNICATIONS_EVENT_TRIGGER_FIRED = 0x04, //!< A trigger condition has been met. Reported as a break detection (bBreak bit).
+	USB_COMMUNICATIONS_EVENT_TRANSACTION_DONE = 0x08, //!< A bus transaction requested by the host has completed. Reported as a ring signal detection (bRingSignal bit).
+	USB_COMMUNICATIONS_EVENT_BUS_ERROR = 0x10, //!< A bus transaction could not complete, like an I2C slave not acknowledging a byte. Reported as a framing error (bFraming bit).
+	USB_COMMUNICATIONS_EVENT_RECEPTION_OVERRUN = 0x40 //!< The reception buffer is full, so the host has been prevented from sending more data (no data is lost). Reported as an overrun (bOverRun bit).
+} TUSBCommunicationsEvent;
+
 /** All supported descriptor types. */
 typedef enum : unsigned char
 {
@@ -61,6 +82,11 @@ typedef struct
 	unsigned char bSubordinateInterface0;
 } __attribute__((packed)) TUSBCommunicationsFunctionalDescriptorUnion;
 
+// Make sure that the functional descriptors match their specification size, so they can be directly sent to the host
+USB_CORE_STATIC_ASSERT(sizeof(TUSBCommunicationsFunctionalDescriptorHeader) == 5, Communications_Header_Functional_Descriptor_Size);
+USB_CORE_STATIC_ASSERT(sizeof(TUSBCommunicationsFunctionalDescriptorAbstractControlManagement) == 4, Communications_Abstract_Control_Management_Functional_Descriptor_Size);
+USB_CORE_STATIC_ASSERT(sizeof(TUSBCommunicationsFunctionalDescriptorUnion) == 5, Communications_Union_Functional_Descriptor_Size);
+
 //-------------------------------------------------------------------------------------------------
 // Functions
 //-------------------------------------------------------------------------------------------------
@@ -70,41 +96,111 @@ typedef struct
  */
 void USBCommunicationsHandleControlRequestCallback(TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data);
 
-/** Needs to be called by the OUT callback of the CDC ACM data OUT endpoint to fetch the received data.
+/** Needs to be called by the OUT callback of the CDC ACM data OUT endpoint of each port to fetch the received data.
  * @param Pointer_Transfer_Callback_Data The request data.
  */
 void USBCommunicationsHandleDataReceptionCallback(TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data);
 
-/** Needs to be called by the IN callback of the CDC ACM data IN endpoint, in order to know when a data chunk has been fully transmitted.
- * @param Endpoint_ID The CDC ACM data IN endpoint number, which is not used here.
+/** Needs to be called by the IN callback of the CDC ACM data IN endpoint of each port, in order to send the next buffered data chunk when the previous one has been fully transmitted.
+ * @param Endpoint_ID The CDC ACM data IN endpoint number, which identifies the port.
  */
 void USBCommunicationsHandleDataTransmissionFlowControlCallback(unsigned char Endpoint_ID);
 
+/** Needs to be called by the IN callback of the CDC ACM notification endpoint of each port that has one, in order to send the events signaled while the previous notification was transmitted.
+ * @param Endpoint_ID The CDC ACM notification endpoint number, which identifies the port.
+ */
+void USBCommunicationsHandleNotificationFlowControlCallback(unsigned char Endpoint_ID);
+
+/** Needs to be called by the USB core Start-Of-Frame callback, in order to periodically flush the partially filled packets of all ports. */
+void USBCommunicationsHandleStartOfFrameCallback(void);
+
+/** Needs to be called by the USB core bus reset callback, in order to restart the synchronization values of all ports and to discard their buffered data. */
+void USBCommunicationsHandleResetCallback(void);
+
 // User-callable functions
-/** Cache some useful USB CDC ACM settings.
+/** Cache some useful USB CDC ACM settings of a port.
+ * @param Port_ID The port to configure.
+ * @param Control_Interface_ID The CDC ACM communications class interface number, to which the class-specific requests are sent.
+ * @param Notification_Endpoint_ID The CDC ACM notification endpoint number, its hardware endpoint must be configured with USB_CORE_HARDWARE_ENDPOINT_NOTIFICATION_BUFFER. Set to 0 if the notification endpoint has no buffer, the events signaled on this port are then discarded.
+ * @param Data_Out_Endpoint_ID The CDC ACM data OUT endpoint number.
  * @param Data_In_Endpoint_ID The CDC ACM data IN endpoint number.
  */
-void USBCommunicationsInitialize(unsigned char Data_In_Endpoint_ID);
+void USBCommunicationsInitialize(TUSBCommunicationsPortID Port_ID, unsigned char Control_Interface_ID, unsigned char Notification_Endpoint_ID, unsigned char Data_Out_Endpoint_ID, unsigned char Data_In_Endpoint_ID);
 
-/** Check wether the CDC ACM link is configured by the host and operational.
- * @return 0 if the host is not connected yet,
- * @return 1 if the host is connected.
+/** Check wether a program on the host has opened the port.
+ * @param Port_ID The port to check.
+ * @return 0 if the port is not opened,
+ * @return 1 if the port is opened and operational.
  */
-unsigned char USBCommunicationsIsCommunicationEstablished(void);
+unsigned char USBCommunicationsIsCommunicationEstablished(TUSBCommunicationsPortID Port_ID);
+
+/** Tell how many times the host has been prevented from sending data because the reception buffer was too full. This happens when the user reads the data slower than the host sends them.
+ * @param Port_ID The port to retrieve the counter of.
+ * @param Is_Reset_Requested Set to 1 to clear the counter after it has been retrieved, set to 0 to keep counting.
+ * @return The throttles count.
+ */
+unsigned short USBCommunicationsGetReceptionThrottlesCount(TUSBCommunicationsPortID Port_ID, unsigned char Is_Reset_Requested);
+
+/** Tell whether a received character is waiting to be read.
+ * @param Port_ID The port to check.
+ * @return 0 if no character is available,
+ * @return 1 if USBCommunicationsReadCharacter() will immediately return a character.
+ */
+unsigned char USBCommunicationsIsCharacterAvailable(TUSBCommunicationsPortID Port_ID);
+
+/** Look for a specific character among the received characters that are waiting to be read, without consuming any of them.
+ * @param Port_ID The port to check.
+ * @param Character The character to look for.
+ * @return 0 if the character has not been received,
+ * @return 1 if the character is waiting to be read, possibly after other characters.
+ */
+unsigned char USBCommunicationsIsCharacterReceived(TUSBCommunicationsPortID Port_ID, char Character);
 
 /** Block until a character is received.
+ * @param Port_ID The port to read from.
  * @return The ASCII code of the received character.
+ * @note The host is not allowed to send more data when the reception buffer is full, so no data is lost when the user reads the characters slower than the host sends them.
  */
-char USBCommunicationsReadCharacter(void);
+char USBCommunicationsReadCharacter(TUSBCommunicationsPortID Port_ID);
 
 /** Transmit a single-byte ASCII character to the host.
+ * @param Port_ID The port to write to.
  * @param Character The character ASCII code.
+ * @note The character is buffered and sent in the background, this function blocks only when the transmission buffer is full.
  */
-void USBCommunicationsWriteCharacter(char Character);
+void USBCommunicationsWriteCharacter(TUSBCommunicationsPortID Port_ID, char Character);
 
 /** Transmit an ASCIIZ string of data to the host.
+ * @param Port_ID The port to write to.
  * @param Pointer_String The string to transmit, which must be terminated by a 0.
+ * @note The string is buffered and sent in the background, this function blocks only when the transmission buffer is full. Consecutive writes are coalesced into packets as large as possible, a partially filled packet is sent within one millisecond.
+ */
+void USBCommunicationsWriteString(TUSBCommunicationsPortID Port_ID, char *Pointer_String);
+
+/** Block until all buffered data have been transmitted to the host.
+ * @param Port_ID The port to flush.
+ */
+void USBCommunicationsFlush(TUSBCommunicationsPortID Port_ID);
+
+/** Report asynchronous events to the host, so it does not need to poll the device to know when something happened.
+ * @param Port_ID The port to send the notification on.
+ * @param Events A combination of TUSBCommunicationsEvent values.
+ * @note The notification is sent in the background, this function never blocks. The events signaled while a previous notification is waiting to be read by the host are merged into a single notification.
+ */
+void USBCommunicationsSignalEvents(TUSBCommunicationsPortID Port_ID, unsigned char Events);
+
+/** Retrieve the next data IN packet buffer, located in the USB RAM, to directly format the data to transmit into it without any intermediate copy.
+ * @param Port_ID The port to write to.
+ * @return The packet buffer, which can hold up to USB_CORE_ENDPOINT_PACKETS_SIZE bytes.
+ * @note This function blocks until all previously written data have been given to the SIE and a packet buffer is free.
+ * @note The packet must be given back with USBCommunicationsCommitTransmissionPacket() before calling any other transmission function on the same port.
+ */
+unsigned char *USBCommunicationsAcquireTransmissionPacket(TUSBCommunicationsPortID Port_ID);
+
+/** Transmit the packet previously retrieved with USBCommunicationsAcquireTransmissionPacket() to the host.
+ * @param Port_ID The port the packet has been acquired from.
+ * @param Data_Size How many bytes have been written to the packet buffer.
  */
-void USBCommunicationsWriteString(char *Pointer_String);
+void USBCommunicationsCommitTransmissionPacket(TUSBCommunicationsPortID Port_ID, unsigned char Data_Size);
 
 #endif
@@ -14,7 +14,21 @@
 #define USB_CORE_ENDPOINT_PACKETS_SIZE 64
 
 /** How many hardware endpoints to map into memory. */
-#define USB_CORE_HARDWARE_ENDPOINTS_COUNT 4
+#define USB_CORE_HARDWARE_ENDPOINTS_COUNT 7
+
+/** How many buffers are alternately used by each direction of a ping-pong enabled endpoint (all endpoints except the control one). */
+#define USB_CORE_PING_PONG_BUFFERS_COUNT 2
+
+/** How many USB_CORE_ENDPOINT_PACKETS_SIZE data buffers to reserve in the USB RAM. The control endpoint needs one buffer per direction, each enabled direction of the other endpoints needs USB_CORE_PING_PONG_BUFFERS_COUNT buffers.
+ * @note The USB RAM that is not reserved by the buffer descriptors and the buffers is allocated by the compiler to the application variables, like any other RAM bank. Reserve only the needed buffers (the initialization log messages tell how many are unused), so the remaining RAM can hold larger application buffers.
+ */
+#define USB_CORE_DATA_BUFFERS_COUNT 14 // The buffers immediately follow the buffer descriptors of the mapped hardware endpoints, only the notification buffers fit after them
+
+/** The size in bytes of a notification buffer, it must be able to hold the largest notification sent by the application. */
+#define USB_CORE_NOTIFICATION_PACKETS_SIZE 16
+
+/** How many USB_CORE_NOTIFICATION_PACKETS_SIZE notification buffers to reserve in the USB RAM, right after the data buffers. Each endpoint flagged with USB_CORE_HARDWARE_ENDPOINT_NOTIFICATION_BUFFER needs one buffer. */
+#define USB_CORE_NOTIFICATION_BUFFERS_COUNT 1
 
 /** Tell whether the USB peripheral interrupt needs to be serviced. */
 #define USB_CORE_IS_INTERRUPT_FIRED() PIR3bits.USBIF // No need to check the interrupt enabled bit because the interrupt is always enabled
@@ -35,12 +49,22 @@
 #define USB_CORE_DESCRIPTOR_SIZE_STRING(Data_Size) (2 + Data_Size)
 /** The size in bytes of the interface descriptor. */
 #define USB_CORE_DESCRIPTOR_SIZE_INTERFACE 9
+/** The size in bytes of the endpoint descriptor. */
+#define USB_CORE_DESCRIPTOR_SIZE_ENDPOINT 7
+/** The size in bytes of the interface association descriptor. */
+#define USB_CORE_DESCRIPTOR_SIZE_INTERFACE_ASSOCIATION 8
 
 /** Retrieve the amount of elements in an array.
  * @param Array The array (not a pointer on the array).
  */
 #define USB_CORE_ARRAY_SIZE(Array) (sizeof(Array) / (sizeof(Array[0])))
 
+/** Stop the compilation if a condition computable at compile time is false. This is mostly used to check the descriptors sizes.
+ * @param Is_Condition_True The condition to check, it must be a constant expression.
+ * @param Name A name unique in the file, displayed by the compiler error message.
+ */
+#define USB_CORE_STATIC_ASSERT(Is_Condition_True, Name) typedef char USB_Core_Static_Assertion_##Name[(Is_Condition_True) ? 1 : -1]
+
 /** The endpoint descriptor bmAttributes Transfer Type field value for an OUT direction. */
 #define USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_OUT 0
 /** The endpoint descriptor bmAttributes Transfer Type field value for an IN direction. */
@@ -55,25 +79,28 @@
 #define USB_CORE_HARDWARE_ENDPOINT_DIRECTION_OUT 0x04
 /** Enabled the IN endpoint of the hardware endpoint. */
 #define USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN 0x02
-
-/** Copy data from a buffer to another, keeping the volatile qualifier and forcing the inlining.
- * @param Pointer_Destination_Buffer Where to store the copied data.
- * @param Pointer_Source_Buffer The data to copy from.
- * @param Bytes_Count How many bytes to copy.
- */
-#define USB_CORE_MEMCPY(Pointer_Destination_Buffer, Pointer_Source_Buffer, Bytes_Count) \
-{ \
-	unsigned char i = (Bytes_Count); \
-	volatile unsigned char *Pointer_Destination_Buffer_Bytes = (volatile unsigned char *) Pointer_Destination_Buffer; \
-	volatile unsigned char *Pointer_Source_Buffer_Bytes = (volatile unsigned char *) Pointer_Source_Buffer; \
-	while (i > 0) \
-	{ \
-		*Pointer_Destination_Buffer_Bytes = *Pointer_Source_Buffer_Bytes; \
-		Pointer_Destination_Buffer_Bytes++; \
-		Pointer_Source_Buffer_Bytes++; \
-		i--; \
-	} \
-}
+/** Enable the hardware endpoint directions without assigning them any data buffer, the SIE will NAK all transactions because the buffers are never given to it. This saves USB RAM for the mandatory endpoints that carry no data, like the CDC ACM notification endpoints. */
+#define USB_CORE_HARDWARE_ENDPOINT_WITHOUT_DATA_BUFFERS 0x80
+/** Give a single USB_CORE_NOTIFICATION_PACKETS_SIZE buffer to the IN direction of the hardware endpoint instead of the data buffers. Both ping-pong buffer descriptors share this buffer, so only one packet can be given to the SIE at a time : the application must wait for the endpoint IN callback before preparing the next packet. This saves USB RAM for the interrupt endpoints sending small notifications. */
+#define USB_CORE_HARDWARE_ENDPOINT_NOTIFICATION_BUFFER 0x40
+
+/** The device request bmRequestType Data Transfer Direction field. */
+#define USB_CORE_DEVICE_REQUEST_TYPE_MASK_DIRECTION 0x80
+#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_DIRECTION_HOST_TO_DEVICE 0
+#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_DIRECTION_DEVICE_TO_HOST 0x80
+
+/** The device request bmRequestType Type field. */
+#define USB_CORE_DEVICE_REQUEST_TYPE_MASK_TYPE 0x60
+#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_TYPE_STANDARD (0 << 5)
+#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_TYPE_CLASS (1 << 5)
+#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_TYPE_VENDOR (2 << 5)
+
+/** The device request bmRequestType Recipient field. */
+#define USB_CORE_DEVICE_REQUEST_TYPE_MASK_RECIPIENT 0x1F
+#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_RECIPIENT_DEVICE 0
+#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_RECIPIENT_INTERFACE 1
+#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_RECIPIENT_ENDPOINT 2
+#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_RECIPIENT_OTHER 3
 
 /** Disable the USB interrupt. */
 #define USB_CORE_INTERRUPT_DISABLE() PIE3bits.USBIE = 0
@@ -92,26 +119,30 @@ typedef enum : unsigned char
 	USB_CORE_DESCRIPTOR_TYPE_STRING = 3,
 	USB_CORE_DESCRIPTOR_TYPE_INTERFACE = 4,
 	USB_CORE_DESCRIPTOR_TYPE_ENDPOINT = 5,
-	USB_CORE_DESCRIPTOR_TYPE_DEVICE_QUALIFIER = 6
+	USB_CORE_DESCRIPTOR_TYPE_DEVICE_QUALIFIER = 6,
+	USB_CORE_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION = 0x0B
 } TUSBCoreDescriptorType;
 
 // Device descriptor
 /** The supported device class codes. */
 typedef enum : unsigned char
 {
-	USB_CORE_DEVICE_CLASS_CODE_COMMUNICATIONS = 2 //!< CDC.
+	USB_CORE_DEVICE_CLASS_CODE_COMMUNICATIONS = 2, //!< CDC.
+	USB_CORE_DEVICE_CLASS_CODE_MISCELLANEOUS = 0xEF //!< Needed by a composite device using interface association descriptors.
 } TUSBCoreDeviceClassCode;
 
 /** The supported device sub class codes. */
 typedef enum : unsigned char
 {
-	USB_CORE_DEVICE_SUB_CLASS_CODE_NONE = 0
+	USB_CORE_DEVICE_SUB_CLASS_CODE_NONE = 0,
+	USB_CORE_DEVICE_SUB_CLASS_CODE_COMMON_CLASS = 2 //!< To be used with the miscellaneous device class.
 } TUSBCoreDeviceSubClassCode;
 
 /** The supported device protocol codes. */
 typedef enum : unsigned char
 {
-	USB_CORE_DEVICE_PROTOCOL_CODE_NONE = 0 //!< No device class-specific protocol is used.
+	USB_CORE_DEVICE_PROTOCOL_CODE_NONE = 0, //!< No device class-specific protocol is used.
+	USB_CORE_DEVICE_PROTOCOL_CODE_INTERFACE_ASSOCIATION_DESCRIPTOR = 1 //!< To be used with the miscellaneous device class and the common class sub class.
 } TUSBCoreDeviceProtocolCode;
 
 // Interface descriptor
@@ -119,7 +150,9 @@ typedef enum : unsigned char
 typedef enum : unsigned char
 {
 	USB_CORE_INTERFACE_CLASS_CODE_COMMUNICATIONS = 2,
-	USB_CORE_INTERFACE_CLASS_CODE_DATA_INTERFACE = 0x0A
+	USB_CORE_INTERFACE_CLASS_CODE_HUMAN_INTERFACE_DEVICE = 3,
+	USB_CORE_INTERFACE_CLASS_CODE_DATA_INTERFACE = 0x0A,
+	USB_CORE_INTERFACE_CLASS_CODE_VENDOR_SPECIFIC = 0xFF
 } TUSBCoreInterfaceClassCode;
 
 /** The supported interface sub class codes. */
@@ -143,6 +176,15 @@ typedef enum : unsigned short
 	USB_CORE_LANGUAGE_ID_FRENCH_STANDARD = 0x040C
 } TUSBCoreLanguageID;
 
+/** The device states visible to the host (see USB 2.0 specification chapter 9.1.1). The suspended state is not part of it, because it can be entered from any other state. */
+typedef enum : unsigned char
+{
+	USB_CORE_DEVICE_STATE_POWERED, //!< The device is attached, the host has not reset it yet.
+	USB_CORE_DEVICE_STATE_DEFAULT, //!< The host has reset the device, which answers to the default address.
+	USB_CORE_DEVICE_STATE_ADDRESSED, //!< The host has assigned an unique address to the device.
+	USB_CORE_DEVICE_STATE_CONFIGURED //!< The host has selected a configuration, all functions can be used.
+} TUSBCoreDeviceState;
+
 /** All supported device request IDs. */
 typedef enum : unsigned char
 {
@@ -179,6 +221,42 @@ typedef void (*TUSBCoreHardwareEndpointOutTransferCallback)(TUSBCoreHardwareEndp
  */
 typedef void (*TUSBCoreHardwareEndpointInTransferCallback)(unsigned char Endpoint_ID);
 
+/** Called from the interrupt context each time the host sends a Start-Of-Frame packet, which happens every millisecond when the bus is not suspended. */
+typedef void (*TUSBCoreStartOfFrameCallback)(void);
+
+/** Called from the interrupt context when the host resets the bus, after all endpoints buffer descriptors have been taken back from the SIE and the OUT ones have been given again with the DATA0 synchronization. The class modules must discard their pending packets and restart their synchronization values from DATA0. */
+typedef void (*TUSBCoreResetCallback)(void);
+
+/** Called from the interrupt context when the host sends a vendor request to the control endpoint.
+ * @param Pointer_Request The request SETUP packet.
+ * @param Pointer_Pointer_Data On output, the RAM location of the data to send to the host for a device-to-host request. The data must stay valid until the data stage is over.
+ * @param Pointer_Data_Size On output, the size in bytes of the data to send to the host for a device-to-host request. No more bytes than asked by the host are sent.
+ * @return 0 if the request has been processed,
+ * @return 1 if the request is not supported or is invalid, the control endpoint is then stalled.
+ * @note Host-to-device requests with a data stage are not supported, they are always stalled without calling this callback.
+ */
+typedef unsigned char (*TUSBCoreVendorRequestCallback)(TUSBCoreDeviceRequest *Pointer_Request, void **Pointer_Pointer_Data, unsigned short *Pointer_Data_Size);
+
+/** Called from the interrupt context when the host sends a class request, so an interface can serve its requests without involving the control endpoint callback.
+ * @param Pointer_Request The request SETUP packet, the wIndex field is the recipient interface or endpoint number.
+ * @param Pointer_Pointer_Data On output, the RAM location of the data to send to the host for a device-to-host request. The data must stay valid until the data stage is over.
+ * @param Pointer_Data_Size On output, the size in bytes of the data to send to the host for a device-to-host request. No more bytes than asked by the host are sent.
+ * @return 0 if the request has been processed,
+ * @return 1 if the request is addressed to the callback interface but is not supported or is invalid, the control endpoint is then stalled,
+ * @return 2 if the request is not addressed to the callback interface, it is then given to the control endpoint callback.
+ * @note Host-to-device requests with a data stage are always given to the control endpoint callback without calling this callback, because the data stage packets are received by the control endpoint callback.
+ */
+typedef unsigned char (*TUSBCoreClassRequestCallback)(TUSBCoreDeviceRequest *Pointer_Request, void **Pointer_Pointer_Data, unsigned short *Pointer_Data_Size);
+
+/** Called from the interrupt context when the host asks for a descriptor type unknown to the USB core, like the class-specific descriptors addressed to an interface.
+ * @param Pointer_Request The GET_DESCRIPTOR request SETUP packet, the wValue high byte is the descriptor type and the wIndex field is the interface number.
+ * @param Pointer_Pointer_Descriptor On output, the program memory location of the descriptor to send to the host.
+ * @param Pointer_Descriptor_Size On output, the size in bytes of the descriptor. No more bytes than asked by the host are sent.
+ * @return 0 if the descriptor is provided,
+ * @return 1 if the descriptor is not supported, the control endpoint is then stalled.
+ */
+typedef unsigned char (*TUSBCoreClassDescriptorCallback)(TUSBCoreDeviceRequest *Pointer_Request, const void **Pointer_Pointer_Descriptor, unsigned short *Pointer_Descriptor_Size);
+
 /** How to configure the microcontroller hardware USB endpoints. */
 typedef struct
 {
@@ -221,6 +299,19 @@ typedef struct
 	unsigned char iInterface;
 } __attribute__((packed)) TUSBCoreDescriptorInterface;
 
+/** An USB interface association descriptor using the USB naming for simplicity. See the USB Interface Association Descriptor ECN table 9-Z. It groups the interfaces of a function made of several interfaces, like a CDC ACM function. */
+typedef struct
+{
+	unsigned char bLength;
+	TUSBCoreDescriptorType bDescriptorType;
+	unsigned char bFirstInterface;
+	unsigned char bInterfaceCount;
+	TUSBCoreInterfaceClassCode bFunctionClass;
+	TUSBCoreInterfaceSubClassCode bFunctionSubClass;
+	TUSBCoreInterfaceProtocolCode bFunctionProtocol;
+	unsigned char iFunction;
+} __attribute__((packed)) TUSBCoreDescriptorInterfaceAssociation;
+
 /** An USB configuration descriptor, using the USB naming for simplicity. See the USB specifications 2.0 table 9.10. */
 typedef struct
 {
@@ -232,8 +323,26 @@ typedef struct
 	unsigned char iConfiguration;
 	unsigned char bmAttributes;
 	unsigned char bMaxPower; //!< Expressed in 2mA units.
-	const void *Pointer_Interfaces_Data; //!< This field is not part of the USB specification.
-} __attribute__((packed)) TUSBCoreDescriptorConfiguration;
+} __attribute__((packed)) TUSBCoreDescriptorConfiguration; // All interfaces, class-specific and endpoints descriptors of the configuration must immediately follow this descriptor in memory, so the whole configuration can be sent as a single blob
+
+/** Always-on USB link statistics, allowing to understand where the throughput is lost. */
+typedef struct
+{
+	unsigned long Interrupts_Count; //!< How many times the USB interrupt handler has been called (this includes the Start-Of-Frame ticks).
+	unsigned long Endpoints_Out_Packets_Count[USB_CORE_HARDWARE_ENDPOINTS_COUNT]; //!< How many OUT and SETUP packets each endpoint received.
+	unsigned long Endpoints_In_Packets_Count[USB_CORE_HARDWARE_ENDPOINTS_COUNT]; //!< How many IN packets each endpoint sent.
+	unsigned long Out_Bytes_Count; //!< How many data bytes have been received on all endpoints.
+	unsigned long In_Bytes_Count; //!< How many data bytes have been sent on all endpoints.
+	unsigned short Resets_Count; //!< How many bus resets have been detected.
+	unsigned short Suspends_Count; //!< How many times the host suspended the bus.
+	unsigned short Stalls_Count; //!< How many STALL handshakes have been sent.
+	unsigned short PID_Errors_Count; //!< UEIR PIDEF bit.
+	unsigned short CRC5_Errors_Count; //!< UEIR CRC5EF bit.
+	unsigned short CRC16_Errors_Count; //!< UEIR CRC16EF bit.
+	unsigned short Data_Field_Size_Errors_Count; //!< UEIR DFN8EF bit.
+	unsigned short Bus_Turnaround_Timeout_Errors_Count; //!< UEIR BTOEF bit.
+	unsigned short Bit_Stuff_Errors_Count; //!< UEIR BTSEF bit.
+} TUSBCoreStatistics;
 
 /** An USB device descriptor, using the USB naming for simplicity. */
 typedef struct
@@ -252,14 +361,25 @@ typedef struct
 	unsigned char iProduct;
 	unsigned char iSerialNumber;
 	unsigned char bNumConfigurations;
-	const TUSBCoreDescriptorConfiguration *Pointer_Configurations; //!< This field is not part of the USB specification.
+	const TUSBCoreDescriptorConfiguration * const *Pointer_Configurations; //!< This field is not part of the USB specification. Each configuration descriptor is the beginning of a contiguous blob of wTotalLength bytes.
 	const TUSBCoreDescriptorString *Pointer_Strings; //!< This field is not part of the USB specification.
 	unsigned char String_Descriptors_Count; //!< This field is not part of the USB specification.
 	// TODO the two following fields should belong to the TUSBCoreDescriptorConfiguration struct and be configured when a configuration is selected by the host, this is too complex for the current usage so configure all endpoints at boot
 	TUSBCoreHardwareEndpointConfiguration *Pointer_Hardware_Endpoints_Configuration; //!< This field is not part of the USB specification.
 	unsigned char Hardware_Endpoints_Count; //!< This field is not part of the USB specification.
+	TUSBCoreStartOfFrameCallback Start_Of_Frame_Callback; //!< This field is not part of the USB specification. Can be NULL if not required.
+	TUSBCoreVendorRequestCallback Vendor_Request_Callback; //!< This field is not part of the USB specification. Can be NULL if not required, all vendor requests are then stalled.
+	TUSBCoreClassDescriptorCallback Class_Descriptor_Callback; //!< This field is not part of the USB specification. Can be NULL if not required, all unknown descriptor types are then stalled.
+	TUSBCoreClassRequestCallback Class_Request_Callback; //!< This field is not part of the USB specification. Can be NULL if not required, all class requests are then given to the control endpoint callback.
+	TUSBCoreResetCallback Reset_Callback; //!< This field is not part of the USB specification. Can be NULL if not required.
 } __attribute__((packed)) TUSBCoreDescriptorDevice;
 
+// Make sure that the descriptors match their USB specification size, so they can be directly sent to the host
+USB_CORE_STATIC_ASSERT(sizeof(TUSBCoreDescriptorConfiguration) == USB_CORE_DESCRIPTOR_SIZE_CONFIGURATION, Configuration_Descriptor_Size);
+USB_CORE_STATIC_ASSERT(sizeof(TUSBCoreDescriptorInterface) == USB_CORE_DESCRIPTOR_SIZE_INTERFACE, Interface_Descriptor_Size);
+USB_CORE_STATIC_ASSERT(sizeof(TUSBCoreDescriptorEndpoint) == USB_CORE_DESCRIPTOR_SIZE_ENDPOINT, Endpoint_Descriptor_Size);
+USB_CORE_STATIC_ASSERT(sizeof(TUSBCoreDescriptorInterfaceAssociation) == USB_CORE_DESCRIPTOR_SIZE_INTERFACE_ASSOCIATION, Interface_Association_Descriptor_Size);
+
 //-------------------------------------------------------------------------------------------------
 // Functions
 //-------------------------------------------------------------------------------------------------
@@ -268,21 +388,82 @@ typedef struct
  */
 void USBCoreInitialize(const TUSBCoreDescriptorDevice *Pointer_Device_Descriptor);
 
-/** Configure the specified endpoint OUT buffer for an upcoming reception of data from the host.
+/** Stall the IN buffer descriptor of the specified endpoint.
+ * @param Endpoint_ID The endpoint to stall.
+ * @note This is mostly used with the control endpoint to tell that a request is not supported.
+ */
+void USBCoreStallEndpoint(unsigned char Endpoint_ID);
+
+/** Configure the specified endpoint next OUT buffer for an upcoming reception of data from the host.
  * @param Endpoint_ID The endpoint number (any endpoint other than 0 must have been enabled in the device descriptors).
  * @param Is_Data_1_Synchronization The data synchronization value to expect from the host. Set to 0 for a DATA0 packet ID or set to 1 for a DATA1 packet ID.
  * @note The maximum endpoint packet size is always set to USB_CORE_ENDPOINT_PACKETS_SIZE.
+ * @note The even and odd buffers of a ping-pong enabled endpoint are given to the SIE in turn, so each call to this function arms the buffer following the previously armed one.
  */
 void USBCorePrepareForOutTransfer(unsigned char Endpoint_ID, unsigned char Is_Data_1_Synchronization);
 
-/** Configure the specified endpoint IN buffer for being read by the host.
+/** Configure the specified endpoint next IN buffer for being read by the host. The function blocks until this buffer has been released by the SIE.
  * @param Endpoint_ID The endpoint number (any endpoint other than 0 must have been enabled in the device descriptors).
  * @param Pointer_Data The buffer containing the data to write to the IN buffer.
  * @param Data_Size The size of the data buffer in bytes. TODO For now, do not exceed the maximum USB packet size.
  * @param Is_Data_1_Synchronization The data synchronization value to expect from the host. Set to 0 for a DATA0 packet ID or set to 1 for a DATA1 packet ID.
+ * @note On a ping-pong enabled endpoint, the firmware can fill a buffer while the other one is being transmitted to the host.
  */
 void USBCorePrepareForInTransfer(unsigned char Endpoint_ID, void *Pointer_Data, unsigned char Data_Size, unsigned char Is_Data_1_Synchronization);
 
+/** Wait for the specified endpoint next IN buffer to be released by the SIE and retrieve its address in the USB RAM. This allows to directly write the data to transmit into the buffer, without an intermediate copy.
+ * @param Endpoint_ID The endpoint number (any endpoint other than 0 must have been enabled in the device descriptors).
+ * @return The buffer address, the buffer can hold up to USB_CORE_ENDPOINT_PACKETS_SIZE bytes.
+ * @note Call USBCoreCommitInTransfer() to give the filled buffer to the SIE. No other IN transfer must be prepared on the same endpoint meanwhile.
+ */
+unsigned char *USBCoreAcquireInBuffer(unsigned char Endpoint_ID);
+
+/** Give to the SIE the IN buffer previously retrieved with USBCoreAcquireInBuffer(), so it can be read by the host.
+ * @param Endpoint_ID The endpoint number.
+ * @param Data_Size How many bytes have been written to the buffer.
+ * @param Is_Data_1_Synchronization The data synchronization value to expect from the host. Set to 0 for a DATA0 packet ID or set to 1 for a DATA1 packet ID.
+ */
+void USBCoreCommitInTransfer(unsigned char Endpoint_ID, unsigned char Data_Size, unsigned char Is_Data_1_Synchronization);
+
+/** Copy data from a RAM location to another one as fast as possible, this is intended for the USB RAM and the circular buffers feeding it.
+ * @param Pointer_Destination Where to store the copied data.
+ * @param Pointer_Source The data to copy from, which must be located in RAM.
+ * @param Bytes_Count How many bytes to copy. A full packet is copied by a fully unrolled code path.
+ * @note Each byte is copied by a single MOVFF instruction using the FSR post-increment addressing, which takes 2 instruction cycles.
+ */
+void USBCoreCopyFromRAM(void *Pointer_Destination, void *Pointer_Source, unsigned char Bytes_Count);
+
+/** Copy data from the program memory to the RAM as fast as possible, this is intended for the descriptors sent to the host.
+ * @param Pointer_Destination Where to store the copied data.
+ * @param Pointer_Source The data to copy from, which must be located in the program memory (the const qualified variables are always stored in the program memory).
+ * @param Bytes_Count How many bytes to copy. A full packet is copied by a fully unrolled code path.
+ * @note Each byte is copied by a table read followed by a MOVFF instruction using the FSR post-increment addressing, which takes 4 instruction cycles.
+ */
+void USBCoreCopyFromProgramMemory(void *Pointer_Destination, const void *Pointer_Source, unsigned char Bytes_Count);
+
+/** Get a millisecond timebase derived from the Start-Of-Frame packets sent by the host.
+ * @return How many milliseconds elapsed since the host started sending frames.
+ * @note The count does not increase while the bus is suspended or when the device is not connected to a host.
+ */
+unsigned long USBCoreGetMillisecondsCount(void);
+
+/** Tell how far the host went in the device enumeration.
+ * @return The current device state, a bus reset brings it back to USB_CORE_DEVICE_STATE_DEFAULT.
+ */
+TUSBCoreDeviceState USBCoreGetDeviceState(void);
+
+/** Retrieve a coherent snapshot of the USB link statistics.
+ * @param Pointer_Statistics On output, contain the statistics.
+ * @param Is_Reset_Requested Set to 1 to clear all statistics after they have been retrieved, set to 0 to keep counting.
+ */
+void USBCoreGetStatistics(TUSBCoreStatistics *Pointer_Statistics, unsigned char Is_Reset_Requested);
+
+/** Get a direct access to the USB link statistics, without copying them. This is intended to stream the statistics to the host from the USB interrupt context.
+ * @return The statistics, which are updated by the USB interrupt.
+ * @note The statistics can change between two packets of the same transfer, use USBCoreGetStatistics() to get a coherent snapshot from the main context.
+ */
+const TUSBCoreStatistics *USBCoreGetLiveStatistics(void);
+
 /** Must be called from the interrupt context to handle the USB interrupt. */
 void USBCoreInterruptHandler(void);
 
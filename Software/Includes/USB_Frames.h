@@ -0,0 +1,72 @@
+/** @file USB_Frames.h
+ * The request and response flow shared by the interfaces carrying binary command frames (see USB_Vendor.h and USB_HID.h), on an OUT and IN endpoints pair with the same number.
+ * Each received OUT packet is a request, it is kept in its ping-pong buffer until the main context has executed it, so the SIE NAKs the host meanwhile. The request is answered by a single IN packet.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_USB_FRAMES_H
+#define H_USB_FRAMES_H
+
+#include <USB_Core.h>
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** Execute a request packet and write the response packet.
+ * @param Pointer_Request The request packet, located in the OUT endpoint buffer.
+ * @param Request_Size The request packet size in bytes.
+ * @param Pointer_Response On output, contain the response packet. The buffer is the IN endpoint buffer, so it is USB_CORE_ENDPOINT_PACKETS_SIZE bytes large.
+ * @return The response packet size in bytes.
+ */
+typedef unsigned char (*TUSBFramesExecutionCallback)(unsigned char *Pointer_Request, unsigned char Request_Size, unsigned char *Pointer_Response);
+
+/** All the state of a frames endpoints pair, shared between the USB interrupt and the main context. */
+typedef struct
+{
+	unsigned char Endpoint_ID; //!< The number used by both OUT and IN endpoints.
+	TUSBFramesExecutionCallback Execution_Callback; //!< Turn a request into a response.
+	unsigned char Data_Out_Endpoint_Data_Synchronization; //!< Keep the data synchronization value for the OUT direction. A buffer that has just received a packet always expects the same synchronization value for its next packet (see USB_Communications.c).
+	unsigned char Data_In_Endpoint_Data_Synchronization; //!< Keep the data synchronization value for the IN direction.
+	unsigned char *Pointer_Received_Packets[USB_CORE_PING_PONG_BUFFERS_COUNT]; //!< The received requests waiting to be executed, each one is located in an OUT ping-pong buffer that is kept by the microcontroller until the request has been executed.
+	unsigned char Received_Packets_Sizes[USB_CORE_PING_PONG_BUFFERS_COUNT]; //!< The size in bytes of each received request.
+	unsigned char Received_Packets_Writing_Index; //!< Where to store the next received request.
+	unsigned char Received_Packets_Reading_Index; //!< The next request to execute.
+	volatile unsigned char Received_Packets_Count; //!< How many requests are waiting to be executed.
+	volatile unsigned char Data_In_Pending_Packets_Count; //!< How many responses have been given to the SIE and are not yet read by the host.
+	volatile unsigned char Is_Bus_Reset_Detected; //!< Set by the bus reset handler, so a request being executed while the bus is reset does not give the buffers of the new session to the SIE.
+} TUSBFramesEndpoint;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+// Protocol callbacks
+/** Needs to be called by the OUT callback of the endpoint to keep the received request until it is executed.
+ * @param Pointer_Endpoint The frames endpoint.
+ * @param Pointer_Transfer_Callback_Data The request data.
+ */
+void USBFramesHandleDataReceptionCallback(TUSBFramesEndpoint *Pointer_Endpoint, TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data);
+
+/** Needs to be called by the IN callback of the endpoint, in order to know when the host has read a response.
+ * @param Pointer_Endpoint The frames endpoint.
+ */
+void USBFramesHandleDataTransmissionFlowControlCallback(TUSBFramesEndpoint *Pointer_Endpoint);
+
+/** Needs to be called by the USB core bus reset callback, in order to discard the received requests and to restart the synchronization values.
+ * @param Pointer_Endpoint The frames endpoint.
+ */
+void USBFramesHandleResetCallback(TUSBFramesEndpoint *Pointer_Endpoint);
+
+// User-callable functions
+/** Cache the endpoint settings.
+ * @param Pointer_Endpoint The frames endpoint.
+ * @param Endpoint_ID The endpoint number used for both OUT and IN directions.
+ * @param Execution_Callback Called from the main context to execute each request.
+ */
+void USBFramesInitialize(TUSBFramesEndpoint *Pointer_Endpoint, unsigned char Endpoint_ID, TUSBFramesExecutionCallback Execution_Callback);
+
+/** Execute the oldest received request (if any) and send its response to the host.
+ * @param Pointer_Endpoint The frames endpoint.
+ * @note This function does not block when there is no request to execute or when the host has not read the previous responses yet, so it can be frequently polled from the main context.
+ */
+void USBFramesProcessReceivedPacket(TUSBFramesEndpoint *Pointer_Endpoint);
+
+#endif
@@ -0,0 +1,109 @@
+/** @file USB_HID.h
+ * A Human Interface Device class interface made of an interrupt OUT and IN endpoints pair, carrying binary command frames (see Binary_Commands.h).
+ * The host polls the interrupt endpoints every millisecond and the HID class does not need any custom host driver, so a host tool can use the operating system HID API to drive the buses.
+ * The frames drive the same buses than the shell commands, so they are only executed from the main context while no shell command is running : when the shell waits for a character, between the command lines of a macro and while the binary mode waits for a byte.
+ * The latency is bounded by the host polling period only when the shell is idle, a running shell command (like a long repeat loop) delays the frames execution until it returns.
+ * Each OUT report is a request and is answered by an IN report containing the response. Both reports are USB_HID_REPORT_SIZE bytes large : the first byte is the frame size, followed by the frame itself, the remaining bytes are padding.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_USB_HID_H
+#define H_USB_HID_H
+
+#include <USB_Core.h>
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** Set to 1 to expose the HID interface instead of the vendor-specific bulk interface, set to 0 to keep the vendor-specific interface. Both interfaces use the same endpoint and data buffers, because the USB RAM can't hold the buffers of both. */
+#define USB_HID_IS_INTERFACE_ENABLED 0
+
+/** The HID specification revision 1.11 release number in little-endian BCD format. */
+#define USB_HID_SPECIFICATION_RELEASE_NUMBER { 0x11, 0x01 }
+
+/** The size in bytes of the input and output reports, a report always fills a full-speed interrupt packet. */
+#define USB_HID_REPORT_SIZE USB_CORE_ENDPOINT_PACKETS_SIZE
+
+/** The size in bytes of the report descriptor. */
+#define USB_HID_REPORT_DESCRIPTOR_SIZE 25
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** The HID class descriptor types. */
+typedef enum : unsigned char
+{
+	USB_HID_DESCRIPTOR_TYPE_HID = 0x21,
+	USB_HID_DESCRIPTOR_TYPE_REPORT = 0x22
+} TUSBHIDDescriptorType;
+
+/** The supported HID class-specific requests. See the HID specifications 1.11 chapter 7.2. */
+typedef enum : unsigned char
+{
+	USB_HID_CLASS_REQUEST_GET_REPORT = 0x01,
+	USB_HID_CLASS_REQUEST_GET_IDLE = 0x02,
+	USB_HID_CLASS_REQUEST_SET_IDLE = 0x0A
+} TUSBHIDClassRequest;
+
+/** An USB HID descriptor using the USB naming for simplicity. See the HID specifications 1.11 chapter 6.2.1. */
+typedef struct
+{
+	unsigned char bLength;
+	TUSBHIDDescriptorType bDescriptorType;
+	unsigned char bcdHID[2];
+	unsigned char bCountryCode;
+	unsigned char bNumDescriptors;
+	TUSBHIDDescriptorType bReportDescriptorType;
+	unsigned short wDescriptorLength;
+} __attribute__((packed)) TUSBHIDDescriptor;
+
+// Make sure that the HID descriptor matches its specification size, so it can be directly sent to the host
+USB_CORE_STATIC_ASSERT(sizeof(TUSBHIDDescriptor) == 9, HID_Descriptor_Size);
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+// Protocol callbacks
+/** Needs to be called by the OUT callback of the HID interface endpoint to keep the received report until it is executed.
+ * @param Pointer_Transfer_Callback_Data The request data.
+ */
+void USBHIDHandleDataReceptionCallback(TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data);
+
+/** Needs to be called by the IN callback of the HID interface endpoint, in order to know when the host has read a response report.
+ * @param Endpoint_ID The HID interface endpoint number, which is not used here.
+ */
+void USBHIDHandleDataTransmissionFlowControlCallback(unsigned char Endpoint_ID);
+
+/** Needs to be called by the USB core bus reset callback, in order to discard the received reports and to restart the synchronization values. */
+void USBHIDHandleResetCallback(void);
+
+/** Needs to be set as the device descriptor class descriptor callback to serve the report descriptor.
+ * @param Pointer_Request The GET_DESCRIPTOR request SETUP packet.
+ * @param Pointer_Pointer_Descriptor On output, the descriptor located in the program memory.
+ * @param Pointer_Descriptor_Size On output, the descriptor size in bytes.
+ * @return 0 if the descriptor is provided, 1 if it is unknown.
+ */
+unsigned char USBHIDHandleGetDescriptorCallback(TUSBCoreDeviceRequest *Pointer_Request, const void **Pointer_Pointer_Descriptor, unsigned short *Pointer_Descriptor_Size);
+
+/** Needs to be set as the device descriptor class request callback to serve the requests addressed to the HID interface.
+ * @param Pointer_Request The request SETUP packet.
+ * @param Pointer_Pointer_Data On output, the data to send to the host.
+ * @param Pointer_Data_Size On output, the size in bytes of the data to send to the host.
+ * @return 0 if the request has been served, 1 if it is addressed to the HID interface but is not supported, 2 if it is addressed to another interface.
+ * @note Get Report is answered with an empty response report, because the responses are only meaningful when they are sent after the execution of a request report. The report padding is not sent to save some RAM.
+ * @note The idle rate is stored to be reported back to the host, but it has no effect because an input report is only sent in response to an output report.
+ */
+unsigned char USBHIDHandleControlRequestCallback(TUSBCoreDeviceRequest *Pointer_Request, void **Pointer_Pointer_Data, unsigned short *Pointer_Data_Size);
+
+// User-callable functions
+/** Cache the HID interface settings.
+ * @param Interface_ID The HID interface number, to which the report descriptor request is sent.
+ * @param Endpoint_ID The endpoint number used by the HID interface for both OUT and IN directions.
+ */
+void USBHIDInitialize(unsigned char Interface_ID, unsigned char Endpoint_ID);
+
+/** Execute the oldest received report (if any) and send its response report to the host.
+ * @note This function does not block when there is no report to execute or when the host has not read the previous responses yet, so it can be frequently polled from the main context.
+ */
+void USBHIDProcessReceivedFrame(void);
+
+#endif
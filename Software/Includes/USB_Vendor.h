@@ -0,0 +1,65 @@
+/** @file USB_Vendor.h
+ * A vendor-specific interface made of a bulk OUT and IN endpoints pair, carrying binary command frames (see Binary_Commands.h).
+ * Each OUT transfer (up to USB_CORE_ENDPOINT_PACKETS_SIZE bytes) is a request frame, which is answered by a single IN transfer containing the response frame.
+ * Some diagnostic vendor requests are also served by the control endpoint, so a host tool can sample the device internal state without going through the shell.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_USB_VENDOR_H
+#define H_USB_VENDOR_H
+
+#include <USB_Core.h>
+
+//-------------------------------------------------------------------------------------------------
+// Constants
+//-------------------------------------------------------------------------------------------------
+/** The size of the data address space (including the SFRs), the memory requests can't access beyond it. */
+#define USB_VENDOR_DATA_MEMORY_SIZE 0x1000
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** All supported vendor control requests, they can be addressed to the device or to any interface. */
+typedef enum : unsigned char
+{
+	USB_VENDOR_CONTROL_REQUEST_READ_MEMORY = 0x01, //!< Device-to-host. wIndex is the data memory address, wLength is the amount of bytes to read. Beware that reading some SFRs has side effects (like the reception data registers).
+	USB_VENDOR_CONTROL_REQUEST_WRITE_MEMORY = 0x02, //!< Host-to-device without data stage. wIndex is the data memory address, the wValue low byte is the value to write.
+	USB_VENDOR_CONTROL_REQUEST_READ_USB_STATISTICS = 0x03 //!< Device-to-host. Return the TUSBCoreStatistics structure in little-endian format.
+} TUSBVendorControlRequest;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+// Protocol callbacks
+/** Needs to be called by the OUT callback of the vendor interface endpoint to keep the received frame until it is executed.
+ * @param Pointer_Transfer_Callback_Data The request data.
+ */
+void USBVendorHandleDataReceptionCallback(TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data);
+
+/** Needs to be called by the IN callback of the vendor interface endpoint, in order to know when the host has read a response frame.
+ * @param Endpoint_ID The vendor interface endpoint number, which is not used here.
+ */
+void USBVendorHandleDataTransmissionFlowControlCallback(unsigned char Endpoint_ID);
+
+/** Needs to be called by the USB core bus reset callback, in order to discard the received frames and to restart the synchronization values. */
+void USBVendorHandleResetCallback(void);
+
+/** Needs to be set as the device descriptor vendor request callback to serve the diagnostic requests.
+ * @param Pointer_Request The request SETUP packet.
+ * @param Pointer_Pointer_Data On output, the data to send to the host.
+ * @param Pointer_Data_Size On output, the size in bytes of the data to send to the host.
+ * @return 0 if the request has been served, 1 if it is unknown or invalid.
+ */
+unsigned char USBVendorHandleControlRequestCallback(TUSBCoreDeviceRequest *Pointer_Request, void **Pointer_Pointer_Data, unsigned short *Pointer_Data_Size);
+
+// User-callable functions
+/** Cache the vendor interface settings.
+ * @param Endpoint_ID The endpoint number used by the vendor interface for both OUT and IN directions.
+ */
+void USBVendorInitialize(unsigned char Endpoint_ID);
+
+/** Execute the oldest received frame (if any) and send its response to the host.
+ * @note This function does not block when there is no frame to execute or when the host has not read the previous responses yet, so it can be frequently polled from the main context.
+ */
+void USBVendorProcessReceivedFrame(void);
+
+#endif
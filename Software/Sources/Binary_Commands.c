@@ -0,0 +1,185 @@
+/** @file Binary_Commands.c
+ * See Binary_Commands.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Binary_Commands.h>
+#include <Log.h>
+#include <MSSP.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** Set to 1 to enable the log messages, set to 0 to disable them. */
+#define BINARY_COMMANDS_IS_LOGGING_ENABLED 0
+
+/** Tell that the MSSP module has not been configured yet by the frame. */
+#define BINARY_COMMANDS_FUNCTIONING_MODE_UNKNOWN 0xFF
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Make sure that all operations of a frame are valid and that their results fit in a response frame, so the execution can't stop halfway because of a malformed frame.
+ * @param Pointer_Request The request frame.
+ * @param Request_Size The request frame size in bytes.
+ * @return BINARY_COMMANDS_STATUS_SUCCESS if the frame can be executed, or the status telling why it can't.
+ */
+static TBinaryCommandsStatus BinaryCommandsValidateFrame(unsigned char *Pointer_Request, unsigned char Request_Size)
+{
+	unsigned char Opcode, Bytes_Count, Response_Size = 1; // The status byte is always present
+
+	while (Request_Size > 0)
+	{
+		Opcode = *Pointer_Request;
+		Pointer_Request++;
+		Request_Size--;
+
+		switch (Opcode)
+		{
+			case BINARY_COMMANDS_OPCODE_I2C_GENERATE_START:
+			case BINARY_COMMANDS_OPCODE_I2C_GENERATE_STOP:
+			case BINARY_COMMANDS_OPCODE_SPI_SELECT_SLAVE:
+			case BINARY_COMMANDS_OPCODE_SPI_DESELECT_SLAVE:
+				break;
+
+			case BINARY_COMMANDS_OPCODE_I2C_WRITE:
+			case BINARY_COMMANDS_OPCODE_I2C_READ:
+			case BINARY_COMMANDS_OPCODE_SPI_TRANSFER:
+				// All these operations are followed by a bytes count
+				if (Request_Size == 0) return BINARY_COMMANDS_STATUS_TRUNCATED_FRAME;
+				Bytes_Count = *Pointer_Request;
+				Pointer_Request++;
+				Request_Size--;
+
+				// Make sure that the data bytes to write are present
+				if (Opcode != BINARY_COMMANDS_OPCODE_I2C_READ)
+				{
+					if (Bytes_Count > Request_Size) return BINARY_COMMANDS_STATUS_TRUNCATED_FRAME;
+					Pointer_Request += Bytes_Count;
+					Request_Size -= Bytes_Count;
+				}
+
+				// Make sure that the read bytes will fit in the response
+				if (Opcode != BINARY_COMMANDS_OPCODE_I2C_WRITE)
+				{
+					if (Bytes_Count > BINARY_COMMANDS_MAXIMUM_RESPONSE_SIZE - Response_Size) return BINARY_COMMANDS_STATUS_RESPONSE_TOO_LONG;
+					Response_Size += Bytes_Count;
+				}
+				break;
+
+			default:
+				LOG(BINARY_COMMANDS_IS_LOGGING_ENABLED, "Unknown opcode 0x%02X.", Opcode);
+				return BINARY_COMMANDS_STATUS_UNKNOWN_OPCODE;
+		}
+	}
+
+	return BINARY_COMMANDS_STATUS_SUCCESS;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+unsigned char BinaryCommandsExecuteFrame(unsigned char *Pointer_Request, unsigned char Request_Size, unsigned char *Pointer_Response)
+{
+	unsigned char Opcode, Bytes_Count, Functioning_Mode = BINARY_COMMANDS_FUNCTIONING_MODE_UNKNOWN, Required_Functioning_Mode, Is_Start_Generated = 0, *Pointer_Response_Data = Pointer_Response + 1; // Skip the status byte
+	TBinaryCommandsStatus Status;
+
+	LOG(BINARY_COMMANDS_IS_LOGGING_ENABLED, "Executing a %u-byte frame.", Request_Size);
+
+	// Do not execute anything if the frame is malformed
+	Status = BinaryCommandsValidateFrame(Pointer_Request, Request_Size);
+	if (Status != BINARY_COMMANDS_STATUS_SUCCESS) goto Exit;
+
+	while (Request_Size > 0)
+	{
+		Opcode = *Pointer_Request;
+		Pointer_Request++;
+		Request_Size--;
+
+		// Configure the MSSP module only when the bus type changes, the I2C opcodes are all lower than the SPI ones
+		if (Opcode < BINARY_COMMANDS_OPCODE_SPI_SELECT_SLAVE) Required_Functioning_Mode = MSSP_FUNCTIONING_MODE_I2C;
+		else Required_Functioning_Mode = MSSP_FUNCTIONING_MODE_SPI;
+		if (Functioning_Mode != Required_Functioning_Mode)
+		{
+			MSSPSetFunctioningMode((TMSSPFunctioningMode) Required_Functioning_Mode);
+			Functioning_Mode = Required_Functioning_Mode;
+			Is_Start_Generated = 0;
+		}
+
+		// Retrieve the bytes count of the operations that have one (the frame has been validated, so it is always present)
+		if ((Opcode == BINARY_COMMANDS_OPCODE_I2C_WRITE) || (Opcode == BINARY_COMMANDS_OPCODE_I2C_READ) || (Opcode == BINARY_COMMANDS_OPCODE_SPI_TRANSFER))
+		{
+			Bytes_Count = *Pointer_Request;
+			Pointer_Request++;
+			Request_Size--;
+		}
+		else Bytes_Count = 0;
+
+		switch (Opcode)
+		{
+			case BINARY_COMMANDS_OPCODE_I2C_GENERATE_START:
+				// Differentiate between an I2C start and a repeated start
+				if (Is_Start_Generated) MSSPI2CGenerateRepeatedStart();
+				else
+				{
+					MSSPI2CGenerateStart();
+					Is_Start_Generated = 1;
+				}
+				break;
+
+			case BINARY_COMMANDS_OPCODE_I2C_GENERATE_STOP:
+				MSSPI2CGenerateStop();
+				Is_Start_Generated = 0;
+				break;
+
+			case BINARY_COMMANDS_OPCODE_I2C_WRITE:
+				while (Bytes_Count > 0)
+				{
+					// Stop here if the slave did not acknowledge the byte, the host will generate the STOP itself if needed
+					if (MSSPI2CWriteByte(*Pointer_Request) != 0)
+					{
+						LOG(BINARY_COMMANDS_IS_LOGGING_ENABLED, "Got NACK to the write 0x%02X.", *Pointer_Request);
+						Status = BINARY_COMMANDS_STATUS_I2C_NOT_ACKNOWLEDGED;
+						goto Exit;
+					}
+					Pointer_Request++;
+					Request_Size--;
+					Bytes_Count--;
+				}
+				break;
+
+			case BINARY_COMMANDS_OPCODE_I2C_READ:
+				while (Bytes_Count > 0)
+				{
+					// Send a NACK if this is the last byte to read
+					*Pointer_Response_Data = MSSPI2CReadByte(Bytes_Count != 1);
+					Pointer_Response_Data++;
+					Bytes_Count--;
+				}
+				break;
+
+			case BINARY_COMMANDS_OPCODE_SPI_SELECT_SLAVE:
+				MSSPSPISelectSlave(1);
+				break;
+
+			case BINARY_COMMANDS_OPCODE_SPI_DESELECT_SLAVE:
+				MSSPSPISelectSlave(0);
+				break;
+
+			case BINARY_COMMANDS_OPCODE_SPI_TRANSFER:
+				while (Bytes_Count > 0)
+				{
+					*Pointer_Response_Data = MSSPSPITransmitByte(*Pointer_Request);
+					Pointer_Response_Data++;
+					Pointer_Request++;
+					Request_Size--;
+					Bytes_Count--;
+				}
+				break;
+		}
+	}
+
+Exit:
+	LOG(BINARY_COMMANDS_IS_LOGGING_ENABLED, "Frame execution status : %u.", Status);
+	*Pointer_Response = Status;
+	return (unsigned char) (Pointer_Response_Data - Pointer_Response);
+}
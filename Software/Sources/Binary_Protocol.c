@@ -0,0 +1,148 @@
+/** @file Binary_Protocol.c
+ * See Binary_Protocol.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Binary_Commands.h>
+#include <Binary_Protocol.h>
+#include <Log.h>
+#include <USB_Communications.h>
+#include <USB_HID.h>
+#include <USB_Vendor.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** Set to 1 to enable the log messages, set to 0 to disable them. */
+#define BINARY_PROTOCOL_IS_LOGGING_ENABLED 0
+
+/** The CRC initial value. */
+#define BINARY_PROTOCOL_CRC_INITIAL_VALUE 0xFFFF
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The request payload being received. */
+static unsigned char Binary_Protocol_Request_Payload[BINARY_PROTOCOL_MAXIMUM_REQUEST_PAYLOAD_SIZE];
+/** The response payload being transmitted. */
+static unsigned char Binary_Protocol_Response_Payload[BINARY_COMMANDS_MAXIMUM_RESPONSE_SIZE];
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Add a byte to a CRC-16/CCITT-FALSE computation (polynomial 0x1021), without using a lookup table to save some program memory.
+ * @param CRC The CRC computed so far.
+ * @param Byte The byte to add.
+ * @return The updated CRC.
+ */
+static unsigned short BinaryProtocolUpdateCRC(unsigned short CRC, unsigned char Byte)
+{
+	unsigned char Index;
+
+	Index = (unsigned char) (CRC >> 8) ^ Byte;
+	Index ^= Index >> 4;
+	return (CRC << 8) ^ ((unsigned short) Index << 12) ^ ((unsigned short) Index << 5) ^ Index;
+}
+
+/** Wait for the next byte sent by the host, while still serving the other binary commands channel.
+ * @param Pointer_Byte On output, contain the received byte.
+ * @return 0 if a byte has been received,
+ * @return 1 if the host closed the port.
+ */
+static unsigned char BinaryProtocolReadByte(unsigned char *Pointer_Byte)
+{
+	while (!USBCommunicationsIsCharacterAvailable(USB_COMMUNICATIONS_PORT_ID_SHELL))
+	{
+		if (!USBCommunicationsIsCommunicationEstablished(USB_COMMUNICATIONS_PORT_ID_SHELL)) return 1;
+#if USB_HID_IS_INTERFACE_ENABLED
+		USBHIDProcessReceivedFrame();
+#else
+		USBVendorProcessReceivedFrame();
+#endif
+	}
+
+	*Pointer_Byte = (unsigned char) USBCommunicationsReadCharacter(USB_COMMUNICATIONS_PORT_ID_SHELL);
+	return 0;
+}
+
+/** Frame and send a payload to the host.
+ * @param Pointer_Payload The payload.
+ * @param Payload_Size The payload size in bytes.
+ */
+static void BinaryProtocolWriteFrame(unsigned char *Pointer_Payload, unsigned char Payload_Size)
+{
+	unsigned short CRC;
+
+	// Send the size
+	USBCommunicationsWriteCharacter(USB_COMMUNICATIONS_PORT_ID_SHELL, (char) Payload_Size);
+	CRC = BinaryProtocolUpdateCRC(BINARY_PROTOCOL_CRC_INITIAL_VALUE, Payload_Size);
+
+	// Send the payload, the transmitted data are coalesced into the USB packets
+	while (Payload_Size > 0)
+	{
+		USBCommunicationsWriteCharacter(USB_COMMUNICATIONS_PORT_ID_SHELL, (char) *Pointer_Payload);
+		CRC = BinaryProtocolUpdateCRC(CRC, *Pointer_Payload);
+		Pointer_Payload++;
+		Payload_Size--;
+	}
+
+	// Send the CRC
+	USBCommunicationsWriteCharacter(USB_COMMUNICATIONS_PORT_ID_SHELL, (char) CRC);
+	USBCommunicationsWriteCharacter(USB_COMMUNICATIONS_PORT_ID_SHELL, (char) (CRC >> 8));
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void BinaryProtocolRun(void)
+{
+	unsigned char Payload_Size, Received_Bytes_Count, Byte, Response_Size;
+	unsigned short CRC, Received_CRC;
+
+	LOG(BINARY_PROTOCOL_IS_LOGGING_ENABLED, "Entering the binary mode.");
+
+	// Tell the host where the binary data start
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, BINARY_PROTOCOL_MAGIC_SEQUENCE);
+
+	while (1)
+	{
+		// Receive the payload size
+		if (BinaryProtocolReadByte(&Payload_Size) != 0) break;
+		CRC = BinaryProtocolUpdateCRC(BINARY_PROTOCOL_CRC_INITIAL_VALUE, Payload_Size);
+
+		// Receive the payload, an oversized payload is still entirely read to stay synchronized with the host
+		for (Received_Bytes_Count = 0; Received_Bytes_Count < Payload_Size; Received_Bytes_Count++)
+		{
+			if (BinaryProtocolReadByte(&Byte) != 0) goto Exit;
+			CRC = BinaryProtocolUpdateCRC(CRC, Byte);
+			if (Received_Bytes_Count < BINARY_PROTOCOL_MAXIMUM_REQUEST_PAYLOAD_SIZE) Binary_Protocol_Request_Payload[Received_Bytes_Count] = Byte;
+		}
+
+		// Receive the CRC
+		if (BinaryProtocolReadByte(&Byte) != 0) break;
+		Received_CRC = Byte;
+		if (BinaryProtocolReadByte(&Byte) != 0) break;
+		Received_CRC |= (unsigned short) Byte << 8;
+
+		// Do not execute anything from a corrupted frame
+		if ((CRC != Received_CRC) || (Payload_Size > BINARY_PROTOCOL_MAXIMUM_REQUEST_PAYLOAD_SIZE))
+		{
+			LOG(BINARY_PROTOCOL_IS_LOGGING_ENABLED, "Discarding a corrupted %u-byte frame (computed CRC : 0x%04X, received CRC : 0x%04X).", Payload_Size, CRC, Received_CRC);
+			Binary_Protocol_Response_Payload[0] = BINARY_COMMANDS_STATUS_CORRUPTED_FRAME;
+			BinaryProtocolWriteFrame(Binary_Protocol_Response_Payload, 1);
+			continue;
+		}
+
+		// An empty request leaves the binary mode
+		if (Payload_Size == 0)
+		{
+			BinaryProtocolWriteFrame(Binary_Protocol_Response_Payload, 0);
+			break;
+		}
+
+		Response_Size = BinaryCommandsExecuteFrame(Binary_Protocol_Request_Payload, Payload_Size, Binary_Protocol_Response_Payload);
+		BinaryProtocolWriteFrame(Binary_Protocol_Response_Payload, Response_Size);
+	}
+
+Exit:
+	LOG(BINARY_PROTOCOL_IS_LOGGING_ENABLED, "Leaving the binary mode.");
+}
@@ -0,0 +1,129 @@
+/** @file Link.c
+ * See Link.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Link.h>
+#include <Log.h>
+#include <USB_Communications.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** Set to 1 to enable the log messages, set to 0 to disable them. */
+#define LINK_IS_LOGGING_ENABLED 0
+
+/** How many boot clock ticks elapse in a millisecond. The timer 3 counts the instruction cycles divided by 8, which gives a 1.5MHz clock. */
+#define LINK_BOOT_CLOCK_TICKS_PER_MILLISECOND ((_XTAL_FREQ / 4 / 8) / 1000)
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** How many times the 16-bit boot clock timer overflowed. */
+static volatile unsigned short Link_Boot_Clock_Overflows_Count = 0;
+
+/** The boot clock time of the first time each state was reached. */
+static unsigned long Link_States_Times[LINK_STATES_COUNT];
+/** The first state that has never been reached yet, all the previous states have a recorded time. */
+static unsigned char Link_Next_Unreached_State = LINK_STATE_POWERED;
+
+// The USB device states are directly converted to link states
+USB_CORE_STATIC_ASSERT(((unsigned char) LINK_STATE_POWERED == (unsigned char) USB_CORE_DEVICE_STATE_POWERED) && ((unsigned char) LINK_STATE_DEFAULT == (unsigned char) USB_CORE_DEVICE_STATE_DEFAULT) && ((unsigned char) LINK_STATE_ADDRESSED == (unsigned char) USB_CORE_DEVICE_STATE_ADDRESSED) && ((unsigned char) LINK_STATE_CONFIGURED == (unsigned char) USB_CORE_DEVICE_STATE_CONFIGURED), Link_States_Values);
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Read the boot clock.
+ * @return The amount of milliseconds elapsed since the boot clock has been started.
+ */
+static unsigned long LinkGetBootClockMilliseconds(void)
+{
+	unsigned short Overflows_Count, Timer_Value;
+
+	// Atomically access to the overflows counter shared with the timer interrupt
+	PIE2bits.TMR3IE = 0;
+	Timer_Value = TMR3L; // The timer high byte is latched when the low byte is read
+	Timer_Value |= (unsigned short) TMR3H << 8;
+	Overflows_Count = Link_Boot_Clock_Overflows_Count;
+	// The timer may have overflowed before being read, but its interrupt could not be serviced yet
+	if (PIR2bits.TMR3IF && (Timer_Value < 0x8000)) Overflows_Count++;
+	PIE2bits.TMR3IE = 1;
+
+	return ((((unsigned long) Overflows_Count) << 16) | Timer_Value) / LINK_BOOT_CLOCK_TICKS_PER_MILLISECOND;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void LinkInitialize(void)
+{
+	// Configure the timer 3 as a free-running 1.5MHz counter
+	T3CON = 0x32; // Use Fosc/4 as the clock, select a 1:8 prescaler, disable the secondary oscillator, enable the 16-bit read/write mode, do not enable the timer yet
+	TMR3H = 0;
+	TMR3L = 0;
+
+	// Count the overflows with a low-priority interrupt, it happens only every 44ms
+	IPR2bits.TMR3IP = 0;
+	PIR2bits.TMR3IF = 0;
+	PIE2bits.TMR3IE = 1;
+	T3CONbits.TMR3ON = 1;
+}
+
+void LinkBootClockInterruptHandler(void)
+{
+	Link_Boot_Clock_Overflows_Count++;
+	PIR2bits.TMR3IF = 0;
+}
+
+TLinkState LinkUpdateState(void)
+{
+	TLinkState State;
+	unsigned long Milliseconds_Count;
+
+	// The shell port can be opened only once the device is configured
+	if (USBCommunicationsIsCommunicationEstablished(USB_COMMUNICATIONS_PORT_ID_SHELL)) State = LINK_STATE_SHELL_OPENED;
+	else State = (TLinkState) USBCoreGetDeviceState(); // The link states share the device states values
+
+	// Record the time of the newly reached states, the states may have been walked through faster than they are polled, so give them all the same time
+	if (State >= Link_Next_Unreached_State)
+	{
+		Milliseconds_Count = LinkGetBootClockMilliseconds();
+		LOG(LINK_IS_LOGGING_ENABLED, "Reached the link state %u after %lu ms.", State, Milliseconds_Count);
+		while (Link_Next_Unreached_State <= State)
+		{
+			Link_States_Times[Link_Next_Unreached_State] = Milliseconds_Count;
+			Link_Next_Unreached_State++;
+		}
+	}
+
+	return State;
+}
+
+void LinkSignalCommandReceived(void)
+{
+	unsigned long Milliseconds_Count;
+
+	// Only the first command matters
+	if (Link_Next_Unreached_State == LINK_STATES_COUNT) return;
+
+	// A command can only come from an opened shell port, so all the states that have not been seen yet have been reached now
+	Milliseconds_Count = LinkGetBootClockMilliseconds();
+	LOG(LINK_IS_LOGGING_ENABLED, "Received the first command after %lu ms.", Milliseconds_Count);
+	while (Link_Next_Unreached_State < LINK_STATES_COUNT)
+	{
+		Link_States_Times[Link_Next_Unreached_State] = Milliseconds_Count;
+		Link_Next_Unreached_State++;
+	}
+
+	// Stop the boot clock to free the timer and to get rid of its interrupt
+	PIE2bits.TMR3IE = 0;
+	T3CONbits.TMR3ON = 0;
+	PIR2bits.TMR3IF = 0;
+}
+
+unsigned char LinkGetStateTime(TLinkState State, unsigned long *Pointer_Milliseconds_Count)
+{
+	if (State >= Link_Next_Unreached_State) return 1;
+
+	*Pointer_Milliseconds_Count = Link_States_Times[State];
+	return 0;
+}
@@ -0,0 +1,461 @@
+/** @file Macro.c
+ * See Macro.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Log.h>
+#include <Macro.h>
+#include <stddef.h>
+#include <xc.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** Set to 1 to enable the log messages, set to 0 to disable them. */
+#define MACRO_IS_LOGGING_ENABLED 0
+
+/** The data EEPROM size in bytes. */
+#define MACRO_EEPROM_SIZE 256
+
+/** The value of an erased EEPROM byte, which terminates the macros list. */
+#define MACRO_END_MARKER 0xFF
+
+/** Tell that no macro is replaced by the macro being recorded. */
+#define MACRO_INVALID_INDEX 0xFF
+
+/** The longest text an item of a macro body is turned into, this is a read operation (" rhXX"). */
+#define MACRO_MAXIMUM_TOKEN_LENGTH 5
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** Where the macro being recorded starts, this is the end of the macros list until the recording is over. */
+static unsigned short Macro_Record_Start_Address;
+/** Where the body of the macro being recorded starts. */
+static unsigned short Macro_Record_Body_Address;
+/** Where the next byte of the macro being recorded is written. */
+static unsigned short Macro_Record_Address;
+/** The name length of the macro being recorded. */
+static unsigned char Macro_Record_Name_Length;
+/** The index of the stored macro that has the same name than the macro being recorded, or MACRO_INVALID_INDEX. */
+static unsigned char Macro_Record_Replaced_Index;
+/** Where the bytes count of the last recorded write operation is stored, so the following written bytes can be appended to it. Set to 0 when the last recorded item is not a write operation (a bytes count is never stored at the EEPROM beginning). */
+static unsigned short Macro_Record_Bytes_Count_Address;
+/** Set to 1 when the last recorded item is an operation, which does not need to be separated from the following argument. */
+static unsigned char Macro_Record_Is_Operation_Recorded;
+
+/** Where the next character of the selected macro is read. */
+static unsigned short Macro_Read_Address;
+/** How many body bytes of the selected macro have not been read yet. */
+static unsigned char Macro_Read_Remaining_Bytes_Count;
+/** The text of the body item being read. */
+static char Macro_Read_Token[MACRO_MAXIMUM_TOKEN_LENGTH];
+/** How many characters the text of the body item being read contains. */
+static unsigned char Macro_Read_Token_Length;
+/** The next character to read from the text of the body item being read. */
+static unsigned char Macro_Read_Token_Index;
+/** How many data bytes of the write operation being read have not been read yet. */
+static unsigned char Macro_Read_Operation_Bytes_Count;
+/** Set to 1 when the last read item is an operation, so a text argument following it needs a separating space. */
+static unsigned char Macro_Read_Is_Separator_Needed;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Read a byte from the data EEPROM.
+ * @param Address The byte address.
+ * @return The byte value.
+ */
+static unsigned char MacroReadEEPROM(unsigned short Address)
+{
+	EEADR = (unsigned char) Address;
+	EECON1bits.EEPGD = 0; // Access the data EEPROM
+	EECON1bits.CFGS = 0;
+	EECON1bits.RD = 1;
+	return EEDATA;
+}
+
+/** Write a byte to the data EEPROM and wait for the write to complete.
+ * @param Address The byte address.
+ * @param Byte The value to write.
+ */
+static void MacroWriteEEPROM(unsigned short Address, unsigned char Byte)
+{
+	// Save the EEPROM endurance and the 4ms write time when the byte does not change
+	if (MacroReadEEPROM(Address) == Byte) return;
+
+	EEADR = (unsigned char) Address;
+	EEDATA = Byte;
+	EECON1bits.WREN = 1;
+
+	// The unlock sequence must not be interrupted
+	INTCONbits.GIEH = 0;
+	EECON2 = 0x55;
+	EECON2 = 0xAA;
+	EECON1bits.WR = 1;
+	INTCONbits.GIEH = 1;
+
+	while (EECON1bits.WR);
+	EECON1bits.WREN = 0;
+}
+
+/** Find where a macro is stored.
+ * @param Index The macro index.
+ * @param Pointer_Address On output, contain the macro address if the macro exists, or the address of the end of the macros list otherwise.
+ * @return 0 if the macro exists,
+ * @return 1 if the end of the macros list has been reached first.
+ */
+static unsigned char MacroLocate(unsigned char Index, unsigned short *Pointer_Address)
+{
+	unsigned short Address = 0, Next_Address;
+	unsigned char Name_Length;
+
+	while (1)
+	{
+		// The end marker is not a valid name length
+		Name_Length = MacroReadEEPROM(Address);
+		if ((Name_Length == 0) || (Name_Length > MACRO_MAXIMUM_NAME_LENGTH)) break;
+
+		// Bypass the name and the body, a macro going past the EEPROM end can only be garbage, so consider it as the list end
+		Next_Address = Address + Name_Length + 1;
+		Next_Address += MacroReadEEPROM(Next_Address) + 1;
+		if (Next_Address >= MACRO_EEPROM_SIZE) break;
+
+		if (Index == 0)
+		{
+			*Pointer_Address = Address;
+			return 0;
+		}
+		Index--;
+		Address = Next_Address;
+	}
+
+	*Pointer_Address = Address;
+	return 1;
+}
+
+/** Delete a stored macro by moving the following macros and the list end over it.
+ * @param Index The macro index, the macro must exist.
+ */
+static void MacroDelete(unsigned char Index)
+{
+	unsigned short Destination_Address, Source_Address, End_Address;
+
+	LOG(MACRO_IS_LOGGING_ENABLED, "Deleting the macro %u.", Index);
+	MacroLocate(Index, &Destination_Address);
+	MacroLocate(Index + 1, &Source_Address);
+	MacroLocate(MACRO_INVALID_INDEX, &End_Address); // No macro has this index, so the list end is returned
+
+	while (Source_Address <= End_Address)
+	{
+		MacroWriteEEPROM(Destination_Address, MacroReadEEPROM(Source_Address));
+		Destination_Address++;
+		Source_Address++;
+	}
+}
+
+/** Append a byte to the macro being recorded.
+ * @param Byte The byte to append.
+ * @return 0 on success,
+ * @return 1 if the EEPROM is full.
+ */
+static unsigned char MacroRecordByte(unsigned char Byte)
+{
+	// Always keep room for the end marker
+	if (Macro_Record_Address >= MACRO_EEPROM_SIZE - 1) return 1;
+
+	MacroWriteEEPROM(Macro_Record_Address, Byte);
+	Macro_Record_Address++;
+	return 0;
+}
+
+/** Append a string to the macro being recorded.
+ * @param Pointer_String The string, it does not need to be zero-terminated.
+ * @param Length The string length.
+ * @return 0 on success,
+ * @return 1 if the EEPROM is full.
+ */
+static unsigned char MacroRecordString(char *Pointer_String, unsigned char Length)
+{
+	while (Length > 0)
+	{
+		if (MacroRecordByte((unsigned char) *Pointer_String) != 0) return 1;
+		Pointer_String++;
+		Length--;
+	}
+	return 0;
+}
+
+/** Read the next byte of the selected macro body.
+ * @return The byte value, or 0 if the whole body has been read.
+ */
+static unsigned char MacroReadBodyByte(void)
+{
+	unsigned char Byte;
+
+	if (Macro_Read_Remaining_Bytes_Count == 0) return 0;
+
+	Byte = MacroReadEEPROM(Macro_Read_Address);
+	Macro_Read_Address++;
+	Macro_Read_Remaining_Bytes_Count--;
+	return Byte;
+}
+
+/** Append a character to the text of the body item being read.
+ * @param Character The character to append.
+ */
+static void MacroAppendTokenCharacter(char Character)
+{
+	Macro_Read_Token[Macro_Read_Token_Length] = Character;
+	Macro_Read_Token_Length++;
+}
+
+/** Append a byte to the text of the body item being read, using the shell hexadecimal syntax.
+ * @param Byte The byte to append.
+ */
+static void MacroAppendTokenByte(unsigned char Byte)
+{
+	static const char Hexadecimal_Digits[] = "0123456789ABCDEF";
+
+	MacroAppendTokenCharacter('h');
+	MacroAppendTokenCharacter(Hexadecimal_Digits[Byte >> 4]);
+	MacroAppendTokenCharacter(Hexadecimal_Digits[Byte & 0x0F]);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+unsigned char MacroRecordBegin(char *Pointer_String_Name, unsigned char Name_Length)
+{
+	// Keep the macro to replace until the new one is stored, so it is not lost if the recording fails
+	if (MacroFind(Pointer_String_Name, Name_Length, &Macro_Record_Replaced_Index) != 0) Macro_Record_Replaced_Index = MACRO_INVALID_INDEX;
+
+	// Write the name after the list end, the name length is written last because it replaces the end marker
+	MacroLocate(MACRO_INVALID_INDEX, &Macro_Record_Start_Address);
+	LOG(MACRO_IS_LOGGING_ENABLED, "Recording a macro at address 0x%02X, replacing the macro %u.", Macro_Record_Start_Address, Macro_Record_Replaced_Index);
+	Macro_Record_Name_Length = Name_Length;
+	Macro_Record_Address = Macro_Record_Start_Address + 1;
+	if (MacroRecordString(Pointer_String_Name, Name_Length) != 0) return 1;
+
+	// Reserve the body size byte
+	if (MacroRecordByte(0) != 0) return 1;
+	Macro_Record_Body_Address = Macro_Record_Address;
+	return 0;
+}
+
+unsigned char MacroRecordCommand(char *Pointer_String_Command, unsigned char Length)
+{
+	Macro_Record_Bytes_Count_Address = 0;
+	Macro_Record_Is_Operation_Recorded = 0;
+
+	// Terminate the previous command line
+	if ((Macro_Record_Address > Macro_Record_Body_Address) && (MacroRecordByte('\r') != 0)) return 1;
+
+	return MacroRecordString(Pointer_String_Command, Length);
+}
+
+unsigned char MacroRecordArgument(char *Pointer_String_Argument, unsigned char Length)
+{
+	if (!Macro_Record_Is_Operation_Recorded && (MacroRecordByte(' ') != 0)) return 1;
+	Macro_Record_Bytes_Count_Address = 0;
+	Macro_Record_Is_Operation_Recorded = 0;
+
+	return MacroRecordString(Pointer_String_Argument, Length);
+}
+
+unsigned char MacroRecordOperation(TBinaryCommandsOpcode Opcode, unsigned char Data)
+{
+	unsigned char Bytes_Count;
+
+	Macro_Record_Is_Operation_Recorded = 1;
+	switch (Opcode)
+	{
+		case BINARY_COMMANDS_OPCODE_I2C_WRITE:
+		case BINARY_COMMANDS_OPCODE_SPI_TRANSFER:
+			// Append the byte to the previous write operation if it can hold one more byte
+			if (Macro_Record_Bytes_Count_Address != 0)
+			{
+				Bytes_Count = MacroReadEEPROM(Macro_Record_Bytes_Count_Address);
+				if (Bytes_Count < 255)
+				{
+					if (MacroRecordByte(Data) != 0) return 1;
+					MacroWriteEEPROM(Macro_Record_Bytes_Count_Address, Bytes_Count + 1);
+					return 0;
+				}
+			}
+
+			// Start a new write operation
+			if (MacroRecordByte(Opcode) != 0) return 1;
+			Macro_Record_Bytes_Count_Address = Macro_Record_Address;
+			if (MacroRecordByte(1) != 0) return 1;
+			return MacroRecordByte(Data);
+
+		case BINARY_COMMANDS_OPCODE_I2C_READ:
+			Macro_Record_Bytes_Count_Address = 0;
+			if (MacroRecordByte(Opcode) != 0) return 1;
+			return MacroRecordByte(Data);
+
+		default:
+			Macro_Record_Bytes_Count_Address = 0;
+			return MacroRecordByte(Opcode);
+	}
+}
+
+unsigned char MacroRecordEnd(void)
+{
+	unsigned char Body_Size;
+
+	// An empty macro deletes the previous one
+	Body_Size = (unsigned char) (Macro_Record_Address - Macro_Record_Body_Address);
+	if (Body_Size == 0)
+	{
+		if (Macro_Record_Replaced_Index == MACRO_INVALID_INDEX) return 2;
+		MacroDelete(Macro_Record_Replaced_Index);
+		return 1;
+	}
+
+	// Terminate the list after the new macro, then make the new macro part of the list
+	MacroWriteEEPROM(Macro_Record_Body_Address - 1, Body_Size);
+	MacroWriteEEPROM(Macro_Record_Address, MACRO_END_MARKER);
+	MacroWriteEEPROM(Macro_Record_Start_Address, Macro_Record_Name_Length);
+	LOG(MACRO_IS_LOGGING_ENABLED, "Stored a %u-byte macro body.", Body_Size);
+
+	if (Macro_Record_Replaced_Index != MACRO_INVALID_INDEX) MacroDelete(Macro_Record_Replaced_Index);
+	return 0;
+}
+
+unsigned char MacroFind(char *Pointer_String_Name, unsigned char Name_Length, unsigned char *Pointer_Index)
+{
+	unsigned char Index, i;
+	unsigned short Address;
+
+	for (Index = 0; MacroLocate(Index, &Address) == 0; Index++)
+	{
+		if (MacroReadEEPROM(Address) != Name_Length) continue;
+
+		// Compare the names
+		for (i = 0; i < Name_Length; i++)
+		{
+			Address++;
+			if (MacroReadEEPROM(Address) != (unsigned char) Pointer_String_Name[i]) break;
+		}
+		if (i == Name_Length)
+		{
+			*Pointer_Index = Index;
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+unsigned char MacroSelect(unsigned char Index, char *Pointer_String_Name)
+{
+	unsigned short Address;
+	unsigned char Name_Length;
+
+	if (MacroLocate(Index, &Address) != 0) return 1;
+
+	// Retrieve the name
+	Name_Length = MacroReadEEPROM(Address);
+	Address++;
+	if (Pointer_String_Name != NULL)
+	{
+		while (Name_Length > 0)
+		{
+			*Pointer_String_Name = (char) MacroReadEEPROM(Address);
+			Pointer_String_Name++;
+			Address++;
+			Name_Length--;
+		}
+		*Pointer_String_Name = 0;
+	}
+	else Address += Name_Length;
+
+	// Prepare for the body reading
+	Macro_Read_Remaining_Bytes_Count = MacroReadEEPROM(Address);
+	Macro_Read_Address = Address + 1;
+	Macro_Read_Token_Length = 0;
+	Macro_Read_Token_Index = 0;
+	Macro_Read_Operation_Bytes_Count = 0;
+	Macro_Read_Is_Separator_Needed = 0;
+	return 0;
+}
+
+unsigned char MacroReadCharacter(char *Pointer_Character)
+{
+	unsigned char Byte;
+
+	// Decode the next body item when the text of the previous one has been read
+	while (Macro_Read_Token_Index >= Macro_Read_Token_Length)
+	{
+		// Terminate the last command line
+		if (Macro_Read_Remaining_Bytes_Count == 0)
+		{
+			*Pointer_Character = '\r';
+			return 1;
+		}
+		Macro_Read_Token_Length = 0;
+		Macro_Read_Token_Index = 0;
+
+		// Continue with the next data byte of a write operation
+		if (Macro_Read_Operation_Bytes_Count > 0)
+		{
+			Macro_Read_Operation_Bytes_Count--;
+			MacroAppendTokenCharacter(' ');
+			MacroAppendTokenByte(MacroReadBodyByte());
+			continue;
+		}
+
+		// Turn an operation back into the transaction command it has been recorded from
+		Byte = MacroReadBodyByte();
+		switch (Byte)
+		{
+			case BINARY_COMMANDS_OPCODE_I2C_GENERATE_START:
+			case BINARY_COMMANDS_OPCODE_SPI_SELECT_SLAVE:
+				MacroAppendTokenCharacter(' ');
+				MacroAppendTokenCharacter('[');
+				break;
+
+			case BINARY_COMMANDS_OPCODE_I2C_GENERATE_STOP:
+			case BINARY_COMMANDS_OPCODE_SPI_DESELECT_SLAVE:
+				MacroAppendTokenCharacter(' ');
+				MacroAppendTokenCharacter(']');
+				break;
+
+			case BINARY_COMMANDS_OPCODE_I2C_WRITE:
+			case BINARY_COMMANDS_OPCODE_SPI_TRANSFER:
+				Macro_Read_Operation_Bytes_Count = MacroReadBodyByte(); // The data bytes are read by the next loop iterations
+				break;
+
+			case BINARY_COMMANDS_OPCODE_I2C_READ:
+				MacroAppendTokenCharacter(' ');
+				MacroAppendTokenCharacter('r');
+				MacroAppendTokenByte(MacroReadBodyByte());
+				break;
+
+			default:
+				// Bypass an unknown control character, only the command lines terminating character is allowed
+				if ((Byte < ' ') && (Byte != '\r')) continue;
+
+				// Separate a text argument from the preceding operation
+				if (Macro_Read_Is_Separator_Needed && (Byte != ' ') && (Byte != '\r')) MacroAppendTokenCharacter(' ');
+				MacroAppendTokenCharacter((char) Byte);
+				Macro_Read_Is_Separator_Needed = 0;
+				continue;
+		}
+		Macro_Read_Is_Separator_Needed = 1;
+	}
+
+	*Pointer_Character = Macro_Read_Token[Macro_Read_Token_Index];
+	Macro_Read_Token_Index++;
+	return 0;
+}
+
+unsigned char MacroGetFreeBytesCount(void)
+{
+	unsigned short Address;
+
+	// The end marker can't be used
+	MacroLocate(MACRO_INVALID_INDEX, &Address);
+	return (unsigned char) (MACRO_EEPROM_SIZE - 1 - Address);
+}
@@ -2,10 +2,14 @@
  * Logic signal generator entry point and main loop.
  * @author Adrien RICCIARDI
  */
+#include <Binary_Protocol.h>
+#include <Link.h>
 #include <Log.h>
 #include <Shell.h>
 #include <UART.h>
 #include <USB_Communications.h>
+#include <USB_HID.h>
+#include <USB_Vendor.h>
 #include <xc.h>
 
 //-------------------------------------------------------------------------------------------------
@@ -36,6 +40,107 @@
 // CONFIG7H register
 #pragma config EBTRB = OFF // Disable boot block read protection
 
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** Generate the interface association descriptor grouping the two interfaces of a CDC ACM function.
+ * @param First_Interface_ID The communications class interface number, the data class interface must immediately follow it.
+ */
+#define MAIN_USB_COMMUNICATIONS_INTERFACE_ASSOCIATION_DESCRIPTOR(First_Interface_ID) \
+{ \
+	.bLength = sizeof(TUSBCoreDescriptorInterfaceAssociation), \
+	.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION, \
+	.bFirstInterface = (First_Interface_ID), \
+	.bInterfaceCount = 2, \
+	.bFunctionClass = USB_CORE_INTERFACE_CLASS_CODE_COMMUNICATIONS, \
+	.bFunctionSubClass = USB_CORE_INTERFACE_SUB_CLASS_CODE_ABSTRACT_CONTROL_MODEL, \
+	.bFunctionProtocol = USB_CORE_INTERFACE_PROTOCOL_CODE_ITU_V250, \
+	.iFunction = 0 \
+}
+
+/** Generate all the descriptors of a CDC ACM function, so all ports are described the same way.
+ * @param Control_Interface_ID The communications class interface number, the data class interface uses the following number.
+ * @param Notification_Endpoint_ID The notification IN endpoint number.
+ * @param Data_Out_Endpoint_ID The data OUT endpoint number.
+ * @param Data_In_Endpoint_ID The data IN endpoint number.
+ */
+#define MAIN_USB_COMMUNICATIONS_DESCRIPTORS(Control_Interface_ID, Notification_Endpoint_ID, Data_Out_Endpoint_ID, Data_In_Endpoint_ID) \
+{ \
+	.Control_Interface = \
+	{ \
+		.bLength = sizeof(TUSBCoreDescriptorInterface), \
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_INTERFACE, \
+		.bInterfaceNumber = (Control_Interface_ID), \
+		.bAlternateSetting = 0, \
+		.bNumEndpoints = 1, \
+		.bInterfaceClass = USB_CORE_INTERFACE_CLASS_CODE_COMMUNICATIONS, \
+		.bInterfaceSubClass = USB_CORE_INTERFACE_SUB_CLASS_CODE_ABSTRACT_CONTROL_MODEL, \
+		.bInterfaceProtocol = USB_CORE_INTERFACE_PROTOCOL_CODE_ITU_V250, \
+		.iInterface = 0 \
+	}, \
+	.Header = \
+	{ \
+		.bFunctionLength = sizeof(TUSBCommunicationsFunctionalDescriptorHeader), \
+		.bDescriptorType = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_TYPE_INTERFACE, \
+		.bDescriptorSubtype = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_SUB_TYPE_HEADER, \
+		.bcdCDC = USB_COMMUNICATIONS_SPECIFICATION_RELEASE_NUMBER \
+	}, \
+	.Management = \
+	{ \
+		.bFunctionLength = sizeof(TUSBCommunicationsFunctionalDescriptorAbstractControlManagement), \
+		.bDescriptorType = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_TYPE_INTERFACE, \
+		.bDescriptorSubtype = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_SUB_TYPE_ABSTRACT_CONTROL_MANAGEMENT, \
+		.bmCapabilities = 0 /* TODO configure the capabilities */ \
+	}, \
+	.Union = \
+	{ \
+		.bFunctionLength = sizeof(TUSBCommunicationsFunctionalDescriptorUnion), \
+		.bDescriptorType = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_TYPE_INTERFACE, \
+		.bDescriptorSubtype = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_SUB_TYPE_UNION, \
+		.bControlInterface = (Control_Interface_ID), \
+		.bSubordinateInterface0 = (Control_Interface_ID) + 1 \
+	}, \
+	.Notification_Endpoint = \
+	{ \
+		.bLength = sizeof(TUSBCoreDescriptorEndpoint), \
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_ENDPOINT, \
+		.bEndpointAddress = (Notification_Endpoint_ID) | USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_IN, \
+		.bmAttributes = USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_TRANSFER_TYPE_INTERRUPT, \
+		.wMaxPacketSize = USB_CORE_NOTIFICATION_PACKETS_SIZE, \
+		.bInterval = 1 /* Poll the endpoint every frame, so the events are reported to the host within a millisecond */ \
+	}, \
+	.Data_Interface = \
+	{ \
+		.bLength = sizeof(TUSBCoreDescriptorInterface), \
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_INTERFACE, \
+		.bInterfaceNumber = (Control_Interface_ID) + 1, \
+		.bAlternateSetting = 0, \
+		.bNumEndpoints = 2, \
+		.bInterfaceClass = USB_CORE_INTERFACE_CLASS_CODE_DATA_INTERFACE, \
+		.bInterfaceSubClass = USB_CORE_INTERFACE_SUB_CLASS_CODE_NONE, \
+		.bInterfaceProtocol = USB_CORE_INTERFACE_PROTOCOL_CODE_NONE, \
+		.iInterface = 0 \
+	}, \
+	.Data_Out_Endpoint = \
+	{ \
+		.bLength = sizeof(TUSBCoreDescriptorEndpoint), \
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_ENDPOINT, \
+		.bEndpointAddress = (Data_Out_Endpoint_ID) | USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_OUT, \
+		.bmAttributes = USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_TRANSFER_TYPE_BULK, \
+		.wMaxPacketSize = USB_CORE_ENDPOINT_PACKETS_SIZE, \
+		.bInterval = 1 \
+	}, \
+	.Data_In_Endpoint = \
+	{ \
+		.bLength = sizeof(TUSBCoreDescriptorEndpoint), \
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_ENDPOINT, \
+		.bEndpointAddress = (Data_In_Endpoint_ID) | USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_IN, \
+		.bmAttributes = USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_TRANSFER_TYPE_BULK, \
+		.wMaxPacketSize = USB_CORE_ENDPOINT_PACKETS_SIZE, \
+		.bInterval = 1 \
+	} \
+}
+
 //-------------------------------------------------------------------------------------------------
 // Private types
 //-------------------------------------------------------------------------------------------------
@@ -52,6 +157,48 @@ typedef struct
 	TUSBCoreDescriptorEndpoint Data_In_Endpoint;
 } __attribute__((packed)) TMainUSBCommunicationsClassSpecificEndpointDescriptor;
 
+/** The format of the vendor-specific binary commands interface descriptors. */
+typedef struct
+{
+	TUSBCoreDescriptorInterface Interface;
+	TUSBCoreDescriptorEndpoint Data_Out_Endpoint;
+	TUSBCoreDescriptorEndpoint Data_In_Endpoint;
+} __attribute__((packed)) TMainUSBVendorEndpointDescriptor;
+
+/** The format of the HID binary commands interface descriptors. */
+typedef struct
+{
+	TUSBCoreDescriptorInterface Interface;
+	TUSBHIDDescriptor HID;
+	TUSBCoreDescriptorEndpoint Data_Out_Endpoint;
+	TUSBCoreDescriptorEndpoint Data_In_Endpoint;
+} __attribute__((packed)) TMainUSBHIDEndpointDescriptor;
+
+/** The whole configuration, assembled at compile time into a single contiguous blob that can be directly sent to the host. */
+typedef struct
+{
+	TUSBCoreDescriptorConfiguration Configuration;
+	TUSBCoreDescriptorInterfaceAssociation Shell_Association;
+	TMainUSBCommunicationsClassSpecificEndpointDescriptor Shell_Communications;
+#if USB_HID_IS_INTERFACE_ENABLED
+	TMainUSBHIDEndpointDescriptor HID;
+#else
+	TMainUSBVendorEndpointDescriptor Vendor;
+#endif
+	TUSBCoreDescriptorInterfaceAssociation Data_Association;
+	TMainUSBCommunicationsClassSpecificEndpointDescriptor Data_Communications;
+} __attribute__((packed)) TMainUSBConfigurationDescriptor;
+
+// Make sure that no padding or field foreign to the USB specification slipped into the configuration blob
+USB_CORE_STATIC_ASSERT(sizeof(TMainUSBCommunicationsClassSpecificEndpointDescriptor) == (2 * USB_CORE_DESCRIPTOR_SIZE_INTERFACE) + sizeof(TUSBCommunicationsFunctionalDescriptorHeader) + sizeof(TUSBCommunicationsFunctionalDescriptorAbstractControlManagement) + sizeof(TUSBCommunicationsFunctionalDescriptorUnion) + (3 * USB_CORE_DESCRIPTOR_SIZE_ENDPOINT), Communications_Descriptors_Size);
+USB_CORE_STATIC_ASSERT(sizeof(TMainUSBVendorEndpointDescriptor) == USB_CORE_DESCRIPTOR_SIZE_INTERFACE + (2 * USB_CORE_DESCRIPTOR_SIZE_ENDPOINT), Vendor_Descriptors_Size);
+USB_CORE_STATIC_ASSERT(sizeof(TMainUSBHIDEndpointDescriptor) == USB_CORE_DESCRIPTOR_SIZE_INTERFACE + sizeof(TUSBHIDDescriptor) + (2 * USB_CORE_DESCRIPTOR_SIZE_ENDPOINT), HID_Descriptors_Size);
+#if USB_HID_IS_INTERFACE_ENABLED
+USB_CORE_STATIC_ASSERT(sizeof(TMainUSBConfigurationDescriptor) == USB_CORE_DESCRIPTOR_SIZE_CONFIGURATION + (2 * (USB_CORE_DESCRIPTOR_SIZE_INTERFACE_ASSOCIATION + sizeof(TMainUSBCommunicationsClassSpecificEndpointDescriptor))) + sizeof(TMainUSBHIDEndpointDescriptor), Configuration_Descriptor_Size);
+#else
+USB_CORE_STATIC_ASSERT(sizeof(TMainUSBConfigurationDescriptor) == USB_CORE_DESCRIPTOR_SIZE_CONFIGURATION + (2 * (USB_CORE_DESCRIPTOR_SIZE_INTERFACE_ASSOCIATION + sizeof(TMainUSBCommunicationsClassSpecificEndpointDescriptor))) + sizeof(TMainUSBVendorEndpointDescriptor), Configuration_Descriptor_Size);
+#endif
+
 //-------------------------------------------------------------------------------------------------
 // Private variables
 //-------------------------------------------------------------------------------------------------
@@ -84,96 +231,109 @@ static const TUSBCoreDescriptorString Main_USB_String_Descriptors[4] =
 	}
 };
 
-/** The interfaces definitions for the unique USB configuration. */
-static const TMainUSBCommunicationsClassSpecificEndpointDescriptor Main_USB_Communications_Class_Specific_Endpoint_Descriptors =
+/** The application unique USB configuration descriptor, followed by all its interfaces descriptors. */
+static const TMainUSBConfigurationDescriptor Main_USB_Configuration_Descriptor = // Store this into the program memory to save some RAM
 {
-	.Control_Interface =
-	{
-		.bLength = sizeof(TUSBCoreDescriptorInterface),
-		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_INTERFACE,
-		.bInterfaceNumber = 0,
-		.bAlternateSetting = 0,
-		.bNumEndpoints = 1,
-		.bInterfaceClass = USB_CORE_INTERFACE_CLASS_CODE_COMMUNICATIONS,
-		.bInterfaceSubClass = USB_CORE_INTERFACE_SUB_CLASS_CODE_ABSTRACT_CONTROL_MODEL,
-		.bInterfaceProtocol = USB_CORE_INTERFACE_PROTOCOL_CODE_ITU_V250,
-		.iInterface = 0
-	},
-	.Header =
-	{
-		.bFunctionLength = sizeof(TUSBCommunicationsFunctionalDescriptorHeader),
-		.bDescriptorType = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_TYPE_INTERFACE,
-		.bDescriptorSubtype = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_SUB_TYPE_HEADER,
-		.bcdCDC = USB_COMMUNICATIONS_SPECIFICATION_RELEASE_NUMBER
-	},
-	.Management =
-	{
-		.bFunctionLength = sizeof(TUSBCommunicationsFunctionalDescriptorAbstractControlManagement),
-		.bDescriptorType = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_TYPE_INTERFACE,
-		.bDescriptorSubtype = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_SUB_TYPE_ABSTRACT_CONTROL_MANAGEMENT,
-		.bmCapabilities = 0 // TODO configure the capabilities
-	},
-	.Union =
+	.Configuration =
 	{
-		.bFunctionLength = sizeof(TUSBCommunicationsFunctionalDescriptorUnion),
-		.bDescriptorType = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_TYPE_INTERFACE,
-		.bDescriptorSubtype = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_SUB_TYPE_UNION,
-		.bControlInterface = 0,
-		.bSubordinateInterface0 = 1
+		.bLength = USB_CORE_DESCRIPTOR_SIZE_CONFIGURATION,
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_CONFIGURATION,
+		.wTotalLength = sizeof(TMainUSBConfigurationDescriptor), // Computed by the compiler, so it can't get out of sync with the descriptors
+		.bNumInterfaces = 5,
+		.bConfigurationValue = 1,
+		.iConfiguration = 0,
+		.bmAttributes = 0, // The device is not self-powered and does not support the remove wakeup feature
+		.bMaxPower = 250 // Take as much power as possible, just in case the logic signal generator needs to power a board
 	},
-	.Notification_Endpoint =
+	.Shell_Association = MAIN_USB_COMMUNICATIONS_INTERFACE_ASSOCIATION_DESCRIPTOR(0),
+	.Shell_Communications = MAIN_USB_COMMUNICATIONS_DESCRIPTORS(0, 1, 2, 3),
+#if USB_HID_IS_INTERFACE_ENABLED
+	.HID =
 	{
-		.bLength = sizeof(TUSBCoreDescriptorEndpoint),
-		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_ENDPOINT,
-		.bEndpointAddress = 1 | USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_IN,
-		.bmAttributes = USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_TRANSFER_TYPE_INTERRUPT,
-		.wMaxPacketSize = 8,
-		.bInterval = 255
+		.Interface =
+		{
+			.bLength = sizeof(TUSBCoreDescriptorInterface),
+			.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_INTERFACE,
+			.bInterfaceNumber = 2,
+			.bAlternateSetting = 0,
+			.bNumEndpoints = 2,
+			.bInterfaceClass = USB_CORE_INTERFACE_CLASS_CODE_HUMAN_INTERFACE_DEVICE,
+			.bInterfaceSubClass = USB_CORE_INTERFACE_SUB_CLASS_CODE_NONE, // The device is not a boot keyboard or mouse
+			.bInterfaceProtocol = USB_CORE_INTERFACE_PROTOCOL_CODE_NONE,
+			.iInterface = 0
+		},
+		.HID =
+		{
+			.bLength = sizeof(TUSBHIDDescriptor),
+			.bDescriptorType = USB_HID_DESCRIPTOR_TYPE_HID,
+			.bcdHID = USB_HID_SPECIFICATION_RELEASE_NUMBER,
+			.bCountryCode = 0, // The hardware is not localized
+			.bNumDescriptors = 1,
+			.bReportDescriptorType = USB_HID_DESCRIPTOR_TYPE_REPORT,
+			.wDescriptorLength = USB_HID_REPORT_DESCRIPTOR_SIZE
+		},
+		.Data_Out_Endpoint =
+		{
+			.bLength = sizeof(TUSBCoreDescriptorEndpoint),
+			.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_ENDPOINT,
+			.bEndpointAddress = 4 | USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_OUT,
+			.bmAttributes = USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_TRANSFER_TYPE_INTERRUPT,
+			.wMaxPacketSize = USB_HID_REPORT_SIZE,
+			.bInterval = 1 // Poll every frame to get the lowest latency
+		},
+		.Data_In_Endpoint =
+		{
+			.bLength = sizeof(TUSBCoreDescriptorEndpoint),
+			.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_ENDPOINT,
+			.bEndpointAddress = 4 | USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_IN,
+			.bmAttributes = USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_TRANSFER_TYPE_INTERRUPT,
+			.wMaxPacketSize = USB_HID_REPORT_SIZE,
+			.bInterval = 1
+		}
 	},
-	.Data_Interface =
+#else
+	.Vendor =
 	{
-		.bLength = sizeof(TUSBCoreDescriptorInterface),
-		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_INTERFACE,
-		.bInterfaceNumber = 1,
-		.bAlternateSetting = 0,
-		.bNumEndpoints = 2,
-		.bInterfaceClass = USB_CORE_INTERFACE_CLASS_CODE_DATA_INTERFACE,
-		.bInterfaceSubClass = USB_CORE_INTERFACE_SUB_CLASS_CODE_NONE,
-		.bInterfaceProtocol = USB_CORE_INTERFACE_PROTOCOL_CODE_NONE,
-		.iInterface = 0
+		.Interface =
+		{
+			.bLength = sizeof(TUSBCoreDescriptorInterface),
+			.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_INTERFACE,
+			.bInterfaceNumber = 2,
+			.bAlternateSetting = 0,
+			.bNumEndpoints = 2,
+			.bInterfaceClass = USB_CORE_INTERFACE_CLASS_CODE_VENDOR_SPECIFIC,
+			.bInterfaceSubClass = USB_CORE_INTERFACE_SUB_CLASS_CODE_NONE,
+			.bInterfaceProtocol = USB_CORE_INTERFACE_PROTOCOL_CODE_NONE,
+			.iInterface = 0
+		},
+		.Data_Out_Endpoint =
+		{
+			.bLength = sizeof(TUSBCoreDescriptorEndpoint),
+			.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_ENDPOINT,
+			.bEndpointAddress = 4 | USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_OUT,
+			.bmAttributes = USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_TRANSFER_TYPE_BULK,
+			.wMaxPacketSize = USB_CORE_ENDPOINT_PACKETS_SIZE,
+			.bInterval = 1
+		},
+		.Data_In_Endpoint =
+		{
+			.bLength = sizeof(TUSBCoreDescriptorEndpoint),
+			.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_ENDPOINT,
+			.bEndpointAddress = 4 | USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_IN,
+			.bmAttributes = USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_TRANSFER_TYPE_BULK,
+			.wMaxPacketSize = USB_CORE_ENDPOINT_PACKETS_SIZE,
+			.bInterval = 1
+		}
 	},
-	.Data_Out_Endpoint =
-	{
-		.bLength = sizeof(TUSBCoreDescriptorEndpoint),
-		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_ENDPOINT,
-		.bEndpointAddress = 2 | USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_OUT,
-		.bmAttributes = USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_TRANSFER_TYPE_BULK,
-		.wMaxPacketSize = USB_CORE_ENDPOINT_PACKETS_SIZE,
-		.bInterval = 1
-	},
-	.Data_In_Endpoint =
-	{
-		.bLength = sizeof(TUSBCoreDescriptorEndpoint),
-		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_ENDPOINT,
-		.bEndpointAddress = 3 | USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_IN,
-		.bmAttributes = USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_TRANSFER_TYPE_BULK,
-		.wMaxPacketSize = USB_CORE_ENDPOINT_PACKETS_SIZE,
-		.bInterval = 1
-	}
+#endif
+	.Data_Association = MAIN_USB_COMMUNICATIONS_INTERFACE_ASSOCIATION_DESCRIPTOR(3),
+	.Data_Communications = MAIN_USB_COMMUNICATIONS_DESCRIPTORS(3, 5, 6, 6)
 };
 
-/** The application unique USB configuration descriptor. */
-static const TUSBCoreDescriptorConfiguration Main_USB_Configuration_Descriptor = // Store this into the program memory to save some RAM
+/** All application USB configurations. */
+static const TUSBCoreDescriptorConfiguration * const Main_USB_Configurations[] =
 {
-	.bLength = USB_CORE_DESCRIPTOR_SIZE_CONFIGURATION,
-	.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_CONFIGURATION,
-	.wTotalLength = USB_CORE_DESCRIPTOR_SIZE_CONFIGURATION + sizeof(Main_USB_Communications_Class_Specific_Endpoint_Descriptors),
-	.bNumInterfaces = 2,
-	.bConfigurationValue = 1,
-	.iConfiguration = 0,
-	.bmAttributes = 0, // The device is not self-powered and does not support the remove wakeup feature
-	.bMaxPower = 250, // Take as much power as possible, just in case the logic signal generator needs to power a board
-	.Pointer_Interfaces_Data = &Main_USB_Communications_Class_Specific_Endpoint_Descriptors
+	&Main_USB_Configuration_Descriptor.Configuration
 };
 
 /** Each used hardware USB endpoint configuration. */
@@ -185,35 +345,63 @@ static TUSBCoreHardwareEndpointConfiguration Main_USB_Hardware_Endpoints_Configu
 		.Out_Transfer_Callback = USBCommunicationsHandleControlRequestCallback,
 		.In_Transfer_Callback = NULL
 	},
-	// CDC ACM notification
+	// Shell CDC ACM notification
 	{
-		.Enabled_Directions = USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN,
+		.Enabled_Directions = USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN | USB_CORE_HARDWARE_ENDPOINT_NOTIFICATION_BUFFER,
 		.Out_Transfer_Callback = NULL,
-		.In_Transfer_Callback = NULL
+		.In_Transfer_Callback = USBCommunicationsHandleNotificationFlowControlCallback
 	},
-	// CDC ACM data OUT
+	// Shell CDC ACM data OUT
 	{
 		.Enabled_Directions = USB_CORE_HARDWARE_ENDPOINT_DIRECTION_OUT,
 		.Out_Transfer_Callback = USBCommunicationsHandleDataReceptionCallback, // Only this endpoint can receive user data
 		.In_Transfer_Callback = NULL
 	},
-	// CDC ACM data IN
+	// Shell CDC ACM data IN
+	{
+		.Enabled_Directions = USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN, // Do not waste USB RAM with ping-pong buffers for the unused OUT direction
+		.Out_Transfer_Callback = NULL,
+		.In_Transfer_Callback = USBCommunicationsHandleDataTransmissionFlowControlCallback
+	},
+	// Vendor-specific or HID binary commands
 	{
 		.Enabled_Directions = USB_CORE_HARDWARE_ENDPOINT_DIRECTION_OUT | USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN,
+#if USB_HID_IS_INTERFACE_ENABLED
+		.Out_Transfer_Callback = USBHIDHandleDataReceptionCallback,
+		.In_Transfer_Callback = USBHIDHandleDataTransmissionFlowControlCallback
+#else
+		.Out_Transfer_Callback = USBVendorHandleDataReceptionCallback,
+		.In_Transfer_Callback = USBVendorHandleDataTransmissionFlowControlCallback
+#endif
+	},
+	// Data CDC ACM notification
+	{
+		.Enabled_Directions = USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN | USB_CORE_HARDWARE_ENDPOINT_WITHOUT_DATA_BUFFERS, // The device events are reported on the shell port only
 		.Out_Transfer_Callback = NULL,
+		.In_Transfer_Callback = NULL
+	},
+	// Data CDC ACM data OUT and IN
+	{
+		.Enabled_Directions = USB_CORE_HARDWARE_ENDPOINT_DIRECTION_OUT | USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN,
+		.Out_Transfer_Callback = USBCommunicationsHandleDataReceptionCallback,
 		.In_Transfer_Callback = USBCommunicationsHandleDataTransmissionFlowControlCallback
 	}
 };
 
-/** The application USB device descriptor, see chapter 5.1.1 of the Class Definitions for Communications Devices revision 1.2. */
+/** Restart all USB class modules when the host resets the bus, the function is defined below.
+ * @note This function is called from the USB interrupt context.
+ */
+static void MainHandleUSBResetCallback(void);
+
+/** The application USB device descriptor. The device is a composite device made of several functions, so it uses the class codes required by the interface association descriptors (see the USB Interface Association Descriptor ECN). */
 static const TUSBCoreDescriptorDevice Main_USB_Device_Descriptor = // Store this into the program memory to save some RAM
 {
 	.bLength = USB_CORE_DESCRIPTOR_SIZE_DEVICE,
 	.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_DEVICE,
 	.bcdUSB = USB_CORE_BCD_USB_SPECIFICATION_RELEASE_NUMBER,
-	.bDeviceClass = USB_CORE_DEVICE_CLASS_CODE_COMMUNICATIONS,
-	.bDeviceSubClass = USB_CORE_DEVICE_SUB_CLASS_CODE_NONE, // Tell the host to check each interface
-	.bDeviceProtocol = USB_CORE_DEVICE_PROTOCOL_CODE_NONE, // Unused
+	.bDeviceClass = USB_CORE_DEVICE_CLASS_CODE_MISCELLANEOUS,
+	.bDeviceSubClass = USB_CORE_DEVICE_SUB_CLASS_CODE_COMMON_CLASS,
+	.bDeviceProtocol = USB_CORE_DEVICE_PROTOCOL_CODE_INTERFACE_ASSOCIATION_DESCRIPTOR,
 	.bMaxPacketSize0 = USB_CORE_ENDPOINT_PACKETS_SIZE,
 	.idVendor = 0x1240, // Use the Microchip VID for now
 	.idProduct = 0xFADA, // Use a random product ID
@@ -221,17 +409,37 @@ static const TUSBCoreDescriptorDevice Main_USB_Device_Descriptor = // Store this
 	.iManufacturer = 1,
 	.iProduct = 2,
 	.iSerialNumber = 3,
-	.bNumConfigurations = 1,
-	.Pointer_Configurations = &Main_USB_Configuration_Descriptor,
+	.bNumConfigurations = USB_CORE_ARRAY_SIZE(Main_USB_Configurations),
+	.Pointer_Configurations = Main_USB_Configurations,
 	.Pointer_Strings = Main_USB_String_Descriptors,
 	.String_Descriptors_Count = USB_CORE_ARRAY_SIZE(Main_USB_String_Descriptors),
 	.Pointer_Hardware_Endpoints_Configuration = Main_USB_Hardware_Endpoints_Configuration,
-	.Hardware_Endpoints_Count = USB_CORE_ARRAY_SIZE(Main_USB_Hardware_Endpoints_Configuration)
+	.Hardware_Endpoints_Count = USB_CORE_ARRAY_SIZE(Main_USB_Hardware_Endpoints_Configuration),
+	.Start_Of_Frame_Callback = USBCommunicationsHandleStartOfFrameCallback,
+	.Vendor_Request_Callback = USBVendorHandleControlRequestCallback,
+#if USB_HID_IS_INTERFACE_ENABLED
+	.Class_Descriptor_Callback = USBHIDHandleGetDescriptorCallback,
+	.Class_Request_Callback = USBHIDHandleControlRequestCallback,
+#else
+	.Class_Descriptor_Callback = NULL,
+	.Class_Request_Callback = NULL,
+#endif
+	.Reset_Callback = MainHandleUSBResetCallback
 };
 
 //-------------------------------------------------------------------------------------------------
 // Private functions
 //-------------------------------------------------------------------------------------------------
+static void MainHandleUSBResetCallback(void)
+{
+	USBCommunicationsHandleResetCallback();
+#if USB_HID_IS_INTERFACE_ENABLED
+	USBHIDHandleResetCallback();
+#else
+	USBVendorHandleResetCallback();
+#endif
+}
+
 /** High-priority interrupts handler entry point. */
 void __interrupt(high_priority) MainInterruptHandlerHighPriority(void)
 {
@@ -242,6 +450,7 @@ void __interrupt(high_priority) MainInterruptHandlerHighPriority(void)
 void __interrupt(low_priority) MainInterruptHandlerLowPriority(void)
 {
 	if (USB_CORE_IS_ACTIVITY_LED_INTERRUPT_FIRED()) USBCoreActivityLedInterruptHandler();
+	if (LINK_IS_BOOT_CLOCK_INTERRUPT_FIRED()) LinkBootClockInterruptHandler();
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -254,10 +463,12 @@ void main(void)
 
 	// Configure the system clock at 48MHz
 	OSCCON = 0x70; // Select a 16MHz frequency output for the internal oscillator, select the primary clock configured by the fuses (which is the internal oscillator)
-	__delay_ms(10); // Add a little delay to make sure that the PLL is locked (2ms should be enough, but take some margin)
+	while (!OSCCON2bits.PLLRDY); // Wait for the PLL to lock, instead of waiting for its worst-case lock time
 
 	// Initialize the modules
+	LinkInitialize(); // Start measuring the boot time as soon as possible
 	UARTInitialize();
+	ShellInitialize(); // The logs are available now
 
 	// Configure the interrupts
 	RCONbits.IPEN = 1; // Enable priority levels on interrupts
@@ -271,17 +482,37 @@ void main(void)
 
 	// Initialize the USB stack now that all modules are operational
 	USBCoreInitialize(&Main_USB_Device_Descriptor);
-	USBCommunicationsInitialize(3);
+	USBCommunicationsInitialize(USB_COMMUNICATIONS_PORT_ID_SHELL, 0, 1, 2, 3);
+	USBCommunicationsInitialize(USB_COMMUNICATIONS_PORT_ID_DATA, 3, 0, 6, 6);
+#if USB_HID_IS_INTERFACE_ENABLED
+	USBHIDInitialize(2, 4);
+#else
+	USBVendorInitialize(4);
+#endif
 
-	// Wait until the host has configured the CDC ACM link
-	while (!USBCommunicationsIsCommunicationEstablished());
-	__delay_ms(100); // Give a bit of delay to finalize the USB CDC ACM configuration
+	// Wait until a terminal has opened the shell port, the binary commands channel can already be used meanwhile
+	// The shell output is buffered until the host reads it, so the prompt can be displayed as soon as the terminal is ready
+#if USB_HID_IS_INTERFACE_ENABLED
+	while (LinkUpdateState() != LINK_STATE_SHELL_OPENED) USBHIDProcessReceivedFrame();
+#else
+	while (LinkUpdateState() != LINK_STATE_SHELL_OPENED) USBVendorProcessReceivedFrame();
+#endif
 
 	// Process the user commands
 	while (1)
 	{
-		ShellReadCommandLine(String_Command_Line, sizeof(String_Command_Line));
+		Result = ShellReadCommandLine(String_Command_Line, sizeof(String_Command_Line));
+		LinkSignalCommandReceived();
+
+		// Let an automation tool exchange binary frames instead of text
+		if (Result == 1)
+		{
+			BinaryProtocolRun();
+			continue;
+		}
+
 		Result = ShellProcessCommand(String_Command_Line);
-		if (Result == 1) USBCommunicationsWriteString("\r\nUnknown command.");
+		if (Result == 1) USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nUnknown command.");
+		ShellWriteStatusLine(Result);
 	}
 }
@@ -2,11 +2,15 @@
  * See Shell.h for description.
  * @author Adrien RICCIARDI
  */
+#include <Binary_Protocol.h>
 #include <Log.h>
 #include <Shell.h>
 #include <string.h>
 #include <USB_Communications.h>
+#include <USB_HID.h>
+#include <USB_Vendor.h>
 #include <Utility.h>
+#include <xc.h>
 
 //-------------------------------------------------------------------------------------------------
 // Private constants
@@ -14,40 +18,185 @@
 /** Set to 1 to enable the log messages, set to 0 to disable them. */
 #define SHELL_IS_LOGGING_ENABLED 1
 
+/** The character sent by the terminals when Ctrl+C is pressed. */
+#define SHELL_CHARACTER_CANCEL 0x03
+
 /** The prompt to display. */
 #define SHELL_STRING_PROMPT "> "
 
 //-------------------------------------------------------------------------------------------------
-// Public functions
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** Convert a nibble to its hexadecimal character. */
+static const char Shell_Hexadecimal_Digits[] = "0123456789ABCDEF";
+
+/** The port the data dump is sent to. */
+static TUSBCommunicationsPortID Shell_Data_Dump_Port_ID;
+/** The next free byte of the USB packet being filled by the data dump. */
+static unsigned char *Pointer_Shell_Data_Dump_Packet;
+/** How many bytes have been written to the USB packet being filled by the data dump. */
+static unsigned char Shell_Data_Dump_Packet_Size;
+
+/** How the shell talks to the host. */
+static TShellMode Shell_Mode = SHELL_MODE_INTERACTIVE;
+
+/** The buffer holding the command line being received, as provided to ShellReadCommandLine(). */
+static char *Pointer_Shell_Command_Line;
+/** How many characters the command line buffer can hold, the terminating zero excluded. */
+static unsigned char Shell_Command_Line_Maximum_Length;
+/** How many characters are stored in the command line buffer. */
+static unsigned char Shell_Command_Line_Length;
+/** Where ShellReadNextArgument() looks for the next argument. */
+static char *Pointer_Shell_Next_Argument;
+/** Set to 1 when the end of the command line has been received, set to 0 when the buffer got full while the user was still typing. */
+static unsigned char Shell_Is_Command_Line_Complete;
+
+/** Provide the characters of the replayed command lines, NULL when the characters are read from the shell port. */
+static TShellInputSourceCallback Shell_Input_Source_Callback = NULL;
+/** Set to 1 from the command that sets an input source up to the end of the last command line read from it. */
+static unsigned char Shell_Is_Input_Source_Replayed = 0;
+
 //-------------------------------------------------------------------------------------------------
-void ShellReadCommandLine(char *Pointer_String_Command_Line, unsigned char Maximum_Length)
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Append a character to the USB packet being filled by the data dump, the packet is transmitted as soon as it is full.
+ * @param Character The character to append.
+ */
+static void ShellDataDumpAppendCharacter(char Character)
+{
+	// Transmit the packet when it is full and continue with the next one
+	if (Shell_Data_Dump_Packet_Size == USB_CORE_ENDPOINT_PACKETS_SIZE)
+	{
+		USBCommunicationsCommitTransmissionPacket(Shell_Data_Dump_Port_ID, USB_CORE_ENDPOINT_PACKETS_SIZE);
+		Pointer_Shell_Data_Dump_Packet = USBCommunicationsAcquireTransmissionPacket(Shell_Data_Dump_Port_ID);
+		Shell_Data_Dump_Packet_Size = 0;
+	}
+
+	*Pointer_Shell_Data_Dump_Packet = (unsigned char) Character;
+	Pointer_Shell_Data_Dump_Packet++;
+	Shell_Data_Dump_Packet_Size++;
+}
+
+/** Append the hexadecimal representation of a byte to the USB packet being filled by the data dump.
+ * @param Byte The byte to convert.
+ */
+static void ShellDataDumpAppendHexadecimalByte(unsigned char Byte)
+{
+	ShellDataDumpAppendCharacter(Shell_Hexadecimal_Digits[Byte >> 4]);
+	ShellDataDumpAppendCharacter(Shell_Hexadecimal_Digits[Byte & 0x0F]);
+}
+
+/** Wait for the next character typed by the user, or read it from the input source when command lines are replayed.
+ * @return The received character.
+ */
+static char ShellWaitForCharacter(void)
 {
 	char Character;
-	unsigned char Length = 0;
 
-	// Immediately return with an empty string if the provided maximum length is too small
-	if (Maximum_Length <= 1)
+	// Go back to the shell port once the last input source character has been read
+	if (Shell_Input_Source_Callback != NULL)
 	{
-		if (Maximum_Length > 0) goto End;
-		return;
+		// No command is using the buses between two replayed command lines, so the binary commands channel can still be served while a macro is running
+#if USB_HID_IS_INTERFACE_ENABLED
+		USBHIDProcessReceivedFrame();
+#else
+		USBVendorProcessReceivedFrame();
+#endif
+
+		if (Shell_Input_Source_Callback(&Character) != 0) Shell_Input_Source_Callback = NULL;
+		return Character;
 	}
-	// Decrement the maximum length by one to always keep room for the terminating zero and to avoid computing "Maximum_Length - 1" in every loop of the following "while"
-	Maximum_Length--;
 
-	// Display the prompt
-	USBCommunicationsWriteString("\r\n" SHELL_STRING_PROMPT);
+	while (!USBCommunicationsIsCharacterAvailable(USB_COMMUNICATIONS_PORT_ID_SHELL))
+	{
+		// Give the shell back to a human when the program that was using it closes the port
+		if (!USBCommunicationsIsCommunicationEstablished(USB_COMMUNICATIONS_PORT_ID_SHELL)) Shell_Mode = SHELL_MODE_INTERACTIVE;
+
+		// Serve the binary commands channel while the user is typing, so both channels can be used at the same time
+#if USB_HID_IS_INTERFACE_ENABLED
+		USBHIDProcessReceivedFrame();
+#else
+		USBVendorProcessReceivedFrame();
+#endif
+	}
+
+	return USBCommunicationsReadCharacter(USB_COMMUNICATIONS_PORT_ID_SHELL);
+}
+
+/** Append the characters typed by the user to the command line buffer, with echo and basic line edition.
+ * @param Is_Continuation Set to 0 to receive a new command line, set to 1 to receive the end of a command line that did not fit in the buffer (its beginning has already been executed, so it can't be edited anymore).
+ * @return 0 if the end of the command line has been reached,
+ * @return 1 if the host sent the binary mode magic sequence (only when receiving a new command line in machine mode), the command line is empty in this case,
+ * @return 2 if the buffer is full while the command line continues,
+ * @return 3 if the user cancelled the end of the command line (only when receiving the end of a command line).
+ */
+static unsigned char ShellReceiveCommandLineCharacters(unsigned char Is_Continuation)
+{
+	char Character, *Pointer_String_Command_Line = Pointer_Shell_Command_Line + Shell_Command_Line_Length;
+	unsigned char Length = Shell_Command_Line_Length, Minimum_Length = Shell_Command_Line_Length, Magic_Sequence_Index = 0, Return_Value = 0;
 
 	while (1)
 	{
-		Character = USBCommunicationsReadCharacter();
+		// Let the caller consume the buffer when it is full, the next characters wait in the reception ring meanwhile
+		if (Length == Shell_Command_Line_Maximum_Length)
+		{
+			Return_Value = 2;
+			goto End;
+		}
+
+		Character = ShellWaitForCharacter();
+
+		// Detect the binary mode magic sequence, its control characters are discarded by the line edition. A user typing its key combinations in interactive mode would be stuck in the binary mode, and a macro can't contain it
+		if (!Is_Continuation && (Shell_Mode == SHELL_MODE_MACHINE) && !Shell_Is_Input_Source_Replayed)
+		{
+			if (Character == BINARY_PROTOCOL_MAGIC_SEQUENCE[Magic_Sequence_Index])
+			{
+				Magic_Sequence_Index++;
+				if (Magic_Sequence_Index == sizeof(BINARY_PROTOCOL_MAGIC_SEQUENCE) - 1) // Do not take the terminating zero into account
+				{
+					LOG(SHELL_IS_LOGGING_ENABLED, "Received the binary mode magic sequence.");
+					Pointer_String_Command_Line -= Length; // Discard the partially typed command line
+					Length = 0;
+					Return_Value = 1;
+					goto End;
+				}
+			}
+			else if (Character == BINARY_PROTOCOL_MAGIC_SEQUENCE[0]) Magic_Sequence_Index = 1;
+			else Magic_Sequence_Index = 0;
+		}
+
+		// A program or a replayed command line do not need the echo nor the line edition, so only keep the printable characters
+		if ((Shell_Mode == SHELL_MODE_MACHINE) || Shell_Is_Input_Source_Replayed)
+		{
+			if ((Character == '\n') || (Character == '\r'))
+			{
+				// Ignore the empty lines, so the second character of a CRLF sequence does not make an empty command
+				if (Is_Continuation || (Length > 0)) goto End;
+			}
+			else if (Character >= ' ')
+			{
+				*Pointer_String_Command_Line = Character;
+				Pointer_String_Command_Line++;
+				Length++;
+			}
+			continue;
+		}
+
 		switch (Character)
 		{
 			// Erase the whole line if any of the following key combination is detected
-			case 0x03: // Ctrl+C
+			case SHELL_CHARACTER_CANCEL: // Ctrl+C
 			case 0x04: // Ctrl+D
 			case 0x15: // Ctrl+U
+				// The beginning of a continued command line has already been executed, so the command can only be stopped
+				if (Is_Continuation)
+				{
+					Return_Value = 3;
+					goto End;
+				}
+
 				// Return the cursor to the beginning of the line, then erase it and display the prompt again
-				USBCommunicationsWriteString("\r\033[2K" SHELL_STRING_PROMPT); // This is VT100-specific but pretty fast
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\033[2K" SHELL_STRING_PROMPT); // This is VT100-specific but pretty fast
 				Pointer_String_Command_Line -= Length;
 				Length = 0;
 				break;
@@ -58,11 +207,11 @@ void ShellReadCommandLine(char *Pointer_String_Command_Line, unsigned char Maxim
 
 			case '\b':
 			case 127: // VT100 terminals send the DEL character when pressing backspace
-				// Remove the last character only if there is one
-				if (Length > 0)
+				// Remove the last character only if there is one that has not been consumed yet
+				if (Length > Minimum_Length)
 				{
 					// Go back one character, erase it then go back again
-					USBCommunicationsWriteString("\b \b");
+					USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\b \b");
 					Pointer_String_Command_Line--;
 					Length--;
 				}
@@ -78,14 +227,10 @@ void ShellReadCommandLine(char *Pointer_String_Command_Line, unsigned char Maxim
 				// Discard any control code not specifically handled before
 				if (Character < ' ') break;
 
-				// Discard the character if the maximum command line size is reached
-				if (Length < Maximum_Length)
-				{
-					*Pointer_String_Command_Line = Character;
-					Pointer_String_Command_Line++;
-					Length++;
-					USBCommunicationsWriteCharacter(Character);
-				}
+				*Pointer_String_Command_Line = Character;
+				Pointer_String_Command_Line++;
+				Length++;
+				USBCommunicationsWriteCharacter(USB_COMMUNICATIONS_PORT_ID_SHELL, Character);
 				break;
 		}
 	}
@@ -93,6 +238,131 @@ void ShellReadCommandLine(char *Pointer_String_Command_Line, unsigned char Maxim
 End:
 	// Terminate the string
 	*Pointer_String_Command_Line = 0;
+	Shell_Command_Line_Length = Length;
+	return Return_Value;
+}
+
+/** Discard the end of a command line that did not fit in the buffer and that has not been consumed by the command. */
+static void ShellDiscardCommandLineEnd(void)
+{
+	char Character;
+
+	if (Shell_Is_Command_Line_Complete) return;
+	LOG(SHELL_IS_LOGGING_ENABLED, "Discarding the end of the command line.");
+
+	do
+	{
+		Character = ShellWaitForCharacter();
+	} while ((Character != '\n') && (Character != '\r'));
+	Shell_Is_Command_Line_Complete = 1;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void ShellInitialize(void)
+{
+	LOG_BEGIN_SECTION(SHELL_IS_LOGGING_ENABLED)
+	{
+		unsigned char i;
+
+		// The binary search of ShellFindCommand() misses the commands that are out of order, and duplicate names are ambiguous
+		for (i = 1; i < SHELL_COMMANDS_COUNT; i++)
+		{
+			if (strcmp(Shell_Commands[i - 1].Pointer_String_Command, Shell_Commands[i].Pointer_String_Command) >= 0) LOG(SHELL_IS_LOGGING_ENABLED, "\033[31mThe shell command \"%s\" must be placed before the command \"%s\" in the Shell_Commands table.\033[0m", Shell_Commands[i].Pointer_String_Command, Shell_Commands[i - 1].Pointer_String_Command);
+		}
+	}
+	LOG_END_SECTION()
+}
+
+void ShellSetMode(TShellMode Mode)
+{
+	LOG(SHELL_IS_LOGGING_ENABLED, "Switching to the mode %u.", Mode);
+	Shell_Mode = Mode;
+}
+
+void ShellSetInputSource(TShellInputSourceCallback Input_Source_Callback)
+{
+	Shell_Input_Source_Callback = Input_Source_Callback;
+	Shell_Is_Input_Source_Replayed = 1;
+}
+
+unsigned char ShellReadCommandLine(char *Pointer_String_Command_Line, unsigned char Maximum_Length)
+{
+	unsigned char Result;
+
+	// Remember the buffer, so the arguments that do not fit in it can be received later by ShellReadNextArgument()
+	Pointer_Shell_Command_Line = Pointer_String_Command_Line;
+	Shell_Command_Line_Length = 0;
+	Shell_Is_Command_Line_Complete = 1;
+
+	// Immediately return with an empty string if the provided maximum length is too small
+	if (Maximum_Length <= 1)
+	{
+		if (Maximum_Length > 0) *Pointer_String_Command_Line = 0;
+		return 0;
+	}
+	Shell_Command_Line_Maximum_Length = Maximum_Length - 1; // Always keep room for the terminating zero
+
+	// Display the prompt
+	if ((Shell_Mode == SHELL_MODE_INTERACTIVE) && !Shell_Is_Input_Source_Replayed) USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\n" SHELL_STRING_PROMPT);
+
+	Result = ShellReceiveCommandLineCharacters(0);
+	if (Result == 2)
+	{
+		LOG(SHELL_IS_LOGGING_ENABLED, "The command line does not fit in the buffer, its end will be received later.");
+		Shell_Is_Command_Line_Complete = 0;
+		return 0;
+	}
+	return Result;
+}
+
+unsigned char ShellReadNextArgument(char **Pointer_Pointer_String_Argument, unsigned char *Pointer_Length)
+{
+	char *Pointer_String_Argument;
+	unsigned char Length, Result;
+
+	while (1)
+	{
+		Length = 0;
+		Pointer_String_Argument = ShellExtractNextToken(Pointer_Shell_Next_Argument, &Length);
+
+		// An argument can be used as is if it is followed by a separating character, otherwise it may continue in the characters that have not been received yet
+		if (Shell_Is_Command_Line_Complete || ((Pointer_String_Argument != NULL) && (Pointer_String_Argument + Length < Pointer_Shell_Command_Line + Shell_Command_Line_Length)))
+		{
+			if (Pointer_String_Argument == NULL) return 1;
+
+			Pointer_Shell_Next_Argument = Pointer_String_Argument + Length;
+			*Pointer_Pointer_String_Argument = Pointer_String_Argument;
+			*Pointer_Length = Length;
+			return 0;
+		}
+
+		// Move the beginning of the incomplete argument (if any) to the beginning of the buffer, and make room for the next characters
+		if (Pointer_String_Argument == NULL) Length = 0;
+		else
+		{
+			// The argument can't fit in the buffer
+			if (Pointer_String_Argument == Pointer_Shell_Command_Line)
+			{
+				LOG(SHELL_IS_LOGGING_ENABLED, "Error : an argument is too long to fit in the command line buffer.");
+				return 2;
+			}
+			memmove(Pointer_Shell_Command_Line, Pointer_String_Argument, Length);
+		}
+		Shell_Command_Line_Length = Length;
+		Pointer_Shell_Next_Argument = Pointer_Shell_Command_Line;
+
+		// Continue receiving the command line
+		Result = ShellReceiveCommandLineCharacters(1);
+		if (Result == 3)
+		{
+			LOG(SHELL_IS_LOGGING_ENABLED, "The user cancelled the command line.");
+			Shell_Is_Command_Line_Complete = 1; // There is nothing left to discard
+			return 2;
+		}
+		if (Result == 0) Shell_Is_Command_Line_Complete = 1;
+	}
 }
 
 char *ShellExtractNextToken(char *Pointer_String_Command_Line, unsigned char *Pointer_Token_Length)
@@ -149,40 +419,87 @@ char *ShellExtractNextToken(char *Pointer_String_Command_Line, unsigned char *Po
 	}
 }
 
+const TShellCommand *ShellFindCommand(char *Pointer_String_Command, unsigned char Length)
+{
+	unsigned char Lowest_Index = 0, Highest_Index = SHELL_COMMANDS_COUNT, Middle_Index, Compared_Length;
+	int Comparison_Result;
+	const TShellCommand *Pointer_Command;
+
+	// Use a binary search to find the command, the commands table is sorted by name, so only a few names are compared whatever the amount of commands
+	while (Lowest_Index < Highest_Index)
+	{
+		Middle_Index = (Lowest_Index + Highest_Index) / 2;
+		Pointer_Command = &Shell_Commands[Middle_Index];
+
+		// Compare the characters the two strings have in common, then the shortest string comes first if they are the same (the token is not zero-terminated)
+		if (Length < Pointer_Command->Command_Length) Compared_Length = Length;
+		else Compared_Length = Pointer_Command->Command_Length;
+		Comparison_Result = strncmp(Pointer_String_Command, Pointer_Command->Pointer_String_Command, Compared_Length);
+		if (Comparison_Result == 0) Comparison_Result = (int) Length - (int) Pointer_Command->Command_Length;
+
+		// Is it the right command ?
+		if (Comparison_Result == 0) return Pointer_Command;
+
+		// Continue with the half of the table that can contain the command
+		if (Comparison_Result < 0) Highest_Index = Middle_Index;
+		else Lowest_Index = Middle_Index + 1;
+	}
+
+	return NULL;
+}
+
 unsigned char ShellProcessCommand(char *Pointer_String_Command_Line)
 {
 	char *Pointer_String_Command;
-	unsigned char Token_Length = 0, i;
-	const TShellCommand *Pointer_Commands = Shell_Commands;
+	unsigned char Token_Length = 0, Return_Value = 1;
+	const TShellCommand *Pointer_Command;
 
 	// The first word is the command itself
 	Pointer_String_Command = ShellExtractNextToken(Pointer_String_Command_Line, &Token_Length);
+	if (Pointer_String_Command == NULL) goto Exit;
+
+	Pointer_Command = ShellFindCommand(Pointer_String_Command, Token_Length);
+	if (Pointer_Command == NULL) goto Exit;
+	LOG(SHELL_IS_LOGGING_ENABLED, "Found the matching command \"%s\", executing it.", Pointer_Command->Pointer_String_Command);
 
-	// Try to match any known command
-	for (i = 0; i < SHELL_COMMANDS_COUNT; i++)
+	// Run the command
+	if (Pointer_Command->Command_Callback == NULL)
 	{
-		// Is it the right command ?
-		if (ShellCompareTokenWithString(Pointer_String_Command, (char *) Pointer_Commands->Pointer_String_Command, Token_Length) == 0)
-		{
-			LOG(SHELL_IS_LOGGING_ENABLED, "Found the matching command \"%s\", executing it.", Pointer_Commands->Pointer_String_Command);
+		LOG(SHELL_IS_LOGGING_ENABLED, "Error : no command callback is provided, aborting.");
+		Return_Value = 2;
+		goto Exit;
+	}
 
-			// Run the command
-			if (Pointer_Commands->Command_Callback == NULL)
-			{
-				LOG(SHELL_IS_LOGGING_ENABLED, "Error : no command callback is provided, aborting.");
-				return 2;
-			}
-			// Provide the arguments list that point right after the command
-			Pointer_Commands->Command_Callback(Pointer_String_Command + Token_Length);
+	// Only the commands streaming their arguments can start before the whole command line has been received, the other ones get the arguments that fit in the buffer
+	if (!Pointer_Command->Are_Arguments_Streamed) ShellDiscardCommandLineEnd();
 
-			return 0;
-		}
+	// Provide the arguments list that point right after the command
+	Pointer_Shell_Next_Argument = Pointer_String_Command + Token_Length;
+	if (Pointer_Command->Command_Callback(Pointer_Shell_Next_Argument) != 0) Return_Value = 3;
+	else Return_Value = 0;
+
+Exit:
+	// A command may have stopped before consuming the whole command line (because of a syntax error for instance)
+	ShellDiscardCommandLineEnd();
+	return Return_Value;
+}
+
+void ShellWriteStatusLine(unsigned char Status)
+{
+	char String_Status_Line[] = "\r\n#0\r\n";
 
-		Pointer_Commands++;
+	// Report a single status for the command that set the input source up and all the replayed command lines
+	if (Shell_Is_Input_Source_Replayed)
+	{
+		if (Status != 0) Shell_Input_Source_Callback = NULL; // Stop replaying at the first failure, so its status is reported
+		if (Shell_Input_Source_Callback != NULL) return;
+		Shell_Is_Input_Source_Replayed = 0;
 	}
 
-	// No matching command was found
-	return 1;
+	if (Shell_Mode == SHELL_MODE_INTERACTIVE) return;
+
+	String_Status_Line[3] += Status; // All statuses are single digits
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, String_Status_Line);
 }
 
 unsigned char ShellCompareTokenWithString(char *Pointer_String_Token, char *Pointer_String_To_Compare, unsigned char Token_Length)
@@ -259,12 +576,159 @@ Exit:
 	return Return_Value;
 }
 
+unsigned char ShellReadRepeatLoopHeader(unsigned long *Pointer_Iterations_Count, unsigned short *Pointer_Delay)
+{
+	char *Pointer_String_Argument;
+	unsigned char Length;
+	unsigned long Value;
+
+	// Retrieve the iterations count
+	if ((ShellReadNextArgument(&Pointer_String_Argument, &Length) != 0) || (ShellConvertNumericalArgumentToBinary(Pointer_String_Argument, Length, Pointer_Iterations_Count) != 0) || (*Pointer_Iterations_Count == 0))
+	{
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : the repeat loop iterations count is missing or invalid.");
+		return 1;
+	}
+
+	// The delay between the iterations is optional
+	*Pointer_Delay = 0;
+	if (ShellReadNextArgument(&Pointer_String_Argument, &Length) != 0) goto Error_Missing_Body;
+	if (*Pointer_String_Argument == 'd')
+	{
+		if ((ShellConvertNumericalArgumentToBinary(Pointer_String_Argument + 1, Length - 1, &Value) != 0) || (Value > 65535)) // Add one to bypass the 'd' character
+		{
+			USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : the repeat loop delay is invalid, make sure the value is in range [0,65535].");
+			return 1;
+		}
+		*Pointer_Delay = (unsigned short) Value;
+		LOG(SHELL_IS_LOGGING_ENABLED, "Found a repeat loop delay of %u ms.", *Pointer_Delay);
+
+		if (ShellReadNextArgument(&Pointer_String_Argument, &Length) != 0) goto Error_Missing_Body;
+	}
+
+	// The loop body must follow
+	if ((Length == 1) && (*Pointer_String_Argument == '{'))
+	{
+		LOG(SHELL_IS_LOGGING_ENABLED, "Found a repeat loop of %lu iterations.", *Pointer_Iterations_Count);
+		return 0;
+	}
+
+Error_Missing_Body:
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : the repeat loop body must start with \"{\".");
+	return 1;
+}
+
+unsigned char ShellReadTransactionWindow(TShellTransactionWindow *Pointer_Window, void *Pointer_Commands, unsigned char Command_Size, TShellTransactionCommandParserCallback Command_Parser_Callback)
+{
+	char *Pointer_String_Argument;
+	unsigned char Length, Result, *Pointer_Command = Pointer_Commands;
+
+	// The window following a repeat loop header holds the loop body
+	Pointer_Window->Is_Repeat_Loop_Body = Pointer_Window->Is_Repeat_Loop_Pending;
+	Pointer_Window->Is_Repeat_Loop_Pending = 0;
+
+	// Parse a window of commands to validate their syntax before executing them
+	Pointer_Window->Commands_Count = 0;
+	while (Pointer_Window->Is_Repeat_Loop_Body || (Pointer_Window->Commands_Count < SHELL_TRANSACTION_WINDOW_SIZE)) // The loop body window is terminated by the "}" character only
+	{
+		Result = ShellReadNextArgument(&Pointer_String_Argument, &Length);
+		if (Result == 1)
+		{
+			if (Pointer_Window->Is_Repeat_Loop_Body)
+			{
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : the repeat loop body must end with \"}\".");
+				return 1;
+			}
+			Pointer_Window->Is_Command_Line_End_Reached = 1;
+			break;
+		}
+		if (Result == 2)
+		{
+			USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : a command is too long or the command line has been cancelled.");
+			return 1;
+		}
+		LOG(SHELL_IS_LOGGING_ENABLED, "Transaction command (not zero terminated) : \"%s\".", Pointer_String_Argument);
+
+		// Handle the repeat loop keywords
+		if (ShellCompareTokenWithString(Pointer_String_Argument, "repeat", Length) == 0)
+		{
+			if (Pointer_Window->Is_Repeat_Loop_Body)
+			{
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : repeat loops can't be nested.");
+				return 1;
+			}
+			if (ShellReadRepeatLoopHeader(&Pointer_Window->Repeat_Loop_Iterations_Count, &Pointer_Window->Repeat_Loop_Delay) != 0) return 1;
+
+			// Execute the commands preceding the loop, the loop body is parsed in the next window
+			Pointer_Window->Is_Repeat_Loop_Pending = 1;
+			break;
+		}
+		if ((Length == 1) && (*Pointer_String_Argument == '}'))
+		{
+			if (!Pointer_Window->Is_Repeat_Loop_Body)
+			{
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : \"}\" does not end a repeat loop body.");
+				return 1;
+			}
+			break;
+		}
+		if (Pointer_Window->Commands_Count == SHELL_TRANSACTION_WINDOW_SIZE)
+		{
+			USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : a repeat loop body can't contain more than 16 commands.");
+			return 1;
+		}
+
+		// Let the bus command parse the command
+		if (Command_Parser_Callback(Pointer_String_Argument, Length, Pointer_Command) != 0) return 1;
+
+		// Go to the next available command slot
+		Pointer_Command += Command_Size;
+		Pointer_Window->Commands_Count++;
+	}
+
+	return 0;
+}
+
+unsigned char ShellWaitForNextRepeatLoopIteration(unsigned short Delay)
+{
+	while (1)
+	{
+		// Leave the received characters in place as long as Ctrl+C is not among them, they may be the next command lines
+		if (USBCommunicationsIsCharacterReceived(USB_COMMUNICATIONS_PORT_ID_SHELL, SHELL_CHARACTER_CANCEL))
+		{
+			LOG(SHELL_IS_LOGGING_ENABLED, "The user stopped the repeat loop.");
+
+			// Discard what has been typed up to Ctrl+C, like a terminal does, which includes the end of the command line
+			while (USBCommunicationsIsCharacterAvailable(USB_COMMUNICATIONS_PORT_ID_SHELL))
+			{
+				if (USBCommunicationsReadCharacter(USB_COMMUNICATIONS_PORT_ID_SHELL) == SHELL_CHARACTER_CANCEL) break;
+			}
+			if (!Shell_Is_Input_Source_Replayed) Shell_Is_Command_Line_Complete = 1; // The end of a replayed command line is still read from the input source
+			return 1;
+		}
+
+		if (Delay == 0) return 0;
+		__delay_ms(1);
+		Delay--;
+	}
+}
+
 void ShellDisplayDataDump(unsigned long Starting_Address, unsigned char *Pointer_Data, unsigned char Data_Bytes_Count)
 {
 	#define MAXIMUM_DATA_BYTES_PER_LINE 16
 
-	unsigned char Chunk_Size, i, j, *Pointer_Data_Beginning, Data;
-	char String_Line[81], *Pointer_String, Character; // Use the same line format as `hexdump -C`, which is 78 characters long, append the CRLF sequence, then add space for the terminating zero
+	unsigned char Chunk_Size, i, *Pointer_Data_Beginning, Data, *Pointer_Address_Bytes;
+	char Character;
+
+	// Nothing to display
+	if (Data_Bytes_Count == 0) return;
+
+	// Send the dump to the data port when a program is listening to it, so the shell stays readable
+	if (USBCommunicationsIsCommunicationEstablished(USB_COMMUNICATIONS_PORT_ID_DATA)) Shell_Data_Dump_Port_ID = USB_COMMUNICATIONS_PORT_ID_DATA;
+	else Shell_Data_Dump_Port_ID = USB_COMMUNICATIONS_PORT_ID_SHELL;
+
+	// Use the same line format as `hexdump -C`, which is 78 characters long followed by the CRLF sequence, the lines are directly formatted into the USB packets to avoid a line buffer and its copy
+	Pointer_Shell_Data_Dump_Packet = USBCommunicationsAcquireTransmissionPacket(Shell_Data_Dump_Port_ID);
+	Shell_Data_Dump_Packet_Size = 0;
 
 	while (Data_Bytes_Count > 0)
 	{
@@ -272,51 +736,44 @@ void ShellDisplayDataDump(unsigned long Starting_Address, unsigned char *Pointer
 		if (Data_Bytes_Count >= MAXIMUM_DATA_BYTES_PER_LINE) Chunk_Size = MAXIMUM_DATA_BYTES_PER_LINE;
 		else Chunk_Size = Data_Bytes_Count;
 
-		// Put the address at the beginning of the string
-		Pointer_String = String_Line;
-		sprintf(Pointer_String, "%08lX  ", Starting_Address);
-		Pointer_String += 10;
+		// Put the address at the beginning of the line, starting from the most significant byte (the microcontroller is little-endian)
+		Pointer_Address_Bytes = ((unsigned char *) &Starting_Address) + sizeof(Starting_Address) - 1;
+		for (i = 0; i < sizeof(Starting_Address); i++)
+		{
+			ShellDataDumpAppendHexadecimalByte(*Pointer_Address_Bytes);
+			Pointer_Address_Bytes--;
+		}
+		ShellDataDumpAppendCharacter(' ');
+		ShellDataDumpAppendCharacter(' ');
 
 		// Append the dumped data
 		Pointer_Data_Beginning = Pointer_Data;
 		for (i = 0; i < Chunk_Size; i++)
 		{
 			// Dump one byte at a time
-			sprintf(Pointer_String, "%02X ", *Pointer_Data);
-			Pointer_String += 3;
+			ShellDataDumpAppendHexadecimalByte(*Pointer_Data);
+			ShellDataDumpAppendCharacter(' ');
 			Pointer_Data++;
 
 			// Add an extra separating space after displaying 8 bytes to make the reading easier
-			if (i == 7)
-			{
-				*Pointer_String = ' ';
-				Pointer_String++;
-			}
+			if (i == 7) ShellDataDumpAppendCharacter(' ');
 		}
 
 		// Fill the space remaining between the hexadecimal dump and the ASCII dump (if any)
 		for (; i < MAXIMUM_DATA_BYTES_PER_LINE; i++)
 		{
 			// Each hexadecimal dump is made of 2 characters followed by a space
-			for (j = 0; j < 3; j++)
-			{
-				*Pointer_String = ' ';
-				Pointer_String++;
-			}
+			ShellDataDumpAppendCharacter(' ');
+			ShellDataDumpAppendCharacter(' ');
+			ShellDataDumpAppendCharacter(' ');
 
 			// Take also into account the extra space separating the dumped hexadecimal values into two groups of 8 data
-			if (i == 7)
-			{
-				*Pointer_String = ' ';
-				Pointer_String++;
-			}
+			if (i == 7) ShellDataDumpAppendCharacter(' ');
 		}
 
 		// Append the characters that start the ASCII dump section
-		*Pointer_String = ' ';
-		Pointer_String++;
-		*Pointer_String = '|';
-		Pointer_String++;
+		ShellDataDumpAppendCharacter(' ');
+		ShellDataDumpAppendCharacter('|');
 
 		// Dump the same characters in ASCII mode
 		Pointer_Data = Pointer_Data_Beginning;
@@ -327,35 +784,25 @@ void ShellDisplayDataDump(unsigned long Starting_Address, unsigned char *Pointer
 			Pointer_Data++;
 
 			// Make sure only printable characters are shown
-			if ((Data >= ' ') && (Data <= '~')) Character = Data;
+			if ((Data >= ' ') && (Data <= '~')) Character = (char) Data;
 			else Character = '.';
 
-			// Append the character
-			*Pointer_String = Character;
-			Pointer_String++;
+			ShellDataDumpAppendCharacter(Character);
 		}
 
 		// Fill the space remaining until the end of the ASCII dump area (if any)
-		for (; i < MAXIMUM_DATA_BYTES_PER_LINE; i++)
-		{
-			*Pointer_String = ' ';
-			Pointer_String++;
-		}
-
-		// Terminate the ASCII dump section and the string
-		*Pointer_String = '|';
-		Pointer_String++;
-		*Pointer_String = '\r';
-		Pointer_String++;
-		*Pointer_String = '\n';
-		Pointer_String++;
-		*Pointer_String = 0;
+		for (; i < MAXIMUM_DATA_BYTES_PER_LINE; i++) ShellDataDumpAppendCharacter(' ');
 
-		// Display the result
-		USBCommunicationsWriteString(String_Line);
+		// Terminate the ASCII dump section and the line
+		ShellDataDumpAppendCharacter('|');
+		ShellDataDumpAppendCharacter('\r');
+		ShellDataDumpAppendCharacter('\n');
 
 		// Update the pointers for the next iteration
 		Starting_Address += Chunk_Size;
 		Data_Bytes_Count -= Chunk_Size;
 	}
+
+	// Transmit the last packet, which is never empty
+	USBCommunicationsCommitTransmissionPacket(Shell_Data_Dump_Port_ID, Shell_Data_Dump_Packet_Size);
 }
@@ -8,21 +8,23 @@
 //-------------------------------------------------------------------------------------------------
 // Public functions
 //-------------------------------------------------------------------------------------------------
-void ShellCommandHelpCallback(char __attribute__((unused)) *Pointer_String_Arguments)
+unsigned char ShellCommandHelpCallback(char __attribute__((unused)) *Pointer_String_Arguments)
 {
 	unsigned char i;
 	const TShellCommand *Pointer_Command = Shell_Commands;
 
 	// Display all available commands
-	USBCommunicationsWriteString("\r\nAvailable commands :");
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nAvailable commands :");
 	for (i = 0; i < SHELL_COMMANDS_COUNT; i++)
 	{
-		// Send a lot of USB packets, which takes a bit of time, but this avoids using one more buffer
-		USBCommunicationsWriteString("\r\n  ");
-		USBCommunicationsWriteString((char *) Pointer_Command->Pointer_String_Command);
-		USBCommunicationsWriteString(" : ");
-		USBCommunicationsWriteString((char *) Pointer_Command->Pointer_String_Description);
+		// The strings are coalesced by the USB transmission buffer, so there is no need to concatenate them here
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\n  ");
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, (char *) Pointer_Command->Pointer_String_Command);
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, " : ");
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, (char *) Pointer_Command->Pointer_String_Description);
 
 		Pointer_Command++;
 	}
+
+	return 0;
 }
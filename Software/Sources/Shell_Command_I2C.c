@@ -16,224 +16,304 @@
 #define SHELL_I2C_IS_LOGGING_ENABLED 1
 
 //-------------------------------------------------------------------------------------------------
-// Public functions
+// Private types
 //-------------------------------------------------------------------------------------------------
-void ShellCommandI2CCallback(char *Pointer_String_Arguments)
+/** All supported command types. */
+typedef enum
 {
-	/** The maximum amount of commands that can be read from the command line. */
-	#define MAXIMUM_COMMANDS_COUNT 16
-
-	/** All supported command types. */
-	typedef enum
-	{
-		I2C_COMMAND_TYPE_GENERATE_START,
-		I2C_COMMAND_TYPE_GENERATE_STOP,
-		I2C_COMMAND_TYPE_READ,
-		I2C_COMMAND_TYPE_WRITE
-	} TI2CCommandType;
-
-	/** Efficiently store the command parameters. */
-	typedef struct
+	I2C_COMMAND_TYPE_GENERATE_START,
+	I2C_COMMAND_TYPE_GENERATE_STOP,
+	I2C_COMMAND_TYPE_READ,
+	I2C_COMMAND_TYPE_WRITE
+} TI2CCommandType;
+
+/** Efficiently store the command parameters. */
+typedef struct
+{
+	TI2CCommandType Type;
+	union
 	{
-		TI2CCommandType Type;
-		union
-		{
-			unsigned long Bytes_Count; //!< For a read operation, how many bytes to read.
-			unsigned char Data; //!< For a write operation, the data byte to write.
-		};
-	} TI2CCommand;
+		unsigned long Bytes_Count; //!< For a read operation, how many bytes to read.
+		unsigned char Data; //!< For a write operation, the data byte to write.
+	};
+} TI2CCommand;
 
-	TI2CCommand Commands[MAXIMUM_COMMANDS_COUNT], *Pointer_Command = Commands;
-	unsigned char Commands_Count = 0, Length = 0, i, Is_Start_Generated = 0;
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Parse a single I2C transaction command (see TShellTransactionCommandParserCallback for the parameters). */
+static unsigned char ShellCommandI2CParseCommand(char *Pointer_String_Command, unsigned char Length, void *Pointer_Command)
+{
+	TI2CCommand *Pointer_I2C_Command = Pointer_Command;
 	unsigned long Value;
-	// Both buffers are never used at the same time, so make sure to reuse the same memory area
-	union
-	{
-		char String_Temporary[32];
-		unsigned char Buffer_Temporary[32];
-	} Buffers;
 
-	// Parse all commands to validate the command line syntax
-	while (*Pointer_String_Arguments != 0)
+	switch (*Pointer_String_Command)
 	{
-		Pointer_String_Arguments = ShellExtractNextToken(Pointer_String_Arguments, &Length);
-		if (Pointer_String_Arguments == NULL) break;
-		LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Command (not zero terminated) : \"%s\".", Pointer_String_Arguments);
+		case '[':
+			LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Found an \"I2C START\" command.");
+			Pointer_I2C_Command->Type = I2C_COMMAND_TYPE_GENERATE_START;
+			break;
 
-		// Parse the next command
-		switch (*Pointer_String_Arguments)
-		{
-			case '[':
-				LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Found an \"I2C START\" command.");
-				Pointer_Command->Type = I2C_COMMAND_TYPE_GENERATE_START;
-				break;
+		case ']':
+			LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Found an \"I2C STOP\" command.");
+			Pointer_I2C_Command->Type = I2C_COMMAND_TYPE_GENERATE_STOP;
+			break;
 
-			case ']':
-				LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Found an \"I2C STOP\" command.");
-				Pointer_Command->Type = I2C_COMMAND_TYPE_GENERATE_STOP;
-				break;
+		case 'r':
+			LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Found an \"I2C READ\" command, parsing it.");
 
-			case 'r':
-				LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Found an \"I2C READ\" command, parsing it.");
+			// Make sure that the bytes count was provided to the read command
+			if (Length == 1)
+			{
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : please provide the amount of bytes to read with the \"r\" command.");
+				return 1;
+			}
 
-				// Make sure that the bytes count was provided to the read command
-				if (Length == 1)
-				{
-					USBCommunicationsWriteString("\r\nError : please provide the amount of bytes to read with the \"r\" command.");
-					return;
-				}
+			// Convert the bytes count to binary
+			if (ShellConvertNumericalArgumentToBinary(Pointer_String_Command + 1, Length - 1, &Value) != 0) // Add one to bypass the 'r' character
+			{
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : the bytes count argument provided to the read command is invalid.");
+				return 1;
+			}
 
-				// Convert the bytes count to binary
-				if (ShellConvertNumericalArgumentToBinary(Pointer_String_Arguments + 1, Length - 1, &Value) != 0) // Add one to bypass the 'r' character
-				{
-					USBCommunicationsWriteString("\r\nError : the bytes count argument provided to the read command is invalid.");
-					return;
-				}
+			// Fill the command
+			LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Asked to read %lu bytes.", Value);
+			Pointer_I2C_Command->Type = I2C_COMMAND_TYPE_READ;
+			Pointer_I2C_Command->Bytes_Count = Value;
+			break;
 
-				// Fill the command
-				LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Asked to read %lu bytes.", Value);
-				Pointer_Command->Type = I2C_COMMAND_TYPE_READ;
-				Pointer_Command->Bytes_Count = Value;
-				break;
+		default:
+			LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Trying to find a write command.");
 
-			default:
-				LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Trying to find a write command.");
+			// Convert the bytes count to binary
+			if (ShellConvertNumericalArgumentToBinary(Pointer_String_Command, Length, &Value) != 0)
+			{
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : a command is invalid.");
+				return 1;
+			}
 
-				// Convert the bytes count to binary
-				if (ShellConvertNumericalArgumentToBinary(Pointer_String_Arguments, Length, &Value) != 0)
-				{
-					USBCommunicationsWriteString("\r\nError : a command is invalid.");
-					return;
-				}
+			// Only bytes are allowed
+			if (Value > 255)
+			{
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : only bytes are allowed as a write command data, make sure the value is in range [0,255].");
+				return 1;
+			}
 
-				// Only bytes are allowed
-				if (Value > 255)
-				{
-					USBCommunicationsWriteString("\r\nError : only bytes are allowed as a write command data, make sure the value is in range [0,255].");
-					return;
-				}
+			// Fill the command
+			Pointer_I2C_Command->Type = I2C_COMMAND_TYPE_WRITE;
+			Pointer_I2C_Command->Data = (unsigned char) Value;
+			LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Found a write command with value 0x%02X.",  Pointer_I2C_Command->Data);
+			break;
+	}
 
-				// Fill the command
-				Pointer_Command->Type = I2C_COMMAND_TYPE_WRITE;
-				Pointer_Command->Data = (unsigned char) Value;
-				LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Found a write command with value 0x%02X.",  Pointer_Command->Data);
-				break;
-		}
+	return 0;
+}
 
-		// Go to the next available command slot
-		Commands_Count++;
-		if (Commands_Count > MAXIMUM_COMMANDS_COUNT)
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+unsigned char ShellCommandI2CCallback(char __attribute__((unused)) *Pointer_String_Arguments)
+{
+	TI2CCommand Commands[SHELL_TRANSACTION_WINDOW_SIZE], *Pointer_Command;
+	TShellTransactionWindow Window = {0};
+	unsigned char i, Is_Start_Generated = 0, Is_Window_Executed = 0, Is_Bus_Error = 0, Is_Repeat_Loop_Cancelled = 0, Is_Iteration_Failed, Minimum_Read_Byte, Maximum_Read_Byte;
+	unsigned long Iterations_Count, Iteration, Failed_Iterations_Count, Read_Bytes_Count;
+	// Both buffers are never used at the same time, so make sure to reuse the same memory area
+	union
+	{
+		char String_Temporary[32];
+		unsigned char Buffer_Temporary[32];
+	} Buffers;
+
+	do
+	{
+		// Parse a window of commands to validate their syntax before executing them
+		if (ShellReadTransactionWindow(&Window, Commands, sizeof(Commands[0]), ShellCommandI2CParseCommand) != 0) goto Exit;
+
+		// Nothing to execute
+		if (Window.Commands_Count == 0)
 		{
-			USBCommunicationsWriteString("\r\nError : the maximum amount of commands has been reached.");
-			return;
+			// A loop can start the transaction or have an empty body
+			if (Window.Is_Repeat_Loop_Pending || Window.Is_Repeat_Loop_Body) continue;
+
+			// Tell the user that no command was provided
+			if (!Is_Window_Executed)
+			{
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nNo I2C command was given.");
+				return 1;
+			}
+			break;
 		}
-		Pointer_Command++;
-	}
+		LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Parsed %u commands, now executing them.", Window.Commands_Count);
 
-	// Tell the user that no command was provided
-	if (Commands_Count == 0)
-	{
-		USBCommunicationsWriteString("\r\nNo I2C command was given.");
-		return;
-	}
-	LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Parsed %u commands, now executing them.", Commands_Count);
+		// Configure the I2C interface before executing the first command
+		if (!Is_Window_Executed) MSSPSetFunctioningMode(MSSP_FUNCTIONING_MODE_I2C);
 
-	// Configure the I2C interface
-	MSSPSetFunctioningMode(MSSP_FUNCTIONING_MODE_I2C);
+		// A repeated window is executed without displaying anything, only a summary is displayed at the end
+		if (Window.Is_Repeat_Loop_Body) Iterations_Count = Window.Repeat_Loop_Iterations_Count;
+		else Iterations_Count = 1;
+		Failed_Iterations_Count = 0;
+		Read_Bytes_Count = 0;
+		Minimum_Read_Byte = 255;
+		Maximum_Read_Byte = 0;
 
-	// Execute the commands
-	Pointer_Command = Commands;
-	for (i = 0; i < Commands_Count; i++)
-	{
-		LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Executing command %u.", i);
-		switch (Pointer_Command->Type)
+		for (Iteration = 0; Iteration < Iterations_Count; Iteration++)
 		{
-			case I2C_COMMAND_TYPE_GENERATE_START:
-				// Differentiate between an I2C start and a repeated start
-				if (Is_Start_Generated)
-				{
-					LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Generating a REPEATED START.");
-					MSSPI2CGenerateRepeatedStart();
-				}
-				else
-				{
-					LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Generating a START.");
-					MSSPI2CGenerateStart();
-					Is_Start_Generated = 1;
-				}
-				break;
-
-			case I2C_COMMAND_TYPE_GENERATE_STOP:
-				LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Generating a STOP.");
-				MSSPI2CGenerateStop();
-				Is_Start_Generated = 0;
+			// Wait between two iterations, the user can stop the loop meanwhile
+			if ((Iteration > 0) && (ShellWaitForNextRepeatLoopIteration(Window.Repeat_Loop_Delay) != 0))
+			{
+				Is_Repeat_Loop_Cancelled = 1;
+				Iterations_Count = Iteration; // Summarize only the executed iterations
 				break;
+			}
 
-			case I2C_COMMAND_TYPE_READ:
+			// Execute the window
+			Is_Iteration_Failed = 0;
+			Pointer_Command = Commands;
+			for (i = 0; i < Window.Commands_Count; i++)
 			{
-				unsigned char Is_Acknowledge_Generated, *Pointer_Data_Buffer, Chunk_Size, Bytes_To_Display_Count;
-				unsigned long Remaining_Bytes_Count = Pointer_Command->Bytes_Count, Address = 0;
-
-				// Read all bytes one chunk at a time
-				snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nReading %lu bytes.\r\n", Remaining_Bytes_Count);
-				USBCommunicationsWriteString(Buffers.String_Temporary);
-				LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Reading %lu bytes.", Remaining_Bytes_Count);
-
-				while (Remaining_Bytes_Count > 0)
+				LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Executing command %u.", i);
+				switch (Pointer_Command->Type)
 				{
-					// Find the next chunk size
-					if (Remaining_Bytes_Count >= sizeof(Buffers.Buffer_Temporary)) Chunk_Size = sizeof(Buffers.Buffer_Temporary);
-					else Chunk_Size = (unsigned char) Remaining_Bytes_Count;
-					Bytes_To_Display_Count = Chunk_Size;
-
-					// Read the chunk of data
-					Pointer_Data_Buffer = Buffers.Buffer_Temporary;
-					while (Chunk_Size > 0)
+					case I2C_COMMAND_TYPE_GENERATE_START:
+						// Differentiate between an I2C start and a repeated start
+						if (Is_Start_Generated)
+						{
+							LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Generating a REPEATED START.");
+							MSSPI2CGenerateRepeatedStart();
+						}
+						else
+						{
+							LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Generating a START.");
+							MSSPI2CGenerateStart();
+							Is_Start_Generated = 1;
+						}
+						break;
+
+					case I2C_COMMAND_TYPE_GENERATE_STOP:
+						LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Generating a STOP.");
+						MSSPI2CGenerateStop();
+						Is_Start_Generated = 0;
+						break;
+
+					case I2C_COMMAND_TYPE_READ:
 					{
-						// Send a NACK if this is the last byte to read
-						if (Remaining_Bytes_Count == 1) Is_Acknowledge_Generated = 0;
-						else Is_Acknowledge_Generated = 1;
-
-						// Read the byte
-						LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Reading the next byte and sending %s to the slave device.", Is_Acknowledge_Generated ? "ACK" : "NACK");
-						*Pointer_Data_Buffer = MSSPI2CReadByte(Is_Acknowledge_Generated);
-
-						// Prepare for the next chunk
-						Chunk_Size--;
-						Remaining_Bytes_Count--;
-						Pointer_Data_Buffer++;
+						unsigned char Is_Acknowledge_Generated, *Pointer_Data_Buffer, Chunk_Size, Bytes_To_Display_Count;
+						unsigned long Remaining_Bytes_Count = Pointer_Command->Bytes_Count, Address = 0;
+
+						// Read all bytes one chunk at a time
+						if (!Window.Is_Repeat_Loop_Body)
+						{
+							snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nReading %lu bytes.\r\n", Remaining_Bytes_Count);
+							USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, Buffers.String_Temporary);
+						}
+						LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Reading %lu bytes.", Remaining_Bytes_Count);
+
+						while (Remaining_Bytes_Count > 0)
+						{
+							// Find the next chunk size
+							if (Remaining_Bytes_Count >= sizeof(Buffers.Buffer_Temporary)) Chunk_Size = sizeof(Buffers.Buffer_Temporary);
+							else Chunk_Size = (unsigned char) Remaining_Bytes_Count;
+							Bytes_To_Display_Count = Chunk_Size;
+
+							// Read the chunk of data
+							Pointer_Data_Buffer = Buffers.Buffer_Temporary;
+							while (Chunk_Size > 0)
+							{
+								// Send a NACK if this is the last byte to read
+								if (Remaining_Bytes_Count == 1) Is_Acknowledge_Generated = 0;
+								else Is_Acknowledge_Generated = 1;
+
+								// Read the byte
+								LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Reading the next byte and sending %s to the slave device.", Is_Acknowledge_Generated ? "ACK" : "NACK");
+								*Pointer_Data_Buffer = MSSPI2CReadByte(Is_Acknowledge_Generated);
+
+								// Keep the read values range for the repeat loop summary
+								if (*Pointer_Data_Buffer < Minimum_Read_Byte) Minimum_Read_Byte = *Pointer_Data_Buffer;
+								if (*Pointer_Data_Buffer > Maximum_Read_Byte) Maximum_Read_Byte = *Pointer_Data_Buffer;
+
+								// Prepare for the next chunk
+								Chunk_Size--;
+								Remaining_Bytes_Count--;
+								Pointer_Data_Buffer++;
+							}
+							Read_Bytes_Count += Bytes_To_Display_Count;
+
+							// Display the data
+							if (!Window.Is_Repeat_Loop_Body) ShellDisplayDataDump(Address, Buffers.Buffer_Temporary, Bytes_To_Display_Count);
+							Address += sizeof(Buffers.Buffer_Temporary);
+						}
+
+						break;
 					}
 
-					// Display the data
-					ShellDisplayDataDump(Address, Buffers.Buffer_Temporary, Bytes_To_Display_Count);
-					Address += sizeof(Buffers.Buffer_Temporary);
+					case I2C_COMMAND_TYPE_WRITE:
+					{
+						unsigned char Is_Not_Acknowledge_Received;
+
+						LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Writing the byte 0x%02X.", Pointer_Command->Data);
+						Is_Not_Acknowledge_Received = MSSPI2CWriteByte(Pointer_Command->Data);
+						if (Is_Not_Acknowledge_Received)
+						{
+							if (!Window.Is_Repeat_Loop_Body)
+							{
+								snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nGot NACK to the write 0x%02X.", Pointer_Command->Data);
+								USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, Buffers.String_Temporary);
+							}
+							Is_Iteration_Failed = 1;
+						}
+
+						break;
+					}
 				}
 
-				break;
+				// Go to the next command
+				Pointer_Command++;
 			}
 
-			case I2C_COMMAND_TYPE_WRITE:
-			{
-				unsigned char Is_Not_Acknowledge_Received;
+			if (Is_Iteration_Failed) Failed_Iterations_Count++;
+		}
 
-				LOG(SHELL_I2C_IS_LOGGING_ENABLED, "Writing the byte 0x%02X.", Pointer_Command->Data);
-				Is_Not_Acknowledge_Received = MSSPI2CWriteByte(Pointer_Command->Data);
-				if (Is_Not_Acknowledge_Received)
-				{
-					snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nGot NACK to the write 0x%02X.", Pointer_Command->Data);
-					USBCommunicationsWriteString(Buffers.String_Temporary);
-				}
+		// Signal the NACKs once, even if many iterations got some
+		if (Failed_Iterations_Count > 0)
+		{
+			USBCommunicationsSignalEvents(USB_COMMUNICATIONS_PORT_ID_SHELL, USB_COMMUNICATIONS_EVENT_BUS_ERROR);
+			Is_Bus_Error = 1;
+		}
 
-				break;
+		// Summarize the repeat loop
+		if (Window.Is_Repeat_Loop_Body)
+		{
+			snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nIterations : %lu.", Iterations_Count);
+			USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, Buffers.String_Temporary);
+			snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nPassed : %lu.", Iterations_Count - Failed_Iterations_Count);
+			USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, Buffers.String_Temporary);
+			snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nGot a NACK : %lu.", Failed_Iterations_Count);
+			USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, Buffers.String_Temporary);
+			if (Read_Bytes_Count > 0)
+			{
+				snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nMinimum byte read : 0x%02X.", Minimum_Read_Byte);
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, Buffers.String_Temporary);
+				snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nMaximum byte read : 0x%02X.", Maximum_Read_Byte);
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, Buffers.String_Temporary);
 			}
 		}
 
-		// Go to the next command
-		Pointer_Command++;
-	}
+		Is_Window_Executed = 1;
+		if (Is_Repeat_Loop_Cancelled) goto Exit;
+	} while (!Window.Is_Command_Line_End_Reached);
+
+	// Let the host know that the transaction is over without having to poll the shell
+	USBCommunicationsSignalEvents(USB_COMMUNICATIONS_PORT_ID_SHELL, USB_COMMUNICATIONS_EVENT_TRANSACTION_DONE);
+	return Is_Bus_Error; // The transaction failed if a byte was not acknowledged
+
+Exit:
+	// The previous windows could not be validated along with the erroneous command or the stopped repeat loop
+	if (Is_Window_Executed) USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nThe transaction has been stopped, only its beginning has been executed.");
+	return 1;
 }
 
-void ShellCommandI2CConfigureCallback(char *Pointer_String_Arguments)
+unsigned char ShellCommandI2CConfigureCallback(char *Pointer_String_Arguments)
 {
 	unsigned char Length = 0;
 	TMSSPI2CFrequency Frequency;
@@ -242,22 +322,23 @@ void ShellCommandI2CConfigureCallback(char *Pointer_String_Arguments)
 	Pointer_String_Arguments = ShellExtractNextToken(Pointer_String_Arguments, &Length);
 	if (Pointer_String_Arguments == NULL)
 	{
-		USBCommunicationsWriteString("\r\nError : could not find the bus frequency argument.");
-		return;
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : could not find the bus frequency argument.");
+		return 1;
 	}
 	if (ShellCompareTokenWithString(Pointer_String_Arguments, "100khz", Length) == 0) Frequency = MSSP_I2C_FREQUENCY_100KHZ;
 	else if (ShellCompareTokenWithString(Pointer_String_Arguments, "400khz", Length) == 0) Frequency = MSSP_I2C_FREQUENCY_400KHZ;
 	else
 	{
-		USBCommunicationsWriteString("\r\nError : unsupported bus frequency argument. The allowed arguments are \"100khz\" and \"400khz\".");
-		return;
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : unsupported bus frequency argument. The allowed arguments are \"100khz\" and \"400khz\".");
+		return 1;
 	}
 
 	MSSPI2CSetFrequency(Frequency);
-	USBCommunicationsWriteString("\r\nSuccess.");
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nSuccess.");
+	return 0;
 }
 
-void ShellCommandI2CScanCallback(char __attribute__((unused)) *Pointer_String_Arguments)
+unsigned char ShellCommandI2CScanCallback(char __attribute__((unused)) *Pointer_String_Arguments)
 {
 	unsigned char i, Result;
 	char String_Temporary[32];
@@ -277,7 +358,9 @@ void ShellCommandI2CScanCallback(char __attribute__((unused)) *Pointer_String_Ar
 		if (Result == 0)
 		{
 			snprintf(String_Temporary, sizeof(String_Temporary), "\r\nAddress 0x%02X answered.", i);
-			USBCommunicationsWriteString(String_Temporary);
+			USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, String_Temporary);
 		}
 	}
+
+	return 0;
 }
@@ -0,0 +1,216 @@
+/** @file Shell_Command_Macro.c
+ * Implement all macro-related shell commands.
+ * @author Adrien RICCIARDI
+ */
+#include <Macro.h>
+#include <Shell.h>
+#include <Shell_Commands.h>
+#include <stdio.h>
+#include <USB_Communications.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** How many EEPROM bytes a typical device initialization command line like "i2c [ h50 h01 h80 ]" takes, including the command lines separator. */
+#define SHELL_COMMAND_MACRO_TYPICAL_COMMAND_LINE_SIZE 11
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** Which bus the transaction commands of the command line being recorded are sent to. */
+typedef enum : unsigned char
+{
+	SHELL_COMMAND_MACRO_TRANSACTION_BUS_NONE, //!< The command line is not a transaction, its arguments are stored as text.
+	SHELL_COMMAND_MACRO_TRANSACTION_BUS_I2C,
+	SHELL_COMMAND_MACRO_TRANSACTION_BUS_SPI
+} TShellCommandMacroTransactionBus;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Record an argument of an I2C or SPI command line, the transaction commands are stored as binary operations to save EEPROM space. The other arguments, like the repeat loop ones or a bytes count that does not fit in a byte, are stored as text.
+ * @param Pointer_String_Argument The argument, it does not need to be zero-terminated.
+ * @param Length The argument length.
+ * @param Bus The bus the command line is sent to.
+ * @return 0 on success,
+ * @return 1 if the EEPROM is full.
+ */
+static unsigned char ShellCommandMacroRecordTransactionArgument(char *Pointer_String_Argument, unsigned char Length, TShellCommandMacroTransactionBus Bus)
+{
+	unsigned long Value;
+
+	if (Length == 1)
+	{
+		if (*Pointer_String_Argument == '[') return MacroRecordOperation(Bus == SHELL_COMMAND_MACRO_TRANSACTION_BUS_I2C ? BINARY_COMMANDS_OPCODE_I2C_GENERATE_START : BINARY_COMMANDS_OPCODE_SPI_SELECT_SLAVE, 0);
+		if (*Pointer_String_Argument == ']') return MacroRecordOperation(Bus == SHELL_COMMAND_MACRO_TRANSACTION_BUS_I2C ? BINARY_COMMANDS_OPCODE_I2C_GENERATE_STOP : BINARY_COMMANDS_OPCODE_SPI_DESELECT_SLAVE, 0);
+	}
+
+	// An I2C read command
+	if ((Bus == SHELL_COMMAND_MACRO_TRANSACTION_BUS_I2C) && (*Pointer_String_Argument == 'r') && (Length > 1))
+	{
+		if ((ShellConvertNumericalArgumentToBinary(Pointer_String_Argument + 1, Length - 1, &Value) == 0) && (Value <= 255)) return MacroRecordOperation(BINARY_COMMANDS_OPCODE_I2C_READ, (unsigned char) Value); // Add one to bypass the 'r' character
+	}
+	// A byte to write
+	else if ((ShellConvertNumericalArgumentToBinary(Pointer_String_Argument, Length, &Value) == 0) && (Value <= 255)) return MacroRecordOperation(Bus == SHELL_COMMAND_MACRO_TRANSACTION_BUS_I2C ? BINARY_COMMANDS_OPCODE_I2C_WRITE : BINARY_COMMANDS_OPCODE_SPI_TRANSFER, (unsigned char) Value);
+
+	// Let the transaction command parser report an invalid argument when the macro is replayed
+	return MacroRecordArgument(Pointer_String_Argument, Length);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+unsigned char ShellCommandMacroListCallback(char __attribute__((unused)) *Pointer_String_Arguments)
+{
+	unsigned char Index, Free_Bytes_Count;
+	char String_Name[MACRO_MAXIMUM_NAME_LENGTH + 1], String_Temporary[32], Character;
+
+	for (Index = 0; MacroSelect(Index, String_Name) == 0; Index++)
+	{
+		snprintf(String_Temporary, sizeof(String_Temporary), "\r\n%u : %s :", Index, String_Name);
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, String_Temporary);
+
+		// Display the command lines the way they were recorded, the last character is the end of the last command line
+		USBCommunicationsWriteCharacter(USB_COMMUNICATIONS_PORT_ID_SHELL, ' ');
+		while (MacroReadCharacter(&Character) == 0)
+		{
+			if (Character == '\r') USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, " ; ");
+			else USBCommunicationsWriteCharacter(USB_COMMUNICATIONS_PORT_ID_SHELL, Character);
+		}
+	}
+	if (Index == 0) USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nNo macro is recorded.");
+
+	// Also tell the capacity in command lines, which is easier to figure out than bytes
+	Free_Bytes_Count = MacroGetFreeBytesCount();
+	snprintf(String_Temporary, sizeof(String_Temporary), "\r\n%u bytes are free, about %u", Free_Bytes_Count, Free_Bytes_Count / SHELL_COMMAND_MACRO_TYPICAL_COMMAND_LINE_SIZE);
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, String_Temporary);
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, " command lines like \"i2c [ h50 h01 h80 ]\".");
+	return 0;
+}
+
+unsigned char ShellCommandMacroRecordCallback(char __attribute__((unused)) *Pointer_String_Arguments)
+{
+	char *Pointer_String_Argument;
+	unsigned char Length, Result, Is_Command_Expected = 1, Is_Repeat_Loop_Header = 0;
+	const TShellCommand *Pointer_Command;
+	TShellCommandMacroTransactionBus Transaction_Bus = SHELL_COMMAND_MACRO_TRANSACTION_BUS_NONE;
+
+	// Retrieve the macro name
+	if (ShellReadNextArgument(&Pointer_String_Argument, &Length) != 0)
+	{
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : could not find the macro name argument.");
+		return 1;
+	}
+	// A name starting with a digit could not be told from an index
+	if ((Length > MACRO_MAXIMUM_NAME_LENGTH) || ((*Pointer_String_Argument >= '0') && (*Pointer_String_Argument <= '9')))
+	{
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : a macro name must not start with a digit and can't be longer than 8 characters.");
+		return 1;
+	}
+	if (MacroRecordBegin(Pointer_String_Argument, Length) != 0) goto EEPROM_Full;
+
+	// Store the command lines while they are received, so they are not limited by the command line buffer size
+	while (1)
+	{
+		Result = ShellReadNextArgument(&Pointer_String_Argument, &Length);
+		if (Result == 1) break;
+		if (Result == 2)
+		{
+			USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : an argument is too long or the command line has been cancelled.");
+			return 1;
+		}
+
+		// The command lines are separated by semicolons
+		if ((Length == 1) && (*Pointer_String_Argument == ';'))
+		{
+			Is_Command_Expected = 1;
+			continue;
+		}
+
+		if (Is_Command_Expected)
+		{
+			// Check the command now rather than when the macro is replayed, the macro commands are refused because a macro replay can't be nested
+			Pointer_Command = ShellFindCommand(Pointer_String_Argument, Length);
+			if ((Pointer_Command == NULL) || (Pointer_Command->Command_Callback == ShellCommandMacroListCallback) || (Pointer_Command->Command_Callback == ShellCommandMacroRecordCallback) || (Pointer_Command->Command_Callback == ShellCommandMacroRunCallback))
+			{
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : a command is unknown or can't be recorded.");
+				return 1;
+			}
+
+			Result = MacroRecordCommand(Pointer_String_Argument, Length);
+			Is_Command_Expected = 0;
+
+			// Tell whether the arguments are transaction commands
+			if (Pointer_Command->Command_Callback == ShellCommandI2CCallback) Transaction_Bus = SHELL_COMMAND_MACRO_TRANSACTION_BUS_I2C;
+			else if (Pointer_Command->Command_Callback == ShellCommandSPICallback) Transaction_Bus = SHELL_COMMAND_MACRO_TRANSACTION_BUS_SPI;
+			else Transaction_Bus = SHELL_COMMAND_MACRO_TRANSACTION_BUS_NONE;
+			Is_Repeat_Loop_Header = 0;
+		}
+		else if (Transaction_Bus == SHELL_COMMAND_MACRO_TRANSACTION_BUS_NONE) Result = MacroRecordArgument(Pointer_String_Argument, Length);
+		else
+		{
+			// The repeat loop iterations count and delay are not transaction commands, the header ends with the loop body opening brace
+			if (ShellCompareTokenWithString(Pointer_String_Argument, "repeat", Length) == 0) Is_Repeat_Loop_Header = 1;
+			if (Is_Repeat_Loop_Header)
+			{
+				Result = MacroRecordArgument(Pointer_String_Argument, Length);
+				if ((Length == 1) && (*Pointer_String_Argument == '{')) Is_Repeat_Loop_Header = 0;
+			}
+			else Result = ShellCommandMacroRecordTransactionArgument(Pointer_String_Argument, Length, Transaction_Bus);
+		}
+		if (Result != 0) goto EEPROM_Full;
+	}
+
+	Result = MacroRecordEnd();
+	if (Result == 2)
+	{
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : no command line was given.");
+		return 1;
+	}
+	if (Result == 1) USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nThe macro has been deleted.");
+	else USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nSuccess.");
+	return 0;
+
+EEPROM_Full:
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : the EEPROM is full, the macro has not been recorded.");
+	return 1;
+}
+
+unsigned char ShellCommandMacroRunCallback(char *Pointer_String_Arguments)
+{
+	unsigned char Length = 0, Index;
+	unsigned long Value;
+
+	Pointer_String_Arguments = ShellExtractNextToken(Pointer_String_Arguments, &Length);
+	if (Pointer_String_Arguments == NULL)
+	{
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : could not find the macro name or index argument.");
+		return 1;
+	}
+
+	// A macro name never starts with a digit
+	if ((*Pointer_String_Arguments >= '0') && (*Pointer_String_Arguments <= '9'))
+	{
+		if ((ShellConvertNumericalArgumentToBinary(Pointer_String_Arguments, Length, &Value) != 0) || (Value > 255))
+		{
+			USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : the macro index is invalid.");
+			return 1;
+		}
+		Index = (unsigned char) Value;
+	}
+	else if (MacroFind(Pointer_String_Arguments, Length, &Index) != 0)
+	{
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : no macro has this name.");
+		return 1;
+	}
+
+	if (MacroSelect(Index, NULL) != 0)
+	{
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : no macro has this index.");
+		return 1;
+	}
+
+	// The command lines are executed by the shell once this command has returned
+	ShellSetInputSource(MacroReadCharacter);
+	return 0;
+}
@@ -8,9 +8,9 @@
 //-------------------------------------------------------------------------------------------------
 // Public functions
 //-------------------------------------------------------------------------------------------------
-void ShellCommandPinoutCallback(char __attribute__((unused)) *Pointer_String_Arguments)
+unsigned char ShellCommandPinoutCallback(char __attribute__((unused)) *Pointer_String_Arguments)
 {
-	USBCommunicationsWriteString("\r\n"
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\n"
 		"I2C :\r\n"
 		"  - SCL (clock) : IO 5\r\n"
 		"  - SDA (data)  : IO 4\r\n"
@@ -23,4 +23,5 @@ void ShellCommandPinoutCallback(char __attribute__((unused)) *Pointer_String_Arg
 		"  - RX (reception)    : IO 3\r\n"
 		"  - TX (transmission) : IO 2"
 	);
+	return 0;
 }
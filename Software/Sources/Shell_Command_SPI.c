@@ -6,6 +6,7 @@
 #include <MSSP.h>
 #include <Shell.h>
 #include <Shell_Commands.h>
+#include <stdio.h>
 #include <USB_Communications.h>
 
 //-------------------------------------------------------------------------------------------------
@@ -15,208 +16,277 @@
 #define SHELL_SPI_IS_LOGGING_ENABLED 1
 
 //-------------------------------------------------------------------------------------------------
-// Public functions
+// Private types
 //-------------------------------------------------------------------------------------------------
-void ShellCommandSPICallback(char *Pointer_String_Arguments)
+/** All supported command types. */
+typedef enum
 {
-	/** The maximum amount of commands that can be read from the command line. */
-	#define MAXIMUM_COMMANDS_COUNT 16
-
-	/** All supported command types. */
-	typedef enum
-	{
-		SPI_COMMAND_TYPE_SELECT_SLAVE,
-		SPI_COMMAND_TYPE_DESELECT_SLAVE,
-		SPI_COMMAND_TYPE_SINGLE_BYTE_TRANSFER,
-		SPI_COMMAND_TYPE_MULTIPLE_BYTES_TRANSFER
-	} TSPICommandType;
-
-	/** Efficiently store the command parameters. */
-	typedef struct
+	SPI_COMMAND_TYPE_SELECT_SLAVE,
+	SPI_COMMAND_TYPE_DESELECT_SLAVE,
+	SPI_COMMAND_TYPE_SINGLE_BYTE_TRANSFER,
+	SPI_COMMAND_TYPE_MULTIPLE_BYTES_TRANSFER
+} TSPICommandType;
+
+/** Efficiently store the command parameters. */
+typedef struct
+{
+	TSPICommandType Type;
+	union
 	{
-		TSPICommandType Type;
-		union
-		{
-			unsigned long Bytes_Count; //!< For a multiple bytes transfer operation, how many bytes to read.
-			unsigned char Data; //!< For a single byte transfer operation, the data byte to write.
-		};
-	} TSPICommand;
+		unsigned long Bytes_Count; //!< For a multiple bytes transfer operation, how many bytes to read.
+		unsigned char Data; //!< For a single byte transfer operation, the data byte to write.
+	};
+} TSPICommand;
 
-	TSPICommand Commands[MAXIMUM_COMMANDS_COUNT], *Pointer_Command = Commands;
-	unsigned char Commands_Count = 0, Length = 0, i;
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Parse a single SPI transaction command (see TShellTransactionCommandParserCallback for the parameters). */
+static unsigned char ShellCommandSPIParseCommand(char *Pointer_String_Command, unsigned char Length, void *Pointer_Command)
+{
+	TSPICommand *Pointer_SPI_Command = Pointer_Command;
 	unsigned long Value;
-	// Both buffers are never used at the same time, so make sure to reuse the same memory area
-	union
-	{
-		char String_Temporary[32];
-		unsigned char Buffer_Temporary[32];
-	} Buffers;
 
-	// Parse all commands to validate the command line syntax
-	while (*Pointer_String_Arguments != 0)
+	switch (*Pointer_String_Command)
 	{
-		Pointer_String_Arguments = ShellExtractNextToken(Pointer_String_Arguments, &Length);
-		if (Pointer_String_Arguments == NULL) break;
-		LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Command (not zero terminated) : \"%s\".", Pointer_String_Arguments);
-
-		// Parse the next command
-		switch (*Pointer_String_Arguments)
-		{
-			case '[':
-				LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Found a \"SPI select slave\" command.");
-				Pointer_Command->Type = SPI_COMMAND_TYPE_SELECT_SLAVE;
-				break;
-
-			case ']':
-				LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Found a \"SPI deselect slave\" command.");
-				Pointer_Command->Type = SPI_COMMAND_TYPE_DESELECT_SLAVE;
-				break;
+		case '[':
+			LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Found a \"SPI select slave\" command.");
+			Pointer_SPI_Command->Type = SPI_COMMAND_TYPE_SELECT_SLAVE;
+			break;
 
-			case 't':
-				LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Found a \"SPI multiple bytes transfer\" command, parsing it.");
+		case ']':
+			LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Found a \"SPI deselect slave\" command.");
+			Pointer_SPI_Command->Type = SPI_COMMAND_TYPE_DESELECT_SLAVE;
+			break;
 
-				// Make sure that the bytes count was provided to the read command
-				if (Length == 1)
-				{
-					USBCommunicationsWriteString("\r\nError : please provide the amount of bytes to transfer with the \"t\" command.");
-					return;
-				}
+		case 't':
+			LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Found a \"SPI multiple bytes transfer\" command, parsing it.");
 
-				// Convert the bytes count to binary
-				if (ShellConvertNumericalArgumentToBinary(Pointer_String_Arguments + 1, Length - 1, &Value) != 0) // Add one to bypass the 't' character
-				{
-					USBCommunicationsWriteString("\r\nError : the bytes count argument provided to the transfer command is invalid.");
-					return;
-				}
+			// Make sure that the bytes count was provided to the read command
+			if (Length == 1)
+			{
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : please provide the amount of bytes to transfer with the \"t\" command.");
+				return 1;
+			}
 
-				// Fill the command
-				LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Asked to transfer %lu bytes.", Value);
-				Pointer_Command->Type = SPI_COMMAND_TYPE_MULTIPLE_BYTES_TRANSFER;
-				Pointer_Command->Bytes_Count = Value;
-				break;
+			// Convert the bytes count to binary
+			if (ShellConvertNumericalArgumentToBinary(Pointer_String_Command + 1, Length - 1, &Value) != 0) // Add one to bypass the 't' character
+			{
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : the bytes count argument provided to the transfer command is invalid.");
+				return 1;
+			}
 
-			default:
-				LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Trying to find a single byte transfer command.");
+			// Fill the command
+			LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Asked to transfer %lu bytes.", Value);
+			Pointer_SPI_Command->Type = SPI_COMMAND_TYPE_MULTIPLE_BYTES_TRANSFER;
+			Pointer_SPI_Command->Bytes_Count = Value;
+			break;
 
-				// Convert the bytes count to binary
-				if (ShellConvertNumericalArgumentToBinary(Pointer_String_Arguments, Length, &Value) != 0)
-				{
-					USBCommunicationsWriteString("\r\nError : a command is invalid.");
-					return;
-				}
+		default:
+			LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Trying to find a single byte transfer command.");
 
-				// Only bytes are allowed
-				if (Value > 255)
-				{
-					USBCommunicationsWriteString("\r\nError : only bytes are allowed as a single byte transfer command data, make sure the value is in range [0,255].");
-					return;
-				}
+			// Convert the bytes count to binary
+			if (ShellConvertNumericalArgumentToBinary(Pointer_String_Command, Length, &Value) != 0)
+			{
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : a command is invalid.");
+				return 1;
+			}
 
-				// Fill the command
-				Pointer_Command->Type = SPI_COMMAND_TYPE_SINGLE_BYTE_TRANSFER;
-				Pointer_Command->Data = (unsigned char) Value;
-				LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Found a single byte transfer command with value 0x%02X.",  Pointer_Command->Data);
-				break;
-		}
+			// Only bytes are allowed
+			if (Value > 255)
+			{
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : only bytes are allowed as a single byte transfer command data, make sure the value is in range [0,255].");
+				return 1;
+			}
 
-		// Go to the next available command slot
-		Commands_Count++;
-		if (Commands_Count > MAXIMUM_COMMANDS_COUNT)
-		{
-			USBCommunicationsWriteString("\r\nError : the maximum amount of commands has been reached.");
-			return;
-		}
-		Pointer_Command++;
+			// Fill the command
+			Pointer_SPI_Command->Type = SPI_COMMAND_TYPE_SINGLE_BYTE_TRANSFER;
+			Pointer_SPI_Command->Data = (unsigned char) Value;
+			LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Found a single byte transfer command with value 0x%02X.",  Pointer_SPI_Command->Data);
+			break;
 	}
 
-	// Tell the user that no command was provided
-	if (Commands_Count == 0)
-	{
-		USBCommunicationsWriteString("\r\nNo SPI command was given.");
-		return;
-	}
-	LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Parsed %u commands, now executing them.", Commands_Count);
+	return 0;
+}
 
-	// Configure the SPI interface
-	MSSPSetFunctioningMode(MSSP_FUNCTIONING_MODE_SPI);
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+unsigned char ShellCommandSPICallback(char __attribute__((unused)) *Pointer_String_Arguments)
+{
+	TSPICommand Commands[SHELL_TRANSACTION_WINDOW_SIZE], *Pointer_Command;
+	TShellTransactionWindow Window = {0};
+	unsigned char i, Is_Window_Executed = 0, Is_Repeat_Loop_Cancelled = 0, Minimum_Received_Byte, Maximum_Received_Byte;
+	unsigned long Iterations_Count, Iteration, Received_Bytes_Count;
+	// Both buffers are never used at the same time, so make sure to reuse the same memory area
+	union
+	{
+		char String_Temporary[32];
+		unsigned char Buffer_Temporary[32];
+	} Buffers;
 
-	// Execute the commands
-	Pointer_Command = Commands;
-	for (i = 0; i < Commands_Count; i++)
+	do
 	{
-		LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Executing command %u.", i);
-		switch (Pointer_Command->Type)
-		{
-			case SPI_COMMAND_TYPE_SELECT_SLAVE:
-				LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Selecting the slave device.");
-				MSSPSPISelectSlave(1);
-				break;
+		// Parse a window of commands to validate their syntax before executing them
+		if (ShellReadTransactionWindow(&Window, Commands, sizeof(Commands[0]), ShellCommandSPIParseCommand) != 0) goto Exit;
 
-			case SPI_COMMAND_TYPE_DESELECT_SLAVE:
-				LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Deselecting the slave device.");
-				MSSPSPISelectSlave(0);
-				break;
+		// Nothing to execute
+		if (Window.Commands_Count == 0)
+		{
+			// A loop can start the transaction or have an empty body
+			if (Window.Is_Repeat_Loop_Pending || Window.Is_Repeat_Loop_Body) continue;
 
-			case SPI_COMMAND_TYPE_SINGLE_BYTE_TRANSFER:
+			// Tell the user that no command was provided
+			if (!Is_Window_Executed)
 			{
-				unsigned char Read_Byte;
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nNo SPI command was given.");
+				return 1;
+			}
+			break;
+		}
+		LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Parsed %u commands, now executing them.", Window.Commands_Count);
 
-				// Perform the transfer
-				LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Writing the byte 0x%02X.", Pointer_Command->Data);
-				Read_Byte = MSSPSPITransmitByte(Pointer_Command->Data);
+		// Configure the SPI interface before executing the first command
+		if (!Is_Window_Executed) MSSPSetFunctioningMode(MSSP_FUNCTIONING_MODE_SPI);
 
-				// Display the transferred data
-				sprintf(Buffers.String_Temporary, "\r\nSent : 0x%02X, received : 0x%02X.", Pointer_Command->Data, Read_Byte);
-				USBCommunicationsWriteString(Buffers.String_Temporary);
+		// A repeated window is executed without displaying anything, only a summary is displayed at the end
+		if (Window.Is_Repeat_Loop_Body) Iterations_Count = Window.Repeat_Loop_Iterations_Count;
+		else Iterations_Count = 1;
+		Received_Bytes_Count = 0;
+		Minimum_Received_Byte = 255;
+		Maximum_Received_Byte = 0;
+
+		for (Iteration = 0; Iteration < Iterations_Count; Iteration++)
+		{
+			// Wait between two iterations, the user can stop the loop meanwhile
+			if ((Iteration > 0) && (ShellWaitForNextRepeatLoopIteration(Window.Repeat_Loop_Delay) != 0))
+			{
+				Is_Repeat_Loop_Cancelled = 1;
+				Iterations_Count = Iteration; // Summarize only the executed iterations
 				break;
 			}
 
-			case SPI_COMMAND_TYPE_MULTIPLE_BYTES_TRANSFER:
+			// Execute the window
+			Pointer_Command = Commands;
+			for (i = 0; i < Window.Commands_Count; i++)
 			{
-				unsigned char *Pointer_Data_Buffer, Chunk_Size, Bytes_To_Display_Count;
-				unsigned long Remaining_Bytes_Count = Pointer_Command->Bytes_Count, Address = 0;
+				LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Executing command %u.", i);
+				switch (Pointer_Command->Type)
+				{
+					case SPI_COMMAND_TYPE_SELECT_SLAVE:
+						LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Selecting the slave device.");
+						MSSPSPISelectSlave(1);
+						break;
 
-				// Read all bytes one chunk at a time
-				snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nTransferring %lu bytes.\r\n", Remaining_Bytes_Count);
-				USBCommunicationsWriteString(Buffers.String_Temporary);
-				LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Transferring %lu bytes.", Remaining_Bytes_Count);
+					case SPI_COMMAND_TYPE_DESELECT_SLAVE:
+						LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Deselecting the slave device.");
+						MSSPSPISelectSlave(0);
+						break;
 
-				while (Remaining_Bytes_Count > 0)
-				{
-					// Find the next chunk size
-					if (Remaining_Bytes_Count >= sizeof(Buffers.Buffer_Temporary)) Chunk_Size = sizeof(Buffers.Buffer_Temporary);
-					else Chunk_Size = (unsigned char) Remaining_Bytes_Count;
-					Bytes_To_Display_Count = Chunk_Size;
-
-					// Read the chunk of data
-					Pointer_Data_Buffer = Buffers.Buffer_Temporary;
-					while (Chunk_Size > 0)
+					case SPI_COMMAND_TYPE_SINGLE_BYTE_TRANSFER:
 					{
-						// Read the byte
-						LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Reading the next byte while sending 0xFF to the slave device.");
-						*Pointer_Data_Buffer = MSSPSPITransmitByte(0xFF);
-
-						// Prepare for the next chunk
-						Chunk_Size--;
-						Remaining_Bytes_Count--;
-						Pointer_Data_Buffer++;
+						unsigned char Read_Byte;
+
+						// Perform the transfer
+						LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Writing the byte 0x%02X.", Pointer_Command->Data);
+						Read_Byte = MSSPSPITransmitByte(Pointer_Command->Data);
+
+						// Keep the received values range for the repeat loop summary
+						if (Read_Byte < Minimum_Received_Byte) Minimum_Received_Byte = Read_Byte;
+						if (Read_Byte > Maximum_Received_Byte) Maximum_Received_Byte = Read_Byte;
+						Received_Bytes_Count++;
+
+						// Display the transferred data
+						if (!Window.Is_Repeat_Loop_Body)
+						{
+							sprintf(Buffers.String_Temporary, "\r\nSent : 0x%02X, received : 0x%02X.", Pointer_Command->Data, Read_Byte);
+							USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, Buffers.String_Temporary);
+						}
+						break;
 					}
 
-					// Display the data
-					ShellDisplayDataDump(Address, Buffers.Buffer_Temporary, Bytes_To_Display_Count);
-					Address += sizeof(Buffers.Buffer_Temporary);
+					case SPI_COMMAND_TYPE_MULTIPLE_BYTES_TRANSFER:
+					{
+						unsigned char *Pointer_Data_Buffer, Chunk_Size, Bytes_To_Display_Count;
+						unsigned long Remaining_Bytes_Count = Pointer_Command->Bytes_Count, Address = 0;
+
+						// Read all bytes one chunk at a time
+						if (!Window.Is_Repeat_Loop_Body)
+						{
+							snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nTransferring %lu bytes.\r\n", Remaining_Bytes_Count);
+							USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, Buffers.String_Temporary);
+						}
+						LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Transferring %lu bytes.", Remaining_Bytes_Count);
+
+						while (Remaining_Bytes_Count > 0)
+						{
+							// Find the next chunk size
+							if (Remaining_Bytes_Count >= sizeof(Buffers.Buffer_Temporary)) Chunk_Size = sizeof(Buffers.Buffer_Temporary);
+							else Chunk_Size = (unsigned char) Remaining_Bytes_Count;
+							Bytes_To_Display_Count = Chunk_Size;
+
+							// Read the chunk of data
+							Pointer_Data_Buffer = Buffers.Buffer_Temporary;
+							while (Chunk_Size > 0)
+							{
+								// Read the byte
+								LOG(SHELL_SPI_IS_LOGGING_ENABLED, "Reading the next byte while sending 0xFF to the slave device.");
+								*Pointer_Data_Buffer = MSSPSPITransmitByte(0xFF);
+
+								// Keep the received values range for the repeat loop summary
+								if (*Pointer_Data_Buffer < Minimum_Received_Byte) Minimum_Received_Byte = *Pointer_Data_Buffer;
+								if (*Pointer_Data_Buffer > Maximum_Received_Byte) Maximum_Received_Byte = *Pointer_Data_Buffer;
+
+								// Prepare for the next chunk
+								Chunk_Size--;
+								Remaining_Bytes_Count--;
+								Pointer_Data_Buffer++;
+							}
+							Received_Bytes_Count += Bytes_To_Display_Count;
+
+							// Display the data
+							if (!Window.Is_Repeat_Loop_Body) ShellDisplayDataDump(Address, Buffers.Buffer_Temporary, Bytes_To_Display_Count);
+							Address += sizeof(Buffers.Buffer_Temporary);
+						}
+
+						break;
+					}
 				}
 
-				break;
+				// Go to the next command
+				Pointer_Command++;
 			}
 		}
 
-		// Go to the next command
-		Pointer_Command++;
-	}
+		// Summarize the repeat loop
+		if (Window.Is_Repeat_Loop_Body)
+		{
+			snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nIterations : %lu.", Iterations_Count);
+			USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, Buffers.String_Temporary);
+			if (Received_Bytes_Count > 0)
+			{
+				snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nMinimum byte received : 0x%02X.", Minimum_Received_Byte);
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, Buffers.String_Temporary);
+				snprintf(Buffers.String_Temporary, sizeof(Buffers.String_Temporary), "\r\nMaximum byte received : 0x%02X.", Maximum_Received_Byte);
+				USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, Buffers.String_Temporary);
+			}
+		}
+
+		Is_Window_Executed = 1;
+		if (Is_Repeat_Loop_Cancelled) goto Exit;
+	} while (!Window.Is_Command_Line_End_Reached);
+
+	// Let the host know that the transaction is over without having to poll the shell
+	USBCommunicationsSignalEvents(USB_COMMUNICATIONS_PORT_ID_SHELL, USB_COMMUNICATIONS_EVENT_TRANSACTION_DONE);
+	return 0;
+
+Exit:
+	// The previous windows could not be validated along with the erroneous command or the stopped repeat loop
+	if (Is_Window_Executed) USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nThe transaction has been stopped, only its beginning has been executed.");
+	return 1;
 }
 
-void ShellCommandSPIConfigureCallback(char *Pointer_String_Arguments)
+unsigned char ShellCommandSPIConfigureCallback(char *Pointer_String_Arguments)
 {
 	unsigned char Length = 0;
 	TMSSPSPIFrequency Frequency;
@@ -226,8 +296,8 @@ void ShellCommandSPIConfigureCallback(char *Pointer_String_Arguments)
 	Pointer_String_Arguments = ShellExtractNextToken(Pointer_String_Arguments, &Length);
 	if (Pointer_String_Arguments == NULL)
 	{
-		USBCommunicationsWriteString("\r\nError : could not find the bus frequency argument.");
-		return;
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : could not find the bus frequency argument.");
+		return 1;
 	}
 	if (ShellCompareTokenWithString(Pointer_String_Arguments, "50khz", Length) == 0) Frequency = MSSP_SPI_FREQUENCY_50KHZ;
 	else if (ShellCompareTokenWithString(Pointer_String_Arguments, "100khz", Length) == 0) Frequency = MSSP_SPI_FREQUENCY_100KHZ;
@@ -236,16 +306,16 @@ void ShellCommandSPIConfigureCallback(char *Pointer_String_Arguments)
 	else if (ShellCompareTokenWithString(Pointer_String_Arguments, "2mhz", Length) == 0) Frequency = MSSP_SPI_FREQUENCY_2MHZ;
 	else
 	{
-		USBCommunicationsWriteString("\r\nError : unsupported bus frequency argument. See the command help for a list of the allowed frequencies.");
-		return;
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : unsupported bus frequency argument. See the command help for a list of the allowed frequencies.");
+		return 1;
 	}
 
 	// Determine the mode
 	Pointer_String_Arguments = ShellExtractNextToken(Pointer_String_Arguments, &Length);
 	if (Pointer_String_Arguments == NULL)
 	{
-		USBCommunicationsWriteString("\r\nError : could not find the mode argument.");
-		return;
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : could not find the mode argument.");
+		return 1;
 	}
 	if (ShellCompareTokenWithString(Pointer_String_Arguments, "mode0", Length) == 0) Mode = MSSP_SPI_MODE_0;
 	else if (ShellCompareTokenWithString(Pointer_String_Arguments, "mode1", Length) == 0) Mode = MSSP_SPI_MODE_1;
@@ -253,12 +323,13 @@ void ShellCommandSPIConfigureCallback(char *Pointer_String_Arguments)
 	else if (ShellCompareTokenWithString(Pointer_String_Arguments, "mode3", Length) == 0) Mode = MSSP_SPI_MODE_3;
 	else
 	{
-		USBCommunicationsWriteString("\r\nError : unsupported mode argument. See the command help for a list of the allowed modes.");
-		return;
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : unsupported mode argument. See the command help for a list of the allowed modes.");
+		return 1;
 	}
 
 	// Apply the new settings
 	MSSPSPISetFrequency(Frequency);
 	MSSPSPISetMode(Mode);
-	USBCommunicationsWriteString("\r\nSuccess.");
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nSuccess.");
+	return 0;
 }
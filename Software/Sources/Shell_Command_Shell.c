@@ -0,0 +1,36 @@
+/** @file Shell_Command_Shell.c
+ * Implement all shell commands that configure the shell itself.
+ * @author Adrien RICCIARDI
+ */
+#include <Shell.h>
+#include <Shell_Commands.h>
+#include <stddef.h>
+#include <USB_Communications.h>
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+unsigned char ShellCommandShellModeCallback(char *Pointer_String_Arguments)
+{
+	unsigned char Length = 0;
+	TShellMode Mode;
+
+	// Determine the mode
+	Pointer_String_Arguments = ShellExtractNextToken(Pointer_String_Arguments, &Length);
+	if (Pointer_String_Arguments == NULL)
+	{
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : could not find the mode argument.");
+		return 1;
+	}
+	if (ShellCompareTokenWithString(Pointer_String_Arguments, "interactive", Length) == 0) Mode = SHELL_MODE_INTERACTIVE;
+	else if (ShellCompareTokenWithString(Pointer_String_Arguments, "machine", Length) == 0) Mode = SHELL_MODE_MACHINE;
+	else
+	{
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nError : unsupported mode argument. The allowed arguments are \"interactive\" and \"machine\".");
+		return 1;
+	}
+
+	ShellSetMode(Mode);
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nSuccess.");
+	return 0;
+}
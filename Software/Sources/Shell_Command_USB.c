@@ -0,0 +1,78 @@
+/** @file Shell_Command_USB.c
+ * Implement all USB-related shell commands.
+ * @author Adrien RICCIARDI
+ */
+#include <Link.h>
+#include <Shell_Commands.h>
+#include <stdio.h>
+#include <USB_Communications.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** A human-readable name for each link state. */
+static const char * const Pointer_Shell_Command_USB_Link_State_Names[LINK_STATES_COUNT] =
+{
+	"powered",
+	"bus reset",
+	"addressed",
+	"configured",
+	"shell opened",
+	"first command"
+};
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+unsigned char ShellCommandUSBBootTimeCallback(char __attribute__((unused)) *Pointer_String_Arguments)
+{
+	unsigned char i;
+	unsigned long Milliseconds_Count;
+	char String_Temporary[48];
+
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "\r\nTime elapsed since the firmware start :");
+	for (i = 0; i < LINK_STATES_COUNT; i++)
+	{
+		// All states have been reached because this command could be typed, but keep the check in case the command is called from somewhere else
+		if (LinkGetStateTime((TLinkState) i, &Milliseconds_Count) != 0) snprintf(String_Temporary, sizeof(String_Temporary), "\r\n%s : not reached.", Pointer_Shell_Command_USB_Link_State_Names[i]);
+		else snprintf(String_Temporary, sizeof(String_Temporary), "\r\n%s : %lu ms.", Pointer_Shell_Command_USB_Link_State_Names[i], Milliseconds_Count);
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, String_Temporary);
+	}
+
+	return 0;
+}
+
+unsigned char ShellCommandUSBStatisticsCallback(char __attribute__((unused)) *Pointer_String_Arguments)
+{
+	TUSBCoreStatistics Statistics;
+	unsigned char i;
+	unsigned short Shell_Reception_Throttles_Count, Data_Reception_Throttles_Count;
+	char String_Temporary[80];
+
+	// Retrieve the statistics first, so the displaying does not alter them
+	USBCoreGetStatistics(&Statistics, 1);
+	Shell_Reception_Throttles_Count = USBCommunicationsGetReceptionThrottlesCount(USB_COMMUNICATIONS_PORT_ID_SHELL, 1);
+	Data_Reception_Throttles_Count = USBCommunicationsGetReceptionThrottlesCount(USB_COMMUNICATIONS_PORT_ID_DATA, 1);
+
+	snprintf(String_Temporary, sizeof(String_Temporary), "\r\nInterrupts : %lu, resets : %u, stalls : %u, suspends : %u.", Statistics.Interrupts_Count, Statistics.Resets_Count, Statistics.Stalls_Count, Statistics.Suspends_Count);
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, String_Temporary);
+
+	// Display the traffic of each endpoint
+	for (i = 0; i < USB_CORE_HARDWARE_ENDPOINTS_COUNT; i++)
+	{
+		snprintf(String_Temporary, sizeof(String_Temporary), "\r\nEndpoint %u : %lu OUT packets, %lu IN packets.", i, Statistics.Endpoints_Out_Packets_Count[i], Statistics.Endpoints_In_Packets_Count[i]);
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, String_Temporary);
+	}
+	snprintf(String_Temporary, sizeof(String_Temporary), "\r\nOUT bytes : %lu, IN bytes : %lu.", Statistics.Out_Bytes_Count, Statistics.In_Bytes_Count);
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, String_Temporary);
+
+	// Display the errors
+	snprintf(String_Temporary, sizeof(String_Temporary), "\r\nErrors : PID %u, CRC5 %u, CRC16 %u, data field size %u, ", Statistics.PID_Errors_Count, Statistics.CRC5_Errors_Count, Statistics.CRC16_Errors_Count, Statistics.Data_Field_Size_Errors_Count);
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, String_Temporary);
+	snprintf(String_Temporary, sizeof(String_Temporary), "bus turnaround timeout %u, bit stuff %u.", Statistics.Bus_Turnaround_Timeout_Errors_Count, Statistics.Bit_Stuff_Errors_Count);
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, String_Temporary);
+
+	snprintf(String_Temporary, sizeof(String_Temporary), "\r\nReception throttles : shell port %u, data port %u.", Shell_Reception_Throttles_Count, Data_Reception_Throttles_Count);
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, String_Temporary);
+	return 0;
+}
@@ -7,48 +7,88 @@
 //-------------------------------------------------------------------------------------------------
 // Public variables
 //-------------------------------------------------------------------------------------------------
+// Keep the commands sorted when adding a new one, otherwise the shell will not find some of them
 const TShellCommand Shell_Commands[SHELL_COMMANDS_COUNT] =
 {
+	// Boot time
+	{
+		SHELL_COMMANDS_NAME("boot-time"),
+		.Pointer_String_Description = "display how long the USB link took to reach each state after the power-up, up to the first received command.",
+		.Command_Callback = ShellCommandUSBBootTimeCallback
+	},
 	// Help
 	{
-		.Pointer_String_Command = "help",
+		SHELL_COMMANDS_NAME("help"),
 		.Pointer_String_Description = "show this commands list.",
 		.Command_Callback = ShellCommandHelpCallback
 	},
 	// I2C
 	{
-		.Pointer_String_Command = "i2c",
-		.Pointer_String_Description = "send an I2C transaction on the bus. Use \"[\" for start, \"]\" for stop, \"r[h]XXXX\" for reading XXXX bytes, then \"XX\" or \"hXX\" to write a decimal or a hexadecimal byte.",
-		.Command_Callback = ShellCommandI2CCallback
+		SHELL_COMMANDS_NAME("i2c"),
+		.Pointer_String_Description = "send an I2C transaction on the bus. Use \"[\" for start, \"]\" for stop, \"r[h]XXXX\" for reading XXXX bytes, then \"XX\" or \"hXX\" to write a decimal or a hexadecimal byte. The transaction length is not limited. Use \"repeat N [dXXXX] { commands }\" to execute up to 16 commands N times with an optional XXXX ms delay between the iterations, only a summary of the iterations is displayed.",
+		.Command_Callback = ShellCommandI2CCallback,
+		.Are_Arguments_Streamed = 1
 	},
 	// I2C configure
 	{
-		.Pointer_String_Command = "i2c-configure",
+		SHELL_COMMANDS_NAME("i2c-configure"),
 		.Pointer_String_Description = "set the I2C interface settings. Usage : \"i2c-configure 100khz|400khz\".",
 		.Command_Callback = ShellCommandI2CConfigureCallback
 	},
 	// I2C scan
 	{
-		.Pointer_String_Command = "i2c-scan",
+		SHELL_COMMANDS_NAME("i2c-scan"),
 		.Pointer_String_Description = "scan the I2C bus from address 1 to 127.",
 		.Command_Callback = ShellCommandI2CScanCallback
 	},
+	// Macro list
+	{
+		SHELL_COMMANDS_NAME("macro-list"),
+		.Pointer_String_Description = "show the macros stored in the EEPROM, with their index.",
+		.Command_Callback = ShellCommandMacroListCallback
+	},
+	// Macro record
+	{
+		SHELL_COMMANDS_NAME("macro-record"),
+		.Pointer_String_Description = "store command lines in the EEPROM. Usage : \"macro-record name command_line [; command_line]...\". The name can't start with a digit. Recording an existing macro replaces it, recording it without command line deletes it.",
+		.Command_Callback = ShellCommandMacroRecordCallback,
+		.Are_Arguments_Streamed = 1
+	},
+	// Macro run
+	{
+		SHELL_COMMANDS_NAME("macro-run"),
+		.Pointer_String_Description = "execute the command lines of a stored macro, until the first failing one. Usage : \"macro-run name|index\".",
+		.Command_Callback = ShellCommandMacroRunCallback
+	},
 	// Pinout
 	{
-		.Pointer_String_Command = "pinout",
+		SHELL_COMMANDS_NAME("pinout"),
 		.Pointer_String_Description = "show the pins wiring corresponding to each supported protocol.",
 		.Command_Callback = ShellCommandPinoutCallback
 	},
+	// Shell mode
+	{
+		SHELL_COMMANDS_NAME("shell-mode"),
+		.Pointer_String_Description = "select how the shell talks to the host. Usage : \"shell-mode interactive|machine\". The machine mode does not echo the received characters nor display a prompt, and terminates each command output with a \"#<status>\" line. The binary mode can only be entered from the machine mode.",
+		.Command_Callback = ShellCommandShellModeCallback
+	},
 	// SPI
 	{
-		.Pointer_String_Command = "spi",
-		.Pointer_String_Description = "send an SPI transaction on the bus. Use \"[\" to select the slave device, \"]\" to deselect it, \"t[h]XXXX\" to transfer XXXX bytes while sending the byte 0xFF, then \"XX\" or \"hXX\" to transfer a decimal or a hexadecimal single byte of data.",
-		.Command_Callback = ShellCommandSPICallback
+		SHELL_COMMANDS_NAME("spi"),
+		.Pointer_String_Description = "send an SPI transaction on the bus. Use \"[\" to select the slave device, \"]\" to deselect it, \"t[h]XXXX\" to transfer XXXX bytes while sending the byte 0xFF, then \"XX\" or \"hXX\" to transfer a decimal or a hexadecimal single byte of data. The transaction length is not limited. Use \"repeat N [dXXXX] { commands }\" to execute up to 16 commands N times with an optional XXXX ms delay between the iterations, only a summary of the iterations is displayed.",
+		.Command_Callback = ShellCommandSPICallback,
+		.Are_Arguments_Streamed = 1
 	},
 	// SPI configure
 	{
-		.Pointer_String_Command = "spi-configure",
+		SHELL_COMMANDS_NAME("spi-configure"),
 		.Pointer_String_Description = "set the SPI interface settings. Usage : \"spi-configure 50khz|100khz|500khz|1mhz|2mhz mode0|mode1|mode2|mode3\".",
 		.Command_Callback = ShellCommandSPIConfigureCallback
+	},
+	// USB statistics
+	{
+		SHELL_COMMANDS_NAME("usb-stats"),
+		.Pointer_String_Description = "display the USB link statistics and error counters, then reset them.",
+		.Command_Callback = ShellCommandUSBStatisticsCallback
 	}
 };
@@ -11,8 +11,20 @@
 /** Set to 1 to enable the log messages, set to 0 to disable them. */
 #define USB_COMMUNICATIONS_IS_LOGGING_ENABLED 0
 
-/** The size in bytes of the reception circular buffer. */
-#define USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE USB_CORE_ENDPOINT_PACKETS_SIZE
+/** The size in bytes of the reception circular buffer. It must have room for a full packet per data OUT endpoint ping-pong buffer, and it must not exceed 255 bytes. */
+#define USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE 192
+#if USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE < (USB_CORE_PING_PONG_BUFFERS_COUNT * USB_CORE_ENDPOINT_PACKETS_SIZE)
+	#error "The reception circular buffer is too small to hold all packets the host can send without waiting for the firmware."
+#endif
+
+/** The size in bytes of the transmission circular buffer (it must not exceed 255 bytes). */
+#define USB_COMMUNICATIONS_DATA_TRANSMISSION_BUFFER_SIZE 128
+
+/** The Set Control Line State request wValue bit telling whether the host program has opened the port. See CDC PSTN revision 1.2 table 18. */
+#define USB_COMMUNICATIONS_CONTROL_LINE_STATE_DTR_MASK 0x0001
+
+/** The bmRequestType value of all notifications : class-specific, device to host, sent by an interface. See CDC revision 1.2 table 18. */
+#define USB_COMMUNICATIONS_NOTIFICATION_REQUEST_TYPE 0xA1
 
 //-------------------------------------------------------------------------------------------------
 // Private types
@@ -24,6 +36,34 @@ typedef enum : unsigned char
 	USB_COMMUNICATIONS_PSTN_REQUEST_CODE_SET_CONTROL_LINE_STATE = 0x22
 } TUSBCommunicationsPSTNRequestCode;
 
+/** The control requests state machine states. */
+typedef enum : unsigned char
+{
+	USB_COMMUNICATIONS_CONTROL_REQUEST_STATE_RECEIVE_REQUEST,
+	USB_COMMUNICATIONS_CONTROL_REQUEST_STATE_RECEIVE_PAYLOAD
+} TUSBCommunicationsControlRequestState;
+
+/** All supported PSTN class-specific notification codes. See CDC PSTN revision 1.2 table 30. */
+typedef enum : unsigned char
+{
+	USB_COMMUNICATIONS_PSTN_NOTIFICATION_CODE_SERIAL_STATE = 0x20
+} TUSBCommunicationsPSTNNotificationCode;
+
+/** The PSTN Serial State notification, including its data. See CDC PSTN revision 1.2 chapter 6.5.4. */
+typedef struct
+{
+	unsigned char bmRequestType;
+	TUSBCommunicationsPSTNNotificationCode bNotification;
+	unsigned short wValue;
+	unsigned short wIndex;
+	unsigned short wLength;
+	unsigned short UART_State_Bitmap;
+} __attribute__((packed)) TUSBCommunicationsPSTNNotificationSerialState;
+
+// Make sure that the notification matches its specification size and fits in the notification endpoint buffer
+USB_CORE_STATIC_ASSERT(sizeof(TUSBCommunicationsPSTNNotificationSerialState) == 10, Communications_Serial_State_Notification_Size);
+USB_CORE_STATIC_ASSERT(sizeof(TUSBCommunicationsPSTNNotificationSerialState) <= USB_CORE_NOTIFICATION_PACKETS_SIZE, Communications_Serial_State_Notification_Buffer_Size);
+
 /** The PSTN Get/Set Line Coding request payload. */
 typedef struct
 {
@@ -33,60 +73,259 @@ typedef struct
 	unsigned char bDataBits;
 } __attribute__((packed)) TUSBCommunicationsPSTNRequestGetLineCodingPayload;
 
+/** All the state of a CDC ACM port, each port has its own endpoints and its own circular buffers. */
+typedef struct
+{
+	unsigned char Control_Interface_ID; //!< The number of the CDC ACM communications class interface, which is the recipient of the class-specific requests.
+	unsigned char Notification_Endpoint_ID; //!< The number corresponding to the notification endpoint, or 0 if the port can't send notifications.
+	unsigned char Notification_Endpoint_Data_Synchronization; //!< Keep the data synchronization value for the notification endpoint communication.
+	volatile unsigned char Pending_Events; //!< The events signaled by the application that are not yet given to the SIE.
+	volatile unsigned char Is_Notification_Pending; //!< Tell whether a notification has been given to the SIE and is not yet read by the host. The notification buffer can't be reused meanwhile.
+	unsigned char Data_Out_Endpoint_ID; //!< The number corresponding to the data OUT endpoint.
+	unsigned char Data_Out_Endpoint_Data_Synchronization; //!< Keep the data synchronization value for the data OUT endpoint communication. Both ping-pong buffers are armed at initialization, so a buffer that has just received a packet always expects the same synchronization value for its next packet, starting from the synchronization value 0 of the first packet sent by the host.
+	unsigned char Data_In_Endpoint_ID; //!< The number corresponding to the data IN endpoint.
+	unsigned char Data_In_Endpoint_Data_Synchronization; //!< Keep the data synchronization value for the data IN endpoint communication.
+
+	unsigned char Data_Reception_Buffer[USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE]; //!< Store the last received data bytes.
+	unsigned char *Pointer_Data_Reception_Buffer_Reading; //!< The beginning of the received data that are not yet read by the user.
+	unsigned char *Pointer_Data_Reception_Buffer_Writing; //!< The beginning of the buffer free area to write incoming data to.
+	volatile unsigned char Data_Reception_Buffer_Occupied_Bytes_Count; //!< The occupancy of the buffer.
+
+	volatile unsigned char Data_Out_Held_Buffers_Count; //!< How many data OUT endpoint buffers are kept by the microcontroller until the reception buffer has enough room to receive their next packet. The SIE NAKs the host meanwhile.
+	unsigned short Reception_Throttles_Count; //!< How many received packets left the host NAKed because the reception buffer was too full.
+
+	unsigned char Data_Transmission_Buffer[USB_COMMUNICATIONS_DATA_TRANSMISSION_BUFFER_SIZE]; //!< Store the data waiting to be sent to the host.
+	unsigned char *Pointer_Data_Transmission_Buffer_Reading; //!< The beginning of the data that are not yet sent to the host.
+	unsigned char *Pointer_Data_Transmission_Buffer_Writing; //!< The beginning of the buffer free area to write outgoing data to.
+	volatile unsigned char Data_Transmission_Buffer_Occupied_Bytes_Count; //!< The occupancy of the buffer.
+
+	volatile unsigned char Data_In_Pending_Packets_Count; //!< How many data IN packets have been given to the SIE and are not yet acknowledged by the host.
+
+	unsigned char Is_Connection_Established; //!< Tell wether a program on the host has opened the port.
+} TUSBCommunicationsPort;
+
 //-------------------------------------------------------------------------------------------------
 // Private variables
 //-------------------------------------------------------------------------------------------------
-/** Keep the data synchronization value for the data OUT endpoint communication. */
-static unsigned char USB_Communications_Data_Out_Endpoint_Data_Synchronization = 1; // The first packet sent by the host has the synchronization value 0, so expect a 1 for the next packet
+/** All CDC ACM ports. */
+static TUSBCommunicationsPort USB_Communications_Ports[USB_COMMUNICATIONS_PORTS_COUNT];
+
+/** Tell whether the next control endpoint packet is a request or the payload of the previous request. */
+static TUSBCommunicationsControlRequestState USB_Communications_Control_Request_State = USB_COMMUNICATIONS_CONTROL_REQUEST_STATE_RECEIVE_REQUEST;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Find the port owning an endpoint.
+ * @param Endpoint_ID The notification, data OUT or data IN endpoint number.
+ * @return The port, or NULL if the endpoint does not belong to any port.
+ */
+static TUSBCommunicationsPort *USBCommunicationsGetPortFromEndpoint(unsigned char Endpoint_ID)
+{
+	TUSBCommunicationsPort *Pointer_Port = USB_Communications_Ports;
+	unsigned char i;
 
-/** Cache the number corresponding to the data IN endpoint. */
-static unsigned char USB_Communications_Data_In_Endpoint_ID;
-/** Keep the data synchronization value for the data IN endpoint communication. */
-static unsigned char USB_Communications_Data_In_Endpoint_Data_Synchronization = 0;
+	for (i = 0; i < USB_COMMUNICATIONS_PORTS_COUNT; i++)
+	{
+		if ((Pointer_Port->Data_Out_Endpoint_ID == Endpoint_ID) || (Pointer_Port->Data_In_Endpoint_ID == Endpoint_ID) || (Pointer_Port->Notification_Endpoint_ID == Endpoint_ID)) return Pointer_Port;
+		Pointer_Port++;
+	}
+	return NULL;
+}
+
+/** Find the port owning a communications class interface.
+ * @param Interface_ID The interface number.
+ * @return The port, or NULL if the interface does not belong to any port.
+ */
+static TUSBCommunicationsPort *USBCommunicationsGetPortFromControlInterface(unsigned char Interface_ID)
+{
+	TUSBCommunicationsPort *Pointer_Port = USB_Communications_Ports;
+	unsigned char i;
 
-/** Store the last received data bytes. */
-static unsigned char USB_Communications_Data_Reception_Buffer[USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE];
-/** The beginning of the received data that are not yet read by the user. */
-static unsigned char *Pointer_USB_Communications_Data_Reception_Buffer_Reading = USB_Communications_Data_Reception_Buffer;
-/** The beginning of the buffer free area to write incoming data to. */
-static unsigned char *Pointer_USB_Communications_Data_Reception_Buffer_Writing = USB_Communications_Data_Reception_Buffer;
-/** The occupancy of the buffer. */
-static volatile unsigned char USB_Communications_Data_Reception_Buffer_Occupied_Bytes_Count = 0;
+	for (i = 0; i < USB_COMMUNICATIONS_PORTS_COUNT; i++)
+	{
+		if (Pointer_Port->Control_Interface_ID == Interface_ID) return Pointer_Port;
+		Pointer_Port++;
+	}
+	return NULL;
+}
 
-/** A synchronization flag telling whether the data transmission path is ready. */
-static volatile unsigned char USB_Communications_Is_Transmission_Finished = 1; // No transmission has taken place yet
+/** Give the next chunk of buffered data to the data IN endpoint.
+ * @param Pointer_Port The port to transmit data from.
+ * @note This function must be called from the USB interrupt context or with the USB interrupt disabled.
+ */
+static void USBCommunicationsTransmitNextPacket(TUSBCommunicationsPort *Pointer_Port)
+{
+	unsigned char Packet_Size, Chunk_Size, Contiguous_Bytes_Count, *Pointer_Endpoint_Buffer;
+
+	// Send as much data as possible in a single packet
+	Packet_Size = Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count;
+	if (Packet_Size > USB_CORE_ENDPOINT_PACKETS_SIZE) Packet_Size = USB_CORE_ENDPOINT_PACKETS_SIZE;
+	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Sending a data chunk of %u bytes.", Packet_Size);
+
+	// Directly copy the data to the USB RAM, so a full packet can be sent even when the data wrap around the end of the buffer
+	Pointer_Endpoint_Buffer = USBCoreAcquireInBuffer(Pointer_Port->Data_In_Endpoint_ID);
+	Chunk_Size = Packet_Size;
+	Contiguous_Bytes_Count = (unsigned char) ((Pointer_Port->Data_Transmission_Buffer + USB_COMMUNICATIONS_DATA_TRANSMISSION_BUFFER_SIZE) - Pointer_Port->Pointer_Data_Transmission_Buffer_Reading);
+	if (Chunk_Size > Contiguous_Bytes_Count) Chunk_Size = Contiguous_Bytes_Count;
+	USBCoreCopyFromRAM(Pointer_Endpoint_Buffer, Pointer_Port->Pointer_Data_Transmission_Buffer_Reading, Chunk_Size);
+	Pointer_Port->Pointer_Data_Transmission_Buffer_Reading += Chunk_Size;
+	if (Pointer_Port->Pointer_Data_Transmission_Buffer_Reading == (Pointer_Port->Data_Transmission_Buffer + USB_COMMUNICATIONS_DATA_TRANSMISSION_BUFFER_SIZE)) Pointer_Port->Pointer_Data_Transmission_Buffer_Reading = Pointer_Port->Data_Transmission_Buffer;
+
+	// Append the data located at the buffer beginning, if any
+	if (Chunk_Size < Packet_Size)
+	{
+		Chunk_Size = Packet_Size - Chunk_Size;
+		USBCoreCopyFromRAM(Pointer_Endpoint_Buffer + Contiguous_Bytes_Count, Pointer_Port->Pointer_Data_Transmission_Buffer_Reading, Chunk_Size);
+		Pointer_Port->Pointer_Data_Transmission_Buffer_Reading += Chunk_Size;
+	}
+	USBCoreCommitInTransfer(Pointer_Port->Data_In_Endpoint_ID, Packet_Size, Pointer_Port->Data_In_Endpoint_Data_Synchronization);
+	Pointer_Port->Data_In_Pending_Packets_Count++;
 
-/** Tell wether the CDC ACM link is configured by the host and operational. */
-static unsigned char USB_Communications_Is_Connection_Established = 0;
+	// Update the synchronization value
+	if (Pointer_Port->Data_In_Endpoint_Data_Synchronization == 0) Pointer_Port->Data_In_Endpoint_Data_Synchronization = 1;
+	else Pointer_Port->Data_In_Endpoint_Data_Synchronization = 0;
+
+	// Release the sent data from the buffer
+	Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count -= Packet_Size;
+}
+
+/** Give the next data OUT endpoint buffer back to the SIE if the reception buffer can hold a full packet more, in addition to the packets that the buffers already owned by the SIE can receive.
+ * @param Pointer_Port The port to receive data on.
+ * @note This function must be called from the USB interrupt context or with the USB interrupt disabled.
+ */
+static void USBCommunicationsReleaseDataOutBuffer(TUSBCommunicationsPort *Pointer_Port)
+{
+	unsigned char Armed_Buffers_Count;
+
+	// Make sure that no received byte can be lost
+	Armed_Buffers_Count = USB_CORE_PING_PONG_BUFFERS_COUNT - Pointer_Port->Data_Out_Held_Buffers_Count;
+	if ((unsigned char) (USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE - Pointer_Port->Data_Reception_Buffer_Occupied_Bytes_Count) < (unsigned char) ((Armed_Buffers_Count + 1) * USB_CORE_ENDPOINT_PACKETS_SIZE)) return;
+
+	// Re-enable packets reception, the buffers are given back to the SIE in the same order they have been received
+	USBCorePrepareForOutTransfer(Pointer_Port->Data_Out_Endpoint_ID, Pointer_Port->Data_Out_Endpoint_Data_Synchronization);
+	Pointer_Port->Data_Out_Held_Buffers_Count--;
+
+	// Update the synchronization value
+	if (Pointer_Port->Data_Out_Endpoint_Data_Synchronization == 0) Pointer_Port->Data_Out_Endpoint_Data_Synchronization = 1;
+	else Pointer_Port->Data_Out_Endpoint_Data_Synchronization = 0;
+}
+
+/** Send all pending events of a port in a single Serial State notification.
+ * @param Pointer_Port The port to send the notification on.
+ * @note This function must be called from the USB interrupt context or with the USB interrupt disabled, and only when no notification is pending.
+ */
+static void USBCommunicationsTransmitNotification(TUSBCommunicationsPort *Pointer_Port)
+{
+	TUSBCommunicationsPSTNNotificationSerialState *Pointer_Notification;
+
+	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Sending the events 0x%02X on endpoint %u.", Pointer_Port->Pending_Events, Pointer_Port->Notification_Endpoint_ID);
+
+	// Directly build the notification in the USB RAM, the buffer is free because no notification is pending
+	Pointer_Notification = (TUSBCommunicationsPSTNNotificationSerialState *) USBCoreAcquireInBuffer(Pointer_Port->Notification_Endpoint_ID);
+	Pointer_Notification->bmRequestType = USB_COMMUNICATIONS_NOTIFICATION_REQUEST_TYPE;
+	Pointer_Notification->bNotification = USB_COMMUNICATIONS_PSTN_NOTIFICATION_CODE_SERIAL_STATE;
+	Pointer_Notification->wValue = 0;
+	Pointer_Notification->wIndex = Pointer_Port->Control_Interface_ID;
+	Pointer_Notification->wLength = sizeof(Pointer_Notification->UART_State_Bitmap);
+	Pointer_Notification->UART_State_Bitmap = Pointer_Port->Pending_Events;
+	USBCoreCommitInTransfer(Pointer_Port->Notification_Endpoint_ID, sizeof(TUSBCommunicationsPSTNNotificationSerialState), Pointer_Port->Notification_Endpoint_Data_Synchronization);
+	Pointer_Port->Pending_Events = 0;
+	Pointer_Port->Is_Notification_Pending = 1;
+
+	// Update the synchronization value
+	if (Pointer_Port->Notification_Endpoint_Data_Synchronization == 0) Pointer_Port->Notification_Endpoint_Data_Synchronization = 1;
+	else Pointer_Port->Notification_Endpoint_Data_Synchronization = 0;
+}
+
+/** Add events to the next notification of a port, and send it right away if the notification buffer is free.
+ * @param Pointer_Port The port to send the notification on.
+ * @param Events A combination of TUSBCommunicationsEvent values.
+ * @note This function must be called from the USB interrupt context or with the USB interrupt disabled.
+ */
+static void USBCommunicationsQueueEvents(TUSBCommunicationsPort *Pointer_Port, unsigned char Events)
+{
+	// Discard the events of a port without notification buffer
+	if (Pointer_Port->Notification_Endpoint_ID == 0) return;
+
+	// The events are merged until the host has read the previous notification, the notification endpoint callback will send them
+	Pointer_Port->Pending_Events |= Events;
+	if (!Pointer_Port->Is_Notification_Pending) USBCommunicationsTransmitNotification(Pointer_Port);
+}
+
+/** Append data to the transmission circular buffer, the data are sent in the background by the data IN endpoint callback.
+ * @param Pointer_Port The port to transmit data to.
+ * @param Pointer_Data The data to transmit.
+ * @param Size The data size in bytes.
+ * @note This function blocks only when the buffer is full.
+ */
+static void USBCommunicationsAppendTransmissionData(TUSBCommunicationsPort *Pointer_Port, char *Pointer_Data, unsigned short Size)
+{
+	unsigned char Chunk_Size, Contiguous_Bytes_Count, i;
+
+	while (Size > 0)
+	{
+		// Wait for some room in the buffer, the data IN endpoint callback frees some room each time the host acknowledges a packet
+		// Accessing the occupied bytes count single-byte variable without the atomic access protections is safe because this is just a read, and the room can only grow meanwhile
+		while (Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count == USB_COMMUNICATIONS_DATA_TRANSMISSION_BUFFER_SIZE);
+		Chunk_Size = USB_COMMUNICATIONS_DATA_TRANSMISSION_BUFFER_SIZE - Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count;
+		if (Chunk_Size > Size) Chunk_Size = (unsigned char) Size;
+
+		// Do not write past the end of the buffer, the remaining data will be appended to the buffer beginning on the next loop
+		Contiguous_Bytes_Count = (unsigned char) ((Pointer_Port->Data_Transmission_Buffer + USB_COMMUNICATIONS_DATA_TRANSMISSION_BUFFER_SIZE) - Pointer_Port->Pointer_Data_Transmission_Buffer_Writing);
+		if (Chunk_Size > Contiguous_Bytes_Count) Chunk_Size = Contiguous_Bytes_Count;
+
+		// Copy the data, only this function is accessing the writing pointer so there is no need for atomic access protections
+		for (i = 0; i < Chunk_Size; i++)
+		{
+			*Pointer_Port->Pointer_Data_Transmission_Buffer_Writing = (unsigned char) *Pointer_Data;
+			Pointer_Port->Pointer_Data_Transmission_Buffer_Writing++;
+			Pointer_Data++;
+		}
+		if (Pointer_Port->Pointer_Data_Transmission_Buffer_Writing == (Pointer_Port->Data_Transmission_Buffer + USB_COMMUNICATIONS_DATA_TRANSMISSION_BUFFER_SIZE)) Pointer_Port->Pointer_Data_Transmission_Buffer_Writing = Pointer_Port->Data_Transmission_Buffer;
+		Size -= Chunk_Size;
+
+		// Atomically access to the transmission circular buffer
+		USB_CORE_INTERRUPT_DISABLE();
+		Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count += Chunk_Size;
+
+		// Send a full packet right away if a ping-pong buffer is free, the remaining data are coalesced with the next writes and flushed on the next Start-Of-Frame at the latest
+		if ((Pointer_Port->Data_In_Pending_Packets_Count < USB_CORE_PING_PONG_BUFFERS_COUNT) && (Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count >= USB_CORE_ENDPOINT_PACKETS_SIZE)) USBCommunicationsTransmitNextPacket(Pointer_Port);
+		USB_CORE_INTERRUPT_ENABLE();
+	}
+}
 
 //-------------------------------------------------------------------------------------------------
 // Public functions
 //-------------------------------------------------------------------------------------------------
 void USBCommunicationsHandleControlRequestCallback(TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data)
 {
-	typedef enum
-	{
-		STATE_RECEIVE_REQUEST,
-		STATE_RECEIVE_PAYLOAD
-	} TState;
-	static TState Current_State = STATE_RECEIVE_REQUEST;
 	static TUSBCommunicationsPSTNRequestCode Last_Request_Code;
 
-	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Entry, current state : %u.", Current_State);
+	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Entry, current state : %u.", USB_Communications_Control_Request_State);
 
 	// A simple state machine to deal with the request packet, that may be followed by a payload packet
-	if (Current_State == STATE_RECEIVE_REQUEST)
+	if (USB_Communications_Control_Request_State == USB_COMMUNICATIONS_CONTROL_REQUEST_STATE_RECEIVE_REQUEST)
 	{
 		// Check wether a payload is expected
 		TUSBCoreDeviceRequest *Pointer_Request = (TUSBCoreDeviceRequest *) Pointer_Transfer_Callback_Data->Pointer_OUT_Data_Buffer;
 		Last_Request_Code = (TUSBCommunicationsPSTNRequestCode) Pointer_Request->bRequest;
 		LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Received a request with the code 0x%02X.", Last_Request_Code);
 
+		// None of the supported requests sends data to the host, so do not wait for a payload that the host will never send
+		if ((Pointer_Request->bmRequestType & USB_CORE_DEVICE_REQUEST_TYPE_MASK_DIRECTION) == USB_CORE_DEVICE_REQUEST_TYPE_VALUE_DIRECTION_DEVICE_TO_HOST)
+		{
+			LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Unsupported device-to-host request 0x%02X, stalling the control endpoint.", Last_Request_Code);
+			USBCoreStallEndpoint(Pointer_Transfer_Callback_Data->Endpoint_ID);
+			USBCorePrepareForOutTransfer(Pointer_Transfer_Callback_Data->Endpoint_ID, 0); // Re-enable packets reception
+			return;
+		}
+
 		// Prepare the state machine for the payload reception
 		if (Pointer_Request->wLength > 0)
 		{
 			LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Expecting a payload of %u bytes.", Pointer_Request->wLength);
-			Current_State = STATE_RECEIVE_PAYLOAD;
+			USB_Communications_Control_Request_State = USB_COMMUNICATIONS_CONTROL_REQUEST_STATE_RECEIVE_PAYLOAD;
 
 			// The request (sent by the host) data synchronization is always 0, so wait for a 1 for the next packet containing the payload
 			// Do not acknowledge the packet reception with an empty IN packet because we are waiting for the payload OUT one
@@ -101,12 +340,19 @@ void USBCommunicationsHandleControlRequestCallback(TUSBCoreHardwareEndpointOutTr
 			switch (Last_Request_Code)
 			{
 				case USB_COMMUNICATIONS_PSTN_REQUEST_CODE_SET_CONTROL_LINE_STATE:
-					// This request is ignored
-					LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Processing the Set Control Line State PSTN request.");
+				{
+					TUSBCommunicationsPort *Pointer_Port;
+
+					// The request recipient is the communications class interface of the port
+					LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Processing the Set Control Line State PSTN request for the interface %u, DTR : %u.", (unsigned char) Pointer_Request->wIndex, Pointer_Request->wValue & USB_COMMUNICATIONS_CONTROL_LINE_STATE_DTR_MASK);
+					Pointer_Port = USBCommunicationsGetPortFromControlInterface((unsigned char) Pointer_Request->wIndex);
+					if (Pointer_Port == NULL) break;
 
-					// The Linux most common TTY programs (Picocom, Minicom etc) seem to send the Set Control Line State request at the end, when everything is ready
-					USB_Communications_Is_Connection_Established = 1;
+					// The Linux most common TTY programs (Picocom, Minicom etc) seem to send the Set Control Line State request at the end, when everything is ready, and the host clears the DTR signal when the program closes the port
+					if (Pointer_Request->wValue & USB_COMMUNICATIONS_CONTROL_LINE_STATE_DTR_MASK) Pointer_Port->Is_Connection_Established = 1;
+					else Pointer_Port->Is_Connection_Established = 0;
 					break;
+				}
 
 				default:
 					LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Unsupported request 0x%02X.", Last_Request_Code);
@@ -166,7 +412,7 @@ void USBCommunicationsHandleControlRequestCallback(TUSBCoreHardwareEndpointOutTr
 		}
 
 		// Wait for the next request
-		Current_State = STATE_RECEIVE_REQUEST;
+		USB_Communications_Control_Request_State = USB_COMMUNICATIONS_CONTROL_REQUEST_STATE_RECEIVE_REQUEST;
 	}
 
 	// Manage the USB connection
@@ -176,95 +422,219 @@ void USBCommunicationsHandleControlRequestCallback(TUSBCoreHardwareEndpointOutTr
 
 void USBCommunicationsHandleDataReceptionCallback(TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data)
 {
-	// Cache the callback data parameters to avoid useless pointer computations in the loop
-	unsigned char Received_Bytes_Count = Pointer_Transfer_Callback_Data->Data_Size, *Pointer_Received_Data_Buffer = Pointer_Transfer_Callback_Data->Pointer_OUT_Data_Buffer;
+	// Cache the callback data parameters to avoid useless pointer computations
+	unsigned char Received_Bytes_Count = Pointer_Transfer_Callback_Data->Data_Size, *Pointer_Received_Data_Buffer = Pointer_Transfer_Callback_Data->Pointer_OUT_Data_Buffer, Chunk_Size, Contiguous_Bytes_Count;
+	TUSBCommunicationsPort *Pointer_Port;
 
-	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Received %u bytes of data.", Received_Bytes_Count);
+	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Received %u bytes of data on endpoint %u.", Received_Bytes_Count, Pointer_Transfer_Callback_Data->Endpoint_ID);
+	Pointer_Port = USBCommunicationsGetPortFromEndpoint(Pointer_Transfer_Callback_Data->Endpoint_ID);
+	if (Pointer_Port == NULL) return;
+	Pointer_Port->Data_Out_Held_Buffers_Count++; // The buffer is now owned by the microcontroller
 
 	// Atomic access to the shared FIFO is granted by the fact that the user-callable function temporarily disables the USB interrupts, so it is not possible to reach this code at the critical moment
-	// Append the received data if there is still room in the buffer
-	if (USB_Communications_Data_Reception_Buffer_Occupied_Bytes_Count < USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE)
+	// A buffer is given to the SIE only when the reception buffer has room for a full packet, so all received data always fit
+	// The data are copied in at most two chunks, the second one starting from the buffer beginning
+	while (Received_Bytes_Count > 0)
 	{
-		// Append the received data until the reception buffer is full or all data have been appended
-		while ((Received_Bytes_Count > 0) && (USB_Communications_Data_Reception_Buffer_Occupied_Bytes_Count < USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE))
-		{
-			// Wrap around the pointer to the beginning of the buffer when it has reached the end of the buffer in a minimum amount of cycles
-			if (Pointer_USB_Communications_Data_Reception_Buffer_Writing == (USB_Communications_Data_Reception_Buffer + USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE)) Pointer_USB_Communications_Data_Reception_Buffer_Writing = USB_Communications_Data_Reception_Buffer;
-
-			// Store the next received byte into the buffer
-			*Pointer_USB_Communications_Data_Reception_Buffer_Writing = *Pointer_Received_Data_Buffer;
-			Pointer_USB_Communications_Data_Reception_Buffer_Writing++;
-			Pointer_Received_Data_Buffer++;
-			USB_Communications_Data_Reception_Buffer_Occupied_Bytes_Count++;
-			Received_Bytes_Count--;
-		}
+		// Wrap around the pointer to the beginning of the buffer when it has reached the end of the buffer
+		if (Pointer_Port->Pointer_Data_Reception_Buffer_Writing == (Pointer_Port->Data_Reception_Buffer + USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE)) Pointer_Port->Pointer_Data_Reception_Buffer_Writing = Pointer_Port->Data_Reception_Buffer;
+
+		// Do not write past the end of the buffer
+		Chunk_Size = Received_Bytes_Count;
+		Contiguous_Bytes_Count = (unsigned char) ((Pointer_Port->Data_Reception_Buffer + USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE) - Pointer_Port->Pointer_Data_Reception_Buffer_Writing);
+		if (Chunk_Size > Contiguous_Bytes_Count) Chunk_Size = Contiguous_Bytes_Count;
+
+		USBCoreCopyFromRAM(Pointer_Port->Pointer_Data_Reception_Buffer_Writing, Pointer_Received_Data_Buffer, Chunk_Size);
+		Pointer_Port->Pointer_Data_Reception_Buffer_Writing += Chunk_Size;
+		Pointer_Received_Data_Buffer += Chunk_Size;
+		Received_Bytes_Count -= Chunk_Size;
+	}
+	Pointer_Port->Data_Reception_Buffer_Occupied_Bytes_Count += Pointer_Transfer_Callback_Data->Data_Size;
+
+	// Re-enable packets reception if there is enough room left, otherwise the host will be NAKed until the user reads enough data
+	USBCommunicationsReleaseDataOutBuffer(Pointer_Port);
+	if (Pointer_Port->Data_Out_Held_Buffers_Count > 0)
+	{
+		Pointer_Port->Reception_Throttles_Count++;
+		USBCommunicationsQueueEvents(Pointer_Port, USB_COMMUNICATIONS_EVENT_RECEPTION_OVERRUN);
 	}
-	else LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Warning : the reception buffer is full, all the received data have been discarded.");
+	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "%u data OUT buffers are held by the microcontroller.", Pointer_Port->Data_Out_Held_Buffers_Count);
+}
 
-	// Re-enable packets reception
-	USBCorePrepareForOutTransfer(Pointer_Transfer_Callback_Data->Endpoint_ID, USB_Communications_Data_Out_Endpoint_Data_Synchronization);
+void USBCommunicationsHandleDataTransmissionFlowControlCallback(unsigned char Endpoint_ID)
+{
+	TUSBCommunicationsPort *Pointer_Port;
 
-	// Update the synchronization value
-	if (USB_Communications_Data_Out_Endpoint_Data_Synchronization == 0) USB_Communications_Data_Out_Endpoint_Data_Synchronization = 1;
-	else USB_Communications_Data_Out_Endpoint_Data_Synchronization = 0;
+	Pointer_Port = USBCommunicationsGetPortFromEndpoint(Endpoint_ID);
+	if (Pointer_Port == NULL) return;
+	// A packet committed by the application right before a bus reset can still complete, while the reset has already cleared the pending packets count
+	if (Pointer_Port->Data_In_Pending_Packets_Count > 0) Pointer_Port->Data_In_Pending_Packets_Count--;
+
+	// Keep the link busy if enough data have been buffered meanwhile, a partially filled packet will be sent on the next Start-Of-Frame
+	if (Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count >= USB_CORE_ENDPOINT_PACKETS_SIZE) USBCommunicationsTransmitNextPacket(Pointer_Port);
 }
 
-void USBCommunicationsHandleDataTransmissionFlowControlCallback(unsigned char __attribute__((unused)) Endpoint_ID)
+void USBCommunicationsHandleNotificationFlowControlCallback(unsigned char Endpoint_ID)
 {
-	USB_Communications_Is_Transmission_Finished = 1;
+	TUSBCommunicationsPort *Pointer_Port;
+
+	Pointer_Port = USBCommunicationsGetPortFromEndpoint(Endpoint_ID);
+	if (Pointer_Port == NULL) return;
+	Pointer_Port->Is_Notification_Pending = 0;
+
+	// Send the events that have been signaled while the previous notification was waiting for the host
+	if (Pointer_Port->Pending_Events != 0) USBCommunicationsTransmitNotification(Pointer_Port);
 }
 
-void USBCommunicationsInitialize(unsigned char Data_In_Endpoint_ID)
+void USBCommunicationsHandleStartOfFrameCallback(void)
 {
-	USB_Communications_Data_In_Endpoint_ID = Data_In_Endpoint_ID;
+	TUSBCommunicationsPort *Pointer_Port = USB_Communications_Ports;
+	unsigned char i;
+
+	// Flush the partially filled packets, this bounds the transmission latency to one millisecond
+	for (i = 0; i < USB_COMMUNICATIONS_PORTS_COUNT; i++)
+	{
+		if ((Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count > 0) && (Pointer_Port->Data_In_Pending_Packets_Count < USB_CORE_PING_PONG_BUFFERS_COUNT)) USBCommunicationsTransmitNextPacket(Pointer_Port);
+		Pointer_Port++;
+	}
 }
 
-unsigned char USBCommunicationsIsCommunicationEstablished(void)
+void USBCommunicationsHandleResetCallback(void)
 {
-	return USB_Communications_Is_Connection_Established;
+	TUSBCommunicationsPort *Pointer_Port = USB_Communications_Ports;
+	unsigned char i, Contiguous_Bytes_Count;
+
+	// The USB core has given the control endpoint back to the SIE, so expect a new request
+	USB_Communications_Control_Request_State = USB_COMMUNICATIONS_CONTROL_REQUEST_STATE_RECEIVE_REQUEST;
+
+	for (i = 0; i < USB_COMMUNICATIONS_PORTS_COUNT; i++)
+	{
+		// The USB core has taken back all buffer descriptors and given both data OUT buffers to the SIE again, all endpoints restart from DATA0
+		Pointer_Port->Notification_Endpoint_Data_Synchronization = 0;
+		Pointer_Port->Data_Out_Endpoint_Data_Synchronization = 0;
+		Pointer_Port->Data_In_Endpoint_Data_Synchronization = 0;
+		Pointer_Port->Data_Out_Held_Buffers_Count = 0;
+		Pointer_Port->Data_In_Pending_Packets_Count = 0;
+		Pointer_Port->Pending_Events = 0;
+		Pointer_Port->Is_Notification_Pending = 0;
+		Pointer_Port->Is_Connection_Established = 0;
+
+		// Discard the received data by moving the writing pointer, which is owned by the interrupt context, the application only updates the reading pointer with the USB interrupt disabled
+		Pointer_Port->Pointer_Data_Reception_Buffer_Writing = Pointer_Port->Pointer_Data_Reception_Buffer_Reading;
+		Pointer_Port->Data_Reception_Buffer_Occupied_Bytes_Count = 0;
+
+		// Discard the data waiting for transmission by moving the reading pointer, the application may be appending data meanwhile
+		Contiguous_Bytes_Count = (unsigned char) ((Pointer_Port->Data_Transmission_Buffer + USB_COMMUNICATIONS_DATA_TRANSMISSION_BUFFER_SIZE) - Pointer_Port->Pointer_Data_Transmission_Buffer_Reading);
+		if (Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count < Contiguous_Bytes_Count) Pointer_Port->Pointer_Data_Transmission_Buffer_Reading += Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count;
+		else Pointer_Port->Pointer_Data_Transmission_Buffer_Reading = Pointer_Port->Data_Transmission_Buffer + (Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count - Contiguous_Bytes_Count);
+		Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count = 0;
+
+		Pointer_Port++;
+	}
+	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "The bus has been reset, all ports have been emptied.");
 }
 
-char USBCommunicationsReadCharacter(void)
+void USBCommunicationsInitialize(TUSBCommunicationsPortID Port_ID, unsigned char Control_Interface_ID, unsigned char Notification_Endpoint_ID, unsigned char Data_Out_Endpoint_ID, unsigned char Data_In_Endpoint_ID)
 {
-	unsigned char Character;
+	TUSBCommunicationsPort *Pointer_Port = &USB_Communications_Ports[Port_ID];
+
+	Pointer_Port->Control_Interface_ID = Control_Interface_ID;
+	Pointer_Port->Notification_Endpoint_ID = Notification_Endpoint_ID;
+	Pointer_Port->Data_Out_Endpoint_ID = Data_Out_Endpoint_ID;
+	Pointer_Port->Data_In_Endpoint_ID = Data_In_Endpoint_ID;
+	Pointer_Port->Pointer_Data_Reception_Buffer_Reading = Pointer_Port->Data_Reception_Buffer;
+	Pointer_Port->Pointer_Data_Reception_Buffer_Writing = Pointer_Port->Data_Reception_Buffer;
+	Pointer_Port->Pointer_Data_Transmission_Buffer_Reading = Pointer_Port->Data_Transmission_Buffer;
+	Pointer_Port->Pointer_Data_Transmission_Buffer_Writing = Pointer_Port->Data_Transmission_Buffer;
+}
 
-	// Wait for a character to be received
-	// Accessing the occupied bytes count single-byte variable without the atomic access protections is safe because this is just a read, doing this avoids disabling the USB interrupts for too long
-	while (USB_Communications_Data_Reception_Buffer_Occupied_Bytes_Count == 0);
+unsigned char USBCommunicationsIsCommunicationEstablished(TUSBCommunicationsPortID Port_ID)
+{
+	// The DTR signal received before a bus reset does not tell anything about the new host session
+	if (USBCoreGetDeviceState() != USB_CORE_DEVICE_STATE_CONFIGURED) return 0;
+	return USB_Communications_Ports[Port_ID].Is_Connection_Established;
+}
 
-	// Wrap around the pointer to the beginning of the buffer when it has reached the end of the buffer in a minimum amount of cycles, this can alse be done without atomic access protections because only this function is accessing this pointer value
-	if (Pointer_USB_Communications_Data_Reception_Buffer_Reading == (USB_Communications_Data_Reception_Buffer + USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE)) Pointer_USB_Communications_Data_Reception_Buffer_Reading = USB_Communications_Data_Reception_Buffer;
+unsigned short USBCommunicationsGetReceptionThrottlesCount(TUSBCommunicationsPortID Port_ID, unsigned char Is_Reset_Requested)
+{
+	TUSBCommunicationsPort *Pointer_Port = &USB_Communications_Ports[Port_ID];
+	unsigned short Count;
 
-	// Atomically access to the reception circular buffer
+	// Atomically access to the multi-byte counter
 	USB_CORE_INTERRUPT_DISABLE();
-	Character = *Pointer_USB_Communications_Data_Reception_Buffer_Reading;
-	Pointer_USB_Communications_Data_Reception_Buffer_Reading++;
-	USB_Communications_Data_Reception_Buffer_Occupied_Bytes_Count--;
+	Count = Pointer_Port->Reception_Throttles_Count;
+	if (Is_Reset_Requested) Pointer_Port->Reception_Throttles_Count = 0;
 	USB_CORE_INTERRUPT_ENABLE();
 
-	return (char) Character;
+	return Count;
 }
 
-void USBCommunicationsWriteCharacter(char Character)
+unsigned char USBCommunicationsIsCharacterAvailable(TUSBCommunicationsPortID Port_ID)
 {
-	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Writing the character '%c'.", Character);
+	// Accessing the occupied bytes count single-byte variable without the atomic access protections is safe because this is just a read
+	if (USB_Communications_Ports[Port_ID].Data_Reception_Buffer_Occupied_Bytes_Count > 0) return 1;
+	return 0;
+}
 
-	// Wait for the previous transmission to end
-	while (!USB_Communications_Is_Transmission_Finished);
-	USB_Communications_Is_Transmission_Finished = 0;
+unsigned char USBCommunicationsIsCharacterReceived(TUSBCommunicationsPortID Port_ID, char Character)
+{
+	TUSBCommunicationsPort *Pointer_Port = &USB_Communications_Ports[Port_ID];
+	unsigned char *Pointer_Data, Bytes_Count;
 
-	// Provide the next chunk of data to transmit
-	USBCorePrepareForInTransfer(USB_Communications_Data_In_Endpoint_ID, &Character, 1, USB_Communications_Data_In_Endpoint_Data_Synchronization);
+	// Only the caller context moves the reading pointer, and the interrupt context can only append characters meanwhile, so the characters already counted can be scanned without the atomic access protections
+	Bytes_Count = Pointer_Port->Data_Reception_Buffer_Occupied_Bytes_Count;
+	Pointer_Data = Pointer_Port->Pointer_Data_Reception_Buffer_Reading;
+	while (Bytes_Count > 0)
+	{
+		// Wrap around the pointer to the beginning of the buffer when it has reached the end of the buffer
+		if (Pointer_Data == (Pointer_Port->Data_Reception_Buffer + USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE)) Pointer_Data = Pointer_Port->Data_Reception_Buffer;
 
-	// Update the synchronization value
-	if (USB_Communications_Data_In_Endpoint_Data_Synchronization == 0) USB_Communications_Data_In_Endpoint_Data_Synchronization = 1;
-	else USB_Communications_Data_In_Endpoint_Data_Synchronization = 0;
+		if (*Pointer_Data == (unsigned char) Character) return 1;
+		Pointer_Data++;
+		Bytes_Count--;
+	}
+	return 0;
 }
 
-void USBCommunicationsWriteString(char *Pointer_String)
+char USBCommunicationsReadCharacter(TUSBCommunicationsPortID Port_ID)
+{
+	TUSBCommunicationsPort *Pointer_Port = &USB_Communications_Ports[Port_ID];
+	unsigned char Character;
+
+	while (1)
+	{
+		// Wait for a character to be received
+		// Accessing the occupied bytes count single-byte variable without the atomic access protections is safe because this is just a read, doing this avoids disabling the USB interrupts for too long
+		while (Pointer_Port->Data_Reception_Buffer_Occupied_Bytes_Count == 0);
+
+		// Atomically access to the reception circular buffer, a bus reset may have discarded the received data meanwhile
+		USB_CORE_INTERRUPT_DISABLE();
+		if (Pointer_Port->Data_Reception_Buffer_Occupied_Bytes_Count > 0) break;
+		USB_CORE_INTERRUPT_ENABLE();
+	}
+
+	// Wrap around the pointer to the beginning of the buffer when it has reached the end of the buffer, the bus reset handler reads this pointer so it is updated with the USB interrupt disabled
+	if (Pointer_Port->Pointer_Data_Reception_Buffer_Reading == (Pointer_Port->Data_Reception_Buffer + USB_COMMUNICATIONS_DATA_RECEPTION_BUFFER_SIZE)) Pointer_Port->Pointer_Data_Reception_Buffer_Reading = Pointer_Port->Data_Reception_Buffer;
+	Character = *Pointer_Port->Pointer_Data_Reception_Buffer_Reading;
+	Pointer_Port->Pointer_Data_Reception_Buffer_Reading++;
+	Pointer_Port->Data_Reception_Buffer_Occupied_Bytes_Count--;
+
+	// Let the host send more data when enough room has been freed
+	if (Pointer_Port->Data_Out_Held_Buffers_Count > 0) USBCommunicationsReleaseDataOutBuffer(Pointer_Port);
+	USB_CORE_INTERRUPT_ENABLE();
+
+	return (char) Character;
+}
+
+void USBCommunicationsWriteCharacter(TUSBCommunicationsPortID Port_ID, char Character)
+{
+	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Writing the character '%c' to the port %u.", Character, Port_ID);
+	USBCommunicationsAppendTransmissionData(&USB_Communications_Ports[Port_ID], &Character, 1);
+}
+
+void USBCommunicationsWriteString(TUSBCommunicationsPortID Port_ID, char *Pointer_String)
 {
 	unsigned short Length = 0;
-	unsigned char Chunk_Length;
 	char *Pointer_String_Temporary = Pointer_String;
 
 	// Cache the string length
@@ -273,29 +643,57 @@ void USBCommunicationsWriteString(char *Pointer_String)
 		Length++;
 		Pointer_String_Temporary++;
 	}
-	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Writing the string \"%s\" made of %u bytes.", Pointer_String, Length);
+	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Writing the string \"%s\" made of %u bytes to the port %u.", Pointer_String, Length, Port_ID);
 
-	// Send the string in chunks if its size exceeds the USB packet size
-	while (Length > 0)
-	{
-		// Wait for the previous transmission to end
-		while (!USB_Communications_Is_Transmission_Finished);
-		USB_Communications_Is_Transmission_Finished = 0;
+	USBCommunicationsAppendTransmissionData(&USB_Communications_Ports[Port_ID], Pointer_String, Length);
+}
 
-		// Split the data in chunks if needed
-		if (Length > USB_CORE_ENDPOINT_PACKETS_SIZE) Chunk_Length = USB_CORE_ENDPOINT_PACKETS_SIZE;
-		else Chunk_Length = (unsigned char) Length;
-		LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Sending a data chunk of %u bytes.", Chunk_Length);
+void USBCommunicationsFlush(TUSBCommunicationsPortID Port_ID)
+{
+	TUSBCommunicationsPort *Pointer_Port = &USB_Communications_Ports[Port_ID];
 
-		// Provide the next chunk of data to transmit
-		USBCorePrepareForInTransfer(USB_Communications_Data_In_Endpoint_ID, Pointer_String, Chunk_Length, USB_Communications_Data_In_Endpoint_Data_Synchronization);
+	// Wait for the data IN endpoint callback to send all buffered data, then for the host to acknowledge the last packet
+	// Accessing the single-byte variables without the atomic access protections is safe because these are just reads
+	while ((Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count > 0) || (Pointer_Port->Data_In_Pending_Packets_Count > 0));
+}
 
-		// Update the synchronization value
-		if (USB_Communications_Data_In_Endpoint_Data_Synchronization == 0) USB_Communications_Data_In_Endpoint_Data_Synchronization = 1;
-		else USB_Communications_Data_In_Endpoint_Data_Synchronization = 0;
+void USBCommunicationsSignalEvents(TUSBCommunicationsPortID Port_ID, unsigned char Events)
+{
+	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Signaling the events 0x%02X on the port %u.", Events, Port_ID);
 
-		// Prepare for the next chunk transmission
-		Pointer_String += Chunk_Length;
-		Length -= Chunk_Length;
-	}
+	// Atomically access to the events shared with the notification endpoint callback
+	USB_CORE_INTERRUPT_DISABLE();
+	USBCommunicationsQueueEvents(&USB_Communications_Ports[Port_ID], Events);
+	USB_CORE_INTERRUPT_ENABLE();
+}
+
+unsigned char *USBCommunicationsAcquireTransmissionPacket(TUSBCommunicationsPortID Port_ID)
+{
+	TUSBCommunicationsPort *Pointer_Port = &USB_Communications_Ports[Port_ID];
+
+	// Keep the data order by waiting for the previously buffered data to be given to the SIE, then wait for a ping-pong buffer to be released by the host
+	// Accessing the single-byte variables without the atomic access protections is safe because these are just reads, and the values can only decrease meanwhile
+	while (Pointer_Port->Data_Transmission_Buffer_Occupied_Bytes_Count > 0);
+	while (Pointer_Port->Data_In_Pending_Packets_Count >= USB_CORE_PING_PONG_BUFFERS_COUNT);
+
+	// Reserve the buffer, so the flow control callback takes the packet into account until the host acknowledges it
+	USB_CORE_INTERRUPT_DISABLE();
+	Pointer_Port->Data_In_Pending_Packets_Count++;
+	USB_CORE_INTERRUPT_ENABLE();
+
+	return USBCoreAcquireInBuffer(Pointer_Port->Data_In_Endpoint_ID);
+}
+
+void USBCommunicationsCommitTransmissionPacket(TUSBCommunicationsPortID Port_ID, unsigned char Data_Size)
+{
+	TUSBCommunicationsPort *Pointer_Port = &USB_Communications_Ports[Port_ID];
+
+	LOG(USB_COMMUNICATIONS_IS_LOGGING_ENABLED, "Committing a directly written packet of %u bytes to the port %u.", Data_Size, Port_ID);
+
+	// The transmission buffer is empty, so the flow control callback can't access to the synchronization value meanwhile
+	USBCoreCommitInTransfer(Pointer_Port->Data_In_Endpoint_ID, Data_Size, Pointer_Port->Data_In_Endpoint_Data_Synchronization);
+
+	// Update the synchronization value
+	if (Pointer_Port->Data_In_Endpoint_Data_Synchronization == 0) Pointer_Port->Data_In_Endpoint_Data_Synchronization = 1;
+	else Pointer_Port->Data_In_Endpoint_Data_Synchronization = 0;
 }
@@ -3,6 +3,7 @@
  * @author Adrien RICCIARDI
  */
 #include <Log.h>
+#include <string.h>
 #include <USB_Core.h>
 #include <xc.h>
 
@@ -12,20 +13,49 @@
 /** Set to 1 to enable the log messages, set to 0 to disable them. */
 #define USB_CORE_IS_LOGGING_ENABLED 0
 
-#define USB_CORE_DEVICE_REQUEST_TYPE_MASK_TYPE 0x60
-#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_TYPE_STANDARD (0 << 5)
-#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_TYPE_CLASS (1 << 5)
-#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_TYPE_VENDOR (2 << 5)
-
-#define USB_CORE_DEVICE_REQUEST_TYPE_MASK_RECIPIENT 0x1F
-#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_RECIPIENT_DEVICE 0
-#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_RECIPIENT_INTERFACE 1
-#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_RECIPIENT_ENDPOINT 2
-#define USB_CORE_DEVICE_REQUEST_TYPE_VALUE_RECIPIENT_OTHER 3
+/** How many buffer descriptors are needed by the mapped hardware endpoints. The control endpoint uses 2 descriptors, the other endpoints use 4 ping-pong descriptors each. */
+#define USB_CORE_BUFFER_DESCRIPTORS_COUNT (2 + ((USB_CORE_HARDWARE_ENDPOINTS_COUNT - 1) * 2 * USB_CORE_PING_PONG_BUFFERS_COUNT))
+/** The SIE expects the buffer descriptors table at the beginning of the USB RAM. */
+#define USB_CORE_BUFFER_DESCRIPTORS_ADDRESS 0x400
+/** The data buffers are located right after the buffer descriptors, so no USB RAM is wasted by the descriptors of the unused hardware endpoints. */
+#define USB_CORE_DATA_BUFFERS_ADDRESS (USB_CORE_BUFFER_DESCRIPTORS_ADDRESS + (USB_CORE_BUFFER_DESCRIPTORS_COUNT * 4)) // A buffer descriptor is 4-byte long
+/** The first address following the USB RAM. */
+#define USB_CORE_RAM_END_ADDRESS 0x800
+/** The notification buffers are located right after the data buffers. */
+#define USB_CORE_NOTIFICATION_BUFFERS_ADDRESS (USB_CORE_DATA_BUFFERS_ADDRESS + (USB_CORE_DATA_BUFFERS_COUNT * USB_CORE_ENDPOINT_PACKETS_SIZE))
+/** The first address following the USB RAM reserved by this module, the compiler is free to allocate the application variables from here up to the USB RAM end. */
+#define USB_CORE_RESERVED_RAM_END_ADDRESS (USB_CORE_NOTIFICATION_BUFFERS_ADDRESS + (USB_CORE_NOTIFICATION_BUFFERS_COUNT * USB_CORE_NOTIFICATION_PACKETS_SIZE))
+#if USB_CORE_RESERVED_RAM_END_ADDRESS > USB_CORE_RAM_END_ADDRESS
+	#error "The buffer descriptors, the data buffers and the notification buffers do not fit in the USB RAM, reduce USB_CORE_HARDWARE_ENDPOINTS_COUNT, USB_CORE_DATA_BUFFERS_COUNT or USB_CORE_NOTIFICATION_BUFFERS_COUNT."
+#endif
+
+/** How many transactions the USTAT FIFO can hold. */
+#define USB_CORE_USTAT_FIFO_SIZE 4
+
+/** Set to 1 to put the microcontroller to sleep while the bus is suspended, set to 0 to only put the USB transceiver in low-power mode. */
+#define USB_CORE_IS_SLEEP_ON_SUSPEND_ENABLED 1
+
+/** Set to 1 to measure the copy routines duration when the module is initialized, the results are displayed with the log messages. */
+#define USB_CORE_IS_COPY_BENCHMARK_ENABLED 0
 
 /** A LED telling the user when there is activity on the USB bus. */
 #define USB_CORE_ACTIVITY_LED LATCbits.LATC1
 
+/** Copy a byte from the RAM address pointed by FSR1 to the RAM address pointed by FSR0, then increment both addresses. */
+#define USB_CORE_COPY_BYTE_FROM_RAM() asm("MOVFF POSTINC1, POSTINC0")
+/** Copy a byte from the program memory address pointed by TBLPTR to the RAM address pointed by FSR0, then increment both addresses. */
+#define USB_CORE_COPY_BYTE_FROM_PROGRAM_MEMORY() asm("TBLRD*+"); asm("MOVFF TABLAT, POSTINC0")
+
+/** Repeat a statement 8 times without any loop overhead. */
+#define USB_CORE_REPEAT_8_TIMES(Statement) Statement; Statement; Statement; Statement; Statement; Statement; Statement; Statement
+/** Repeat a statement 64 times without any loop overhead. */
+#define USB_CORE_REPEAT_64_TIMES(Statement) USB_CORE_REPEAT_8_TIMES(USB_CORE_REPEAT_8_TIMES(Statement))
+
+// The unrolled copy code paths are designed for a full packet
+#if USB_CORE_ENDPOINT_PACKETS_SIZE != 64
+	#error "The unrolled copy code paths must be updated to match the endpoint packets size."
+#endif
+
 //-------------------------------------------------------------------------------------------------
 // Private types
 //-------------------------------------------------------------------------------------------------
@@ -67,21 +97,56 @@ typedef struct
 	volatile unsigned char *Pointer_Address; // The compiler manual tells that this type of pointer is always 2-byte long
 } __attribute__((packed)) TUSBCoreBufferDescriptor;
 
-/** Consider than the in and out directions are enabled for all endpoints, so always map them both into the SIE endpoint descriptors memory. */
+/** Gather the buffer descriptors of both directions of an hardware endpoint and keep track of the ping-pong state.
+ * The control endpoint does not use ping-pong buffering, so its even and odd entries point to the same buffer descriptor.
+ */
+typedef struct
+{
+	volatile TUSBCoreBufferDescriptor *Pointer_Out_Descriptors[USB_CORE_PING_PONG_BUFFERS_COUNT]; //!< A transfer from the host to the device, indexed by the ping-pong buffer (0 for even, 1 for odd).
+	volatile TUSBCoreBufferDescriptor *Pointer_In_Descriptors[USB_CORE_PING_PONG_BUFFERS_COUNT]; //!< A transfer from the device to the host, indexed by the ping-pong buffer (0 for even, 1 for odd).
+	unsigned char Out_Next_Ping_Pong_Index; //!< The OUT buffer descriptor to give to the SIE on the next OUT transfer preparation.
+	unsigned char In_Next_Ping_Pong_Index; //!< The IN buffer descriptor to give to the SIE on the next IN transfer preparation.
+} TUSBCoreEndpointBufferDescriptor;
+
+/** Keep track of a control read transfer data stage, which can span several packets. */
 typedef struct
 {
-	volatile TUSBCoreBufferDescriptor Out_Descriptor; //!< A transfer from the host to the device.
-	volatile TUSBCoreBufferDescriptor In_Descriptor; //!< A transfer from the device to the host.
-} __attribute__((packed)) TUSBCoreEndpointBufferDescriptor;
+	const unsigned char *Pointer_Header; //!< The next byte to send from the first part of the data (usually the descriptor fields stored in the descriptor structure).
+	unsigned char Header_Remaining_Bytes_Count; //!< How many bytes of the first part of the data still need to be sent.
+	const unsigned char *Pointer_Data; //!< The next byte to send from the second part of the data (usually the descriptor content pointed by the descriptor structure).
+	unsigned char Is_Data_Located_In_RAM; //!< Set to 1 when the second part of the data is located in RAM, set to 0 when it is located in the program memory like the descriptors.
+	unsigned short Remaining_Bytes_Count; //!< How many bytes of the whole data still need to be sent.
+	unsigned char Is_Zero_Length_Packet_Needed; //!< Set to 1 when the data stage must be terminated by a zero-length packet.
+	unsigned char Is_Data_1_Synchronization; //!< The synchronization value of the next packet to send.
+	unsigned char Is_In_Progress; //!< Tell whether more packets need to be sent when the host acknowledges the current one.
+} TUSBCoreControlTransferDataStage;
 
 //-------------------------------------------------------------------------------------------------
 // Private variables
 //-------------------------------------------------------------------------------------------------
-/** Reserve the space for all possible buffer descriptors, even if they are not used (TODO this is hardcoded for now). */
-static volatile TUSBCoreEndpointBufferDescriptor USB_Core_Endpoint_Descriptors[32] __at(0x400);
+/** Reserve the space for the buffer descriptors of the mapped hardware endpoints only, the SIE never accesses the descriptors of the disabled endpoints. */
+static volatile TUSBCoreBufferDescriptor USB_Core_Buffer_Descriptors[USB_CORE_BUFFER_DESCRIPTORS_COUNT] __at(USB_CORE_BUFFER_DESCRIPTORS_ADDRESS);
 
 /** Reserve the space for the USB buffers. */
-static volatile unsigned char USB_Core_Buffers[USB_CORE_HARDWARE_ENDPOINTS_COUNT * USB_CORE_ENDPOINT_PACKETS_SIZE] __at(0x500);
+static volatile unsigned char USB_Core_Buffers[USB_CORE_DATA_BUFFERS_COUNT * USB_CORE_ENDPOINT_PACKETS_SIZE] __at(USB_CORE_DATA_BUFFERS_ADDRESS);
+
+/** Reserve the space for the small buffers of the notification endpoints. */
+static volatile unsigned char USB_Core_Notification_Buffers[USB_CORE_NOTIFICATION_BUFFERS_COUNT * USB_CORE_NOTIFICATION_PACKETS_SIZE] __at(USB_CORE_NOTIFICATION_BUFFERS_ADDRESS);
+
+/** Map each used hardware endpoint to its buffer descriptors. */
+static TUSBCoreEndpointBufferDescriptor USB_Core_Endpoint_Descriptors[USB_CORE_HARDWARE_ENDPOINTS_COUNT];
+
+/** The control read transfer currently being sent to the host. */
+static TUSBCoreControlTransferDataStage USB_Core_Control_Transfer_Data_Stage;
+
+/** Count the received Start-Of-Frame packets, the host sends one every millisecond. */
+static volatile unsigned long USB_Core_Milliseconds_Count = 0;
+
+/** Count the USB link events. */
+static TUSBCoreStatistics USB_Core_Statistics;
+
+/** Follow the enumeration progress. */
+static volatile TUSBCoreDeviceState USB_Core_Device_State = USB_CORE_DEVICE_STATE_POWERED;
 
 /** Allow a direct access to the device descriptor everywhere in the module. */
 static const TUSBCoreDescriptorDevice *Pointer_USB_Core_Device_Descriptor;
@@ -89,21 +154,82 @@ static const TUSBCoreDescriptorDevice *Pointer_USB_Core_Device_Descriptor;
 //-------------------------------------------------------------------------------------------------
 // Private functions
 //-------------------------------------------------------------------------------------------------
-/** Stall the IN buffer descriptor of the specified endpoint.
- * @param Endpoint_ID The endpoint to stall.
- * @note This is mostly used with the control endpoint to tell that a feature is not supported.
- */
-static void USBCoreStallEndpoint(unsigned char Endpoint_ID)
+/** Fill the control endpoint IN buffer with the next packet of the current control transfer data stage and give it to the SIE. */
+static void USBCoreSendNextControlTransferPacket(void)
 {
-	volatile TUSBCoreEndpointBufferDescriptor *Pointer_Endpoint_Descriptor;
+	unsigned char *Pointer_Endpoint_Buffer, Packet_Size, Chunk_Size;
 
-	// Cache the buffer descriptor access
-	Pointer_Endpoint_Descriptor = &USB_Core_Endpoint_Descriptors[Endpoint_ID];
+	// Directly fill the control endpoint buffer
+	Pointer_Endpoint_Buffer = USBCoreAcquireInBuffer(0);
 
-	// Get immediate ownership of the endpoint, do not wait for it to be returned by the SIE (otherwise, this function would block if multiple STALL need to be issued in a row)
-	Pointer_Endpoint_Descriptor->In_Descriptor.Status = 0;
-	Pointer_Endpoint_Descriptor->In_Descriptor.Status_To_Peripheral.Is_Buffer_Stalled = 1;
-	Pointer_Endpoint_Descriptor->In_Descriptor.Status_From_Peripheral.Is_Owned_By_Peripheral = 1;
+	// Send as much data as possible in a single packet
+	if (USB_Core_Control_Transfer_Data_Stage.Remaining_Bytes_Count >= USB_CORE_ENDPOINT_PACKETS_SIZE) Packet_Size = USB_CORE_ENDPOINT_PACKETS_SIZE;
+	else Packet_Size = (unsigned char) USB_Core_Control_Transfer_Data_Stage.Remaining_Bytes_Count;
+	USB_Core_Control_Transfer_Data_Stage.Remaining_Bytes_Count -= Packet_Size;
+
+	// Start with the header bytes that have not been sent yet (if any)
+	Chunk_Size = Packet_Size;
+	if (USB_Core_Control_Transfer_Data_Stage.Header_Remaining_Bytes_Count > 0)
+	{
+		if (Chunk_Size > USB_Core_Control_Transfer_Data_Stage.Header_Remaining_Bytes_Count) Chunk_Size = USB_Core_Control_Transfer_Data_Stage.Header_Remaining_Bytes_Count;
+		USBCoreCopyFromProgramMemory(Pointer_Endpoint_Buffer, USB_Core_Control_Transfer_Data_Stage.Pointer_Header, Chunk_Size);
+		USB_Core_Control_Transfer_Data_Stage.Pointer_Header += Chunk_Size;
+		USB_Core_Control_Transfer_Data_Stage.Header_Remaining_Bytes_Count -= Chunk_Size;
+		Pointer_Endpoint_Buffer += Chunk_Size;
+		Chunk_Size = Packet_Size - Chunk_Size;
+	}
+
+	// Fill the remaining packet space with the following data
+	if (Chunk_Size > 0)
+	{
+		if (USB_Core_Control_Transfer_Data_Stage.Is_Data_Located_In_RAM) USBCoreCopyFromRAM(Pointer_Endpoint_Buffer, (void *) USB_Core_Control_Transfer_Data_Stage.Pointer_Data, Chunk_Size);
+		else USBCoreCopyFromProgramMemory(Pointer_Endpoint_Buffer, USB_Core_Control_Transfer_Data_Stage.Pointer_Data, Chunk_Size);
+		USB_Core_Control_Transfer_Data_Stage.Pointer_Data += Chunk_Size;
+	}
+	LOG(USB_CORE_IS_LOGGING_ENABLED, "Sending a %u-byte control transfer packet, %u bytes remaining.", Packet_Size, USB_Core_Control_Transfer_Data_Stage.Remaining_Bytes_Count);
+
+	USBCoreCommitInTransfer(0, Packet_Size, USB_Core_Control_Transfer_Data_Stage.Is_Data_1_Synchronization);
+	USB_Core_Control_Transfer_Data_Stage.Is_Data_1_Synchronization ^= 1;
+
+	// A short packet terminates the data stage, a full last packet needs to be followed by a zero-length packet only when the host asked for more data than available
+	if ((Packet_Size < USB_CORE_ENDPOINT_PACKETS_SIZE) || ((USB_Core_Control_Transfer_Data_Stage.Remaining_Bytes_Count == 0) && !USB_Core_Control_Transfer_Data_Stage.Is_Zero_Length_Packet_Needed)) USB_Core_Control_Transfer_Data_Stage.Is_In_Progress = 0;
+}
+
+/** Start the data stage of a control read transfer, the data are sent in as many packets as needed when the host acknowledges each packet.
+ * @param Pointer_Header The first part of the data to send, located in the program memory. It can be NULL if Header_Size is 0, so contiguous data are streamed from Pointer_Data only.
+ * @param Header_Size The size in bytes of the first part of the data.
+ * @param Pointer_Data The second part of the data to send, which will be transmitted right after the first part. It can be NULL if Descriptor_Size equals Header_Size.
+ * @param Is_Data_Located_In_RAM Set to 1 if the second part of the data is located in RAM, set to 0 if it is located in the program memory.
+ * @param Descriptor_Size The total size in bytes of the two data parts.
+ * @param Requested_Length The amount of bytes asked by the host.
+ */
+static void USBCoreStartControlTransferDataStage(const void *Pointer_Header, unsigned char Header_Size, const void *Pointer_Data, unsigned char Is_Data_Located_In_RAM, unsigned short Descriptor_Size, unsigned short Requested_Length)
+{
+	// Never send more data than asked by the host
+	if (Descriptor_Size < Requested_Length)
+	{
+		USB_Core_Control_Transfer_Data_Stage.Remaining_Bytes_Count = Descriptor_Size;
+		// The host expects more data, so it must be told that the data stage is terminated if the last packet is a full one
+		if ((Descriptor_Size % USB_CORE_ENDPOINT_PACKETS_SIZE) == 0) USB_Core_Control_Transfer_Data_Stage.Is_Zero_Length_Packet_Needed = 1;
+		else USB_Core_Control_Transfer_Data_Stage.Is_Zero_Length_Packet_Needed = 0;
+	}
+	else
+	{
+		USB_Core_Control_Transfer_Data_Stage.Remaining_Bytes_Count = Requested_Length;
+		USB_Core_Control_Transfer_Data_Stage.Is_Zero_Length_Packet_Needed = 0;
+	}
+	LOG(USB_CORE_IS_LOGGING_ENABLED, "Starting a control transfer data stage of %u bytes (descriptor size : %u bytes, requested length : %u bytes).", USB_Core_Control_Transfer_Data_Stage.Remaining_Bytes_Count, Descriptor_Size, Requested_Length);
+
+	// Configure the data sources
+	USB_Core_Control_Transfer_Data_Stage.Pointer_Header = Pointer_Header;
+	USB_Core_Control_Transfer_Data_Stage.Header_Remaining_Bytes_Count = Header_Size;
+	USB_Core_Control_Transfer_Data_Stage.Pointer_Data = Pointer_Data;
+	USB_Core_Control_Transfer_Data_Stage.Is_Data_Located_In_RAM = Is_Data_Located_In_RAM;
+
+	// The first data stage packet always uses the DATA1 synchronization
+	USB_Core_Control_Transfer_Data_Stage.Is_Data_1_Synchronization = 1;
+	USB_Core_Control_Transfer_Data_Stage.Is_In_Progress = 1;
+	USBCoreSendNextControlTransferPacket();
 }
 
 /** Send to the host the expected amount of configuration data. This function takes care of preparing the appropriate control pipe IN transfer.
@@ -112,8 +238,7 @@ static void USBCoreStallEndpoint(unsigned char Endpoint_ID)
  */
 static inline void USBCoreProcessGetConfigurationDescriptor(unsigned char Configuration_Index, unsigned short Length)
 {
-	volatile unsigned char *Pointer_Endpoint_Descriptor_Buffer = USB_Core_Endpoint_Descriptors[0].In_Descriptor.Pointer_Address; // Cache the control descriptor buffer address
-	unsigned char Count, Adjusted_Length;
+	unsigned char Count;
 	const TUSBCoreDescriptorConfiguration *Pointer_Configuration_Descriptor;
 
 	// Check the correctness of some values
@@ -130,77 +255,493 @@ static inline void USBCoreProcessGetConfigurationDescriptor(unsigned char Config
 		return;
 	}
 
-	// Clamp the requested total length to the one of a packet
-	if (Length <= USB_CORE_ENDPOINT_PACKETS_SIZE) Adjusted_Length = (unsigned char) Length; // TODO support for data greater than USB_CORE_ENDPOINT_PACKETS_SIZE
-	else
+	// Find the requested configuration
+	Pointer_Configuration_Descriptor = Pointer_USB_Core_Device_Descriptor->Pointer_Configurations[Configuration_Index];
+	LOG(USB_CORE_IS_LOGGING_ENABLED, "Found the configuration descriptor %u, it has %u interfaces and its total length is %u bytes.", Configuration_Index, Pointer_Configuration_Descriptor->bNumInterfaces, Pointer_Configuration_Descriptor->wTotalLength);
+
+	// The configuration descriptor is immediately followed by all its interfaces descriptors, so send everything in a single stream
+	USBCoreStartControlTransferDataStage(NULL, 0, Pointer_Configuration_Descriptor, 0, Pointer_Configuration_Descriptor->wTotalLength, Length);
+}
+
+/** Send to the host the expected amount of string data. This function takes care of preparing the appropriate control pipe IN transfer.
+ * @param String_Index The string to obtain information from.
+ * @param Length The amount of string bytes requested by the host.
+ */
+static inline void USBCoreProcessGetStringDescriptor(unsigned char String_Index, unsigned short Length)
+{
+	const unsigned char STRING_DESCRIPTOR_HEADER_SIZE = 2;
+	const TUSBCoreDescriptorString *Pointer_String_Descriptor;
+
+	// Is this string descriptor existing ?
+	if (String_Index >= Pointer_USB_Core_Device_Descriptor->String_Descriptors_Count) // TODO compute the amount of strings in the whole descriptors and do more secure checks
 	{
-		LOG(USB_CORE_IS_LOGGING_ENABLED, "Limiting the requested size of %u bytes to the maximum configured %u bytes.", Length, USB_CORE_ENDPOINT_PACKETS_SIZE);
-		Adjusted_Length = USB_CORE_ENDPOINT_PACKETS_SIZE;
+		LOG(USB_CORE_IS_LOGGING_ENABLED, "Error : an out-of-bounds string index %u has been requested (the device descriptor has %u string descriptors), aborting.", String_Index, Pointer_USB_Core_Device_Descriptor->String_Descriptors_Count);
+		return;
 	}
 
-	// Find the requested configuration
-	Pointer_Configuration_Descriptor = &Pointer_USB_Core_Device_Descriptor->Pointer_Configurations[Configuration_Index];
-	LOG(USB_CORE_IS_LOGGING_ENABLED, "Found the configuration descriptor %u.", Configuration_Index);
+	// Cache access to the string descriptor
+	Pointer_String_Descriptor = &Pointer_USB_Core_Device_Descriptor->Pointer_Strings[String_Index];
+	LOG(USB_CORE_IS_LOGGING_ENABLED, "Selecting the string descriptor %u of size %u bytes.", String_Index, Pointer_String_Descriptor->bLength);
+
+	// Start with the "header" of the descriptor, then append the string data
+	USBCoreStartControlTransferDataStage(Pointer_String_Descriptor, STRING_DESCRIPTOR_HEADER_SIZE, Pointer_String_Descriptor->Pointer_Data, 0, Pointer_String_Descriptor->bLength, Length);
+}
+
+/** Send a descriptor type unknown to the USB core, provided by the application.
+ * @param Pointer_Request The GET_DESCRIPTOR request SETUP packet.
+ */
+static inline void USBCoreProcessGetClassDescriptor(TUSBCoreDeviceRequest *Pointer_Request)
+{
+	const void *Pointer_Descriptor;
+	unsigned short Descriptor_Size;
+	TUSBCoreClassDescriptorCallback Class_Descriptor_Callback = Pointer_USB_Core_Device_Descriptor->Class_Descriptor_Callback;
+
+	if ((Class_Descriptor_Callback == NULL) || (Class_Descriptor_Callback(Pointer_Request, &Pointer_Descriptor, &Descriptor_Size) != 0))
+	{
+		LOG(USB_CORE_IS_LOGGING_ENABLED, "Unsupported descriptor type, stalling the control endpoint.");
+		USBCoreStallEndpoint(0);
+		return;
+	}
+
+	LOG(USB_CORE_IS_LOGGING_ENABLED, "Selecting a %u-byte class descriptor.", Descriptor_Size);
+	USBCoreStartControlTransferDataStage(NULL, 0, Pointer_Descriptor, 0, Descriptor_Size, Pointer_Request->wLength);
+}
+
+/** Terminate a request served by an application callback : send the data the callback provided, acknowledge the request or stall the control endpoint.
+ * @param Pointer_Request The request SETUP packet.
+ * @param Is_Request_Supported Set to 1 if the callback has served the request, set to 0 to stall the control endpoint.
+ * @param Pointer_Data The RAM location of the data to send for a device-to-host request.
+ * @param Data_Size The size in bytes of the data to send for a device-to-host request.
+ */
+static void USBCoreCompleteApplicationRequest(TUSBCoreDeviceRequest *Pointer_Request, unsigned char Is_Request_Supported, void *Pointer_Data, unsigned short Data_Size)
+{
+	if (!Is_Request_Supported)
+	{
+		LOG(USB_CORE_IS_LOGGING_ENABLED, "The request is not supported, stalling the control endpoint.");
+		USBCoreStallEndpoint(0);
+	}
+	// Send the requested data
+	else if ((Pointer_Request->bmRequestType & USB_CORE_DEVICE_REQUEST_TYPE_MASK_DIRECTION) == USB_CORE_DEVICE_REQUEST_TYPE_VALUE_DIRECTION_DEVICE_TO_HOST) USBCoreStartControlTransferDataStage(NULL, 0, Pointer_Data, 1, Data_Size, Pointer_Request->wLength);
+	// Send back an empty packet to acknowledge a request without data stage
+	else USBCorePrepareForInTransfer(0, NULL, 0, 1);
+
+	USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
+}
+
+/** Let the application process a vendor request, then send the data it provided or acknowledge the request.
+ * @param Pointer_Request The request SETUP packet.
+ */
+static inline void USBCoreProcessVendorRequest(TUSBCoreDeviceRequest *Pointer_Request)
+{
+	void *Pointer_Data = NULL;
+	unsigned short Data_Size = 0;
+	unsigned char Is_Request_Supported;
+	TUSBCoreVendorRequestCallback Vendor_Request_Callback = Pointer_USB_Core_Device_Descriptor->Vendor_Request_Callback;
+
+	LOG(USB_CORE_IS_LOGGING_ENABLED, "Decoded as a vendor request (request : 0x%02X, value = 0x%04X, index = 0x%04X, length = 0x%04X).", Pointer_Request->bRequest, Pointer_Request->wValue, Pointer_Request->wIndex, Pointer_Request->wLength);
+
+	// The host-to-device data stage packets would be given to the control endpoint callback, so this kind of request can't be supported
+	if ((Vendor_Request_Callback == NULL) || (((Pointer_Request->bmRequestType & USB_CORE_DEVICE_REQUEST_TYPE_MASK_DIRECTION) == USB_CORE_DEVICE_REQUEST_TYPE_VALUE_DIRECTION_HOST_TO_DEVICE) && (Pointer_Request->wLength > 0)) || (Vendor_Request_Callback(Pointer_Request, &Pointer_Data, &Data_Size) != 0)) Is_Request_Supported = 0;
+	else Is_Request_Supported = 1;
+
+	USBCoreCompleteApplicationRequest(Pointer_Request, Is_Request_Supported, Pointer_Data, Data_Size);
+}
+
+/** Let the application serve a class request without data stage or with a device-to-host data stage, the other class requests are forwarded to the control endpoint callback.
+ * @param Pointer_Request The request SETUP packet.
+ * @return 0 if the request has been served (or stalled),
+ * @return 1 if the request must be forwarded to the control endpoint callback.
+ */
+static inline unsigned char USBCoreProcessClassRequest(TUSBCoreDeviceRequest *Pointer_Request)
+{
+	void *Pointer_Data = NULL;
+	unsigned short Data_Size = 0;
+	TUSBCoreClassRequestCallback Class_Request_Callback = Pointer_USB_Core_Device_Descriptor->Class_Request_Callback;
+
+	// The host-to-device data stage packets are given to the control endpoint callback, so this callback must also process the request
+	if ((Class_Request_Callback == NULL) || (((Pointer_Request->bmRequestType & USB_CORE_DEVICE_REQUEST_TYPE_MASK_DIRECTION) == USB_CORE_DEVICE_REQUEST_TYPE_VALUE_DIRECTION_HOST_TO_DEVICE) && (Pointer_Request->wLength > 0))) return 1;
+
+	switch (Class_Request_Callback(Pointer_Request, &Pointer_Data, &Data_Size))
+	{
+		case 0:
+			USBCoreCompleteApplicationRequest(Pointer_Request, 1, Pointer_Data, Data_Size);
+			return 0;
+
+		case 1:
+			USBCoreCompleteApplicationRequest(Pointer_Request, 0, NULL, 0);
+			return 0;
+
+		default:
+			return 1;
+	}
+}
+
+/** Service the transaction at the top of the USTAT FIFO. */
+static void USBCoreProcessTransaction(void)
+{
+	static unsigned char Device_Address = 0; // Keep the assigned address to set it in a later interrupt
+	unsigned char Endpoint_ID, Is_In_Transfer, Ping_Pong_Index;
+	TUSBCoreEndpointBufferDescriptor *Pointer_Endpoint_Descriptor;
+	volatile TUSBCoreBufferDescriptor *Pointer_Buffer_Descriptor;
+	volatile unsigned char *Pointer_Endpoint_Buffer;
+	volatile TUSBCoreDeviceRequest *Pointer_Device_Request;
+	TUSBCoreHardwareEndpointConfiguration *Pointer_Hardware_Endpoints_Configuration;
+	TUSBCorePacketIdentifierType Packet_Identifier_Type;
 
-	// Always start from the configuration descriptor itself
-	USB_CORE_MEMCPY(Pointer_Endpoint_Descriptor_Buffer, Pointer_Configuration_Descriptor, USB_CORE_DESCRIPTOR_SIZE_CONFIGURATION);
+	// Cache the involved endpoint information
+	Endpoint_ID = USTAT >> 3;
+	Is_In_Transfer = USTATbits.DIR; // Determine the transfer direction
+	Ping_Pong_Index = USTATbits.PPBI; // Determine whether the even or the odd buffer was used (this is always the even one for the control endpoint)
+	Pointer_Endpoint_Descriptor = &USB_Core_Endpoint_Descriptors[Endpoint_ID]; // Cache the endpoint access
+	if (Is_In_Transfer) Pointer_Buffer_Descriptor = Pointer_Endpoint_Descriptor->Pointer_In_Descriptors[Ping_Pong_Index];
+	else Pointer_Buffer_Descriptor = Pointer_Endpoint_Descriptor->Pointer_Out_Descriptors[Ping_Pong_Index];
 
-	// Append the interfaces if asked to
-	if (Adjusted_Length > USB_CORE_DESCRIPTOR_SIZE_CONFIGURATION)
+	// Display low level debugging information
+	LOG_BEGIN_SECTION(USB_CORE_IS_LOGGING_ENABLED)
 	{
-		Pointer_Endpoint_Descriptor_Buffer += USB_CORE_DESCRIPTOR_SIZE_CONFIGURATION;
-		LOG(USB_CORE_IS_LOGGING_ENABLED, "The configuration descriptor has %u interfaces, its total length is %u bytes.", Pointer_Configuration_Descriptor->bNumInterfaces, Pointer_Configuration_Descriptor->wTotalLength);
+		const char *Pointer_String_Packet_Identifier;
+		volatile unsigned char *Pointer_Endpoint_Register;
+
+		// Display the last endpoint activity
+		printf("Last endpoint ID : %u, transaction type : %s, buffer : %s.\r\n", Endpoint_ID, Is_In_Transfer ? "IN" : "OUT", Ping_Pong_Index ? "odd" : "even");
 
-		// Make sure only no more bytes than contained in the descriptor are transmitted
-		if (Adjusted_Length > Pointer_Configuration_Descriptor->wTotalLength)
+		// Show the received packet (OUT) type
+		if (!Is_In_Transfer)
 		{
-			Adjusted_Length = (unsigned char) Pointer_Configuration_Descriptor->wTotalLength;
-			LOG(USB_CORE_IS_LOGGING_ENABLED, "The requested length is greater than the descriptor length, adjusting the requested length.");
+			switch (Pointer_Buffer_Descriptor->Status_From_Peripheral.PID)
+			{
+				case USB_CORE_PACKET_IDENTIFIER_TYPE_TOKEN_OUT:
+					Pointer_String_Packet_Identifier = "token OUT";
+					break;
+				case USB_CORE_PACKET_IDENTIFIER_TYPE_HANDSHAKE_ACK:
+					Pointer_String_Packet_Identifier = "handshake ACK";
+					break;
+				case USB_CORE_PACKET_IDENTIFIER_TYPE_TOKEN_SETUP:
+					Pointer_String_Packet_Identifier = "token SETUP";
+					break;
+				default:
+					Pointer_String_Packet_Identifier = "\033[31munknown\033[0m";
+					break;
+			}
+			printf("Received Packet Identifier (PID) : %s.\r\n", Pointer_String_Packet_Identifier);
 		}
 
-		// Append all interface descriptors
-		USB_CORE_MEMCPY(Pointer_Endpoint_Descriptor_Buffer, Pointer_Configuration_Descriptor->Pointer_Interfaces_Data, Adjusted_Length - USB_CORE_DESCRIPTOR_SIZE_CONFIGURATION);
+		// Tell whether the endpoint is stalled by the host
+		Pointer_Endpoint_Register = &UEP0 + Endpoint_ID;
+		if (*Pointer_Endpoint_Register & 0x01) printf("The endpoint is stalled.\r\n");
 	}
+	LOG_END_SECTION()
 
-	USBCorePrepareForInTransfer(0, NULL, Adjusted_Length, 1);
+	// Cache the endpoint data buffer access
+	Pointer_Endpoint_Buffer = Pointer_Buffer_Descriptor->Pointer_Address;
+
+	// IN transfer
+	if (Is_In_Transfer)
+	{
+		LOG(USB_CORE_IS_LOGGING_ENABLED, "Sent a %u-byte packet from endpoint %u.", Pointer_Buffer_Descriptor->Bytes_Count, Endpoint_ID);
+		USB_Core_Statistics.Endpoints_In_Packets_Count[Endpoint_ID]++;
+		USB_Core_Statistics.In_Bytes_Count += Pointer_Buffer_Descriptor->Bytes_Count;
+
+		// Assign the device address only when the ACK of the SET ADDRESS command has been transmitted on the default address 0
+		if (Device_Address != 0)
+		{
+			UADDR = Device_Address;
+			Device_Address = 0;
+			USB_Core_Device_State = USB_CORE_DEVICE_STATE_ADDRESSED;
+		}
+		// Continue sending the control transfer data stage
+		else if ((Endpoint_ID == 0) && USB_Core_Control_Transfer_Data_Stage.Is_In_Progress) USBCoreSendNextControlTransferPacket();
+		else
+		{
+			LOG(USB_CORE_IS_LOGGING_ENABLED, "An IN transfer is completed, calling the corresponding callback (if any).");
+			// Call the corresponding callback
+			Pointer_Hardware_Endpoints_Configuration = &Pointer_USB_Core_Device_Descriptor->Pointer_Hardware_Endpoints_Configuration[Endpoint_ID];
+			if (Pointer_Hardware_Endpoints_Configuration->In_Transfer_Callback != NULL) Pointer_Hardware_Endpoints_Configuration->In_Transfer_Callback(Endpoint_ID);
+		}
+	}
+	// OUT or SETUP transfer
+	else
+	{
+		USB_Core_Statistics.Endpoints_Out_Packets_Count[Endpoint_ID]++;
+		USB_Core_Statistics.Out_Bytes_Count += Pointer_Buffer_Descriptor->Bytes_Count;
+
+		// Display the received packet data
+		LOG_BEGIN_SECTION(USB_CORE_IS_LOGGING_ENABLED)
+		{
+			unsigned char i, Bytes_Count;
+
+			Bytes_Count = Pointer_Buffer_Descriptor->Bytes_Count;
+			LOG(USB_CORE_IS_LOGGING_ENABLED, "Received a %u-byte packet on endpoint %u : ", Bytes_Count, Endpoint_ID);
+			for (i = 0; i < Bytes_Count; i++) printf("0x%02X ", Pointer_Endpoint_Buffer[i]);
+			puts("\r");
+		}
+		LOG_END_SECTION()
+
+		// Handle the request according to its type
+		Packet_Identifier_Type = Pointer_Buffer_Descriptor->Status_From_Peripheral.PID;
+
+		// Host sending a normal OUT
+		if (Packet_Identifier_Type == USB_CORE_PACKET_IDENTIFIER_TYPE_TOKEN_OUT)
+		{
+			LOG(USB_CORE_IS_LOGGING_ENABLED, "Decoded as a normal OUT packet, calling the corresponding endpoint callback.");
+
+			// Call the corresponding callback
+			Pointer_Hardware_Endpoints_Configuration = &Pointer_USB_Core_Device_Descriptor->Pointer_Hardware_Endpoints_Configuration[Endpoint_ID];
+			Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback_Data.Pointer_OUT_Data_Buffer = (unsigned char *) Pointer_Endpoint_Buffer; // The data are located in the ping-pong buffer that has just been filled
+			Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback_Data.Data_Size = Pointer_Buffer_Descriptor->Bytes_Count;
+			Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback(&Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback_Data);
+		}
+		// Host acknowledging an IN transfer
+		else if (Packet_Identifier_Type == USB_CORE_PACKET_IDENTIFIER_TYPE_HANDSHAKE_ACK) LOG(USB_CORE_IS_LOGGING_ENABLED, "Received a handshake ACK from the host.");
+		// Host sending a SETUP request
+		else if (Packet_Identifier_Type == USB_CORE_PACKET_IDENTIFIER_TYPE_TOKEN_SETUP)
+		{
+			// A new SETUP packet aborts any previous control transfer, take back the control IN buffer that the host may not have read
+			USB_Core_Control_Transfer_Data_Stage.Is_In_Progress = 0;
+			Pointer_Endpoint_Descriptor->Pointer_In_Descriptors[0]->Status = 0;
+
+			// Manage the standard setup requests
+			Pointer_Device_Request = (volatile TUSBCoreDeviceRequest *) Pointer_Endpoint_Buffer;
+			if ((Pointer_Device_Request->bmRequestType & USB_CORE_DEVICE_REQUEST_TYPE_MASK_TYPE) == USB_CORE_DEVICE_REQUEST_TYPE_VALUE_TYPE_STANDARD)
+			{
+				LOG(USB_CORE_IS_LOGGING_ENABLED, "Decoded as a standard setup device request.");
+
+				switch (Pointer_Device_Request->bRequest)
+				{
+					case USB_CORE_DEVICE_REQUEST_ID_SET_ADDRESS:
+						// Keep the address to set it after this SETUP request has been fully serviced on the current default address 0
+						Device_Address = (unsigned char) Pointer_Device_Request->wValue;
+						LOG(USB_CORE_IS_LOGGING_ENABLED, "Host is setting the device address to 0x%02X.", Device_Address);
+
+						// Send back an empty packet to acknowledge the address setting (still using the default address 0)
+						USBCorePrepareForInTransfer(0, NULL, 0, 1);
+						USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
+						break;
+
+					case USB_CORE_DEVICE_REQUEST_ID_GET_DESCRIPTOR:
+					{
+						TUSBCoreDescriptorType Descriptor_Type;
+						unsigned char Descriptor_Index;
+
+						// Retrieve the request parameters
+						Descriptor_Type = Pointer_Device_Request->wValue >> 8;
+						Descriptor_Index = (unsigned char) Pointer_Device_Request->wValue;
+						LOG(USB_CORE_IS_LOGGING_ENABLED, "Host is asking for %u bytes of the descriptor of type %u and index %u.", Pointer_Device_Request->wLength, Descriptor_Type, Descriptor_Index);
+
+						switch (Descriptor_Type)
+						{
+							case USB_CORE_DESCRIPTOR_TYPE_CONFIGURATION:
+								USBCoreProcessGetConfigurationDescriptor(Descriptor_Index, Pointer_Device_Request->wLength);
+								USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
+								break;
+
+							case USB_CORE_DESCRIPTOR_TYPE_STRING:
+								USBCoreProcessGetStringDescriptor(Descriptor_Index, Pointer_Device_Request->wLength);
+								USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
+								break;
+
+							case USB_CORE_DESCRIPTOR_TYPE_DEVICE:
+								LOG(USB_CORE_IS_LOGGING_ENABLED, "Selecting the device descriptor.");
+								USBCoreStartControlTransferDataStage(Pointer_USB_Core_Device_Descriptor, USB_CORE_DESCRIPTOR_SIZE_DEVICE, NULL, 0, USB_CORE_DESCRIPTOR_SIZE_DEVICE, Pointer_Device_Request->wLength);
+								USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
+								break;
+
+							case USB_CORE_DESCRIPTOR_TYPE_DEVICE_QUALIFIER:
+								LOG(USB_CORE_IS_LOGGING_ENABLED, "Tell the host that the device qualifier descriptor is not supported.");
+								// Stall the control endpoint to tell that the device does not support high speed (see USB2.0 spec chapter 9.2.7)
+								USBCoreStallEndpoint(0);
+								USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
+								break;
+
+							default:
+								USBCoreProcessGetClassDescriptor((TUSBCoreDeviceRequest *) Pointer_Device_Request);
+								USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
+								break;
+						}
+						break;
+					}
+
+					case USB_CORE_DEVICE_REQUEST_ID_SET_CONFIGURATION:
+					{
+						LOG(USB_CORE_IS_LOGGING_ENABLED, "The host is setting the configuration with value %u (note that only the first configuration is supported for now).", (unsigned char) Pointer_Device_Request->wValue);
+
+						// The configuration value 0 brings the device back to the addressed state
+						if ((unsigned char) Pointer_Device_Request->wValue != 0) USB_Core_Device_State = USB_CORE_DEVICE_STATE_CONFIGURED;
+						else USB_Core_Device_State = USB_CORE_DEVICE_STATE_ADDRESSED;
+						USBCorePrepareForInTransfer(0, NULL, 0, 1); // Send back an empty packet to acknowledge the configuration setting
+						USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
+						break;
+					}
+				}
+			}
+			// The vendor requests are served without involving the class handler, so they do not disturb the class state machine
+			else if ((Pointer_Device_Request->bmRequestType & USB_CORE_DEVICE_REQUEST_TYPE_MASK_TYPE) == USB_CORE_DEVICE_REQUEST_TYPE_VALUE_TYPE_VENDOR) USBCoreProcessVendorRequest((TUSBCoreDeviceRequest *) Pointer_Device_Request);
+			// This is a class request, let the class request callback serve it if it is addressed to its interface, otherwise forward it to the control endpoint callback
+			else if (((Pointer_Device_Request->bmRequestType & USB_CORE_DEVICE_REQUEST_TYPE_MASK_TYPE) != USB_CORE_DEVICE_REQUEST_TYPE_VALUE_TYPE_CLASS) || USBCoreProcessClassRequest((TUSBCoreDeviceRequest *) Pointer_Device_Request))
+			{
+				LOG(USB_CORE_IS_LOGGING_ENABLED, "Decoded as a class request (request : 0x%02X, value = 0x%04X, index = 0x%04X, length = 0x%04X), calling the control endpoint callback.", Pointer_Device_Request->bRequest, Pointer_Device_Request->wValue, Pointer_Device_Request->wIndex, Pointer_Device_Request->wLength);
+
+				// Call the corresponding callback
+				Pointer_Hardware_Endpoints_Configuration = &Pointer_USB_Core_Device_Descriptor->Pointer_Hardware_Endpoints_Configuration[Endpoint_ID];
+				Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback_Data.Pointer_OUT_Data_Buffer = (unsigned char *) Pointer_Endpoint_Buffer;
+				Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback_Data.Data_Size = Pointer_Buffer_Descriptor->Bytes_Count;
+				Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback(&Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback_Data);
+			}
+
+			// When a setup transfer is received, the SIE disables packets processing, so re-enable it now
+			UCONbits.PKTDIS = 0;
+		}
+	}
 }
 
-/** Send to the host the expected amount of string data. This function takes care of preparing the appropriate control pipe IN transfer.
- * @param String_Index The string to obtain information from.
- * @param Length The amount of string bytes requested by the host.
+/** Measure how many instruction cycles are needed to copy a full packet with the former generic byte-by-byte copy and with the dedicated copy routines, then display the results.
+ * @note This function must be called before the USB module is enabled, because it uses the USB RAM as scratch buffers.
  */
-static inline void USBCoreProcessGetStringDescriptor(unsigned char String_Index, unsigned char Length)
+static void USBCoreBenchmarkCopies(void)
 {
-	const unsigned char STRING_DESCRIPTOR_HEADER_SIZE = 2;
-	volatile unsigned char *Pointer_Endpoint_Descriptor_Buffer = USB_Core_Endpoint_Descriptors[0].In_Descriptor.Pointer_Address; // Cache the control descriptor buffer address
-	const TUSBCoreDescriptorString *Pointer_String_Descriptor;
+	// The const objects are stored in program memory, and this pointer never receives a RAM address, so the compiler can't turn it into a mixed RAM/ROM pointer
+	static const unsigned char Program_Memory_Source[USB_CORE_ENDPOINT_PACKETS_SIZE] = { 0x55 };
+	volatile unsigned char *Pointer_Destination, *Pointer_Source;
+	const unsigned char *Pointer_Program_Memory_Source;
+	unsigned char i, j;
+	unsigned short Cycles_Counts[4];
 
-	// Is this string descriptor existing ?
-	if (String_Index >= Pointer_USB_Core_Device_Descriptor->String_Descriptors_Count) // TODO compute the amount of strings in the whole descriptors and do more secure checks
+	// Timer 1 counts the instruction cycles
+	T1CON = 0x02; // Do not enable the timer yet, use Fosc/4 as the clock, disable the prescaler, enable the 16-bit read/write mode
+
+	for (i = 0; i < 4; i++)
 	{
-		LOG(USB_CORE_IS_LOGGING_ENABLED, "Error : an out-of-bounds string index %u has been requested (the device descriptor has %u string descriptors), aborting.", String_Index, Pointer_USB_Core_Device_Descriptor->String_Descriptors_Count);
-		return;
+		// Copy between two packet buffers, or from a full packet table located in program memory (the device descriptor is not known yet)
+		Pointer_Destination = USB_Core_Buffers;
+		Pointer_Source = USB_Core_Buffers + USB_CORE_ENDPOINT_PACKETS_SIZE;
+		Pointer_Program_Memory_Source = Program_Memory_Source;
+
+		TMR1H = 0;
+		TMR1L = 0;
+		T1CONbits.TMR1ON = 1;
+		switch (i)
+		{
+			// The former generic copy from RAM
+			case 0:
+				for (j = 0; j < USB_CORE_ENDPOINT_PACKETS_SIZE; j++)
+				{
+					*Pointer_Destination = *Pointer_Source;
+					Pointer_Destination++;
+					Pointer_Source++;
+				}
+				break;
+
+			// The former generic copy from program memory
+			case 1:
+				for (j = 0; j < USB_CORE_ENDPOINT_PACKETS_SIZE; j++)
+				{
+					*Pointer_Destination = *Pointer_Program_Memory_Source;
+					Pointer_Destination++;
+					Pointer_Program_Memory_Source++;
+				}
+				break;
+
+			case 2:
+				USBCoreCopyFromRAM((void *) Pointer_Destination, (void *) Pointer_Source, USB_CORE_ENDPOINT_PACKETS_SIZE);
+				break;
+
+			case 3:
+				USBCoreCopyFromProgramMemory((void *) Pointer_Destination, Pointer_Program_Memory_Source, USB_CORE_ENDPOINT_PACKETS_SIZE);
+				break;
+		}
+		T1CONbits.TMR1ON = 0;
+
+		// The timer high byte is latched when the low byte is read
+		Cycles_Counts[i] = TMR1L;
+		Cycles_Counts[i] |= (unsigned short) TMR1H << 8;
 	}
 
-	// Clamp the requested total length to the one of a packet
-	if (Length > USB_CORE_ENDPOINT_PACKETS_SIZE)
+	LOG(USB_CORE_IS_COPY_BENCHMARK_ENABLED, "Full packet copy from RAM : %u cycles with the generic copy, %u cycles with the dedicated routine.", Cycles_Counts[0], Cycles_Counts[2]);
+	LOG(USB_CORE_IS_COPY_BENCHMARK_ENABLED, "Full packet copy from program memory : %u cycles with the generic copy, %u cycles with the dedicated routine.", Cycles_Counts[1], Cycles_Counts[3]);
+}
+
+/** Take back all buffer descriptors from the SIE, restart the ping-pong sequence of each endpoint from the even buffer descriptor, then give the OUT buffer descriptors to the SIE again.
+ * @note The SIE must have been told to use the even buffer descriptors too (see the PPBRST bit).
+ */
+static void USBCoreResetEndpoints(void)
+{
+	TUSBCoreEndpointBufferDescriptor *Pointer_Endpoint_Descriptor;
+	const TUSBCoreHardwareEndpointConfiguration *Pointer_Endpoint_Hardware_Configuration;
+	unsigned char i, j, Enabled_Directions;
+
+	Pointer_Endpoint_Descriptor = USB_Core_Endpoint_Descriptors;
+	Pointer_Endpoint_Hardware_Configuration = Pointer_USB_Core_Device_Descriptor->Pointer_Hardware_Endpoints_Configuration;
+	for (i = 0; i < Pointer_USB_Core_Device_Descriptor->Hardware_Endpoints_Count; i++)
 	{
-		LOG(USB_CORE_IS_LOGGING_ENABLED, "Limiting the requested size of %u bytes to the maximum configured %u bytes.", Length, USB_CORE_ENDPOINT_PACKETS_SIZE);
-		Length = USB_CORE_ENDPOINT_PACKETS_SIZE;
+		// Make sure all buffer descriptors belong to the MCU, including the ones the SIE did not return because the host stopped polling the endpoint
+		for (j = 0; j < USB_CORE_PING_PONG_BUFFERS_COUNT; j++)
+		{
+			Pointer_Endpoint_Descriptor->Pointer_Out_Descriptors[j]->Status = 0;
+			Pointer_Endpoint_Descriptor->Pointer_In_Descriptors[j]->Status = 0;
+		}
+		Pointer_Endpoint_Descriptor->Out_Next_Ping_Pong_Index = 0;
+		Pointer_Endpoint_Descriptor->In_Next_Ping_Pong_Index = 0;
+
+		// Make sure that the endpoint can receive a packet (all host transactions start with a synchronization value of 0)
+		Enabled_Directions = Pointer_Endpoint_Hardware_Configuration->Enabled_Directions;
+		if ((i == 0) || ((Enabled_Directions & (USB_CORE_HARDWARE_ENDPOINT_DIRECTION_OUT | USB_CORE_HARDWARE_ENDPOINT_WITHOUT_DATA_BUFFERS | USB_CORE_HARDWARE_ENDPOINT_NOTIFICATION_BUFFER)) == USB_CORE_HARDWARE_ENDPOINT_DIRECTION_OUT))
+		{
+			USBCorePrepareForOutTransfer(i, 0);
+
+			// Also give the odd buffer to the SIE, so the host can send two packets in a row without waiting for the firmware
+			if (i != 0) USBCorePrepareForOutTransfer(i, 1);
+		}
+
+		Pointer_Endpoint_Descriptor++;
+		Pointer_Endpoint_Hardware_Configuration++;
 	}
+}
 
-	// Cache access to the string descriptor
-	Pointer_String_Descriptor = &Pointer_USB_Core_Device_Descriptor->Pointer_Strings[String_Index];
-	if (Pointer_String_Descriptor->bLength < Length) Length = Pointer_String_Descriptor->bLength; // Clamp the size to the descriptor one, otherwise use the size asked by the host
-	LOG(USB_CORE_IS_LOGGING_ENABLED, "Selecting the string descriptor %u of size %u bytes (transmitting %u bytes).", String_Index, Pointer_String_Descriptor->bLength, Length);
+/** Put the USB module in low-power mode when the host suspends the bus, then put the microcontroller to sleep until the host resumes the bus.
+ * @note This function must be called from the USB interrupt context.
+ */
+static void USBCoreSuspend(void)
+{
+	LOG(USB_CORE_IS_LOGGING_ENABLED, "The bus has been idle for more than 3ms, suspending the device.");
+	USB_Core_Statistics.Suspends_Count++;
+
+	// Only bus activity can end the suspend state, any other USB event is meaningless until then
+	UIEbits.IDLEIE = 0;
+	UIEbits.ACTVIE = 1;
+	UIRbits.IDLEIF = 0;
+
+	// The activity LED draws more current than the suspend limit allows, and its timer would wake the microcontroller up
+	T0CONbits.TMR0ON = 0;
+	INTCONbits.TMR0IF = 0;
+	USB_CORE_ACTIVITY_LED = 0;
 
-	// Start with the "header" of the descriptor
-	USB_CORE_MEMCPY(Pointer_Endpoint_Descriptor_Buffer, Pointer_String_Descriptor, STRING_DESCRIPTOR_HEADER_SIZE);
-	Pointer_Endpoint_Descriptor_Buffer += STRING_DESCRIPTOR_HEADER_SIZE;
-	// Append the string data
-	USB_CORE_MEMCPY(Pointer_Endpoint_Descriptor_Buffer, Pointer_String_Descriptor->Pointer_Data, Length - STRING_DESCRIPTOR_HEADER_SIZE);
+	// Stop the USB transceiver and the module clock
+	UCONbits.SUSPND = 1;
 
-	USBCorePrepareForInTransfer(0, NULL, Length, 1);
+	// The bus activity interrupt wakes the microcontroller up even if the interrupts are disabled, so the execution continues after the SLEEP instruction, then the pending activity interrupt resumes the device as soon as this handler returns
+#if USB_CORE_IS_SLEEP_ON_SUSPEND_ENABLED
+	SLEEP();
+	NOP(); // The instruction following SLEEP is prefetched when entering sleep mode, so do not put anything meaningful in it
+#endif
+}
+
+/** Restore the USB module normal operations when the host resumes the bus.
+ * @note This function must be called from the USB interrupt context.
+ */
+static void USBCoreResume(void)
+{
+	LOG(USB_CORE_IS_LOGGING_ENABLED, "Bus activity has been detected, resuming the device.");
+
+	// The PLL needs to lock again if the microcontroller has been sleeping, the USB module requires its 48MHz clock (the host gives at least 10ms to the device to resume, locking takes about 2ms)
+	while (!OSCCON2bits.PLLRDY);
+
+	// Restart the USB module clock and the transceiver
+	UCONbits.SUSPND = 0;
+
+	// The activity flag can't be cleared until the USB module internal state has synchronized with the restarted clock, so retry until it sticks
+	UIEbits.ACTVIE = 0;
+	while (UIRbits.ACTVIF) UIRbits.ACTVIF = 0;
+	UIEbits.IDLEIE = 1;
 }
 
 //-------------------------------------------------------------------------------------------------
@@ -208,11 +749,19 @@ static inline void USBCoreProcessGetStringDescriptor(unsigned char String_Index,
 //-------------------------------------------------------------------------------------------------
 void USBCoreInitialize(const TUSBCoreDescriptorDevice *Pointer_Device_Descriptor)
 {
-	volatile TUSBCoreEndpointBufferDescriptor *Pointer_Endpoint_Descriptor;
-	unsigned char i, Endpoints_Count;
-	volatile unsigned char *Pointer_Endpoint_Data_Buffer, *Pointer_Endpoint_Register;
+	TUSBCoreEndpointBufferDescriptor *Pointer_Endpoint_Descriptor;
+	volatile TUSBCoreBufferDescriptor *Pointer_Buffer_Descriptor;
+	unsigned char i, j, Endpoints_Count, Enabled_Directions, Buffers_Count = 0, Notification_Buffers_Count = 0;
+	volatile unsigned char *Pointer_Endpoint_Data_Buffer, *Pointer_Endpoint_Notification_Buffer, *Pointer_Endpoint_Register;
 	TUSBCoreHardwareEndpointConfiguration *Pointer_Endpoint_Hardware_Configuration;
 
+	// Measure the copy routines performances while the USB RAM is still unused
+	LOG_BEGIN_SECTION(USB_CORE_IS_COPY_BENCHMARK_ENABLED)
+	{
+		USBCoreBenchmarkCopies();
+	}
+	LOG_END_SECTION()
+
 	// Display the USB bus activity using a LED
 	USB_CORE_ACTIVITY_LED = 0; // Start with the LED turned off (no analog input on RC1)
 	TRISCbits.TRISC1 = 0;
@@ -229,41 +778,107 @@ void USBCoreInitialize(const TUSBCoreDescriptorDevice *Pointer_Device_Descriptor
 	}
 	LOG(USB_CORE_IS_LOGGING_ENABLED, "There are %u hardware endpoints to configure.", Endpoints_Count);
 
-	// Disable eye test pattern, disable the USB OE monitoring signal, enable the on-chip pull-up, select the full-speed device mode, TODO for now disable ping-pong buffers, this will be a further optimization
-	UCFG = 0x14;
+	// Make sure there are enough reserved data buffers (the control endpoint always uses one buffer per direction)
+	Pointer_Endpoint_Hardware_Configuration = Pointer_Device_Descriptor->Pointer_Hardware_Endpoints_Configuration;
+	for (i = 0; i < Endpoints_Count; i++)
+	{
+		if (i == 0) Buffers_Count += 2;
+		else if (Pointer_Endpoint_Hardware_Configuration->Enabled_Directions & USB_CORE_HARDWARE_ENDPOINT_NOTIFICATION_BUFFER) Notification_Buffers_Count++;
+		else if (!(Pointer_Endpoint_Hardware_Configuration->Enabled_Directions & USB_CORE_HARDWARE_ENDPOINT_WITHOUT_DATA_BUFFERS))
+		{
+			if (Pointer_Endpoint_Hardware_Configuration->Enabled_Directions & USB_CORE_HARDWARE_ENDPOINT_DIRECTION_OUT) Buffers_Count += USB_CORE_PING_PONG_BUFFERS_COUNT;
+			if (Pointer_Endpoint_Hardware_Configuration->Enabled_Directions & USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN) Buffers_Count += USB_CORE_PING_PONG_BUFFERS_COUNT;
+		}
+		Pointer_Endpoint_Hardware_Configuration++;
+	}
+	if (Buffers_Count > USB_CORE_DATA_BUFFERS_COUNT)
+	{
+		LOG(USB_CORE_IS_LOGGING_ENABLED, "Error : %u data buffers are needed while only %u have been reserved (see USB_CORE_DATA_BUFFERS_COUNT).", Buffers_Count, USB_CORE_DATA_BUFFERS_COUNT);
+		return;
+	}
+	if (Notification_Buffers_Count > USB_CORE_NOTIFICATION_BUFFERS_COUNT)
+	{
+		LOG(USB_CORE_IS_LOGGING_ENABLED, "Error : %u notification buffers are needed while only %u have been reserved (see USB_CORE_NOTIFICATION_BUFFERS_COUNT).", Notification_Buffers_Count, USB_CORE_NOTIFICATION_BUFFERS_COUNT);
+		return;
+	}
+
+	// Tell how much reserved USB RAM could be given back to the application
+	LOG(USB_CORE_IS_LOGGING_ENABLED, "The USB RAM is reserved up to 0x%03X, %u data buffers and %u notification buffers are unused (%u bytes).", USB_CORE_RESERVED_RAM_END_ADDRESS, USB_CORE_DATA_BUFFERS_COUNT - Buffers_Count, USB_CORE_NOTIFICATION_BUFFERS_COUNT - Notification_Buffers_Count, ((USB_CORE_DATA_BUFFERS_COUNT - Buffers_Count) * USB_CORE_ENDPOINT_PACKETS_SIZE) + ((USB_CORE_NOTIFICATION_BUFFERS_COUNT - Notification_Buffers_Count) * USB_CORE_NOTIFICATION_PACKETS_SIZE));
 
-	// Enable the packet transfer
-	UCON = 0;
+	// Disable eye test pattern, disable the USB OE monitoring signal, enable the on-chip pull-up, select the full-speed device mode, enable the even/odd ping-pong buffers for all endpoints except the endpoint 0
+	UCFG = 0x17;
+
+	// Enable the packet transfer, make sure that the SIE starts from the even buffer of each endpoint
+	UCON = 0x40;
+	UCONbits.PPBRST = 0;
 
 	// Keep access to the various USB descriptors
 	Pointer_USB_Core_Device_Descriptor = Pointer_Device_Descriptor;
 
 	// Configure the buffer descriptors
 	Pointer_Endpoint_Descriptor = USB_Core_Endpoint_Descriptors;
+	Pointer_Buffer_Descriptor = USB_Core_Buffer_Descriptors;
 	Pointer_Endpoint_Data_Buffer = USB_Core_Buffers;
+	Pointer_Endpoint_Notification_Buffer = USB_Core_Notification_Buffers;
 	Pointer_Endpoint_Hardware_Configuration = Pointer_USB_Core_Device_Descriptor->Pointer_Hardware_Endpoints_Configuration;
 	Pointer_Endpoint_Register = &UEP0;
 	for (i = 0; i < Endpoints_Count; i++)
 	{
-		// Assign the data buffers
-		Pointer_Endpoint_Descriptor->Out_Descriptor.Pointer_Address = Pointer_Endpoint_Data_Buffer;
-		Pointer_Endpoint_Hardware_Configuration->Out_Transfer_Callback_Data.Pointer_OUT_Data_Buffer = (unsigned char *) Pointer_Endpoint_Data_Buffer;
-		Pointer_Endpoint_Data_Buffer += USB_CORE_ENDPOINT_PACKETS_SIZE;
-		Pointer_Endpoint_Descriptor->In_Descriptor.Pointer_Address = Pointer_Endpoint_Data_Buffer;
-		Pointer_Endpoint_Data_Buffer += USB_CORE_ENDPOINT_PACKETS_SIZE;
+		Enabled_Directions = Pointer_Endpoint_Hardware_Configuration->Enabled_Directions;
+
+		// The control endpoint has a single buffer descriptor per direction, so always use it
+		if (i == 0)
+		{
+			Pointer_Endpoint_Descriptor->Pointer_Out_Descriptors[0] = Pointer_Buffer_Descriptor;
+			Pointer_Endpoint_Descriptor->Pointer_Out_Descriptors[1] = Pointer_Buffer_Descriptor;
+			Pointer_Buffer_Descriptor->Pointer_Address = Pointer_Endpoint_Data_Buffer;
+			Pointer_Endpoint_Data_Buffer += USB_CORE_ENDPOINT_PACKETS_SIZE;
+			Pointer_Buffer_Descriptor++;
+
+			Pointer_Endpoint_Descriptor->Pointer_In_Descriptors[0] = Pointer_Buffer_Descriptor;
+			Pointer_Endpoint_Descriptor->Pointer_In_Descriptors[1] = Pointer_Buffer_Descriptor;
+			Pointer_Buffer_Descriptor->Pointer_Address = Pointer_Endpoint_Data_Buffer;
+			Pointer_Endpoint_Data_Buffer += USB_CORE_ENDPOINT_PACKETS_SIZE;
+			Pointer_Buffer_Descriptor++;
+		}
+		// The other endpoints buffer descriptors are stored by the SIE in the OUT even, OUT odd, IN even, IN odd order
+		else
+		{
+			for (j = 0; j < USB_CORE_PING_PONG_BUFFERS_COUNT; j++)
+			{
+				Pointer_Endpoint_Descriptor->Pointer_Out_Descriptors[j] = Pointer_Buffer_Descriptor;
+				Pointer_Endpoint_Descriptor->Pointer_In_Descriptors[j] = Pointer_Buffer_Descriptor + USB_CORE_PING_PONG_BUFFERS_COUNT;
+				Pointer_Buffer_Descriptor++;
 
-		// Make sure all endpoints belong to the MCU before booting
-		Pointer_Endpoint_Descriptor->Out_Descriptor.Status = 0;
-		Pointer_Endpoint_Descriptor->In_Descriptor.Status = 0;
+				// Both IN buffer descriptors of a notification endpoint share the same small buffer
+				if (Enabled_Directions & USB_CORE_HARDWARE_ENDPOINT_NOTIFICATION_BUFFER)
+				{
+					Pointer_Endpoint_Descriptor->Pointer_In_Descriptors[j]->Pointer_Address = Pointer_Endpoint_Notification_Buffer;
+					continue;
+				}
+
+				// Assign the data buffers to the enabled directions only, to save some USB RAM
+				if (Enabled_Directions & USB_CORE_HARDWARE_ENDPOINT_WITHOUT_DATA_BUFFERS) continue;
+				if (Enabled_Directions & USB_CORE_HARDWARE_ENDPOINT_DIRECTION_OUT)
+				{
+					Pointer_Endpoint_Descriptor->Pointer_Out_Descriptors[j]->Pointer_Address = Pointer_Endpoint_Data_Buffer;
+					Pointer_Endpoint_Data_Buffer += USB_CORE_ENDPOINT_PACKETS_SIZE;
+				}
+				if (Enabled_Directions & USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN)
+				{
+					Pointer_Endpoint_Descriptor->Pointer_In_Descriptors[j]->Pointer_Address = Pointer_Endpoint_Data_Buffer;
+					Pointer_Endpoint_Data_Buffer += USB_CORE_ENDPOINT_PACKETS_SIZE;
+				}
+			}
+			Pointer_Buffer_Descriptor += USB_CORE_PING_PONG_BUFFERS_COUNT; // Bypass the IN buffer descriptors
+			if (Enabled_Directions & USB_CORE_HARDWARE_ENDPOINT_NOTIFICATION_BUFFER) Pointer_Endpoint_Notification_Buffer += USB_CORE_NOTIFICATION_PACKETS_SIZE;
+		}
 
 		// Assign the endpoint ID, which is useful inside the endpoint callback
 		Pointer_Endpoint_Hardware_Configuration->Out_Transfer_Callback_Data.Endpoint_ID = i;
 
 		// Configure the hardware endpoint
-		*Pointer_Endpoint_Register = 0x18 | Pointer_Endpoint_Hardware_Configuration->Enabled_Directions; // Enable endpoint handshake, disable control transfers
-
-		// Make sure that the endpoint can receive a packet (all host transactions start with a synchronization value of 0)
-		USBCorePrepareForOutTransfer(i, 0);
+		*Pointer_Endpoint_Register = 0x18 | (Enabled_Directions & (USB_CORE_HARDWARE_ENDPOINT_DIRECTION_OUT | USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN)); // Enable endpoint handshake, disable control transfers
 
 		Pointer_Endpoint_Register++;
 		Pointer_Endpoint_Descriptor++;
@@ -272,10 +887,14 @@ void USBCoreInitialize(const TUSBCoreDescriptorDevice *Pointer_Device_Descriptor
 	// Ensure that the endpoint 0, used as the control endpoint, is always correctly configured
 	UEP0 = 0x16; // Enable endpoint handshake, allow control transfers, enable the endpoint OUT and IN directions
 
+	// Make sure all endpoints belong to the MCU before booting, then let them receive the first packets
+	USBCoreResetEndpoints();
+
 	// Configure the interrupts
 	// USB module
 	USB_CORE_INTERRUPT_ENABLE(); // Enable the USB peripheral global interrupt
-	UIE = 0x29; // Enable the STALL Handshake, the Transaction Complete and the Reset interrupts
+	UIE = 0x7B; // Enable the Start-Of-Frame, the STALL Handshake, the Idle Detect, the Transaction Complete, the USB Error Condition and the Reset interrupts (the Bus Activity Detect interrupt is enabled only while the bus is suspended)
+	UEIE = 0x9F; // Report all errors through the USB Error Condition interrupt, so they can be counted
 	IPR3bits.USBIP = 1; // Set the USB interrupt as high priority
 
 	// Activity LED timer
@@ -290,79 +909,233 @@ void USBCoreInitialize(const TUSBCoreDescriptorDevice *Pointer_Device_Descriptor
 	ACTCON = 0xD0; // Enable the active clock tuning module, allow the module to automatically update the OSCTUNE register, use the USB host clock as reference
 }
 
+void USBCoreStallEndpoint(unsigned char Endpoint_ID)
+{
+	TUSBCoreEndpointBufferDescriptor *Pointer_Endpoint_Descriptor;
+	volatile TUSBCoreBufferDescriptor *Pointer_Buffer_Descriptor;
+
+	// Cache the buffer descriptor access, the SIE will look at the next IN buffer descriptor of the endpoint
+	Pointer_Endpoint_Descriptor = &USB_Core_Endpoint_Descriptors[Endpoint_ID];
+	Pointer_Buffer_Descriptor = Pointer_Endpoint_Descriptor->Pointer_In_Descriptors[Pointer_Endpoint_Descriptor->In_Next_Ping_Pong_Index];
+
+	// Get immediate ownership of the endpoint, do not wait for it to be returned by the SIE (otherwise, this function would block if multiple STALL need to be issued in a row)
+	Pointer_Buffer_Descriptor->Status = 0;
+	Pointer_Buffer_Descriptor->Status_To_Peripheral.Is_Buffer_Stalled = 1;
+	Pointer_Buffer_Descriptor->Status_From_Peripheral.Is_Owned_By_Peripheral = 1;
+}
+
 void USBCorePrepareForOutTransfer(unsigned char Endpoint_ID, unsigned char Is_Data_1_Synchronization)
 {
+	TUSBCoreEndpointBufferDescriptor *Pointer_Endpoint_Descriptor;
+	volatile TUSBCoreBufferDescriptor *Pointer_Buffer_Descriptor;
+
 	// Cache the buffer descriptor access
-	volatile TUSBCoreEndpointBufferDescriptor *Pointer_Endpoint_Descriptor = &USB_Core_Endpoint_Descriptors[Endpoint_ID];
+	Pointer_Endpoint_Descriptor = &USB_Core_Endpoint_Descriptors[Endpoint_ID];
+	Pointer_Buffer_Descriptor = Pointer_Endpoint_Descriptor->Pointer_Out_Descriptors[Pointer_Endpoint_Descriptor->Out_Next_Ping_Pong_Index];
 
-	// Wait for any transfer concerning the endpoint to finish
-	while (Pointer_Endpoint_Descriptor->Out_Descriptor.Status_From_Peripheral.Is_Owned_By_Peripheral);
+	// Wait for any transfer concerning the buffer to finish
+	while (Pointer_Buffer_Descriptor->Status_From_Peripheral.Is_Owned_By_Peripheral);
 
 	// Allow the maximum amount of data to be received
-	Pointer_Endpoint_Descriptor->Out_Descriptor.Bytes_Count = USB_CORE_ENDPOINT_PACKETS_SIZE;
-	Pointer_Endpoint_Descriptor->Out_Descriptor.Status = 0; // Clear all previous settings
-	Pointer_Endpoint_Descriptor->Out_Descriptor.Status_To_Peripheral.Is_Data_Toggle_Synchronized_Enabled = 1;
-	Pointer_Endpoint_Descriptor->Out_Descriptor.Status_To_Peripheral.Data_Toggle_Synchronization = Is_Data_1_Synchronization;
-	Pointer_Endpoint_Descriptor->Out_Descriptor.Status_To_Peripheral.Is_Owned_By_Peripheral = 1; // Give the endpoint OUT buffer ownership to the USB peripheral
+	Pointer_Buffer_Descriptor->Bytes_Count = USB_CORE_ENDPOINT_PACKETS_SIZE;
+	Pointer_Buffer_Descriptor->Status = 0; // Clear all previous settings
+	Pointer_Buffer_Descriptor->Status_To_Peripheral.Is_Data_Toggle_Synchronized_Enabled = 1;
+	Pointer_Buffer_Descriptor->Status_To_Peripheral.Data_Toggle_Synchronization = Is_Data_1_Synchronization;
+	Pointer_Buffer_Descriptor->Status_To_Peripheral.Is_Owned_By_Peripheral = 1; // Give the endpoint OUT buffer ownership to the USB peripheral
+
+	// The SIE will use the other buffer for the next transaction (this has no effect on the control endpoint, which has the same buffer descriptor for both indexes)
+	Pointer_Endpoint_Descriptor->Out_Next_Ping_Pong_Index ^= 1;
 }
 
 void USBCorePrepareForInTransfer(unsigned char Endpoint_ID, void *Pointer_Data, unsigned char Data_Size, unsigned char Is_Data_1_Synchronization)
 {
-	volatile TUSBCoreEndpointBufferDescriptor *Pointer_Endpoint_Descriptor;
+	unsigned char *Pointer_Endpoint_Buffer;
 
 	// TODO what to do with a size higher than 64 bytes ?
 
+	// Wait for the buffer to be available (the other ping-pong buffer can still be in transmission meanwhile)
+	Pointer_Endpoint_Buffer = USBCoreAcquireInBuffer(Endpoint_ID);
+
+	// Copy the data to the USB RAM
+	if (Pointer_Data != NULL) USBCoreCopyFromRAM(Pointer_Endpoint_Buffer, Pointer_Data, Data_Size);
+
+	USBCoreCommitInTransfer(Endpoint_ID, Data_Size, Is_Data_1_Synchronization);
+}
+
+unsigned char *USBCoreAcquireInBuffer(unsigned char Endpoint_ID)
+{
+	TUSBCoreEndpointBufferDescriptor *Pointer_Endpoint_Descriptor;
+	volatile TUSBCoreBufferDescriptor *Pointer_Buffer_Descriptor;
+
 	// Cache the buffer descriptor access
 	Pointer_Endpoint_Descriptor = &USB_Core_Endpoint_Descriptors[Endpoint_ID];
+	Pointer_Buffer_Descriptor = Pointer_Endpoint_Descriptor->Pointer_In_Descriptors[Pointer_Endpoint_Descriptor->In_Next_Ping_Pong_Index];
 
-	// Wait for any transfer concerning the endpoint to finish
-	while (Pointer_Endpoint_Descriptor->In_Descriptor.Status_From_Peripheral.Is_Owned_By_Peripheral);
+	// Wait for any transfer concerning the buffer to finish
+	while (Pointer_Buffer_Descriptor->Status_From_Peripheral.Is_Owned_By_Peripheral);
 
-	// Copy the data to the USB RAM
-	if (Pointer_Data != NULL) USB_CORE_MEMCPY(Pointer_Endpoint_Descriptor->In_Descriptor.Pointer_Address, Pointer_Data, Data_Size);
-	Pointer_Endpoint_Descriptor->In_Descriptor.Bytes_Count = Data_Size;
+	// The buffer belongs to the microcontroller until it is committed, so it can be accessed without the volatile qualifier
+	return (unsigned char *) Pointer_Buffer_Descriptor->Pointer_Address;
+}
+
+void USBCoreCommitInTransfer(unsigned char Endpoint_ID, unsigned char Data_Size, unsigned char Is_Data_1_Synchronization)
+{
+	TUSBCoreEndpointBufferDescriptor *Pointer_Endpoint_Descriptor;
+	volatile TUSBCoreBufferDescriptor *Pointer_Buffer_Descriptor;
+
+	// Cache the buffer descriptor access
+	Pointer_Endpoint_Descriptor = &USB_Core_Endpoint_Descriptors[Endpoint_ID];
+	Pointer_Buffer_Descriptor = Pointer_Endpoint_Descriptor->Pointer_In_Descriptors[Pointer_Endpoint_Descriptor->In_Next_Ping_Pong_Index];
+	Pointer_Buffer_Descriptor->Bytes_Count = Data_Size;
 
 	// Configure the transfer settings
-	Pointer_Endpoint_Descriptor->In_Descriptor.Status = 0; // Clear all previous settings
-	Pointer_Endpoint_Descriptor->In_Descriptor.Status_To_Peripheral.Is_Data_Toggle_Synchronized_Enabled = 1;
-	Pointer_Endpoint_Descriptor->In_Descriptor.Status_To_Peripheral.Data_Toggle_Synchronization = Is_Data_1_Synchronization;
-	Pointer_Endpoint_Descriptor->In_Descriptor.Status_To_Peripheral.Is_Owned_By_Peripheral = 1; // Give the endpoint IN buffer ownership to the USB peripheral
+	Pointer_Buffer_Descriptor->Status = 0; // Clear all previous settings
+	Pointer_Buffer_Descriptor->Status_To_Peripheral.Is_Data_Toggle_Synchronized_Enabled = 1;
+	Pointer_Buffer_Descriptor->Status_To_Peripheral.Data_Toggle_Synchronization = Is_Data_1_Synchronization;
+	Pointer_Buffer_Descriptor->Status_To_Peripheral.Is_Owned_By_Peripheral = 1; // Give the endpoint IN buffer ownership to the USB peripheral
+
+	// The SIE will use the other buffer for the next transaction
+	Pointer_Endpoint_Descriptor->In_Next_Ping_Pong_Index ^= 1;
+}
+
+void USBCoreGetStatistics(TUSBCoreStatistics *Pointer_Statistics, unsigned char Is_Reset_Requested)
+{
+	// Atomically access to the counters
+	USB_CORE_INTERRUPT_DISABLE();
+	memcpy(Pointer_Statistics, &USB_Core_Statistics, sizeof(USB_Core_Statistics));
+	if (Is_Reset_Requested) memset(&USB_Core_Statistics, 0, sizeof(USB_Core_Statistics));
+	USB_CORE_INTERRUPT_ENABLE();
+}
+
+const TUSBCoreStatistics *USBCoreGetLiveStatistics(void)
+{
+	return &USB_Core_Statistics;
+}
+
+void USBCoreCopyFromRAM(void *Pointer_Destination, void *Pointer_Source, unsigned char Bytes_Count)
+{
+#ifdef __XC8
+	unsigned short Saved_FSR0, Saved_FSR1;
+
+	// The compiler does not know that the inline assembly uses the FSR registers, so make sure that the interrupted code or the calling code finds them unchanged
+	Saved_FSR0 = FSR0;
+	Saved_FSR1 = FSR1;
+	FSR0 = (unsigned short) Pointer_Destination;
+	FSR1 = (unsigned short) Pointer_Source;
+
+	// Avoid any loop overhead for a full packet, which is the most frequent case
+	if (Bytes_Count == USB_CORE_ENDPOINT_PACKETS_SIZE)
+	{
+		USB_CORE_REPEAT_64_TIMES(USB_CORE_COPY_BYTE_FROM_RAM());
+	}
+	else
+	{
+		while (Bytes_Count > 0)
+		{
+			USB_CORE_COPY_BYTE_FROM_RAM();
+			Bytes_Count--;
+		}
+	}
+
+	FSR0 = Saved_FSR0;
+	FSR1 = Saved_FSR1;
+#else
+	// Allow the module to be built by a host compiler against simulated registers, there is no program memory to deal with in this case
+	memcpy(Pointer_Destination, Pointer_Source, Bytes_Count);
+#endif
+}
+
+void USBCoreCopyFromProgramMemory(void *Pointer_Destination, const void *Pointer_Source, unsigned char Bytes_Count)
+{
+#ifdef __XC8
+	unsigned short Saved_FSR0;
+	unsigned char Saved_TBLPTRU, Saved_TBLPTRH, Saved_TBLPTRL, Saved_TABLAT;
+	unsigned long Address;
+
+	// The compiler does not know that the inline assembly uses these registers, so make sure that the interrupted code or the calling code finds them unchanged
+	Saved_FSR0 = FSR0;
+	Saved_TBLPTRU = TBLPTRU;
+	Saved_TBLPTRH = TBLPTRH;
+	Saved_TBLPTRL = TBLPTRL;
+	Saved_TABLAT = TABLAT;
+	FSR0 = (unsigned short) Pointer_Destination;
+	Address = (unsigned long) Pointer_Source;
+	TBLPTRU = (unsigned char) (Address >> 16);
+	TBLPTRH = (unsigned char) (Address >> 8);
+	TBLPTRL = (unsigned char) Address;
+
+	// Avoid any loop overhead for a full packet, which is the most frequent case
+	if (Bytes_Count == USB_CORE_ENDPOINT_PACKETS_SIZE)
+	{
+		USB_CORE_REPEAT_64_TIMES(USB_CORE_COPY_BYTE_FROM_PROGRAM_MEMORY());
+	}
+	else
+	{
+		while (Bytes_Count > 0)
+		{
+			USB_CORE_COPY_BYTE_FROM_PROGRAM_MEMORY();
+			Bytes_Count--;
+		}
+	}
+
+	FSR0 = Saved_FSR0;
+	TBLPTRU = Saved_TBLPTRU;
+	TBLPTRH = Saved_TBLPTRH;
+	TBLPTRL = Saved_TBLPTRL;
+	TABLAT = Saved_TABLAT;
+#else
+	// Allow the module to be built by a host compiler against simulated registers, the constant data are located in the same address space than the other data in this case
+	memcpy(Pointer_Destination, Pointer_Source, Bytes_Count);
+#endif
+}
+
+unsigned long USBCoreGetMillisecondsCount(void)
+{
+	unsigned long Milliseconds_Count;
+
+	// Atomically read the multi-byte counter
+	USB_CORE_INTERRUPT_DISABLE();
+	Milliseconds_Count = USB_Core_Milliseconds_Count;
+	USB_CORE_INTERRUPT_ENABLE();
+
+	return Milliseconds_Count;
+}
+
+TUSBCoreDeviceState USBCoreGetDeviceState(void)
+{
+	return USB_Core_Device_State; // This is a single-byte variable, so it can be read without disabling the interrupts
 }
 
 void USBCoreInterruptHandler(void)
 {
-	static unsigned char Device_Address = 0; // Keep the assigned address to set it in a later interrupt
-	unsigned char Endpoint_ID, Is_In_Transfer;
-	volatile TUSBCoreEndpointBufferDescriptor *Pointer_Endpoint_Descriptor;
-	volatile unsigned char *Pointer_Endpoint_Buffer, *Pointer_Endpoint_Register;
-	volatile TUSBCoreDeviceRequest *Pointer_Device_Request;
-	TUSBCoreHardwareEndpointConfiguration *Pointer_Hardware_Endpoints_Configuration;
-	TUSBCorePacketIdentifierType Packet_Identifier_Type;
+	unsigned char Endpoint_ID, i;
+	TUSBCoreEndpointBufferDescriptor *Pointer_Endpoint_Descriptor;
+	volatile unsigned char *Pointer_Endpoint_Register;
 
 	// Clear the main USB interrupt flag at the beginning, because this flag needs to be cleared before the transfer complete one is cleared, otherwise a transfer stored in the USTAT FIFO might be lost.
 	// When TRNIF is cleared and there is a transfer in the FIFO, the USBIF flag is reasserted pretty soon. That's why the latter flag needs to be cleared first.
 	// There is no issue of USB interrupt handler re-entrancy because the interrupts are disabled until the handler returns
 	PIR3bits.USBIF = 0;
+	USB_Core_Statistics.Interrupts_Count++;
 
-	// Turn the activity LED on
-	USB_CORE_ACTIVITY_LED = 1;
-	// Re-arm the timer
-	TMR0H = 0;
-	TMR0L = 0;
-	T0CONbits.TMR0ON = 1;
+	// Provide the millisecond tick, this is the most frequent interrupt so handle it first and do not display anything about it
+	if (UIRbits.SOFIF)
+	{
+		USB_Core_Milliseconds_Count++;
+		if (Pointer_USB_Core_Device_Descriptor->Start_Of_Frame_Callback != NULL) Pointer_USB_Core_Device_Descriptor->Start_Of_Frame_Callback();
 
-	LOG(USB_CORE_IS_LOGGING_ENABLED, "\033[33m--- Entering USB handler ---\033[0m");
+		// Clear the interrupt flag
+		UIRbits.SOFIF = 0;
 
-	// Cache the involved endpoint information
-	Endpoint_ID = USTAT >> 3;
-	Is_In_Transfer = USTATbits.DIR; // Determine the transfer direction
-	Pointer_Endpoint_Descriptor = &USB_Core_Endpoint_Descriptors[Endpoint_ID]; // Cache the endpoint access
+		// Do not waste time when there is no other event to service
+		if ((UIR & UIE) == 0) return;
+	}
+
+	LOG(USB_CORE_IS_LOGGING_ENABLED, "\033[33m--- Entering USB handler ---\033[0m");
 
 	// Display low level debugging information
 	LOG_BEGIN_SECTION(USB_CORE_IS_LOGGING_ENABLED)
 	{
-		const char *Pointer_String_Packet_Identifier;
-
 		// Display the fired interrupts
 		printf("Status interrupts register : 0x%02X", UIR);
 		if (UIRbits.SOFIF) printf(" SOF");
@@ -374,50 +1147,59 @@ void USBCoreInterruptHandler(void)
 		if (UIRbits.URSTIF) printf(" RESET");
 		printf(".\r\n");
 
-		// Display any error that occurred
-		if (UEIR != 0)
-		{
-			printf("An error was detected, UEIR = 0x%02X.\r\n", UEIR);
-			UEIR = 0; // Clear all errors to see the next ones
-		}
-
 		// Tell if a SETUP packet disabled the SIE
 		if (UCONbits.PKTDIS) printf("USB packet processing is disabled (PKTDIS).\r\n");
+	}
+	LOG_END_SECTION()
 
-		// Display the last endpoint activity
-		printf("Last endpoint ID : %u, transaction type : %s.\r\n", Endpoint_ID, Is_In_Transfer ? "IN" : "OUT");
+	// Resume the device first, the USB module can't process any other event while it is suspended
+	if (UIEbits.ACTVIE && UIRbits.ACTVIF) USBCoreResume();
+	else if (UCONbits.SUSPND) return;
 
-		// Show the received packet (OUT) type
-		if (!Is_In_Transfer)
-		{
-			switch (Pointer_Endpoint_Descriptor->Out_Descriptor.Status_From_Peripheral.PID)
-			{
-				case USB_CORE_PACKET_IDENTIFIER_TYPE_TOKEN_OUT:
-					Pointer_String_Packet_Identifier = "token OUT";
-					break;
-				case USB_CORE_PACKET_IDENTIFIER_TYPE_HANDSHAKE_ACK:
-					Pointer_String_Packet_Identifier = "handshake ACK";
-					break;
-				case USB_CORE_PACKET_IDENTIFIER_TYPE_TOKEN_SETUP:
-					Pointer_String_Packet_Identifier = "token SETUP";
-					break;
-				default:
-					Pointer_String_Packet_Identifier = "\033[31munknown\033[0m";
-					break;
-			}
-			printf("Received Packet Identifier (PID) : %s.\r\n", Pointer_String_Packet_Identifier);
-		}
+	// The host stops sending Start-Of-Frame packets when it suspends the bus
+	if (UIEbits.IDLEIE && UIRbits.IDLEIF)
+	{
+		USBCoreSuspend();
+		return;
+	}
 
-		// Tell whether the endpoint is stalled by the host
-		Pointer_Endpoint_Register = &UEP0 + Endpoint_ID;
-		if (*Pointer_Endpoint_Register & 0x01) printf("The endpoint is stalled.\r\n");
+	// Count the bus errors, they are automatically recovered by the SIE and the host
+	if (UIRbits.UERRIF)
+	{
+		LOG(USB_CORE_IS_LOGGING_ENABLED, "An error was detected, UEIR = 0x%02X.", UEIR);
+		if (UEIRbits.PIDEF) USB_Core_Statistics.PID_Errors_Count++;
+		if (UEIRbits.CRC5EF) USB_Core_Statistics.CRC5_Errors_Count++;
+		if (UEIRbits.CRC16EF) USB_Core_Statistics.CRC16_Errors_Count++;
+		if (UEIRbits.DFN8EF) USB_Core_Statistics.Data_Field_Size_Errors_Count++;
+		if (UEIRbits.BTOEF) USB_Core_Statistics.Bus_Turnaround_Timeout_Errors_Count++;
+		if (UEIRbits.BTSEF) USB_Core_Statistics.Bit_Stuff_Errors_Count++;
+
+		// Clear all errors to see the next ones, then clear the interrupt flag
+		UEIR = 0;
+		UIRbits.UERRIF = 0;
 	}
-	LOG_END_SECTION()
 
 	// Discard every other event when the device has been reset
 	if (UIRbits.URSTIF)
 	{
 		LOG(USB_CORE_IS_LOGGING_ENABLED, "Detected a Reset condition, starting enumeration process.");
+		USB_Core_Statistics.Resets_Count++;
+		USB_Core_Device_State = USB_CORE_DEVICE_STATE_DEFAULT;
+
+		// The SIE will start from the even buffer of each endpoint again
+		UCONbits.PPBRST = 1;
+		UCONbits.PPBRST = 0;
+
+		// Flush the transactions that were completed before the reset, they would refer to the discarded buffer descriptors
+		for (i = 0; i < USB_CORE_USTAT_FIFO_SIZE; i++) UIRbits.TRNIF = 0;
+
+		// Abort any control transfer, then hand the endpoints back in the state they had at boot
+		USB_Core_Control_Transfer_Data_Stage.Is_In_Progress = 0;
+		USBCoreResetEndpoints();
+
+		// The class modules must forget the synchronization values and the packets of the previous session too
+		if (Pointer_USB_Core_Device_Descriptor->Reset_Callback != NULL) Pointer_USB_Core_Device_Descriptor->Reset_Callback();
+
 		UIRbits.URSTIF = 0; // Clear the interrupt flag
 		return;
 	}
@@ -425,164 +1207,53 @@ void USBCoreInterruptHandler(void)
 	// Re-enable a stalled endpoint upon reception of a stall handshake
 	if (UIRbits.STALLIF)
 	{
+		// Retrieve the stalled endpoint
+		Endpoint_ID = USTAT >> 3;
+		Pointer_Endpoint_Descriptor = &USB_Core_Endpoint_Descriptors[Endpoint_ID];
+
+		USB_Core_Statistics.Stalls_Count++;
+
 		// The endpoint stall indication needs to be cleared by software
-		LOG(USB_CORE_IS_LOGGING_ENABLED, "Received the %s endpoint %u stall handshake, clearing the endpoint stall condition.", Is_In_Transfer ? "IN" : "OUT", Endpoint_ID);
+		LOG(USB_CORE_IS_LOGGING_ENABLED, "Received the %s endpoint %u stall handshake, clearing the endpoint stall condition.", USTATbits.DIR ? "IN" : "OUT", Endpoint_ID);
 		Pointer_Endpoint_Register = &UEP0 + Endpoint_ID;
 		*Pointer_Endpoint_Register &= 0xFE;
 
-		// Return the IN buffer descriptor to the microcontroller, otherwise it stays owned by the SIE indefinitely
-		Pointer_Endpoint_Descriptor->In_Descriptor.Status = 0;
+		// Return the IN buffer descriptors to the microcontroller, otherwise they stay owned by the SIE indefinitely
+		Pointer_Endpoint_Descriptor->Pointer_In_Descriptors[0]->Status = 0;
+		Pointer_Endpoint_Descriptor->Pointer_In_Descriptors[1]->Status = 0;
 
 		// Clear the interrupt flag
 		UIRbits.STALLIF = 0;
 		return;
 	}
 
-	// Manage data transmission and reception
-	if (UIRbits.TRNIF)
+	// Manage data transmission and reception, service all transactions queued in the USTAT FIFO in a single pass to avoid paying the interrupt entry cost for each of them
+	for (i = 0; i < USB_CORE_USTAT_FIFO_SIZE; i++)
 	{
-		// Cache the endpoint data buffer access
-		if (Is_In_Transfer) Pointer_Endpoint_Buffer = Pointer_Endpoint_Descriptor->In_Descriptor.Pointer_Address;
-		else Pointer_Endpoint_Buffer = Pointer_Endpoint_Descriptor->Out_Descriptor.Pointer_Address;
+		if (!UIRbits.TRNIF) break;
 
-		// IN transfer
-		if (Is_In_Transfer)
+		// Turn the activity LED on only when data are transferred, the Start-Of-Frame packets would keep it always lit
+		if (i == 0)
 		{
-			LOG(USB_CORE_IS_LOGGING_ENABLED, "Sent a %u-byte packet from endpoint %u.", Pointer_Endpoint_Descriptor->In_Descriptor.Bytes_Count, Endpoint_ID);
-
-			// Assign the device address only when the ACK of the SET ADDRESS command has been transmitted on the default address 0
-			if (Device_Address != 0)
-			{
-				UADDR = Device_Address;
-				Device_Address = 0;
-			}
-			else
-			{
-				LOG(USB_CORE_IS_LOGGING_ENABLED, "An IN transfer is completed, calling the corresponding callback (if any).");
-				// Call the corresponding callback
-				Pointer_Hardware_Endpoints_Configuration = &Pointer_USB_Core_Device_Descriptor->Pointer_Hardware_Endpoints_Configuration[Endpoint_ID];
-				if (Pointer_Hardware_Endpoints_Configuration->In_Transfer_Callback != NULL) Pointer_Hardware_Endpoints_Configuration->In_Transfer_Callback(Endpoint_ID);
-			}
+			USB_CORE_ACTIVITY_LED = 1;
+			// Re-arm the timer
+			TMR0H = 0;
+			TMR0L = 0;
+			T0CONbits.TMR0ON = 1;
 		}
-		// OUT or SETUP transfer
-		else
-		{
-			// Display the received packet data
-			LOG_BEGIN_SECTION(USB_CORE_IS_LOGGING_ENABLED)
-			{
-				unsigned char i, Bytes_Count;
-
-				Bytes_Count = Pointer_Endpoint_Descriptor->Out_Descriptor.Bytes_Count;
-				LOG(USB_CORE_IS_LOGGING_ENABLED, "Received a %u-byte packet on endpoint %u : ", Bytes_Count, Endpoint_ID);
-				for (i = 0; i < Bytes_Count; i++) printf("0x%02X ", Pointer_Endpoint_Buffer[i]);
-				puts("\r");
-			}
-			LOG_END_SECTION()
-
-			// Handle the request according to its type
-			Packet_Identifier_Type = Pointer_Endpoint_Descriptor->Out_Descriptor.Status_From_Peripheral.PID;
 
-			// Host sending a normal OUT
-			if (Packet_Identifier_Type == USB_CORE_PACKET_IDENTIFIER_TYPE_TOKEN_OUT)
-			{
-				LOG(USB_CORE_IS_LOGGING_ENABLED, "Decoded as a normal OUT packet, calling the corresponding endpoint callback.");
-
-				// Call the corresponding callback
-				Pointer_Hardware_Endpoints_Configuration = &Pointer_USB_Core_Device_Descriptor->Pointer_Hardware_Endpoints_Configuration[Endpoint_ID];
-				Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback_Data.Data_Size = Pointer_Endpoint_Descriptor->Out_Descriptor.Bytes_Count;
-				Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback(&Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback_Data);
-			}
-			// Host acknowledging an IN transfer
-			else if (Packet_Identifier_Type == USB_CORE_PACKET_IDENTIFIER_TYPE_HANDSHAKE_ACK) LOG(USB_CORE_IS_LOGGING_ENABLED, "Received a handshake ACK from the host.");
-			// Host sending a SETUP request
-			else if (Packet_Identifier_Type == USB_CORE_PACKET_IDENTIFIER_TYPE_TOKEN_SETUP)
-			{
-				// Manage the standard setup requests
-				Pointer_Device_Request = (volatile TUSBCoreDeviceRequest *) Pointer_Endpoint_Buffer;
-				if ((Pointer_Device_Request->bmRequestType & USB_CORE_DEVICE_REQUEST_TYPE_MASK_TYPE) == USB_CORE_DEVICE_REQUEST_TYPE_VALUE_TYPE_STANDARD)
-				{
-					LOG(USB_CORE_IS_LOGGING_ENABLED, "Decoded as a standard setup device request.");
-
-					switch (Pointer_Device_Request->bRequest)
-					{
-						case USB_CORE_DEVICE_REQUEST_ID_SET_ADDRESS:
-							// Keep the address to set it after this SETUP request has been fully serviced on the current default address 0
-							Device_Address = (unsigned char) Pointer_Device_Request->wValue;
-							LOG(USB_CORE_IS_LOGGING_ENABLED, "Host is setting the device address to 0x%02X.", Device_Address);
-
-							// Send back an empty packet to acknowledge the address setting (still using the default address 0)
-							USBCorePrepareForInTransfer(0, NULL, 0, 1);
-							USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
-							break;
-
-						case USB_CORE_DEVICE_REQUEST_ID_GET_DESCRIPTOR:
-						{
-							TUSBCoreDescriptorType Descriptor_Type;
-							unsigned char Descriptor_Index;
-
-							// Retrieve the request parameters
-							Descriptor_Type = Pointer_Device_Request->wValue >> 8;
-							Descriptor_Index = (unsigned char) Pointer_Device_Request->wValue;
-							LOG(USB_CORE_IS_LOGGING_ENABLED, "Host is asking for %u bytes of the descriptor of type %u and index %u.", Pointer_Device_Request->wLength, Descriptor_Type, Descriptor_Index);
-
-							switch (Descriptor_Type)
-							{
-								case USB_CORE_DESCRIPTOR_TYPE_CONFIGURATION:
-									USBCoreProcessGetConfigurationDescriptor(Descriptor_Index, Pointer_Device_Request->wLength);
-									USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
-									break;
-
-								case USB_CORE_DESCRIPTOR_TYPE_STRING:
-									USBCoreProcessGetStringDescriptor(Descriptor_Index, (unsigned char) Pointer_Device_Request->wLength);
-									USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
-									break;
-
-								case USB_CORE_DESCRIPTOR_TYPE_DEVICE:
-									LOG(USB_CORE_IS_LOGGING_ENABLED, "Selecting the device descriptor.");
-									USBCorePrepareForInTransfer(0, (void *) Pointer_USB_Core_Device_Descriptor, USB_CORE_DESCRIPTOR_SIZE_DEVICE, 1);
-									USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
-									break;
-
-								case USB_CORE_DESCRIPTOR_TYPE_DEVICE_QUALIFIER:
-									LOG(USB_CORE_IS_LOGGING_ENABLED, "Tell the host that the device qualifier descriptor is not supported.");
-									// Stall the control endpoint to tell that the device does not support high speed (see USB2.0 spec chapter 9.2.7)
-									USBCoreStallEndpoint(0);
-									USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
-									break;
-
-								default:
-									LOG(USB_CORE_IS_LOGGING_ENABLED, "Unsupported descriptor type.");
-									break;
-							}
-							break;
-						}
-
-						case USB_CORE_DEVICE_REQUEST_ID_SET_CONFIGURATION:
-						{
-							LOG(USB_CORE_IS_LOGGING_ENABLED, "The host is setting the configuration with value %u (note that only the first configuration is supported for now).", (unsigned char) Pointer_Device_Request->wValue);
-							USBCorePrepareForInTransfer(0, NULL, 0, 1); // Send back an empty packet to acknowledge the configuration setting
-							USBCorePrepareForOutTransfer(0, 0); // Re-enable packets reception
-							break;
-						}
-					}
-				}
-				// This is a class or vendor request, forward it to the class handler
-				else
-				{
-					if ((Pointer_Device_Request->bmRequestType & USB_CORE_DEVICE_REQUEST_TYPE_MASK_TYPE) == USB_CORE_DEVICE_REQUEST_TYPE_VALUE_TYPE_CLASS) LOG(USB_CORE_IS_LOGGING_ENABLED, "Decoded as a class request (request : 0x%02X, value = 0x%04X, index = 0x%04X, length = 0x%04X), calling the corresponding callback.", Pointer_Device_Request->bRequest, Pointer_Device_Request->wValue, Pointer_Device_Request->wIndex, Pointer_Device_Request->wLength);
+		USBCoreProcessTransaction();
 
-					// Call the corresponding callback
-					Pointer_Hardware_Endpoints_Configuration = &Pointer_USB_Core_Device_Descriptor->Pointer_Hardware_Endpoints_Configuration[Endpoint_ID];
-					Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback_Data.Data_Size = Pointer_Endpoint_Descriptor->Out_Descriptor.Bytes_Count;
-					Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback(&Pointer_Hardware_Endpoints_Configuration->Out_Transfer_Callback_Data);
-				}
-
-				// When a setup transfer is received, the SIE disables packets processing, so re-enable it now
-				UCONbits.PKTDIS = 0;
-			}
-		}
-		// Clear the interrupt flag
+		// Clear the interrupt flag, this advances the USTAT FIFO
 		UIRbits.TRNIF = 0;
+
+		// The SIE needs up to 6 instruction cycles to set the flag again when another transaction is waiting in the FIFO (if it is missed, USBIF will simply fire again)
+		NOP();
+		NOP();
+		NOP();
+		NOP();
+		NOP();
+		NOP();
 	}
 }
 
@@ -0,0 +1,95 @@
+/** @file USB_Frames.c
+ * See USB_Frames.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Log.h>
+#include <USB_Frames.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** Set to 1 to enable the log messages, set to 0 to disable them. */
+#define USB_FRAMES_IS_LOGGING_ENABLED 0
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void USBFramesHandleDataReceptionCallback(TUSBFramesEndpoint *Pointer_Endpoint, TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data)
+{
+	LOG(USB_FRAMES_IS_LOGGING_ENABLED, "Received a %u-byte request on the endpoint %u.", Pointer_Transfer_Callback_Data->Data_Size, Pointer_Endpoint->Endpoint_ID);
+
+	// Do not give the buffer back to the SIE, so the host is NAKed until the request has been executed
+	Pointer_Endpoint->Pointer_Received_Packets[Pointer_Endpoint->Received_Packets_Writing_Index] = Pointer_Transfer_Callback_Data->Pointer_OUT_Data_Buffer;
+	Pointer_Endpoint->Received_Packets_Sizes[Pointer_Endpoint->Received_Packets_Writing_Index] = Pointer_Transfer_Callback_Data->Data_Size;
+	Pointer_Endpoint->Received_Packets_Writing_Index ^= 1; // The SIE alternately fills each ping-pong buffer
+	Pointer_Endpoint->Received_Packets_Count++;
+}
+
+void USBFramesHandleDataTransmissionFlowControlCallback(TUSBFramesEndpoint *Pointer_Endpoint)
+{
+	// A response committed right before a bus reset can still be read, while the reset has already cleared the pending packets count
+	if (Pointer_Endpoint->Data_In_Pending_Packets_Count > 0) Pointer_Endpoint->Data_In_Pending_Packets_Count--;
+}
+
+void USBFramesHandleResetCallback(TUSBFramesEndpoint *Pointer_Endpoint)
+{
+	// The USB core has taken back all buffer descriptors and given both OUT buffers to the SIE again, so forget the received requests and restart from DATA0
+	Pointer_Endpoint->Data_Out_Endpoint_Data_Synchronization = 0;
+	Pointer_Endpoint->Data_In_Endpoint_Data_Synchronization = 0;
+	Pointer_Endpoint->Received_Packets_Writing_Index = 0;
+	Pointer_Endpoint->Received_Packets_Reading_Index = 0;
+	Pointer_Endpoint->Received_Packets_Count = 0;
+	Pointer_Endpoint->Data_In_Pending_Packets_Count = 0;
+	Pointer_Endpoint->Is_Bus_Reset_Detected = 1;
+}
+
+void USBFramesInitialize(TUSBFramesEndpoint *Pointer_Endpoint, unsigned char Endpoint_ID, TUSBFramesExecutionCallback Execution_Callback)
+{
+	Pointer_Endpoint->Endpoint_ID = Endpoint_ID;
+	Pointer_Endpoint->Execution_Callback = Execution_Callback;
+}
+
+void USBFramesProcessReceivedPacket(TUSBFramesEndpoint *Pointer_Endpoint)
+{
+	unsigned char *Pointer_Response, Response_Size, Reading_Index;
+
+	// Detect a bus reset happening from now on
+	USB_CORE_INTERRUPT_DISABLE();
+	Pointer_Endpoint->Is_Bus_Reset_Detected = 0;
+	USB_CORE_INTERRUPT_ENABLE();
+
+	// Accessing the single-byte variables without the atomic access protections is safe because these are just reads
+	// Nothing to do
+	if (Pointer_Endpoint->Received_Packets_Count == 0) return;
+	// Do not block the caller until the host has read a previous response
+	if (Pointer_Endpoint->Data_In_Pending_Packets_Count >= USB_CORE_PING_PONG_BUFFERS_COUNT) return;
+
+	// Directly write the response to the USB RAM (an IN buffer is free, so this will not block)
+	Pointer_Response = USBCoreAcquireInBuffer(Pointer_Endpoint->Endpoint_ID);
+	Reading_Index = Pointer_Endpoint->Received_Packets_Reading_Index;
+	Response_Size = Pointer_Endpoint->Execution_Callback(Pointer_Endpoint->Pointer_Received_Packets[Reading_Index], Pointer_Endpoint->Received_Packets_Sizes[Reading_Index], Pointer_Response);
+	LOG(USB_FRAMES_IS_LOGGING_ENABLED, "Sending a %u-byte response.", Response_Size);
+
+	// Atomically access to the counters shared with the USB interrupt, the buffers are also given to the SIE with the USB interrupt disabled so a bus reset can't take them back meanwhile
+	USB_CORE_INTERRUPT_DISABLE();
+
+	// The bus has been reset while the request was executed, the buffers now belong to the new session so discard the response
+	if (Pointer_Endpoint->Is_Bus_Reset_Detected)
+	{
+		USB_CORE_INTERRUPT_ENABLE();
+		LOG(USB_FRAMES_IS_LOGGING_ENABLED, "The bus has been reset during the execution, discarding the response.");
+		return;
+	}
+	Pointer_Endpoint->Received_Packets_Reading_Index ^= 1;
+	Pointer_Endpoint->Received_Packets_Count--;
+	Pointer_Endpoint->Data_In_Pending_Packets_Count++;
+
+	// Send the response
+	USBCoreCommitInTransfer(Pointer_Endpoint->Endpoint_ID, Response_Size, Pointer_Endpoint->Data_In_Endpoint_Data_Synchronization);
+	Pointer_Endpoint->Data_In_Endpoint_Data_Synchronization ^= 1;
+
+	// Allow the host to send a new request, the buffers are given back to the SIE in the same order they have been received
+	USBCorePrepareForOutTransfer(Pointer_Endpoint->Endpoint_ID, Pointer_Endpoint->Data_Out_Endpoint_Data_Synchronization);
+	Pointer_Endpoint->Data_Out_Endpoint_Data_Synchronization ^= 1;
+	USB_CORE_INTERRUPT_ENABLE();
+}
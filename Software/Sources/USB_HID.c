@@ -0,0 +1,150 @@
+/** @file USB_HID.c
+ * See USB_HID.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Binary_Commands.h>
+#include <Log.h>
+#include <USB_Frames.h>
+#include <USB_HID.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** Set to 1 to enable the log messages, set to 0 to disable them. */
+#define USB_HID_IS_LOGGING_ENABLED 0
+
+/** The largest frame a report can hold, the first report byte is the frame size. */
+#define USB_HID_MAXIMUM_FRAME_SIZE (USB_HID_REPORT_SIZE - 1)
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** A vendor-defined usage page collection made of a 64-byte input report and a 64-byte output report, without report ID. See the HID specifications 1.11 chapter 6.2.2. */
+static const unsigned char USB_HID_Report_Descriptor[] = // Store this into the program memory to save some RAM
+{
+	0x06, 0x00, 0xFF, // Usage Page (Vendor Defined 0xFF00)
+	0x09, 0x01, // Usage (0x01)
+	0xA1, 0x01, // Collection (Application)
+	0x09, 0x02, // Usage (0x02)
+	0x15, 0x00, // Logical Minimum (0)
+	0x26, 0xFF, 0x00, // Logical Maximum (255)
+	0x75, 0x08, // Report Size (8 bits)
+	0x95, USB_HID_REPORT_SIZE, // Report Count
+	0x81, 0x02, // Input (Data, Variable, Absolute)
+	0x09, 0x03, // Usage (0x03)
+	0x91, 0x02, // Output (Data, Variable, Absolute)
+	0xC0 // End Collection
+};
+
+// The configuration descriptor tells the report descriptor size to the host
+USB_CORE_STATIC_ASSERT(sizeof(USB_HID_Report_Descriptor) == USB_HID_REPORT_DESCRIPTOR_SIZE, HID_Report_Descriptor_Size);
+
+/** Cache the number corresponding to the HID interface. */
+static unsigned char USB_HID_Interface_ID;
+/** The request and response flow of the HID interface endpoints. */
+static TUSBFramesEndpoint USB_HID_Frames_Endpoint;
+
+/** The idle rate set by the host, in 4ms units. */
+static unsigned char USB_HID_Idle_Rate = 0;
+/** The report returned by the Get Report request, it tells that the frame is empty. */
+static unsigned char USB_HID_Empty_Report = 0;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Execute the frame carried by a request report and build the response report.
+ * @param Pointer_Report The request report, its first byte is the frame size.
+ * @param Report_Size The request report size in bytes, as received.
+ * @param Pointer_Response On output, contain the response report.
+ * @return The response report size, which is always USB_HID_REPORT_SIZE.
+ */
+static unsigned char USBHIDExecuteReport(unsigned char *Pointer_Report, unsigned char Report_Size, unsigned char *Pointer_Response)
+{
+	unsigned char Request_Size, Response_Size, i;
+
+	// Do not execute a frame that would extend past the received report
+	Request_Size = *Pointer_Report;
+	if ((Request_Size > USB_HID_MAXIMUM_FRAME_SIZE) || (Request_Size >= Report_Size))
+	{
+		LOG(USB_HID_IS_LOGGING_ENABLED, "The %u-byte frame does not fit in the report.", Request_Size);
+		Pointer_Response[1] = BINARY_COMMANDS_STATUS_TRUNCATED_FRAME;
+		Response_Size = 1;
+	}
+	else Response_Size = BinaryCommandsExecuteFrame(Pointer_Report + 1, Request_Size, Pointer_Response + 1);
+	LOG(USB_HID_IS_LOGGING_ENABLED, "Sending a %u-byte response.", Response_Size);
+
+	// Build the fixed-size response report, clear the padding so no stale data from a previous transfer is sent
+	*Pointer_Response = Response_Size;
+	for (i = Response_Size + 1; i < USB_HID_REPORT_SIZE; i++) Pointer_Response[i] = 0;
+	return USB_HID_REPORT_SIZE;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void USBHIDHandleDataReceptionCallback(TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data)
+{
+	USBFramesHandleDataReceptionCallback(&USB_HID_Frames_Endpoint, Pointer_Transfer_Callback_Data);
+}
+
+void USBHIDHandleDataTransmissionFlowControlCallback(unsigned char __attribute__((unused)) Endpoint_ID)
+{
+	USBFramesHandleDataTransmissionFlowControlCallback(&USB_HID_Frames_Endpoint);
+}
+
+void USBHIDHandleResetCallback(void)
+{
+	USBFramesHandleResetCallback(&USB_HID_Frames_Endpoint);
+	USB_HID_Idle_Rate = 0;
+}
+
+unsigned char USBHIDHandleGetDescriptorCallback(TUSBCoreDeviceRequest *Pointer_Request, const void **Pointer_Pointer_Descriptor, unsigned short *Pointer_Descriptor_Size)
+{
+	// The HID descriptor is only provided as part of the configuration descriptor, the hosts do not request it separately
+	if (((Pointer_Request->wValue >> 8) != USB_HID_DESCRIPTOR_TYPE_REPORT) || (Pointer_Request->wIndex != USB_HID_Interface_ID)) return 1;
+	LOG(USB_HID_IS_LOGGING_ENABLED, "Sending the report descriptor.");
+
+	*Pointer_Pointer_Descriptor = USB_HID_Report_Descriptor;
+	*Pointer_Descriptor_Size = sizeof(USB_HID_Report_Descriptor);
+	return 0;
+}
+
+unsigned char USBHIDHandleControlRequestCallback(TUSBCoreDeviceRequest *Pointer_Request, void **Pointer_Pointer_Data, unsigned short *Pointer_Data_Size)
+{
+	// Let the CDC ACM interfaces serve their own requests
+	if (((Pointer_Request->bmRequestType & USB_CORE_DEVICE_REQUEST_TYPE_MASK_RECIPIENT) != USB_CORE_DEVICE_REQUEST_TYPE_VALUE_RECIPIENT_INTERFACE) || (Pointer_Request->wIndex != USB_HID_Interface_ID)) return 2;
+
+	switch ((TUSBHIDClassRequest) Pointer_Request->bRequest)
+	{
+		case USB_HID_CLASS_REQUEST_GET_REPORT:
+			LOG(USB_HID_IS_LOGGING_ENABLED, "Sending an empty report.");
+			*Pointer_Pointer_Data = &USB_HID_Empty_Report;
+			*Pointer_Data_Size = sizeof(USB_HID_Empty_Report);
+			return 0;
+
+		case USB_HID_CLASS_REQUEST_GET_IDLE:
+			*Pointer_Pointer_Data = &USB_HID_Idle_Rate;
+			*Pointer_Data_Size = sizeof(USB_HID_Idle_Rate);
+			return 0;
+
+		case USB_HID_CLASS_REQUEST_SET_IDLE:
+			USB_HID_Idle_Rate = (unsigned char) (Pointer_Request->wValue >> 8);
+			LOG(USB_HID_IS_LOGGING_ENABLED, "Setting the idle rate to %u.", USB_HID_Idle_Rate);
+			return 0;
+
+		default:
+			LOG(USB_HID_IS_LOGGING_ENABLED, "Unsupported class request 0x%02X.", Pointer_Request->bRequest);
+			return 1;
+	}
+}
+
+void USBHIDInitialize(unsigned char Interface_ID, unsigned char Endpoint_ID)
+{
+	USB_HID_Interface_ID = Interface_ID;
+	USBFramesInitialize(&USB_HID_Frames_Endpoint, Endpoint_ID, USBHIDExecuteReport);
+}
+
+void USBHIDProcessReceivedFrame(void)
+{
+	USBFramesProcessReceivedPacket(&USB_HID_Frames_Endpoint);
+}
@@ -0,0 +1,84 @@
+/** @file USB_Vendor.c
+ * See USB_Vendor.h for description.
+ * @author Adrien RICCIARDI
+ */
+#include <Binary_Commands.h>
+#include <Log.h>
+#include <USB_Frames.h>
+#include <USB_Vendor.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** Set to 1 to enable the log messages, set to 0 to disable them. */
+#define USB_VENDOR_IS_LOGGING_ENABLED 0
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The request and response flow of the vendor interface endpoints. */
+static TUSBFramesEndpoint USB_Vendor_Frames_Endpoint;
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void USBVendorHandleDataReceptionCallback(TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data)
+{
+	USBFramesHandleDataReceptionCallback(&USB_Vendor_Frames_Endpoint, Pointer_Transfer_Callback_Data);
+}
+
+void USBVendorHandleDataTransmissionFlowControlCallback(unsigned char __attribute__((unused)) Endpoint_ID)
+{
+	USBFramesHandleDataTransmissionFlowControlCallback(&USB_Vendor_Frames_Endpoint);
+}
+
+void USBVendorHandleResetCallback(void)
+{
+	USBFramesHandleResetCallback(&USB_Vendor_Frames_Endpoint);
+}
+
+unsigned char USBVendorHandleControlRequestCallback(TUSBCoreDeviceRequest *Pointer_Request, void **Pointer_Pointer_Data, unsigned short *Pointer_Data_Size)
+{
+	unsigned short Address = Pointer_Request->wIndex;
+
+	switch ((TUSBVendorControlRequest) Pointer_Request->bRequest)
+	{
+		case USB_VENDOR_CONTROL_REQUEST_READ_MEMORY:
+			// Do not read past the data memory end
+			if ((Address >= USB_VENDOR_DATA_MEMORY_SIZE) || (Pointer_Request->wLength > USB_VENDOR_DATA_MEMORY_SIZE - Address)) return 1;
+			LOG(USB_VENDOR_IS_LOGGING_ENABLED, "Reading %u bytes from the address 0x%03X.", Pointer_Request->wLength, Address);
+
+			// The data are directly streamed from their location
+			*Pointer_Pointer_Data = (void *) Address;
+			*Pointer_Data_Size = Pointer_Request->wLength;
+			return 0;
+
+		case USB_VENDOR_CONTROL_REQUEST_WRITE_MEMORY:
+			if (Address >= USB_VENDOR_DATA_MEMORY_SIZE) return 1;
+			LOG(USB_VENDOR_IS_LOGGING_ENABLED, "Writing 0x%02X to the address 0x%03X.", (unsigned char) Pointer_Request->wValue, Address);
+
+			*((volatile unsigned char *) Address) = (unsigned char) Pointer_Request->wValue;
+			return 0;
+
+		case USB_VENDOR_CONTROL_REQUEST_READ_USB_STATISTICS:
+			// The counters are sent from the USB interrupt context, so there is no need to take a snapshot of them
+			*Pointer_Pointer_Data = (void *) USBCoreGetLiveStatistics();
+			*Pointer_Data_Size = sizeof(TUSBCoreStatistics);
+			return 0;
+
+		default:
+			LOG(USB_VENDOR_IS_LOGGING_ENABLED, "Unknown vendor request 0x%02X.", Pointer_Request->bRequest);
+			return 1;
+	}
+}
+
+void USBVendorInitialize(unsigned char Endpoint_ID)
+{
+	// Each request frame fills a whole packet, so the packets are directly executed
+	USBFramesInitialize(&USB_Vendor_Frames_Endpoint, Endpoint_ID, BinaryCommandsExecuteFrame);
+}
+
+void USBVendorProcessReceivedFrame(void)
+{
+	USBFramesProcessReceivedPacket(&USB_Vendor_Frames_Endpoint);
+}
@@ -0,0 +1,82 @@
+/** @file Mock_SIE.h
+ * Simulate the PIC18F25K50 USB Serial Interface Engine on the host computer, so the USB stack can be driven by recorded host transactions without a board.
+ * The SIE works on the buffer descriptors table located at 0x400 by the firmware, and on the UCON, UIR, USTAT, UADDR and UEPn registers of the mock xc.h, like the real one does. Each completed transaction is immediately serviced by calling the firmware USB interrupt handler.
+ * Only the ping-pong mode used by the firmware is supported : a single buffer per direction for the endpoint 0, even and odd buffers for the other endpoints.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_MOCK_SIE_H
+#define H_MOCK_SIE_H
+
+//-------------------------------------------------------------------------------------------------
+// Types
+//-------------------------------------------------------------------------------------------------
+/** The handshake seen by the host at the end of a transaction. */
+typedef enum : unsigned char
+{
+	MOCK_SIE_HANDSHAKE_ACK, //!< The data have been accepted (OUT and SETUP) or sent (IN).
+	MOCK_SIE_HANDSHAKE_NAK, //!< The endpoint buffer is not owned by the SIE, the host needs to retry later.
+	MOCK_SIE_HANDSHAKE_STALL, //!< The endpoint has been stalled by the firmware.
+	MOCK_SIE_HANDSHAKE_NONE //!< The device did not answer, because it is not attached, the address does not match or the endpoint direction is disabled.
+} TMockSIEHandshake;
+
+/** Measure the work done by the firmware interrupt handler. */
+typedef struct
+{
+	unsigned long Interrupt_Handler_Calls_Count; //!< How many times the interrupt handler has been called.
+	unsigned long long Interrupt_Handler_Duration; //!< How many nanoseconds of host time the interrupt handler has spent.
+	unsigned long Busy_Buffer_Descriptors_Count; //!< How many transactions have been NAKed because the firmware had not given the buffer to the SIE.
+	unsigned long Discarded_Packets_Count; //!< How many OUT packets have been acknowledged but dropped because of a data toggle mismatch.
+} TMockSIEStatistics;
+
+//-------------------------------------------------------------------------------------------------
+// Functions
+//-------------------------------------------------------------------------------------------------
+/** Attach the simulated device to the host. The SIE does not answer until the firmware has set the USBEN bit. */
+void MockSIEInitialize(void);
+
+/** Signal a bus reset : the device address is cleared, the SIE restarts from the even buffer of each endpoint and the reset interrupt is serviced. */
+void MockSIEResetBus(void);
+
+/** Send a Start-Of-Frame packet and service its interrupt. */
+void MockSIESendStartOfFrame(void);
+
+/** Send a SETUP transaction to a control endpoint.
+ * @param Address The device address targeted by the host.
+ * @param Endpoint_ID The endpoint number.
+ * @param Pointer_Request The 8-byte request.
+ * @return The handshake seen by the host.
+ */
+TMockSIEHandshake MockSIESendSetup(unsigned char Address, unsigned char Endpoint_ID, const void *Pointer_Request);
+
+/** Send an OUT transaction.
+ * @param Address The device address targeted by the host.
+ * @param Endpoint_ID The endpoint number.
+ * @param Pointer_Data The packet data, can be NULL if Data_Size is 0.
+ * @param Data_Size The packet size in bytes.
+ * @param Is_Data_1_Synchronization Set to 1 to send a DATA1 packet, set to 0 to send a DATA0 packet.
+ * @return The handshake seen by the host.
+ */
+TMockSIEHandshake MockSIESendOut(unsigned char Address, unsigned char Endpoint_ID, const void *Pointer_Data, unsigned char Data_Size, unsigned char Is_Data_1_Synchronization);
+
+/** Send an IN transaction and acknowledge the received data.
+ * @param Address The device address targeted by the host.
+ * @param Endpoint_ID The endpoint number.
+ * @param Pointer_Data On output, contain the packet data. The buffer must be able to hold a full packet.
+ * @param Pointer_Data_Size On output, contain the packet size in bytes.
+ * @param Pointer_Is_Data_1_Synchronization On output, contain 1 for a DATA1 packet or 0 for a DATA0 packet.
+ * @return The handshake seen by the host, the output parameters are valid only for MOCK_SIE_HANDSHAKE_ACK.
+ */
+TMockSIEHandshake MockSIEReceiveIn(unsigned char Address, unsigned char Endpoint_ID, void *Pointer_Data, unsigned char *Pointer_Data_Size, unsigned char *Pointer_Is_Data_1_Synchronization);
+
+/** Retrieve the interrupt handler work measured since the SIE initialization or the previous reset of the statistics.
+ * @param Pointer_Statistics On output, contain the statistics.
+ * @param Is_Reset_Requested Set to 1 to clear all statistics after they have been retrieved, set to 0 to keep counting.
+ */
+void MockSIEGetStatistics(TMockSIEStatistics *Pointer_Statistics, unsigned char Is_Reset_Requested);
+
+/** Tell how many firmware misbehaviors the SIE has detected, like an interrupt flag left set when the interrupt handler returns. Each of them is also displayed when it is detected.
+ * @return The errors count.
+ */
+unsigned int MockSIEGetErrorsCount(void);
+
+#endif
@@ -0,0 +1,87 @@
+/** @file xc.h
+ * Replace the xc8 compiler header when the USB stack is built for the host computer : the PIC18F25K50 special function registers used by the USB stack become plain variables, which are driven by the simulated SIE (see Mock_SIE.h).
+ * Only the registers and the bits used by the USB stack are provided, they keep the datasheet layout, so the values written as a whole byte by the firmware keep their meaning.
+ * @author Adrien RICCIARDI
+ */
+#ifndef H_XC_H
+#define H_XC_H
+
+//-------------------------------------------------------------------------------------------------
+// Constants and macros
+//-------------------------------------------------------------------------------------------------
+/** Locate a variable at a fixed data memory address. The host can't do that, so the variable is put in a dedicated section named after its address instead, and the simulated SIE finds the buffer descriptors table through the __start_Mock_Data_Memory_0x400 symbol the linker defines for this section.
+ * @param Address The data memory address, it is expanded before being converted to a string by the MOCK_DATA_MEMORY_SECTION() macro.
+ */
+#define __at(Address) MOCK_DATA_MEMORY_SECTION(Address)
+/** Build the section name of __at(), do not use directly. The name is quoted for the assembler, because the computed addresses are expressions containing spaces and parentheses. */
+#define MOCK_DATA_MEMORY_SECTION(Address) __attribute__((section("\"Mock_Data_Memory_" #Address "\"")))
+
+/** The instructions that have no meaning on the host. */
+#define NOP() do {} while (0)
+#define SLEEP() do {} while (0)
+/** The busy-wait delays would only slow the host tests down. */
+#define __delay_ms(Milliseconds) do {} while (0)
+
+/** Declare a special function register that is accessed as a whole byte and through its bits.
+ * @param Name The register name.
+ * @param Bits The register bit fields, from bit 0 to bit 7.
+ */
+#define MOCK_REGISTER(Name, Bits) \
+	typedef union \
+	{ \
+		struct { Bits }; \
+		unsigned char Value; \
+	} T##Name##bits; \
+	extern volatile T##Name##bits Name##bits;
+
+// Make the whole byte access look like the xc8 one
+#define ACTCON Mock_ACTCON
+#define T0CON T0CONbits.Value
+#define T1CON T1CONbits.Value
+#define TMR0H Mock_TMR0H
+#define TMR0L Mock_TMR0L
+#define TMR1H Mock_TMR1H
+#define TMR1L Mock_TMR1L
+#define UADDR Mock_UADDR
+#define UCFG Mock_UCFG
+#define UCON UCONbits.Value
+#define UEIE Mock_UEIE
+#define UEIR UEIRbits.Value
+#define UIE UIEbits.Value
+#define UIR UIRbits.Value
+#define USTAT USTATbits.Value
+
+/** The endpoint control registers are contiguous, the firmware walks through them with a pointer. */
+#define UEP0 Mock_UEP[0]
+#define UEP1 Mock_UEP[1]
+#define UEP2 Mock_UEP[2]
+#define UEP3 Mock_UEP[3]
+#define UEP4 Mock_UEP[4]
+#define UEP5 Mock_UEP[5]
+#define UEP6 Mock_UEP[6]
+#define UEP7 Mock_UEP[7]
+
+//-------------------------------------------------------------------------------------------------
+// Variables
+//-------------------------------------------------------------------------------------------------
+// Registers without bit access
+extern volatile unsigned char Mock_ACTCON, Mock_TMR0H, Mock_TMR0L, Mock_TMR1H, Mock_TMR1L, Mock_UADDR, Mock_UCFG, Mock_UEIE, Mock_UEP[16];
+
+// Registers with bit access
+MOCK_REGISTER(INTCON, unsigned char RBIF : 1; unsigned char INT0IF : 1; unsigned char TMR0IF : 1; unsigned char IOCIE : 1; unsigned char INT0IE : 1; unsigned char TMR0IE : 1; unsigned char PEIE : 1; unsigned char GIE : 1;)
+MOCK_REGISTER(INTCON2, unsigned char RBIP : 1; unsigned char : 1; unsigned char TMR0IP : 1; unsigned char : 5;)
+MOCK_REGISTER(IPR3, unsigned char CCP2IP : 1; unsigned char CTMUIP : 1; unsigned char USBIP : 1; unsigned char TMR3GIP : 1; unsigned char TMR1GIP : 1; unsigned char : 3;)
+MOCK_REGISTER(LATC, unsigned char LATC0 : 1; unsigned char LATC1 : 1; unsigned char LATC2 : 1; unsigned char : 5;)
+MOCK_REGISTER(OSCCON2, unsigned char LFIOFS : 1; unsigned char MFIOFS : 1; unsigned char PRISD : 1; unsigned char SOSCGO : 1; unsigned char : 2; unsigned char SOSCRUN : 1; unsigned char PLLRDY : 1;)
+MOCK_REGISTER(PIE3, unsigned char CCP2IE : 1; unsigned char CTMUIE : 1; unsigned char USBIE : 1; unsigned char TMR3GIE : 1; unsigned char TMR1GIE : 1; unsigned char : 3;)
+MOCK_REGISTER(PIR3, unsigned char CCP2IF : 1; unsigned char CTMUIF : 1; unsigned char USBIF : 1; unsigned char TMR3GIF : 1; unsigned char TMR1GIF : 1; unsigned char : 3;)
+MOCK_REGISTER(T0CON, unsigned char T0PS : 3; unsigned char PSA : 1; unsigned char T0SE : 1; unsigned char T0CS : 1; unsigned char T08BIT : 1; unsigned char TMR0ON : 1;)
+MOCK_REGISTER(T1CON, unsigned char TMR1ON : 1; unsigned char RD16 : 1; unsigned char T1SYNC : 1; unsigned char SOSCEN : 1; unsigned char T1CKPS : 2; unsigned char TMR1CS : 2;)
+MOCK_REGISTER(TRISC, unsigned char TRISC0 : 1; unsigned char TRISC1 : 1; unsigned char TRISC2 : 1; unsigned char : 5;)
+MOCK_REGISTER(UCON, unsigned char : 1; unsigned char SUSPND : 1; unsigned char RESUME : 1; unsigned char USBEN : 1; unsigned char PKTDIS : 1; unsigned char SE0 : 1; unsigned char PPBRST : 1; unsigned char : 1;)
+MOCK_REGISTER(UEIR, unsigned char PIDEF : 1; unsigned char CRC5EF : 1; unsigned char CRC16EF : 1; unsigned char DFN8EF : 1; unsigned char BTOEF : 1; unsigned char : 2; unsigned char BTSEF : 1;)
+MOCK_REGISTER(UIE, unsigned char URSTIE : 1; unsigned char UERRIE : 1; unsigned char ACTVIE : 1; unsigned char TRNIE : 1; unsigned char IDLEIE : 1; unsigned char STALLIE : 1; unsigned char SOFIE : 1; unsigned char : 1;)
+MOCK_REGISTER(UIR, unsigned char URSTIF : 1; unsigned char UERRIF : 1; unsigned char ACTVIF : 1; unsigned char TRNIF : 1; unsigned char IDLEIF : 1; unsigned char STALLIF : 1; unsigned char SOFIF : 1; unsigned char : 1;)
+MOCK_REGISTER(USTAT, unsigned char : 1; unsigned char PPBI : 1; unsigned char DIR : 1; unsigned char ENDP : 4; unsigned char : 1;)
+
+#endif
@@ -0,0 +1,363 @@
+/** @file Mock_SIE.c
+ * See Mock_SIE.h.
+ * @author Adrien RICCIARDI
+ */
+#include <Mock_SIE.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <USB_Core.h>
+#include <xc.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants
+//-------------------------------------------------------------------------------------------------
+/** How many endpoints the SIE can address. */
+#define MOCK_SIE_ENDPOINTS_COUNT 16
+
+/** The buffer descriptor status bits written by the microcontroller. */
+#define MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_UOWN 0x80
+#define MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_DTS 0x40
+#define MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_DTSEN 0x08
+#define MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_BSTALL 0x04
+/** The buffer descriptor status byte count high bits. */
+#define MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_BYTES_COUNT_HIGH_MASK 0x03
+/** The buffer descriptor status packet ID field position, written by the SIE. */
+#define MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_PID_SHIFT 2
+
+/** The UEPn register bits. */
+#define MOCK_SIE_ENDPOINT_REGISTER_EPINEN 0x02
+#define MOCK_SIE_ENDPOINT_REGISTER_EPOUTEN 0x04
+#define MOCK_SIE_ENDPOINT_REGISTER_EPCONDIS 0x08
+#define MOCK_SIE_ENDPOINT_REGISTER_EPHSHK 0x10
+
+/** The UCFG ping-pong mode enabling the even and odd buffers on all endpoints except the endpoint 0, which is the only mode used by the firmware. */
+#define MOCK_SIE_PING_PONG_MODE_ALL_BUT_ENDPOINT_0 0x03
+
+/** The UIR register bits, UIE uses the same layout. */
+#define MOCK_SIE_INTERRUPT_URSTIF 0x01
+#define MOCK_SIE_INTERRUPT_TRNIF 0x08
+#define MOCK_SIE_INTERRUPT_STALLIF 0x20
+#define MOCK_SIE_INTERRUPT_SOFIF 0x40
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** The packet IDs written by the SIE to the buffer descriptors status (see USB 2.0 specifications table 8-1). */
+typedef enum : unsigned char
+{
+	MOCK_SIE_PACKET_IDENTIFIER_OUT = 0x01,
+	MOCK_SIE_PACKET_IDENTIFIER_IN = 0x09,
+	MOCK_SIE_PACKET_IDENTIFIER_SETUP = 0x0D
+} TMockSIEPacketIdentifier;
+
+/** The SIE view of a buffer descriptor, it must match the firmware one byte per byte. */
+typedef struct
+{
+	unsigned char Status;
+	unsigned char Bytes_Count;
+	volatile unsigned char *Pointer_Address;
+} __attribute__((packed)) TMockSIEBufferDescriptor;
+
+//-------------------------------------------------------------------------------------------------
+// Variables
+//-------------------------------------------------------------------------------------------------
+// The special function registers declared by the mock xc.h
+volatile unsigned char Mock_ACTCON, Mock_TMR0H, Mock_TMR0L, Mock_TMR1H, Mock_TMR1L, Mock_UADDR, Mock_UCFG, Mock_UEIE, Mock_UEP[16];
+volatile TINTCONbits INTCONbits;
+volatile TINTCON2bits INTCON2bits;
+volatile TIPR3bits IPR3bits;
+volatile TLATCbits LATCbits;
+volatile TOSCCON2bits OSCCON2bits;
+volatile TPIE3bits PIE3bits;
+volatile TPIR3bits PIR3bits;
+volatile TT0CONbits T0CONbits;
+volatile TT1CONbits T1CONbits;
+volatile TTRISCbits TRISCbits;
+volatile TUCONbits UCONbits;
+volatile TUEIRbits UEIRbits;
+volatile TUIEbits UIEbits;
+volatile TUIRbits UIRbits;
+volatile TUSTATbits USTATbits;
+
+/** The linker provides the bounds of the section holding the firmware buffer descriptors table (see the __at() macro of the mock xc.h). */
+extern volatile TMockSIEBufferDescriptor __start_Mock_Data_Memory_0x400[], __stop_Mock_Data_Memory_0x400[];
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The buffer descriptor the SIE uses for the next transaction of each endpoint direction, indexed by the endpoint number and by the direction (0 for OUT, 1 for IN). */
+static unsigned char Mock_SIE_Ping_Pong_Indexes[MOCK_SIE_ENDPOINTS_COUNT][2];
+
+/** The interrupt handler work. */
+static TMockSIEStatistics Mock_SIE_Statistics;
+
+/** Count the detected firmware misbehaviors. */
+static unsigned int Mock_SIE_Errors_Count = 0;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Display a firmware misbehavior and count it.
+ * @param Pointer_String_Format A printf() like format string.
+ */
+static void MockSIEReportError(const char *Pointer_String_Format, ...)
+{
+	va_list Arguments_List;
+
+	printf("\033[31mSIE error : ");
+	va_start(Arguments_List, Pointer_String_Format);
+	vprintf(Pointer_String_Format, Arguments_List);
+	va_end(Arguments_List);
+	printf("\033[0m\n");
+	Mock_SIE_Errors_Count++;
+}
+
+/** Raise an interrupt flag, call the firmware interrupt handler like the microcontroller would do, then make sure that the handler has serviced the flag.
+ * @param Interrupt_Flag_Mask The UIR flag to raise.
+ */
+static void MockSIEServiceInterrupt(unsigned char Interrupt_Flag_Mask)
+{
+	struct timespec Start_Time, End_Time;
+
+	UIR |= Interrupt_Flag_Mask;
+	if ((UIR & UIE) == 0)
+	{
+		MockSIEReportError("the interrupt flag 0x%02X is not enabled (UIE = 0x%02X).", Interrupt_Flag_Mask, UIE);
+		return;
+	}
+	PIR3bits.USBIF = 1;
+
+	// The firmware calls the interrupt handler from the high-priority interrupt entry point
+	if (!PIE3bits.USBIE)
+	{
+		MockSIEReportError("the USB interrupt is disabled.");
+		return;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &Start_Time);
+	USBCoreInterruptHandler();
+	clock_gettime(CLOCK_MONOTONIC, &End_Time);
+	Mock_SIE_Statistics.Interrupt_Handler_Calls_Count++;
+	Mock_SIE_Statistics.Interrupt_Handler_Duration += ((End_Time.tv_sec - Start_Time.tv_sec) * 1000000000ULL) + End_Time.tv_nsec - Start_Time.tv_nsec;
+
+	// Each event must be serviced by a single interrupt, the USTAT FIFO always holds a single transaction here
+	if (UIR & Interrupt_Flag_Mask) MockSIEReportError("the interrupt flag 0x%02X has not been cleared by the interrupt handler.", Interrupt_Flag_Mask);
+	if (PIR3bits.USBIF) MockSIEReportError("the USBIF flag has not been cleared by the interrupt handler.");
+}
+
+/** Tell whether the device answers to a transaction.
+ * @param Address The device address targeted by the host.
+ * @param Endpoint_ID The endpoint number.
+ * @param Endpoint_Register_Mask The UEPn bits that must be set.
+ * @return 1 if the transaction must be processed, 0 if the device must stay silent.
+ */
+static unsigned char MockSIEIsTransactionForDevice(unsigned char Address, unsigned char Endpoint_ID, unsigned char Endpoint_Register_Mask)
+{
+	if (!UCONbits.USBEN || UCONbits.SUSPND) return 0;
+	if (Address != UADDR) return 0;
+	if (Endpoint_ID >= MOCK_SIE_ENDPOINTS_COUNT) return 0;
+	if ((Mock_UEP[Endpoint_ID] & Endpoint_Register_Mask) != Endpoint_Register_Mask) return 0;
+	return 1;
+}
+
+/** Find the buffer descriptor that the SIE uses for the next transaction of an endpoint direction.
+ * @param Endpoint_ID The endpoint number.
+ * @param Is_In_Transfer Set to 1 for the IN direction, set to 0 for the OUT direction.
+ * @return The buffer descriptor, or NULL if it is located outside of the table reserved by the firmware.
+ */
+static volatile TMockSIEBufferDescriptor *MockSIEGetBufferDescriptor(unsigned char Endpoint_ID, unsigned char Is_In_Transfer)
+{
+	unsigned int Index, Buffer_Descriptors_Count;
+
+	if ((UCFG & MOCK_SIE_PING_PONG_MODE_ALL_BUT_ENDPOINT_0) != MOCK_SIE_PING_PONG_MODE_ALL_BUT_ENDPOINT_0)
+	{
+		MockSIEReportError("only the ping-pong mode enabled for all endpoints except the endpoint 0 is simulated (UCFG = 0x%02X).", UCFG);
+		return NULL;
+	}
+
+	// The SIE stores the endpoint 0 OUT and IN descriptors first, then the OUT even, OUT odd, IN even, IN odd descriptors of each following endpoint
+	if (Endpoint_ID == 0) Index = Is_In_Transfer;
+	else Index = 2 + ((Endpoint_ID - 1) * 2 * USB_CORE_PING_PONG_BUFFERS_COUNT) + (Is_In_Transfer * USB_CORE_PING_PONG_BUFFERS_COUNT) + Mock_SIE_Ping_Pong_Indexes[Endpoint_ID][Is_In_Transfer];
+
+	// The SIE would read the application variables located after a too small table
+	Buffer_Descriptors_Count = __stop_Mock_Data_Memory_0x400 - __start_Mock_Data_Memory_0x400;
+	if (Index >= Buffer_Descriptors_Count)
+	{
+		MockSIEReportError("the endpoint %u buffer descriptor %u is located after the end of the %u-entry table.", Endpoint_ID, Index, Buffer_Descriptors_Count);
+		return NULL;
+	}
+	return &__start_Mock_Data_Memory_0x400[Index];
+}
+
+/** Report a completed transaction through the USTAT register and service it.
+ * @param Endpoint_ID The endpoint number.
+ * @param Is_In_Transfer Set to 1 for the IN direction, set to 0 for the OUT direction.
+ */
+static void MockSIECompleteTransaction(unsigned char Endpoint_ID, unsigned char Is_In_Transfer)
+{
+	unsigned char Ping_Pong_Index;
+
+	// The endpoint 0 always uses the even buffer descriptor
+	Ping_Pong_Index = Mock_SIE_Ping_Pong_Indexes[Endpoint_ID][Is_In_Transfer];
+	if (Endpoint_ID != 0) Mock_SIE_Ping_Pong_Indexes[Endpoint_ID][Is_In_Transfer] ^= 1;
+
+	USTATbits.ENDP = Endpoint_ID;
+	USTATbits.DIR = Is_In_Transfer;
+	USTATbits.PPBI = Ping_Pong_Index;
+	MockSIEServiceInterrupt(MOCK_SIE_INTERRUPT_TRNIF);
+}
+
+/** Answer with a STALL handshake and service the corresponding interrupt.
+ * @param Endpoint_ID The endpoint number.
+ * @param Is_In_Transfer Set to 1 for the IN direction, set to 0 for the OUT direction.
+ * @return Always MOCK_SIE_HANDSHAKE_STALL.
+ */
+static TMockSIEHandshake MockSIEStallTransaction(unsigned char Endpoint_ID, unsigned char Is_In_Transfer)
+{
+	// The buffer descriptor stays owned by the SIE, the firmware takes it back when servicing the interrupt
+	USTATbits.ENDP = Endpoint_ID;
+	USTATbits.DIR = Is_In_Transfer;
+	MockSIEServiceInterrupt(MOCK_SIE_INTERRUPT_STALLIF);
+	return MOCK_SIE_HANDSHAKE_STALL;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+void MockSIEInitialize(void)
+{
+	// The PLL is always locked on the host, so resuming the bus does not block
+	OSCCON2bits.PLLRDY = 1;
+	memset(Mock_SIE_Ping_Pong_Indexes, 0, sizeof(Mock_SIE_Ping_Pong_Indexes));
+	memset(&Mock_SIE_Statistics, 0, sizeof(Mock_SIE_Statistics));
+}
+
+void MockSIEResetBus(void)
+{
+	if (!UCONbits.USBEN) return;
+
+	// The firmware pulses PPBRST when servicing the reset, a plain variable can't tell the SIE about it so restart from the even buffers right now
+	UADDR = 0;
+	memset(Mock_SIE_Ping_Pong_Indexes, 0, sizeof(Mock_SIE_Ping_Pong_Indexes));
+	MockSIEServiceInterrupt(MOCK_SIE_INTERRUPT_URSTIF);
+}
+
+void MockSIESendStartOfFrame(void)
+{
+	if (!UCONbits.USBEN || UCONbits.SUSPND) return;
+	MockSIEServiceInterrupt(MOCK_SIE_INTERRUPT_SOFIF);
+}
+
+TMockSIEHandshake MockSIESendSetup(unsigned char Address, unsigned char Endpoint_ID, const void *Pointer_Request)
+{
+	volatile TMockSIEBufferDescriptor *Pointer_Buffer_Descriptor;
+
+	// Only the control endpoints accept the SETUP transactions
+	if (!MockSIEIsTransactionForDevice(Address, Endpoint_ID, MOCK_SIE_ENDPOINT_REGISTER_EPOUTEN | MOCK_SIE_ENDPOINT_REGISTER_EPHSHK) || (Mock_UEP[Endpoint_ID] & MOCK_SIE_ENDPOINT_REGISTER_EPCONDIS)) return MOCK_SIE_HANDSHAKE_NONE;
+	Pointer_Buffer_Descriptor = MockSIEGetBufferDescriptor(Endpoint_ID, 0);
+	if (Pointer_Buffer_Descriptor == NULL) return MOCK_SIE_HANDSHAKE_NONE;
+
+	// A SETUP can't be refused according to the USB specifications, so the firmware must always keep the control endpoint OUT buffer armed
+	if (!(Pointer_Buffer_Descriptor->Status & MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_UOWN))
+	{
+		MockSIEReportError("the endpoint %u OUT buffer is not owned by the SIE when a SETUP is received.", Endpoint_ID);
+		Mock_SIE_Statistics.Busy_Buffer_Descriptors_Count++;
+		return MOCK_SIE_HANDSHAKE_NAK;
+	}
+
+	// The data synchronization and the stall condition are ignored for a SETUP
+	memcpy((void *) Pointer_Buffer_Descriptor->Pointer_Address, Pointer_Request, sizeof(TUSBCoreDeviceRequest));
+	Pointer_Buffer_Descriptor->Bytes_Count = sizeof(TUSBCoreDeviceRequest);
+	Pointer_Buffer_Descriptor->Status = MOCK_SIE_PACKET_IDENTIFIER_SETUP << MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_PID_SHIFT;
+
+	// Let the firmware decode the request before any other packet is processed
+	UCONbits.PKTDIS = 1;
+	MockSIECompleteTransaction(Endpoint_ID, 0);
+	return MOCK_SIE_HANDSHAKE_ACK;
+}
+
+TMockSIEHandshake MockSIESendOut(unsigned char Address, unsigned char Endpoint_ID, const void *Pointer_Data, unsigned char Data_Size, unsigned char Is_Data_1_Synchronization)
+{
+	volatile TMockSIEBufferDescriptor *Pointer_Buffer_Descriptor;
+	unsigned short Buffer_Size;
+	unsigned char Status;
+
+	if (!MockSIEIsTransactionForDevice(Address, Endpoint_ID, MOCK_SIE_ENDPOINT_REGISTER_EPOUTEN | MOCK_SIE_ENDPOINT_REGISTER_EPHSHK)) return MOCK_SIE_HANDSHAKE_NONE;
+	if (UCONbits.PKTDIS) return MOCK_SIE_HANDSHAKE_NAK;
+	Pointer_Buffer_Descriptor = MockSIEGetBufferDescriptor(Endpoint_ID, 0);
+	if (Pointer_Buffer_Descriptor == NULL) return MOCK_SIE_HANDSHAKE_NONE;
+
+	Status = Pointer_Buffer_Descriptor->Status;
+	if (!(Status & MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_UOWN))
+	{
+		Mock_SIE_Statistics.Busy_Buffer_Descriptors_Count++;
+		return MOCK_SIE_HANDSHAKE_NAK;
+	}
+	if (Status & MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_BSTALL) return MockSIEStallTransaction(Endpoint_ID, 0);
+
+	// A packet with the wrong synchronization value is a retry of an already received packet, it is acknowledged but the buffer descriptor is not updated
+	if ((Status & MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_DTSEN) && (((Status & MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_DTS) != 0) != (Is_Data_1_Synchronization != 0)))
+	{
+		Mock_SIE_Statistics.Discarded_Packets_Count++;
+		return MOCK_SIE_HANDSHAKE_ACK;
+	}
+
+	Buffer_Size = ((Status & MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_BYTES_COUNT_HIGH_MASK) << 8) | Pointer_Buffer_Descriptor->Bytes_Count;
+	if (Data_Size > Buffer_Size)
+	{
+		MockSIEReportError("the endpoint %u OUT buffer can hold %u bytes only, while the host sends %u bytes.", Endpoint_ID, Buffer_Size, Data_Size);
+		return MOCK_SIE_HANDSHAKE_NONE;
+	}
+	if (Data_Size > 0) memcpy((void *) Pointer_Buffer_Descriptor->Pointer_Address, Pointer_Data, Data_Size);
+	Pointer_Buffer_Descriptor->Bytes_Count = Data_Size;
+	Pointer_Buffer_Descriptor->Status = (MOCK_SIE_PACKET_IDENTIFIER_OUT << MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_PID_SHIFT) | (Status & MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_DTS);
+
+	MockSIECompleteTransaction(Endpoint_ID, 0);
+	return MOCK_SIE_HANDSHAKE_ACK;
+}
+
+TMockSIEHandshake MockSIEReceiveIn(unsigned char Address, unsigned char Endpoint_ID, void *Pointer_Data, unsigned char *Pointer_Data_Size, unsigned char *Pointer_Is_Data_1_Synchronization)
+{
+	volatile TMockSIEBufferDescriptor *Pointer_Buffer_Descriptor;
+	unsigned short Data_Size;
+	unsigned char Status;
+
+	if (!MockSIEIsTransactionForDevice(Address, Endpoint_ID, MOCK_SIE_ENDPOINT_REGISTER_EPINEN | MOCK_SIE_ENDPOINT_REGISTER_EPHSHK)) return MOCK_SIE_HANDSHAKE_NONE;
+	if (UCONbits.PKTDIS) return MOCK_SIE_HANDSHAKE_NAK;
+	Pointer_Buffer_Descriptor = MockSIEGetBufferDescriptor(Endpoint_ID, 1);
+	if (Pointer_Buffer_Descriptor == NULL) return MOCK_SIE_HANDSHAKE_NONE;
+
+	Status = Pointer_Buffer_Descriptor->Status;
+	if (!(Status & MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_UOWN))
+	{
+		Mock_SIE_Statistics.Busy_Buffer_Descriptors_Count++;
+		return MOCK_SIE_HANDSHAKE_NAK;
+	}
+	if (Status & MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_BSTALL) return MockSIEStallTransaction(Endpoint_ID, 1);
+
+	Data_Size = ((Status & MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_BYTES_COUNT_HIGH_MASK) << 8) | Pointer_Buffer_Descriptor->Bytes_Count;
+	if (Data_Size > USB_CORE_ENDPOINT_PACKETS_SIZE)
+	{
+		MockSIEReportError("the endpoint %u IN buffer holds %u bytes, which is more than the maximum packet size.", Endpoint_ID, Data_Size);
+		return MOCK_SIE_HANDSHAKE_NONE;
+	}
+	if (Data_Size > 0) memcpy(Pointer_Data, (void *) Pointer_Buffer_Descriptor->Pointer_Address, Data_Size);
+	*Pointer_Data_Size = (unsigned char) Data_Size;
+	*Pointer_Is_Data_1_Synchronization = (Status & MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_DTS) != 0;
+	Pointer_Buffer_Descriptor->Status = (MOCK_SIE_PACKET_IDENTIFIER_IN << MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_PID_SHIFT) | (Status & MOCK_SIE_BUFFER_DESCRIPTOR_STATUS_DTS);
+
+	MockSIECompleteTransaction(Endpoint_ID, 1);
+	return MOCK_SIE_HANDSHAKE_ACK;
+}
+
+void MockSIEGetStatistics(TMockSIEStatistics *Pointer_Statistics, unsigned char Is_Reset_Requested)
+{
+	memcpy(Pointer_Statistics, &Mock_SIE_Statistics, sizeof(Mock_SIE_Statistics));
+	if (Is_Reset_Requested) memset(&Mock_SIE_Statistics, 0, sizeof(Mock_SIE_Statistics));
+}
+
+unsigned int MockSIEGetErrorsCount(void)
+{
+	return Mock_SIE_Errors_Count;
+}
@@ -0,0 +1,210 @@
+/** @file Test_Shell_Find_Command.c
+ * Compare the binary search of ShellFindCommand() with the linear walk the shell used before, which called strlen() and strncmp() on each table entry until the command was found.
+ * The program is built once per table size by setting SHELL_COMMANDS_COUNT to 8, 16, 32 or 64 on the command line (see the Makefile "test" target), because the firmware sizes the commands table at compilation time.
+ * @author Adrien RICCIARDI
+ */
+#include <Shell.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <USB_Vendor.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants and macros
+//-------------------------------------------------------------------------------------------------
+/** How many times the whole table is looked up by each method. */
+#define TEST_SHELL_FIND_COMMAND_ITERATIONS_COUNT 100000
+
+/** Arguments appended to each looked up command, so the token is not zero-terminated, like on a real command line. */
+#define TEST_SHELL_FIND_COMMAND_STRING_ARGUMENTS " h50 h00"
+
+/** The longest command line built by the test. */
+#define TEST_SHELL_FIND_COMMAND_MAXIMUM_LINE_LENGTH 64
+
+/** Fill a table entry, only the name matters for the lookup.
+ * @param String_Command The command name, it must be a string literal.
+ */
+#define TEST_SHELL_FIND_COMMAND_ENTRY(String_Command) { SHELL_COMMANDS_NAME(String_Command) }
+
+#if (SHELL_COMMANDS_COUNT != 8) && (SHELL_COMMANDS_COUNT != 16) && (SHELL_COMMANDS_COUNT != 32) && (SHELL_COMMANDS_COUNT != 64)
+	#error "SHELL_COMMANDS_COUNT must be set to 8, 16, 32 or 64 when building this test."
+#endif
+
+//-------------------------------------------------------------------------------------------------
+// Public variables
+//-------------------------------------------------------------------------------------------------
+// Plausible command names sorted by ascending strcmp() order, each bigger table adds names after the previous ones so every table stays sorted
+const TShellCommand Shell_Commands[SHELL_COMMANDS_COUNT] =
+{
+	TEST_SHELL_FIND_COMMAND_ENTRY("adc-read"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("adc-sample"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("boot-time"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("can-configure"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("can-send"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("clock-output"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("eeprom-dump"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("eeprom-erase"),
+#if SHELL_COMMANDS_COUNT >= 16
+	TEST_SHELL_FIND_COMMAND_ENTRY("eeprom-read"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("eeprom-write"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("gpio-configure"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("gpio-read"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("gpio-toggle"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("gpio-write"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("help"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("i2c"),
+#endif
+#if SHELL_COMMANDS_COUNT >= 32
+	TEST_SHELL_FIND_COMMAND_ENTRY("i2c-configure"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("i2c-monitor"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("i2c-scan"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("i2c-slave"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("jtag-scan"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("led"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("logic-capture"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("macro-delete"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("macro-list"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("macro-record"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("macro-run"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("onewire"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("onewire-scan"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("pinout"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("power"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("power-configure"),
+#endif
+#if SHELL_COMMANDS_COUNT >= 64
+	TEST_SHELL_FIND_COMMAND_ENTRY("pwm"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("pwm-configure"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("pwm-stop"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("reset"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("rtc-read"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("rtc-write"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("sequence"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("sequence-run"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("shell-mode"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("spi"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("spi-configure"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("spi-flash-erase"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("spi-flash-id"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("spi-flash-read"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("spi-flash-write"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("spi-monitor"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("swd-read"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("swd-write"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("trigger"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("trigger-configure"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("uart"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("uart-bridge"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("uart-configure"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("uart-monitor"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("usb-reset"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("usb-stats"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("version"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("voltage"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("voltage-select"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("wait"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("watch"),
+	TEST_SHELL_FIND_COMMAND_ENTRY("wiegand")
+#endif
+};
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** Tokens that are not commands : before the first name, a prefix, a name with an extra character, between two names and after the last name. */
+static const char *Pointer_Test_Shell_Find_Command_Unknown_Strings[] = { "a", "adc", "adc-reads", "bus", "zz" };
+
+/** The command lines looked up by the benchmark, one per table entry. */
+static char Test_Shell_Find_Command_Lines[SHELL_COMMANDS_COUNT][TEST_SHELL_FIND_COMMAND_MAXIMUM_LINE_LENGTH];
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+/** Find a command like the shell did before the table was sorted, by comparing the token with each name in turn.
+ * @param Pointer_String_Command The token to look for, it does not need to be zero-terminated.
+ * @param Length The token length.
+ * @return NULL if the command was not found,
+ * @return The command description if it was found.
+ */
+static const TShellCommand *TestShellFindCommandLinearly(char *Pointer_String_Command, unsigned char Length)
+{
+	unsigned char i;
+
+	// ShellCompareTokenWithString() computes the name length with strlen() before comparing the strings with strncmp()
+	for (i = 0; i < SHELL_COMMANDS_COUNT; i++)
+	{
+		if (ShellCompareTokenWithString(Pointer_String_Command, (char *) Shell_Commands[i].Pointer_String_Command, Length) == 0) return &Shell_Commands[i];
+	}
+	return NULL;
+}
+
+/** Look every command of the table up many times and measure the average lookup duration.
+ * @param Find_Command_Function The lookup method to measure.
+ * @return The average duration of a lookup, in nanoseconds.
+ */
+static double TestShellFindCommandMeasure(const TShellCommand *(*Find_Command_Function)(char *, unsigned char))
+{
+	struct timespec Start_Time, End_Time;
+	unsigned long Iteration;
+	unsigned char i;
+	const TShellCommand * volatile Pointer_Command; // Keep the compiler from discarding the lookups
+
+	clock_gettime(CLOCK_MONOTONIC, &Start_Time);
+	for (Iteration = 0; Iteration < TEST_SHELL_FIND_COMMAND_ITERATIONS_COUNT; Iteration++)
+	{
+		for (i = 0; i < SHELL_COMMANDS_COUNT; i++) Pointer_Command = Find_Command_Function(Test_Shell_Find_Command_Lines[i], Shell_Commands[i].Command_Length);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &End_Time);
+	(void) Pointer_Command;
+
+	return (((End_Time.tv_sec - Start_Time.tv_sec) * 1000000000.0) + End_Time.tv_nsec - Start_Time.tv_nsec) / ((double) TEST_SHELL_FIND_COMMAND_ITERATIONS_COUNT * SHELL_COMMANDS_COUNT);
+}
+
+//-------------------------------------------------------------------------------------------------
+// Public functions
+//-------------------------------------------------------------------------------------------------
+// The vendor interface is not part of this test, the shell polls it while waiting for characters
+void USBVendorProcessReceivedFrame(void) {}
+
+//-------------------------------------------------------------------------------------------------
+// Entry point
+//-------------------------------------------------------------------------------------------------
+int main(void)
+{
+	unsigned char i, Errors_Count = 0, Length;
+	const TShellCommand *Pointer_Command;
+	double Linear_Duration, Binary_Search_Duration;
+
+	// Both methods must find each command of the table, even when the token is followed by arguments
+	for (i = 0; i < SHELL_COMMANDS_COUNT; i++)
+	{
+		snprintf(Test_Shell_Find_Command_Lines[i], sizeof(Test_Shell_Find_Command_Lines[i]), "%s" TEST_SHELL_FIND_COMMAND_STRING_ARGUMENTS, Shell_Commands[i].Pointer_String_Command);
+		Pointer_Command = ShellFindCommand(Test_Shell_Find_Command_Lines[i], Shell_Commands[i].Command_Length);
+		if ((Pointer_Command != &Shell_Commands[i]) || (TestShellFindCommandLinearly(Test_Shell_Find_Command_Lines[i], Shell_Commands[i].Command_Length) != &Shell_Commands[i]))
+		{
+			printf("Error : the command \"%s\" has not been found.\n", Shell_Commands[i].Pointer_String_Command);
+			Errors_Count++;
+		}
+	}
+
+	// Both methods must reject the unknown tokens
+	for (i = 0; i < sizeof(Pointer_Test_Shell_Find_Command_Unknown_Strings) / sizeof(Pointer_Test_Shell_Find_Command_Unknown_Strings[0]); i++)
+	{
+		Length = (unsigned char) strlen(Pointer_Test_Shell_Find_Command_Unknown_Strings[i]);
+		if ((ShellFindCommand((char *) Pointer_Test_Shell_Find_Command_Unknown_Strings[i], Length) != NULL) || (TestShellFindCommandLinearly((char *) Pointer_Test_Shell_Find_Command_Unknown_Strings[i], Length) != NULL))
+		{
+			printf("Error : the unknown command \"%s\" has been found.\n", Pointer_Test_Shell_Find_Command_Unknown_Strings[i]);
+			Errors_Count++;
+		}
+	}
+	if (Errors_Count > 0)
+	{
+		printf("\033[31m%u lookup errors with %u commands.\033[0m\n", Errors_Count, SHELL_COMMANDS_COUNT);
+		return 1;
+	}
+
+	Linear_Duration = TestShellFindCommandMeasure(TestShellFindCommandLinearly);
+	Binary_Search_Duration = TestShellFindCommandMeasure(ShellFindCommand);
+	printf("%2u commands : linear walk %6.1f ns, binary search %5.1f ns per lookup (%.1fx faster).\n", SHELL_COMMANDS_COUNT, Linear_Duration, Binary_Search_Duration, Linear_Duration / Binary_Search_Duration);
+	return 0;
+}
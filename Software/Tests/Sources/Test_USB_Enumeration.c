@@ -0,0 +1,766 @@
+/** @file Test_USB_Enumeration.c
+ * Replay a Linux host enumeration of the two CDC ACM ports followed by bulk transfers against the simulated SIE, check every answer of the USB stack and display the interrupt handler work spent on each transaction.
+ * The vendor-specific interface is not part of the tested device, so only USB_Core.c and USB_Communications.c are needed.
+ * @author Adrien RICCIARDI
+ */
+#include <Mock_SIE.h>
+#include <stdio.h>
+#include <string.h>
+#include <USB_Communications.h>
+#include <USB_Core.h>
+
+//-------------------------------------------------------------------------------------------------
+// Private constants and macros
+//-------------------------------------------------------------------------------------------------
+/** How many bulk packets to send in each direction to measure the interrupt handler cost. */
+#define TEST_USB_ENUMERATION_BENCHMARK_PACKETS_COUNT 10000
+
+/** Generate the same CDC ACM function descriptors than the firmware.
+ * @param Control_Interface_ID The communications class interface number, the data class interface uses the following number.
+ * @param Notification_Endpoint_ID The notification IN endpoint number.
+ * @param Data_Out_Endpoint_ID The data OUT endpoint number.
+ * @param Data_In_Endpoint_ID The data IN endpoint number.
+ */
+#define TEST_USB_ENUMERATION_COMMUNICATIONS_DESCRIPTORS(Control_Interface_ID, Notification_Endpoint_ID, Data_Out_Endpoint_ID, Data_In_Endpoint_ID) \
+{ \
+	.Association = \
+	{ \
+		.bLength = sizeof(TUSBCoreDescriptorInterfaceAssociation), \
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION, \
+		.bFirstInterface = (Control_Interface_ID), \
+		.bInterfaceCount = 2, \
+		.bFunctionClass = USB_CORE_INTERFACE_CLASS_CODE_COMMUNICATIONS, \
+		.bFunctionSubClass = USB_CORE_INTERFACE_SUB_CLASS_CODE_ABSTRACT_CONTROL_MODEL, \
+		.bFunctionProtocol = USB_CORE_INTERFACE_PROTOCOL_CODE_ITU_V250, \
+		.iFunction = 0 \
+	}, \
+	.Control_Interface = \
+	{ \
+		.bLength = sizeof(TUSBCoreDescriptorInterface), \
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_INTERFACE, \
+		.bInterfaceNumber = (Control_Interface_ID), \
+		.bAlternateSetting = 0, \
+		.bNumEndpoints = 1, \
+		.bInterfaceClass = USB_CORE_INTERFACE_CLASS_CODE_COMMUNICATIONS, \
+		.bInterfaceSubClass = USB_CORE_INTERFACE_SUB_CLASS_CODE_ABSTRACT_CONTROL_MODEL, \
+		.bInterfaceProtocol = USB_CORE_INTERFACE_PROTOCOL_CODE_ITU_V250, \
+		.iInterface = 0 \
+	}, \
+	.Header = \
+	{ \
+		.bFunctionLength = sizeof(TUSBCommunicationsFunctionalDescriptorHeader), \
+		.bDescriptorType = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_TYPE_INTERFACE, \
+		.bDescriptorSubtype = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_SUB_TYPE_HEADER, \
+		.bcdCDC = USB_COMMUNICATIONS_SPECIFICATION_RELEASE_NUMBER \
+	}, \
+	.Management = \
+	{ \
+		.bFunctionLength = sizeof(TUSBCommunicationsFunctionalDescriptorAbstractControlManagement), \
+		.bDescriptorType = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_TYPE_INTERFACE, \
+		.bDescriptorSubtype = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_SUB_TYPE_ABSTRACT_CONTROL_MANAGEMENT, \
+		.bmCapabilities = 0 \
+	}, \
+	.Union = \
+	{ \
+		.bFunctionLength = sizeof(TUSBCommunicationsFunctionalDescriptorUnion), \
+		.bDescriptorType = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_TYPE_INTERFACE, \
+		.bDescriptorSubtype = USB_COMMUNICATIONS_FUNCTIONAL_DESCRIPTOR_SUB_TYPE_UNION, \
+		.bControlInterface = (Control_Interface_ID), \
+		.bSubordinateInterface0 = (Control_Interface_ID) + 1 \
+	}, \
+	.Notification_Endpoint = \
+	{ \
+		.bLength = sizeof(TUSBCoreDescriptorEndpoint), \
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_ENDPOINT, \
+		.bEndpointAddress = (Notification_Endpoint_ID) | USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_IN, \
+		.bmAttributes = USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_TRANSFER_TYPE_INTERRUPT, \
+		.wMaxPacketSize = USB_CORE_NOTIFICATION_PACKETS_SIZE, \
+		.bInterval = 1 \
+	}, \
+	.Data_Interface = \
+	{ \
+		.bLength = sizeof(TUSBCoreDescriptorInterface), \
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_INTERFACE, \
+		.bInterfaceNumber = (Control_Interface_ID) + 1, \
+		.bAlternateSetting = 0, \
+		.bNumEndpoints = 2, \
+		.bInterfaceClass = USB_CORE_INTERFACE_CLASS_CODE_DATA_INTERFACE, \
+		.bInterfaceSubClass = USB_CORE_INTERFACE_SUB_CLASS_CODE_NONE, \
+		.bInterfaceProtocol = USB_CORE_INTERFACE_PROTOCOL_CODE_NONE, \
+		.iInterface = 0 \
+	}, \
+	.Data_Out_Endpoint = \
+	{ \
+		.bLength = sizeof(TUSBCoreDescriptorEndpoint), \
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_ENDPOINT, \
+		.bEndpointAddress = (Data_Out_Endpoint_ID) | USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_OUT, \
+		.bmAttributes = USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_TRANSFER_TYPE_BULK, \
+		.wMaxPacketSize = USB_CORE_ENDPOINT_PACKETS_SIZE, \
+		.bInterval = 1 \
+	}, \
+	.Data_In_Endpoint = \
+	{ \
+		.bLength = sizeof(TUSBCoreDescriptorEndpoint), \
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_ENDPOINT, \
+		.bEndpointAddress = (Data_In_Endpoint_ID) | USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_ENDPOINT_ADDRESS_DIRECTION_IN, \
+		.bmAttributes = USB_CORE_DESCRIPTOR_ENDPOINT_ATTRIBUTE_TRANSFER_TYPE_BULK, \
+		.wMaxPacketSize = USB_CORE_ENDPOINT_PACKETS_SIZE, \
+		.bInterval = 1 \
+	} \
+}
+
+/** A bus reset.
+ * @param String_Description What the host is doing.
+ */
+#define TEST_USB_ENUMERATION_STEP_RESET(String_Description) { .Pointer_String_Description = String_Description, .Type = TEST_USB_ENUMERATION_STEP_TYPE_RESET }
+
+/** A Start-Of-Frame packet. */
+#define TEST_USB_ENUMERATION_STEP_START_OF_FRAME() { .Pointer_String_Description = "Start-Of-Frame", .Type = TEST_USB_ENUMERATION_STEP_TYPE_START_OF_FRAME }
+
+/** A SETUP transaction on the endpoint 0.
+ * @param String_Description What the host is doing.
+ * @param Device_Address The device address targeted by the host.
+ * @param Handshake The expected handshake.
+ * @param ... The 8 request bytes, as recorded on the bus.
+ */
+#define TEST_USB_ENUMERATION_STEP_SETUP_WITH_HANDSHAKE(String_Description, Device_Address, Handshake, ...) { .Pointer_String_Description = String_Description, .Type = TEST_USB_ENUMERATION_STEP_TYPE_SETUP, .Address = (Device_Address), .Pointer_Data = (const unsigned char []) { __VA_ARGS__ }, .Data_Size = sizeof(TUSBCoreDeviceRequest), .Expected_Handshake = (Handshake) }
+
+/** A SETUP transaction on the endpoint 0, which must be acknowledged.
+ * @param String_Description What the host is doing.
+ * @param Device_Address The device address targeted by the host.
+ * @param ... The 8 request bytes, as recorded on the bus.
+ */
+#define TEST_USB_ENUMERATION_STEP_SETUP(String_Description, Device_Address, ...) TEST_USB_ENUMERATION_STEP_SETUP_WITH_HANDSHAKE(String_Description, Device_Address, MOCK_SIE_HANDSHAKE_ACK, __VA_ARGS__)
+
+/** An OUT transaction.
+ * @param String_Description What the host is doing.
+ * @param Device_Address The device address targeted by the host.
+ * @param Endpoint The endpoint number.
+ * @param String_Data The packet data as a string literal, the terminating zero is not sent.
+ * @param Is_Data_1 Set to 1 to send a DATA1 packet, set to 0 to send a DATA0 packet.
+ * @param Handshake The expected handshake.
+ */
+#define TEST_USB_ENUMERATION_STEP_OUT(String_Description, Device_Address, Endpoint, String_Data, Is_Data_1, Handshake) { .Pointer_String_Description = String_Description, .Type = TEST_USB_ENUMERATION_STEP_TYPE_OUT, .Address = (Device_Address), .Endpoint_ID = (Endpoint), .Pointer_Data = (const unsigned char *) String_Data, .Data_Size = sizeof(String_Data) - 1, .Is_Data_1_Synchronization = (Is_Data_1), .Expected_Handshake = (Handshake) }
+
+/** An IN transaction.
+ * @param String_Description What the host is doing.
+ * @param Device_Address The device address targeted by the host.
+ * @param Endpoint The endpoint number.
+ * @param Pointer_Expected_Data The data the device must send. Can be NULL if the handshake is not an ACK.
+ * @param Expected_Data_Size The packet size the device must send.
+ * @param Is_Data_1 Set to 1 if the device must send a DATA1 packet, set to 0 for a DATA0 packet.
+ * @param Handshake The expected handshake.
+ */
+#define TEST_USB_ENUMERATION_STEP_IN(String_Description, Device_Address, Endpoint, Pointer_Expected_Data, Expected_Data_Size, Is_Data_1, Handshake) { .Pointer_String_Description = String_Description, .Type = TEST_USB_ENUMERATION_STEP_TYPE_IN, .Address = (Device_Address), .Endpoint_ID = (Endpoint), .Pointer_Data = (const unsigned char *) (Pointer_Expected_Data), .Data_Size = (Expected_Data_Size), .Is_Data_1_Synchronization = (Is_Data_1), .Expected_Handshake = (Handshake) }
+
+/** Run application code from the main context between two transactions.
+ * @param String_Description What the application is doing or checking.
+ * @param Function The function to call.
+ */
+#define TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT(String_Description, Function) { .Pointer_String_Description = String_Description, .Type = TEST_USB_ENUMERATION_STEP_TYPE_MAIN_CONTEXT, .Main_Context_Function = Function }
+
+/** The configuration blob seen as bytes, to check each packet of its data stage. */
+#define TEST_USB_ENUMERATION_CONFIGURATION_BYTES ((const unsigned char *) &Test_USB_Enumeration_Configuration_Descriptor)
+
+/** The device addresses assigned by the host to the successive sessions. */
+#define TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS 5
+#define TEST_USB_ENUMERATION_SECOND_SESSION_ADDRESS 7
+
+//-------------------------------------------------------------------------------------------------
+// Private types
+//-------------------------------------------------------------------------------------------------
+/** All the descriptors of a CDC ACM function. */
+typedef struct
+{
+	TUSBCoreDescriptorInterfaceAssociation Association;
+	TUSBCoreDescriptorInterface Control_Interface;
+	TUSBCommunicationsFunctionalDescriptorHeader Header;
+	TUSBCommunicationsFunctionalDescriptorAbstractControlManagement Management;
+	TUSBCommunicationsFunctionalDescriptorUnion Union;
+	TUSBCoreDescriptorEndpoint Notification_Endpoint;
+	TUSBCoreDescriptorInterface Data_Interface;
+	TUSBCoreDescriptorEndpoint Data_Out_Endpoint;
+	TUSBCoreDescriptorEndpoint Data_In_Endpoint;
+} __attribute__((packed)) TTestUSBEnumerationCommunicationsDescriptors;
+
+/** The whole configuration blob. */
+typedef struct
+{
+	TUSBCoreDescriptorConfiguration Configuration;
+	TTestUSBEnumerationCommunicationsDescriptors Shell;
+	TTestUSBEnumerationCommunicationsDescriptors Data;
+} __attribute__((packed)) TTestUSBEnumerationConfigurationDescriptor;
+
+/** The kind of event of a replayed step. */
+typedef enum : unsigned char
+{
+	TEST_USB_ENUMERATION_STEP_TYPE_RESET,
+	TEST_USB_ENUMERATION_STEP_TYPE_START_OF_FRAME,
+	TEST_USB_ENUMERATION_STEP_TYPE_SETUP,
+	TEST_USB_ENUMERATION_STEP_TYPE_OUT,
+	TEST_USB_ENUMERATION_STEP_TYPE_IN,
+	TEST_USB_ENUMERATION_STEP_TYPE_MAIN_CONTEXT
+} TTestUSBEnumerationStepType;
+
+/** A replayed bus event or an application action. */
+typedef struct
+{
+	const char *Pointer_String_Description; //!< Displayed with the step results.
+	TTestUSBEnumerationStepType Type;
+	unsigned char Address; //!< The device address targeted by the host.
+	unsigned char Endpoint_ID;
+	const unsigned char *Pointer_Data; //!< The SETUP or OUT data to send, or the IN data to expect (not checked if NULL).
+	unsigned char Data_Size; //!< The size of the data to send or to expect.
+	unsigned char Is_Data_1_Synchronization; //!< The synchronization value to send or to expect.
+	TMockSIEHandshake Expected_Handshake;
+	unsigned char (*Main_Context_Function)(void); //!< Return 0 on success.
+} TTestUSBEnumerationStep;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions declarations
+//-------------------------------------------------------------------------------------------------
+// The endpoint callbacks are wrapped to count the application work done by the interrupt handler
+static void TestUSBEnumerationHandleControlRequestCallback(TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data);
+static void TestUSBEnumerationHandleDataReceptionCallback(TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data);
+static void TestUSBEnumerationHandleDataTransmissionFlowControlCallback(unsigned char Endpoint_ID);
+static void TestUSBEnumerationHandleNotificationFlowControlCallback(unsigned char Endpoint_ID);
+static void TestUSBEnumerationHandleStartOfFrameCallback(void);
+static void TestUSBEnumerationHandleResetCallback(void);
+
+// The main context actions of the replayed sequence
+static unsigned char TestUSBEnumerationCheckDefaultState(void);
+static unsigned char TestUSBEnumerationCheckAddressedState(void);
+static unsigned char TestUSBEnumerationCheckConfiguredState(void);
+static unsigned char TestUSBEnumerationCheckShellPortClosed(void);
+static unsigned char TestUSBEnumerationCheckShellPortOpened(void);
+static unsigned char TestUSBEnumerationCheckReceivedCommand(void);
+static unsigned char TestUSBEnumerationCheckReceivedRetriedPacket(void);
+static unsigned char TestUSBEnumerationCheckReceivedNewSessionCommand(void);
+static unsigned char TestUSBEnumerationWriteGreeting(void);
+static unsigned char TestUSBEnumerationWriteLongString(void);
+static unsigned char TestUSBEnumerationCheckStatistics(void);
+
+//-------------------------------------------------------------------------------------------------
+// Private variables
+//-------------------------------------------------------------------------------------------------
+/** The device strings, they are not the firmware ones to keep the expected descriptors short. */
+static const unsigned short Test_USB_Enumeration_String_Data_0 = USB_CORE_LANGUAGE_ID_FRENCH_STANDARD;
+static const unsigned short Test_USB_Enumeration_String_Data_Product[] = { 'T', 'e', 's', 't' };
+static const TUSBCoreDescriptorString Test_USB_Enumeration_String_Descriptors[] =
+{
+	{
+		.bLength = USB_CORE_DESCRIPTOR_SIZE_STRING(sizeof(Test_USB_Enumeration_String_Data_0)),
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_STRING,
+		.Pointer_Data = &Test_USB_Enumeration_String_Data_0
+	},
+	{
+		.bLength = USB_CORE_DESCRIPTOR_SIZE_STRING(sizeof(Test_USB_Enumeration_String_Data_Product)),
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_STRING,
+		.Pointer_Data = &Test_USB_Enumeration_String_Data_Product
+	}
+};
+
+/** The two CDC ACM ports of the firmware, without the vendor-specific interface. */
+static const TTestUSBEnumerationConfigurationDescriptor Test_USB_Enumeration_Configuration_Descriptor =
+{
+	.Configuration =
+	{
+		.bLength = USB_CORE_DESCRIPTOR_SIZE_CONFIGURATION,
+		.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_CONFIGURATION,
+		.wTotalLength = sizeof(TTestUSBEnumerationConfigurationDescriptor),
+		.bNumInterfaces = 4,
+		.bConfigurationValue = 1,
+		.iConfiguration = 0,
+		.bmAttributes = 0,
+		.bMaxPower = 250
+	},
+	.Shell = TEST_USB_ENUMERATION_COMMUNICATIONS_DESCRIPTORS(0, 1, 2, 3),
+	.Data = TEST_USB_ENUMERATION_COMMUNICATIONS_DESCRIPTORS(2, 5, 6, 6)
+};
+
+/** The device unique configuration. */
+static const TUSBCoreDescriptorConfiguration * const Test_USB_Enumeration_Configurations[] =
+{
+	&Test_USB_Enumeration_Configuration_Descriptor.Configuration
+};
+
+/** Use the same hardware endpoints than the firmware, the vendor-specific interface endpoint is left disabled. */
+static TUSBCoreHardwareEndpointConfiguration Test_USB_Enumeration_Hardware_Endpoints_Configuration[] =
+{
+	// Control endpoint
+	{
+		.Enabled_Directions = USB_CORE_HARDWARE_ENDPOINT_DIRECTION_OUT | USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN,
+		.Out_Transfer_Callback = TestUSBEnumerationHandleControlRequestCallback,
+		.In_Transfer_Callback = NULL
+	},
+	// Shell CDC ACM notification
+	{
+		.Enabled_Directions = USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN | USB_CORE_HARDWARE_ENDPOINT_NOTIFICATION_BUFFER,
+		.Out_Transfer_Callback = NULL,
+		.In_Transfer_Callback = TestUSBEnumerationHandleNotificationFlowControlCallback
+	},
+	// Shell CDC ACM data OUT
+	{
+		.Enabled_Directions = USB_CORE_HARDWARE_ENDPOINT_DIRECTION_OUT,
+		.Out_Transfer_Callback = TestUSBEnumerationHandleDataReceptionCallback,
+		.In_Transfer_Callback = NULL
+	},
+	// Shell CDC ACM data IN
+	{
+		.Enabled_Directions = USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN,
+		.Out_Transfer_Callback = NULL,
+		.In_Transfer_Callback = TestUSBEnumerationHandleDataTransmissionFlowControlCallback
+	},
+	// Unused vendor-specific interface
+	{
+		.Enabled_Directions = 0,
+		.Out_Transfer_Callback = NULL,
+		.In_Transfer_Callback = NULL
+	},
+	// Data CDC ACM notification
+	{
+		.Enabled_Directions = USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN | USB_CORE_HARDWARE_ENDPOINT_WITHOUT_DATA_BUFFERS,
+		.Out_Transfer_Callback = NULL,
+		.In_Transfer_Callback = NULL
+	},
+	// Data CDC ACM data OUT and IN
+	{
+		.Enabled_Directions = USB_CORE_HARDWARE_ENDPOINT_DIRECTION_OUT | USB_CORE_HARDWARE_ENDPOINT_DIRECTION_IN,
+		.Out_Transfer_Callback = TestUSBEnumerationHandleDataReceptionCallback,
+		.In_Transfer_Callback = TestUSBEnumerationHandleDataTransmissionFlowControlCallback
+	}
+};
+
+/** The tested device descriptor. */
+static const TUSBCoreDescriptorDevice Test_USB_Enumeration_Device_Descriptor =
+{
+	.bLength = USB_CORE_DESCRIPTOR_SIZE_DEVICE,
+	.bDescriptorType = USB_CORE_DESCRIPTOR_TYPE_DEVICE,
+	.bcdUSB = USB_CORE_BCD_USB_SPECIFICATION_RELEASE_NUMBER,
+	.bDeviceClass = USB_CORE_DEVICE_CLASS_CODE_MISCELLANEOUS,
+	.bDeviceSubClass = USB_CORE_DEVICE_SUB_CLASS_CODE_COMMON_CLASS,
+	.bDeviceProtocol = USB_CORE_DEVICE_PROTOCOL_CODE_INTERFACE_ASSOCIATION_DESCRIPTOR,
+	.bMaxPacketSize0 = USB_CORE_ENDPOINT_PACKETS_SIZE,
+	.idVendor = 0x1240,
+	.idProduct = 0xFADA,
+	.bcdDevice = 0x0001,
+	.iManufacturer = 0,
+	.iProduct = 1,
+	.iSerialNumber = 0,
+	.bNumConfigurations = USB_CORE_ARRAY_SIZE(Test_USB_Enumeration_Configurations),
+	.Pointer_Configurations = Test_USB_Enumeration_Configurations,
+	.Pointer_Strings = Test_USB_Enumeration_String_Descriptors,
+	.String_Descriptors_Count = USB_CORE_ARRAY_SIZE(Test_USB_Enumeration_String_Descriptors),
+	.Pointer_Hardware_Endpoints_Configuration = Test_USB_Enumeration_Hardware_Endpoints_Configuration,
+	.Hardware_Endpoints_Count = USB_CORE_ARRAY_SIZE(Test_USB_Enumeration_Hardware_Endpoints_Configuration),
+	.Start_Of_Frame_Callback = TestUSBEnumerationHandleStartOfFrameCallback,
+	.Vendor_Request_Callback = NULL,
+	.Class_Descriptor_Callback = NULL,
+	.Class_Request_Callback = NULL,
+	.Reset_Callback = TestUSBEnumerationHandleResetCallback
+};
+
+/** The transactions recorded while a Linux host enumerates the device, then opens the shell port with a terminal and exchanges some text. */
+static const TTestUSBEnumerationStep Test_USB_Enumeration_Steps[] =
+{
+	// Default address
+	TEST_USB_ENUMERATION_STEP_RESET("Reset"),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Check the default state", TestUSBEnumerationCheckDefaultState),
+	TEST_USB_ENUMERATION_STEP_SETUP("GET_DESCRIPTOR device (64 bytes)", 0, 0x80, 0x06, 0x00, 0x01, 0x00, 0x00, 0x40, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Data stage", 0, 0, &Test_USB_Enumeration_Device_Descriptor, USB_CORE_DESCRIPTOR_SIZE_DEVICE, 1, MOCK_SIE_HANDSHAKE_ACK),
+	// The firmware has already armed the endpoint 0 for the next SETUP (DATA0), so the SIE acknowledges and drops the status stage packets (DATA1) without interrupting the firmware
+	TEST_USB_ENUMERATION_STEP_OUT("  Status stage", 0, 0, "", 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_RESET("Reset"),
+	TEST_USB_ENUMERATION_STEP_SETUP("SET_ADDRESS", 0, 0x00, 0x05, TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0x00, 0x00, 0x00, 0x00, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Status stage", 0, 0, NULL, 0, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Check the addressed state", TestUSBEnumerationCheckAddressedState),
+	TEST_USB_ENUMERATION_STEP_SETUP_WITH_HANDSHAKE("Old address is ignored", 0, MOCK_SIE_HANDSHAKE_NONE, 0x80, 0x06, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00),
+	TEST_USB_ENUMERATION_STEP_SETUP("GET_DESCRIPTOR device", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0x80, 0x06, 0x00, 0x01, 0x00, 0x00, 0x12, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Data stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, &Test_USB_Enumeration_Device_Descriptor, USB_CORE_DESCRIPTOR_SIZE_DEVICE, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_OUT("  Status stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, "", 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_SETUP("GET_DESCRIPTOR device qualifier", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0x80, 0x06, 0x00, 0x06, 0x00, 0x00, 0x0A, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Data stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, NULL, 0, 0, MOCK_SIE_HANDSHAKE_STALL),
+	TEST_USB_ENUMERATION_STEP_SETUP("GET_DESCRIPTOR configuration (9 bytes)", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0x80, 0x06, 0x00, 0x02, 0x00, 0x00, 0x09, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Data stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, &Test_USB_Enumeration_Configuration_Descriptor, USB_CORE_DESCRIPTOR_SIZE_CONFIGURATION, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_OUT("  Status stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, "", 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_SETUP("GET_DESCRIPTOR configuration (whole)", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0x80, 0x06, 0x00, 0x02, 0x00, 0x00, sizeof(TTestUSBEnumerationConfigurationDescriptor), 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Data stage, first packet", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, TEST_USB_ENUMERATION_CONFIGURATION_BYTES, USB_CORE_ENDPOINT_PACKETS_SIZE, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_IN("  Data stage, second packet", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, TEST_USB_ENUMERATION_CONFIGURATION_BYTES + USB_CORE_ENDPOINT_PACKETS_SIZE, USB_CORE_ENDPOINT_PACKETS_SIZE, 0, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_IN("  Data stage, last packet", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, TEST_USB_ENUMERATION_CONFIGURATION_BYTES + (2 * USB_CORE_ENDPOINT_PACKETS_SIZE), sizeof(TTestUSBEnumerationConfigurationDescriptor) - (2 * USB_CORE_ENDPOINT_PACKETS_SIZE), 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_OUT("  Status stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, "", 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_SETUP("GET_DESCRIPTOR string 0", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0x80, 0x06, 0x00, 0x03, 0x00, 0x00, 0xFF, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Data stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, "\x04\x03\x0C\x04", 4, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_OUT("  Status stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, "", 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_SETUP("GET_DESCRIPTOR string 1", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0x80, 0x06, 0x01, 0x03, 0x0C, 0x04, 0xFF, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Data stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, "\x0A\x03T\0e\0s\0t\0", 10, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_OUT("  Status stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, "", 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_SETUP("SET_CONFIGURATION", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0x00, 0x09, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Status stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, NULL, 0, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Check the configured state", TestUSBEnumerationCheckConfiguredState),
+
+	// The cdc_acm driver probes the ports
+	TEST_USB_ENUMERATION_STEP_SETUP("SET_CONTROL_LINE_STATE (none)", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0x21, 0x22, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Status stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, NULL, 0, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_SETUP("SET_LINE_CODING", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0x21, 0x20, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00),
+	TEST_USB_ENUMERATION_STEP_OUT("  Data stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, "\x80\x25\x00\x00\x00\x00\x08", 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_IN("  Status stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, NULL, 0, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Check that the shell port is closed", TestUSBEnumerationCheckShellPortClosed),
+
+	// A terminal opens the shell port
+	TEST_USB_ENUMERATION_STEP_SETUP("GET_LINE_CODING", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0xA1, 0x21, 0x00, 0x00, 0x00, 0x00, 0x07, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Data stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, NULL, 0, 0, MOCK_SIE_HANDSHAKE_STALL),
+	TEST_USB_ENUMERATION_STEP_SETUP("SET_CONTROL_LINE_STATE (DTR, RTS)", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0x21, 0x22, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Status stage", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 0, NULL, 0, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Check that only the shell port is opened", TestUSBEnumerationCheckShellPortOpened),
+
+	// Bulk transfers
+	TEST_USB_ENUMERATION_STEP_OUT("Send a command", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 2, "help\r", 0, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Read the command", TestUSBEnumerationCheckReceivedCommand),
+	TEST_USB_ENUMERATION_STEP_OUT("Send a character", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 2, "x", 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_OUT("Retry the character (lost ACK)", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 2, "x", 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Read the character only once", TestUSBEnumerationCheckReceivedRetriedPacket),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Write a short string", TestUSBEnumerationWriteGreeting),
+	TEST_USB_ENUMERATION_STEP_IN("Poll the shell port", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 3, NULL, 0, 0, MOCK_SIE_HANDSHAKE_NAK),
+	TEST_USB_ENUMERATION_STEP_START_OF_FRAME(),
+	TEST_USB_ENUMERATION_STEP_IN("Poll the shell port", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 3, "Hello\r\n", 7, 0, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_IN("Poll the shell port", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 3, NULL, 0, 0, MOCK_SIE_HANDSHAKE_NAK),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Write a string longer than a packet", TestUSBEnumerationWriteLongString),
+	TEST_USB_ENUMERATION_STEP_IN("Poll the shell port", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 3, "0123456789012345678901234567890123456789012345678901234567890123", 64, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_START_OF_FRAME(),
+	TEST_USB_ENUMERATION_STEP_IN("Poll the shell port", TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS, 3, "456789", 6, 0, MOCK_SIE_HANDSHAKE_ACK),
+
+	// The host resets the device in the middle of the session
+	TEST_USB_ENUMERATION_STEP_RESET("Reset"),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Check the default state", TestUSBEnumerationCheckDefaultState),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Check that the shell port is closed", TestUSBEnumerationCheckShellPortClosed),
+	TEST_USB_ENUMERATION_STEP_SETUP("SET_ADDRESS", 0, 0x00, 0x05, TEST_USB_ENUMERATION_SECOND_SESSION_ADDRESS, 0x00, 0x00, 0x00, 0x00, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Status stage", 0, 0, NULL, 0, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_SETUP("SET_CONFIGURATION", TEST_USB_ENUMERATION_SECOND_SESSION_ADDRESS, 0x00, 0x09, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Status stage", TEST_USB_ENUMERATION_SECOND_SESSION_ADDRESS, 0, NULL, 0, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_SETUP("SET_CONTROL_LINE_STATE (DTR, RTS)", TEST_USB_ENUMERATION_SECOND_SESSION_ADDRESS, 0x21, 0x22, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00),
+	TEST_USB_ENUMERATION_STEP_IN("  Status stage", TEST_USB_ENUMERATION_SECOND_SESSION_ADDRESS, 0, NULL, 0, 1, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Check that only the shell port is opened", TestUSBEnumerationCheckShellPortOpened),
+	TEST_USB_ENUMERATION_STEP_OUT("Send a command from DATA0 again", TEST_USB_ENUMERATION_SECOND_SESSION_ADDRESS, 2, "i2c\r", 0, MOCK_SIE_HANDSHAKE_ACK),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Read the command", TestUSBEnumerationCheckReceivedNewSessionCommand),
+	TEST_USB_ENUMERATION_STEP_MAIN_CONTEXT("Check the USB core statistics", TestUSBEnumerationCheckStatistics)
+};
+
+/** The names of the handshakes. */
+static const char *Pointer_Test_USB_Enumeration_Handshake_Strings[] = { "ACK", "NAK", "STALL", "none" };
+
+/** Count the endpoint callbacks called by the interrupt handler. */
+static unsigned long Test_USB_Enumeration_Callbacks_Count = 0;
+
+/** Count the Start-Of-Frame packets sent by the host. */
+static unsigned long Test_USB_Enumeration_Start_Of_Frames_Count = 0;
+
+//-------------------------------------------------------------------------------------------------
+// Private functions
+//-------------------------------------------------------------------------------------------------
+static void TestUSBEnumerationHandleControlRequestCallback(TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data)
+{
+	Test_USB_Enumeration_Callbacks_Count++;
+	USBCommunicationsHandleControlRequestCallback(Pointer_Transfer_Callback_Data);
+}
+
+static void TestUSBEnumerationHandleDataReceptionCallback(TUSBCoreHardwareEndpointOutTransferCallbackData *Pointer_Transfer_Callback_Data)
+{
+	Test_USB_Enumeration_Callbacks_Count++;
+	USBCommunicationsHandleDataReceptionCallback(Pointer_Transfer_Callback_Data);
+}
+
+static void TestUSBEnumerationHandleDataTransmissionFlowControlCallback(unsigned char Endpoint_ID)
+{
+	Test_USB_Enumeration_Callbacks_Count++;
+	USBCommunicationsHandleDataTransmissionFlowControlCallback(Endpoint_ID);
+}
+
+static void TestUSBEnumerationHandleNotificationFlowControlCallback(unsigned char Endpoint_ID)
+{
+	Test_USB_Enumeration_Callbacks_Count++;
+	USBCommunicationsHandleNotificationFlowControlCallback(Endpoint_ID);
+}
+
+static void TestUSBEnumerationHandleStartOfFrameCallback(void)
+{
+	Test_USB_Enumeration_Callbacks_Count++;
+	USBCommunicationsHandleStartOfFrameCallback();
+}
+
+static void TestUSBEnumerationHandleResetCallback(void)
+{
+	Test_USB_Enumeration_Callbacks_Count++;
+	USBCommunicationsHandleResetCallback();
+}
+
+/** Read all characters received by a port and compare them to the expected ones.
+ * @param Port_ID The port to read from.
+ * @param Pointer_String_Expected The expected characters.
+ * @return 0 if the received characters match,
+ * @return 1 if they do not match.
+ */
+static unsigned char TestUSBEnumerationCheckReceivedString(TUSBCommunicationsPortID Port_ID, const char *Pointer_String_Expected)
+{
+	char String_Received[USB_CORE_ENDPOINT_PACKETS_SIZE + 1];
+	unsigned char Length = 0;
+
+	while (USBCommunicationsIsCharacterAvailable(Port_ID) && (Length < sizeof(String_Received) - 1))
+	{
+		String_Received[Length] = USBCommunicationsReadCharacter(Port_ID);
+		Length++;
+	}
+	String_Received[Length] = 0;
+
+	if (strcmp(String_Received, Pointer_String_Expected) != 0)
+	{
+		printf("Error : received \"%s\" instead of \"%s\".\n", String_Received, Pointer_String_Expected);
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned char TestUSBEnumerationCheckDefaultState(void)
+{
+	if ((USBCoreGetDeviceState() != USB_CORE_DEVICE_STATE_DEFAULT) || (UADDR != 0))
+	{
+		printf("Error : the device state is %u and the address is %u.\n", USBCoreGetDeviceState(), UADDR);
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned char TestUSBEnumerationCheckAddressedState(void)
+{
+	if ((USBCoreGetDeviceState() != USB_CORE_DEVICE_STATE_ADDRESSED) || (UADDR != TEST_USB_ENUMERATION_FIRST_SESSION_ADDRESS))
+	{
+		printf("Error : the device state is %u and the address is %u.\n", USBCoreGetDeviceState(), UADDR);
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned char TestUSBEnumerationCheckConfiguredState(void)
+{
+	if (USBCoreGetDeviceState() != USB_CORE_DEVICE_STATE_CONFIGURED)
+	{
+		printf("Error : the device state is %u.\n", USBCoreGetDeviceState());
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned char TestUSBEnumerationCheckShellPortClosed(void)
+{
+	if (USBCommunicationsIsCommunicationEstablished(USB_COMMUNICATIONS_PORT_ID_SHELL))
+	{
+		printf("Error : the shell port is opened.\n");
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned char TestUSBEnumerationCheckShellPortOpened(void)
+{
+	if (!USBCommunicationsIsCommunicationEstablished(USB_COMMUNICATIONS_PORT_ID_SHELL) || USBCommunicationsIsCommunicationEstablished(USB_COMMUNICATIONS_PORT_ID_DATA))
+	{
+		printf("Error : the shell port is %s and the data port is %s.\n", USBCommunicationsIsCommunicationEstablished(USB_COMMUNICATIONS_PORT_ID_SHELL) ? "opened" : "closed", USBCommunicationsIsCommunicationEstablished(USB_COMMUNICATIONS_PORT_ID_DATA) ? "opened" : "closed");
+		return 1;
+	}
+	return 0;
+}
+
+static unsigned char TestUSBEnumerationCheckReceivedCommand(void)
+{
+	return TestUSBEnumerationCheckReceivedString(USB_COMMUNICATIONS_PORT_ID_SHELL, "help\r");
+}
+
+static unsigned char TestUSBEnumerationCheckReceivedRetriedPacket(void)
+{
+	return TestUSBEnumerationCheckReceivedString(USB_COMMUNICATIONS_PORT_ID_SHELL, "x");
+}
+
+static unsigned char TestUSBEnumerationCheckReceivedNewSessionCommand(void)
+{
+	return TestUSBEnumerationCheckReceivedString(USB_COMMUNICATIONS_PORT_ID_SHELL, "i2c\r");
+}
+
+static unsigned char TestUSBEnumerationWriteGreeting(void)
+{
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "Hello\r\n");
+	return 0;
+}
+
+static unsigned char TestUSBEnumerationWriteLongString(void)
+{
+	// A full packet is sent right away, the remaining bytes wait for the next Start-Of-Frame
+	USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, "0123456789012345678901234567890123456789012345678901234567890123456789");
+	return 0;
+}
+
+static unsigned char TestUSBEnumerationCheckStatistics(void)
+{
+	TUSBCoreStatistics Statistics;
+
+	USBCoreGetStatistics(&Statistics, 0);
+	if ((Statistics.Resets_Count != 3) || (Statistics.Stalls_Count != 2) || (USBCoreGetMillisecondsCount() != Test_USB_Enumeration_Start_Of_Frames_Count))
+	{
+		printf("Error : %u resets, %u stalls and %lu milliseconds have been counted instead of 3 resets, 2 stalls and %lu milliseconds.\n", Statistics.Resets_Count, Statistics.Stalls_Count, USBCoreGetMillisecondsCount(), Test_USB_Enumeration_Start_Of_Frames_Count);
+		return 1;
+	}
+	return 0;
+}
+
+/** Replay a step and check the device answer.
+ * @param Pointer_Step The step to replay.
+ * @return 0 if the device answered as expected,
+ * @return 1 if the device answer is wrong.
+ */
+static unsigned char TestUSBEnumerationReplayStep(const TTestUSBEnumerationStep *Pointer_Step)
+{
+	unsigned char Data[USB_CORE_ENDPOINT_PACKETS_SIZE], Data_Size = 0, Is_Data_1_Synchronization = 0;
+	TMockSIEHandshake Handshake;
+
+	switch (Pointer_Step->Type)
+	{
+		case TEST_USB_ENUMERATION_STEP_TYPE_RESET:
+			MockSIEResetBus();
+			return 0;
+
+		case TEST_USB_ENUMERATION_STEP_TYPE_START_OF_FRAME:
+			MockSIESendStartOfFrame();
+			Test_USB_Enumeration_Start_Of_Frames_Count++;
+			return 0;
+
+		case TEST_USB_ENUMERATION_STEP_TYPE_MAIN_CONTEXT:
+			return Pointer_Step->Main_Context_Function();
+
+		case TEST_USB_ENUMERATION_STEP_TYPE_SETUP:
+			Handshake = MockSIESendSetup(Pointer_Step->Address, Pointer_Step->Endpoint_ID, Pointer_Step->Pointer_Data);
+			break;
+
+		case TEST_USB_ENUMERATION_STEP_TYPE_OUT:
+			Handshake = MockSIESendOut(Pointer_Step->Address, Pointer_Step->Endpoint_ID, Pointer_Step->Pointer_Data, Pointer_Step->Data_Size, Pointer_Step->Is_Data_1_Synchronization);
+			break;
+
+		case TEST_USB_ENUMERATION_STEP_TYPE_IN:
+			Handshake = MockSIEReceiveIn(Pointer_Step->Address, Pointer_Step->Endpoint_ID, Data, &Data_Size, &Is_Data_1_Synchronization);
+			break;
+
+		default:
+			printf("Error : unknown step type %u.\n", Pointer_Step->Type);
+			return 1;
+	}
+
+	if (Handshake != Pointer_Step->Expected_Handshake)
+	{
+		printf("Error : the device answered %s instead of %s.\n", Pointer_Test_USB_Enumeration_Handshake_Strings[Handshake], Pointer_Test_USB_Enumeration_Handshake_Strings[Pointer_Step->Expected_Handshake]);
+		return 1;
+	}
+
+	// Check the sent data
+	if ((Pointer_Step->Type == TEST_USB_ENUMERATION_STEP_TYPE_IN) && (Handshake == MOCK_SIE_HANDSHAKE_ACK))
+	{
+		if ((Data_Size != Pointer_Step->Data_Size) || (Is_Data_1_Synchronization != Pointer_Step->Is_Data_1_Synchronization))
+		{
+			printf("Error : the device sent %u bytes with DATA%u instead of %u bytes with DATA%u.\n", Data_Size, Is_Data_1_Synchronization, Pointer_Step->Data_Size, Pointer_Step->Is_Data_1_Synchronization);
+			return 1;
+		}
+		if ((Pointer_Step->Pointer_Data != NULL) && (memcmp(Data, Pointer_Step->Pointer_Data, Data_Size) != 0))
+		{
+			printf("Error : the device sent unexpected data.\n");
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/** Measure the interrupt handler cost of the bulk transfers of the shell port.
+ * @return 0 if all packets have been transferred,
+ * @return 1 if a transfer failed.
+ */
+static unsigned char TestUSBEnumerationBenchmarkBulkTransfers(void)
+{
+	char String_Packet[USB_CORE_ENDPOINT_PACKETS_SIZE + 1];
+	unsigned char Data[USB_CORE_ENDPOINT_PACKETS_SIZE], Data_Size, Is_Data_1_Synchronization, Is_Out_Data_1_Synchronization = 1, Is_In_Data_1_Synchronization = 0, i;
+	unsigned long Packets_Count;
+	TMockSIEStatistics Statistics;
+
+	// The replayed sequence has already sent a DATA0 packet to the data OUT endpoint, and has not used its data IN endpoint since the bus reset
+	memset(String_Packet, 'a', USB_CORE_ENDPOINT_PACKETS_SIZE);
+	String_Packet[USB_CORE_ENDPOINT_PACKETS_SIZE] = 0;
+	MockSIEGetStatistics(&Statistics, 1);
+	Test_USB_Enumeration_Callbacks_Count = 0;
+
+	// Host to device
+	for (Packets_Count = 0; Packets_Count < TEST_USB_ENUMERATION_BENCHMARK_PACKETS_COUNT; Packets_Count++)
+	{
+		if (MockSIESendOut(TEST_USB_ENUMERATION_SECOND_SESSION_ADDRESS, 2, String_Packet, USB_CORE_ENDPOINT_PACKETS_SIZE, Is_Out_Data_1_Synchronization) != MOCK_SIE_HANDSHAKE_ACK)
+		{
+			printf("Error : the OUT packet %lu has not been acknowledged.\n", Packets_Count);
+			return 1;
+		}
+		Is_Out_Data_1_Synchronization ^= 1;
+		for (i = 0; i < USB_CORE_ENDPOINT_PACKETS_SIZE; i++) USBCommunicationsReadCharacter(USB_COMMUNICATIONS_PORT_ID_SHELL);
+	}
+	MockSIEGetStatistics(&Statistics, 1);
+	printf("%lu full OUT packets : %.2f handler calls, %.2f callbacks and %.0f ns per packet.\n", Packets_Count, (double) Statistics.Interrupt_Handler_Calls_Count / Packets_Count, (double) Test_USB_Enumeration_Callbacks_Count / Packets_Count, (double) Statistics.Interrupt_Handler_Duration / Packets_Count);
+	Test_USB_Enumeration_Callbacks_Count = 0;
+
+	// Device to host, a full packet is given to the SIE as soon as it is written
+	for (Packets_Count = 0; Packets_Count < TEST_USB_ENUMERATION_BENCHMARK_PACKETS_COUNT; Packets_Count++)
+	{
+		USBCommunicationsWriteString(USB_COMMUNICATIONS_PORT_ID_SHELL, String_Packet);
+		if ((MockSIEReceiveIn(TEST_USB_ENUMERATION_SECOND_SESSION_ADDRESS, 3, Data, &Data_Size, &Is_Data_1_Synchronization) != MOCK_SIE_HANDSHAKE_ACK) || (Data_Size != USB_CORE_ENDPOINT_PACKETS_SIZE) || (Is_Data_1_Synchronization != Is_In_Data_1_Synchronization))
+		{
+			printf("Error : the IN packet %lu has not been received.\n", Packets_Count);
+			return 1;
+		}
+		Is_In_Data_1_Synchronization ^= 1;
+	}
+	MockSIEGetStatistics(&Statistics, 1);
+	printf("%lu full IN packets : %.2f handler calls, %.2f callbacks and %.0f ns per packet.\n", Packets_Count, (double) Statistics.Interrupt_Handler_Calls_Count / Packets_Count, (double) Test_USB_Enumeration_Callbacks_Count / Packets_Count, (double) Statistics.Interrupt_Handler_Duration / Packets_Count);
+	return 0;
+}
+
+//-------------------------------------------------------------------------------------------------
+// Entry point
+//-------------------------------------------------------------------------------------------------
+int main(void)
+{
+	unsigned int i, Failed_Steps_Count = 0;
+	unsigned char Result;
+	const TTestUSBEnumerationStep *Pointer_Step;
+	TMockSIEStatistics Statistics;
+
+	// Boot the USB stack like the firmware does
+	MockSIEInitialize();
+	USBCoreInitialize(&Test_USB_Enumeration_Device_Descriptor);
+	USBCommunicationsInitialize(USB_COMMUNICATIONS_PORT_ID_SHELL, 0, 1, 2, 3);
+	USBCommunicationsInitialize(USB_COMMUNICATIONS_PORT_ID_DATA, 2, 0, 6, 6);
+
+	// Replay the recorded sequence, display the interrupt handler work of each step
+	printf("%-45s %-6s %-8s %-9s %s\n", "Step", "Result", "Handlers", "Callbacks", "Handler time");
+	for (i = 0; i < USB_CORE_ARRAY_SIZE(Test_USB_Enumeration_Steps); i++)
+	{
+		Pointer_Step = &Test_USB_Enumeration_Steps[i];
+		Test_USB_Enumeration_Callbacks_Count = 0;
+
+		Result = TestUSBEnumerationReplayStep(Pointer_Step);
+		if (Result != 0) Failed_Steps_Count++;
+
+		MockSIEGetStatistics(&Statistics, 1);
+		printf("%-45s %-6s %8lu %9lu %9llu ns\n", Pointer_Step->Pointer_String_Description, Result ? "\033[31mFAIL\033[0m" : "OK", Statistics.Interrupt_Handler_Calls_Count, Test_USB_Enumeration_Callbacks_Count, Statistics.Interrupt_Handler_Duration);
+	}
+
+	// Measure the handler cost on a configured device
+	if (TestUSBEnumerationBenchmarkBulkTransfers() != 0) Failed_Steps_Count++;
+
+	// The SIE errors are displayed when they are detected
+	if ((Failed_Steps_Count > 0) || (MockSIEGetErrorsCount() > 0))
+	{
+		printf("\033[31m%u failed steps, %u SIE errors.\033[0m\n", Failed_Steps_Count, MockSIEGetErrorsCount());
+		return 1;
+	}
+	printf("\033[32mAll %u steps passed.\033[0m\n", (unsigned int) USB_CORE_ARRAY_SIZE(Test_USB_Enumeration_Steps));
+	return 0;
+}